@@ -11,6 +11,6 @@ public class PeopleCounterUDP : ModuleRules
             "Sockets", "Networking", "Json", "JsonUtilities"
         });
 
-        PrivateDependencyModuleNames.AddRange(new string[] { });
+        PrivateDependencyModuleNames.AddRange(new string[] { "RHI" });
     }
 }
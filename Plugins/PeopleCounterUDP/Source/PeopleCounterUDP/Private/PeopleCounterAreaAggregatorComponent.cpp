@@ -0,0 +1,593 @@
+#include "PeopleCounterAreaAggregatorComponent.h"
+#include "UDPJsonReceiverComponent.h"
+#include "GameFramework/Actor.h"
+#include "Misc/App.h"
+#include "Algo/Sort.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterAreas, Log, All);
+
+namespace
+{
+    // Counts e detections della stessa cattura arrivano a pochi microsecondi: un solo pacchetto
+    constexpr double SameCaptureSeconds = 1e-3;
+
+    // Trasforma coppie (chiave, valore) in CSR: Start ha NumKeys+1 elementi
+    void BuildCsr(int32 NumKeys, TConstArrayView<int32> Keys, TArray<int32>& OutStart, TArray<int32>& OutOrder)
+    {
+        OutStart.Init(0, NumKeys + 1);
+        for (int32 Key : Keys)
+        {
+            ++OutStart[Key + 1];
+        }
+        for (int32 i = 0; i < NumKeys; ++i)
+        {
+            OutStart[i + 1] += OutStart[i];
+        }
+        TArray<int32> Cursor(OutStart.GetData(), NumKeys);
+        OutOrder.SetNumUninitialized(Keys.Num());
+        for (int32 i = 0; i < Keys.Num(); ++i)
+        {
+            OutOrder[Cursor[Keys[i]]++] = i;
+        }
+    }
+}
+
+UPeopleCounterAreaAggregatorComponent::UPeopleCounterAreaAggregatorComponent()
+{
+    PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UPeopleCounterAreaAggregatorComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    if (!Receiver && GetOwner())
+    {
+        Receiver = GetOwner()->FindComponentByClass<UUDPJsonReceiverComponent>();
+    }
+    if (!Receiver)
+    {
+        UE_LOG(LogPeopleCounterAreas, Warning, TEXT("%s: no UDPJsonReceiverComponent to aggregate from"), *GetName());
+        return;
+    }
+
+    PacketHandle = Receiver->OnPeopleCountReceivedNative.AddUObject(this, &UPeopleCounterAreaAggregatorComponent::HandlePacket);
+    ReceiverStartedHandle = Receiver->OnReceiverStartedNative.AddUObject(this, &UPeopleCounterAreaAggregatorComponent::HandleReceiverStarted);
+    RebuildFromTable();
+}
+
+void UPeopleCounterAreaAggregatorComponent::HandleReceiverStarted()
+{
+    if (bWaitingForRegistry)
+    {
+        RebuildFromTable();
+    }
+}
+
+void UPeopleCounterAreaAggregatorComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (Receiver)
+    {
+        Receiver->OnPeopleCountReceivedNative.Remove(PacketHandle);
+        Receiver->OnReceiverStartedNative.Remove(ReceiverStartedHandle);
+    }
+    PacketHandle.Reset();
+    ReceiverStartedHandle.Reset();
+    Super::EndPlay(EndPlayReason);
+}
+
+void UPeopleCounterAreaAggregatorComponent::RebuildFromTable()
+{
+    // I conteggi esterni non vengono dal DataTable: passano alla nuova compilazione per nome
+    TMap<FName, float> PreviousExternalCounts;
+    for (int32 AreaIndex = 0; AreaIndex < FMath::Min(AreaNames.Num(), ExternalCounts.Num()); ++AreaIndex)
+    {
+        if (ExternalCounts[AreaIndex] != 0.f)
+        {
+            PreviousExternalCounts.Add(AreaNames[AreaIndex], ExternalCounts[AreaIndex]);
+        }
+    }
+
+    AreaNames.Reset();
+    AreaIndexByName.Reset();
+    AreaCounts.Reset();
+    RawAreaCounts.Reset();
+    AreaCombine.Reset();
+    SensorEdgeStart.Reset();
+    SensorEdgeArea.Reset();
+    AreaMemberStart.Reset();
+    AreaMemberSlot.Reset();
+    AreaMemberWeight.Reset();
+    SensorCounts.Reset();
+    ExternalCounts.Reset();
+    DirtyAreas.Reset();
+    AreaFromCounts.Reset();
+    AreaFromSeconds.Reset();
+    AreaToSeconds.Reset();
+    LastPacketSeconds = 0.0;
+    MeanPacketIntervalSeconds = 0.0;
+    MostPopulatedIndex = INDEX_NONE;
+    ThresholdStart.Reset();
+    ThresholdValue.Reset();
+    ++CommitSerial;
+
+    // Indici d'area rifatti da capo: anche lo stato del filtro
+    AreaCountFilter = FPeopleCounterCountFilter();
+    TArray<FPeopleCounterFilterSettings> Profiles;
+    Profiles.Add(AreaFilter);
+    for (const TPair<FName, FPeopleCounterFilterSettings>& Pair : AreaFilterOverrides)
+    {
+        Profiles.Add(Pair.Value);
+    }
+    AreaCountFilter.SetProfiles(Profiles);
+
+    // Senza Receiver, tabella o registro restano le sole aree esterne
+    TArray<FPeopleCounterAreaMembershipRow*> Rows;
+    const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = Receiver ? Receiver->GetSensorRegistry() : nullptr;
+    // Niente canale prima di StartReceiver: si ricompila quando parte
+    bWaitingForRegistry = Receiver && !Registry;
+    if (bWaitingForRegistry)
+    {
+        UE_LOG(LogPeopleCounterAreas, Log, TEXT("%s: receiver not started yet, sensor areas compiled when it starts"), *GetName());
+    }
+    else if (AreaTable && (!AreaTable->GetRowStruct() || !AreaTable->GetRowStruct()->IsChildOf(FPeopleCounterAreaMembershipRow::StaticStruct())))
+    {
+        UE_LOG(LogPeopleCounterAreas, Error, TEXT("%s: AreaTable %s must use FPeopleCounterAreaMembershipRow"), *GetName(), *AreaTable->GetName());
+    }
+    else if (AreaTable && Registry)
+    {
+        AreaTable->GetAllRows<FPeopleCounterAreaMembershipRow>(TEXT("PeopleCounterAreas"), Rows);
+    }
+
+    // Archi (slot, area, peso) in ordine di tabella
+    TArray<int32> EdgeSlot, EdgeArea;
+    TArray<float> EdgeWeight;
+    int32 NumSlots = 0;
+    for (const FPeopleCounterAreaMembershipRow* Row : Rows)
+    {
+        if (!Row || Row->SensorId.IsNone() || Row->Area.IsNone()) continue;
+
+        int32 AreaIndex = INDEX_NONE;
+        if (const int32* Existing = AreaIndexByName.Find(Row->Area))
+        {
+            AreaIndex = *Existing;
+        }
+        else
+        {
+            AreaIndex = AreaNames.Add(Row->Area);
+            AreaIndexByName.Add(Row->Area, AreaIndex);
+            const EPeopleCounterAreaCombine* Override = AreaCombineOverrides.Find(Row->Area);
+            AreaCombine.Add(Override ? *Override : DefaultCombine);
+        }
+
+        // Registrare qui il sensore fissa il suo slot prima del primo pacchetto
+        const int32 Slot = Registry->FindOrAddSlot(Row->SensorId);
+        EdgeSlot.Add(Slot);
+        EdgeArea.Add(AreaIndex);
+        EdgeWeight.Add(Row->Weight);
+        NumSlots = FMath::Max(NumSlots, Slot + 1);
+    }
+
+    // Aree esterne senza righe nel DataTable: nessun membro
+    for (FName Area : ExternalAreaNames)
+    {
+        if (!AreaIndexByName.Contains(Area))
+        {
+            AreaIndexByName.Add(Area, AreaNames.Add(Area));
+            AreaCombine.Add(DefaultCombine);
+        }
+    }
+    ExternalCounts.Init(0.f, AreaNames.Num());
+    for (const TPair<FName, float>& Pair : PreviousExternalCounts)
+    {
+        if (const int32* AreaIndex = AreaIndexByName.Find(Pair.Key))
+        {
+            ExternalCounts[*AreaIndex] = Pair.Value;
+        }
+    }
+
+    TArray<int32> Order;
+    BuildCsr(NumSlots, EdgeSlot, SensorEdgeStart, Order);
+    SensorEdgeArea.SetNumUninitialized(Order.Num());
+    for (int32 i = 0; i < Order.Num(); ++i)
+    {
+        SensorEdgeArea[i] = EdgeArea[Order[i]];
+    }
+
+    BuildCsr(AreaNames.Num(), EdgeArea, AreaMemberStart, Order);
+    AreaMemberSlot.SetNumUninitialized(Order.Num());
+    AreaMemberWeight.SetNumUninitialized(Order.Num());
+    for (int32 i = 0; i < Order.Num(); ++i)
+    {
+        AreaMemberSlot[i] = EdgeSlot[Order[i]];
+        AreaMemberWeight[i] = EdgeWeight[Order[i]];
+    }
+
+    // Parte dallo stato gia' noto al receiver
+    SensorCounts.SetNumUninitialized(NumSlots);
+    for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+    {
+        SensorCounts[Slot] = Registry->GetCount(Slot);
+    }
+    RawAreaCounts.Init(0.f, AreaNames.Num());
+    DirtyFlags.Init(false, AreaNames.Num());
+    DirtyAreas.Reserve(AreaNames.Num());
+    for (int32 AreaIndex = 0; AreaIndex < AreaNames.Num(); ++AreaIndex)
+    {
+        RecomputeArea(AreaIndex);
+        ConfigureAreaFilter(AreaIndex);
+    }
+    // Il primo passo del filtro parte da questi valori
+    AreaCounts = RawAreaCounts;
+    RecomputeMostPopulated();
+    // Nessuna storia: i valori iniziali valgono da sempre
+    AreaFromCounts = AreaCounts;
+    AreaFromSeconds.Init(0.0, AreaNames.Num());
+    AreaToSeconds.Init(0.0, AreaNames.Num());
+    CompileThresholds();
+
+    UE_LOG(LogPeopleCounterAreas, Log, TEXT("%s: compiled %d areas from %d sensor memberships"), *GetName(), AreaNames.Num(), EdgeSlot.Num());
+    OnAreasRebuiltNative.Broadcast();
+}
+
+int32 UPeopleCounterAreaAggregatorComponent::AddExternalArea(FName Area)
+{
+    if (Area.IsNone()) return INDEX_NONE;
+    ExternalAreaNames.AddUnique(Area);
+    if (const int32* Existing = AreaIndexByName.Find(Area))
+    {
+        return *Existing;
+    }
+
+    // Area nuova in coda, senza membri: gli array gia' compilati crescono di un elemento
+    const int32 AreaIndex = AreaNames.Add(Area);
+    AreaIndexByName.Add(Area, AreaIndex);
+    AreaCombine.Add(DefaultCombine);
+    AreaCounts.Add(0.f);
+    RawAreaCounts.Add(0.f);
+    ExternalCounts.SetNumZeroed(AreaNames.Num());
+    if (AreaMemberStart.Num() == 0)
+    {
+        AreaMemberStart.Add(0);
+    }
+    AreaMemberStart.Add(AreaMemberStart.Last());
+    DirtyFlags.Add(false);
+    AreaFromCounts.Add(0.f);
+    AreaFromSeconds.Add(0.0);
+    AreaToSeconds.Add(0.0);
+    ConfigureAreaFilter(AreaIndex);
+    CompileThresholds();
+    return AreaIndex;
+}
+
+void UPeopleCounterAreaAggregatorComponent::ConfigureAreaFilter(int32 AreaIndex)
+{
+    // Profilo = posizione in AreaFilterOverrides + 1 (stesso ordine di SetProfiles)
+    int32 Profile = 0;
+    int32 Index = 1;
+    for (const TPair<FName, FPeopleCounterFilterSettings>& Pair : AreaFilterOverrides)
+    {
+        if (Pair.Key == AreaNames[AreaIndex])
+        {
+            Profile = Index;
+            break;
+        }
+        ++Index;
+    }
+    AreaCountFilter.SetSlotProfile(AreaIndex, Profile);
+    AreaCountFilter.SetInput(AreaIndex, RawAreaCounts[AreaIndex]);
+}
+
+void UPeopleCounterAreaAggregatorComponent::SetExternalAreaCounts(TConstArrayView<int32> AreaIndices, TConstArrayView<float> Counts, double EngineSeconds)
+{
+    check(AreaIndices.Num() == Counts.Num());
+    double PacketSeconds = EngineSeconds;
+    const double PreviousPacketSeconds = AdvanceTimeline(PacketSeconds);
+    for (int32 i = 0; i < AreaIndices.Num(); ++i)
+    {
+        const int32 AreaIndex = AreaIndices[i];
+        if (!ExternalCounts.IsValidIndex(AreaIndex) || ExternalCounts[AreaIndex] == Counts[i]) continue;
+        ExternalCounts[AreaIndex] = Counts[i];
+        MarkAreaDirty(AreaIndex);
+    }
+    CommitDirtyAreas(PreviousPacketSeconds, PacketSeconds);
+}
+
+double UPeopleCounterAreaAggregatorComponent::AdvanceTimeline(double& InOutPacketSeconds)
+{
+    // Un pacchetto in ritardo non riporta indietro la timeline
+    InOutPacketSeconds = FMath::Max(InOutPacketSeconds, LastPacketSeconds);
+    const double PreviousPacketSeconds = LastPacketSeconds;
+    if (PreviousPacketSeconds > 0.0 && InOutPacketSeconds - PreviousPacketSeconds > SameCaptureSeconds)
+    {
+        const double Interval = InOutPacketSeconds - PreviousPacketSeconds;
+        MeanPacketIntervalSeconds = MeanPacketIntervalSeconds > 0.0 ? MeanPacketIntervalSeconds + (Interval - MeanPacketIntervalSeconds) / 8.0 : Interval;
+    }
+    LastPacketSeconds = InOutPacketSeconds;
+    return PreviousPacketSeconds;
+}
+
+void UPeopleCounterAreaAggregatorComponent::MarkAreaDirty(int32 AreaIndex)
+{
+    if (!DirtyFlags[AreaIndex])
+    {
+        DirtyFlags[AreaIndex] = true;
+        DirtyAreas.Add(AreaIndex);
+    }
+}
+
+void UPeopleCounterAreaAggregatorComponent::HandlePacket(const FPeopleCountPacket& Packet)
+{
+    if (!PeopleCounter::IsCountsType(Packet.Type)) return;
+
+    // Istante di cattura sull'orologio del motore; senza stima dell'orologio dell'hub l'arrivo
+    double PacketSeconds = Packet.EngineTimestamp > 0.0 ? Packet.EngineTimestamp
+        : Packet.ReceivedSeconds > 0.0 ? Packet.ReceivedSeconds : FPlatformTime::Seconds();
+    const double PreviousPacketSeconds = AdvanceTimeline(PacketSeconds);
+
+    const int32 NumMappedSlots = SensorCounts.Num();
+    for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        // Sensori fuori dal DataTable non toccano nessuna area
+        if (Sensor.Slot < 0 || Sensor.Slot >= NumMappedSlots || SensorCounts[Sensor.Slot] == Sensor.Count) continue;
+
+        SensorCounts[Sensor.Slot] = Sensor.Count;
+        for (int32 Edge = SensorEdgeStart[Sensor.Slot]; Edge < SensorEdgeStart[Sensor.Slot + 1]; ++Edge)
+        {
+            MarkAreaDirty(SensorEdgeArea[Edge]);
+        }
+    }
+    CommitDirtyAreas(PreviousPacketSeconds, PacketSeconds);
+}
+
+void UPeopleCounterAreaAggregatorComponent::CommitDirtyAreas(double PreviousPacketSeconds, double PacketSeconds)
+{
+    ChangedAreas.Reset();
+    ChangedFromCounts.Reset();
+    if (AreaCountFilter.IsActive())
+    {
+        for (int32 AreaIndex : DirtyAreas)
+        {
+            RecomputeArea(AreaIndex);
+            AreaCountFilter.SetInput(AreaIndex, RawAreaCounts[AreaIndex]);
+            DirtyFlags[AreaIndex] = false;
+        }
+        DirtyAreas.Reset();
+
+        // Avanza anche senza aree cambiate: mediana, EMA e permanenza si muovono col tempo
+        FilterChanged.Reset();
+        AreaCountFilter.Step(PacketSeconds, FilterChanged);
+        if (FilterChanged.Num() == 0) return;
+        for (int32 AreaIndex : FilterChanged)
+        {
+            CommitAreaValue(AreaIndex, AreaCountFilter.GetOutput(AreaIndex), PreviousPacketSeconds, PacketSeconds);
+        }
+    }
+    else
+    {
+        if (DirtyAreas.Num() == 0) return;
+        for (int32 AreaIndex : DirtyAreas)
+        {
+            RecomputeArea(AreaIndex);
+            CommitAreaValue(AreaIndex, RawAreaCounts[AreaIndex], PreviousPacketSeconds, PacketSeconds);
+            DirtyFlags[AreaIndex] = false;
+        }
+        DirtyAreas.Reset();
+    }
+    const int32 PreviousMostPopulated = MostPopulatedIndex;
+    RecomputeMostPopulated();
+    // Serial preso prima del primo broadcast: un commit annidato in OnAreasUpdated riscrive ChangedAreas
+    const uint32 Serial = ++CommitSerial;
+
+    OnAreasUpdated.Broadcast();
+    if (CommitSerial != Serial) return;
+    BroadcastAreaEvents(PreviousMostPopulated, Serial);
+}
+
+void UPeopleCounterAreaAggregatorComponent::CommitAreaValue(int32 AreaIndex, float Value, double PreviousPacketSeconds, double PacketSeconds)
+{
+    ChangedAreas.Add(AreaIndex);
+    ChangedFromCounts.Add(AreaCounts[AreaIndex]);
+    // Il valore vecchio era ancora vero all'ultimo pacchetto: il cambio sta tra i due
+    AreaFromCounts[AreaIndex] = AreaCounts[AreaIndex];
+    AreaFromSeconds[AreaIndex] = PreviousPacketSeconds > 0.0 ? PreviousPacketSeconds : PacketSeconds;
+    AreaToSeconds[AreaIndex] = PacketSeconds;
+    AreaCounts[AreaIndex] = Value;
+}
+
+void UPeopleCounterAreaAggregatorComponent::BroadcastAreaEvents(int32 PreviousMostPopulated, uint32 Serial)
+{
+    const bool bThresholds = ThresholdValue.Num() > 0 && (OnAreaThresholdCrossed.IsBound() || OnAreaThresholdCrossedNative.IsBound());
+    const bool bCountChanged = OnAreaCountChanged.IsBound() || OnAreaCountChangedNative.IsBound();
+
+    for (int32 i = 0; i < ChangedAreas.Num() && (bThresholds || bCountChanged); ++i)
+    {
+        const int32 AreaIndex = ChangedAreas[i];
+        const FName Area = AreaNames[AreaIndex];
+        const float From = ChangedFromCounts[i];
+        const float To = AreaCounts[AreaIndex];
+
+        if (bThresholds)
+        {
+            // Soglie in ordine di attraversamento: crescenti in salita, decrescenti in discesa
+            const int32 First = ThresholdStart[AreaIndex];
+            const int32 Last = ThresholdStart[AreaIndex + 1];
+            const bool bRising = To > From;
+            for (int32 k = 0; k < Last - First; ++k)
+            {
+                const float Threshold = ThresholdValue[bRising ? First + k : Last - 1 - k];
+                const bool bAbove = To >= Threshold;
+                if ((From >= Threshold) == bAbove) continue;
+                OnAreaThresholdCrossedNative.Broadcast(Area, Threshold, bAbove, To);
+                OnAreaThresholdCrossed.Broadcast(Area, Threshold, bAbove, To);
+                if (CommitSerial != Serial) return;
+            }
+        }
+        if (bCountChanged)
+        {
+            const int32 Rounded = FMath::RoundToInt(To);
+            const int32 PreviousRounded = FMath::RoundToInt(From);
+            if (Rounded != PreviousRounded)
+            {
+                OnAreaCountChangedNative.Broadcast(Area, Rounded, PreviousRounded);
+                OnAreaCountChanged.Broadcast(Area, Rounded, PreviousRounded);
+                if (CommitSerial != Serial) return;
+            }
+        }
+    }
+
+    if (MostPopulatedIndex != PreviousMostPopulated)
+    {
+        const FName Area = MostPopulatedIndex != INDEX_NONE ? AreaNames[MostPopulatedIndex] : NAME_None;
+        const FName PreviousArea = AreaNames.IsValidIndex(PreviousMostPopulated) ? AreaNames[PreviousMostPopulated] : NAME_None;
+        const float Count = MostPopulatedIndex != INDEX_NONE ? AreaCounts[MostPopulatedIndex] : 0.f;
+        OnDominantAreaChangedNative.Broadcast(Area, PreviousArea, Count);
+        OnDominantAreaChanged.Broadcast(Area, PreviousArea, Count);
+    }
+}
+
+void UPeopleCounterAreaAggregatorComponent::CompileThresholds()
+{
+    // Poche soglie, ricompilate solo quando cambiano le soglie o le aree
+    TArray<int32> Keys;
+    TArray<float> Values;
+    for (const FPeopleCounterAreaThreshold& Entry : AreaThresholds)
+    {
+        if (const int32* AreaIndex = AreaIndexByName.Find(Entry.Area))
+        {
+            Keys.Add(*AreaIndex);
+            Values.Add(Entry.Threshold);
+        }
+    }
+    TArray<int32> Order;
+    BuildCsr(AreaNames.Num(), Keys, ThresholdStart, Order);
+    ThresholdValue.SetNumUninitialized(Order.Num());
+    for (int32 i = 0; i < Order.Num(); ++i)
+    {
+        ThresholdValue[i] = Values[Order[i]];
+    }
+    for (int32 AreaIndex = 0; AreaIndex < AreaNames.Num(); ++AreaIndex)
+    {
+        Algo::Sort(MakeArrayView(ThresholdValue.GetData() + ThresholdStart[AreaIndex], ThresholdStart[AreaIndex + 1] - ThresholdStart[AreaIndex]));
+    }
+}
+
+void UPeopleCounterAreaAggregatorComponent::AddAreaThreshold(FName Area, float Threshold)
+{
+    if (Area.IsNone()) return;
+    FPeopleCounterAreaThreshold& Entry = AreaThresholds.AddDefaulted_GetRef();
+    Entry.Area = Area;
+    Entry.Threshold = Threshold;
+    CompileThresholds();
+    // Chiamata da un handler: il CSR e' cambiato sotto BroadcastAreaEvents, che si ferma qui
+    ++CommitSerial;
+}
+
+bool UPeopleCounterAreaAggregatorComponent::RemoveAreaThreshold(FName Area, float Threshold)
+{
+    const int32 NumRemoved = AreaThresholds.RemoveAll([Area, Threshold](const FPeopleCounterAreaThreshold& Entry)
+    {
+        return Entry.Area == Area && Entry.Threshold == Threshold;
+    });
+    if (NumRemoved == 0) return false;
+    CompileThresholds();
+    ++CommitSerial;
+    return true;
+}
+
+void UPeopleCounterAreaAggregatorComponent::RecomputeArea(int32 AreaIndex)
+{
+    // Ricalcolo dai membri (non per differenza) per non accumulare errori float
+    const bool bMax = AreaCombine[AreaIndex] == EPeopleCounterAreaCombine::Max;
+    float Value = 0.f;
+    for (int32 Member = AreaMemberStart[AreaIndex]; Member < AreaMemberStart[AreaIndex + 1]; ++Member)
+    {
+        const float Contribution = AreaMemberWeight[Member] * SensorCounts[AreaMemberSlot[Member]];
+        Value = bMax ? FMath::Max(Value, Contribution) : Value + Contribution;
+    }
+    RawAreaCounts[AreaIndex] = Value + ExternalCounts[AreaIndex];
+}
+
+void UPeopleCounterAreaAggregatorComponent::RecomputeMostPopulated()
+{
+    // O(aree) solo quando qualcosa cambia; a parita' vince l'area definita prima
+    MostPopulatedIndex = INDEX_NONE;
+    float Best = 0.f;
+    for (int32 AreaIndex = 0; AreaIndex < AreaCounts.Num(); ++AreaIndex)
+    {
+        if (AreaCounts[AreaIndex] > Best)
+        {
+            Best = AreaCounts[AreaIndex];
+            MostPopulatedIndex = AreaIndex;
+        }
+    }
+}
+
+float UPeopleCounterAreaAggregatorComponent::GetAreaCount(FName Area) const
+{
+    return GetAreaCountByIndex(GetAreaIndex(Area));
+}
+
+float UPeopleCounterAreaAggregatorComponent::GetAreaRawCount(FName Area) const
+{
+    const int32 AreaIndex = GetAreaIndex(Area);
+    return RawAreaCounts.IsValidIndex(AreaIndex) ? RawAreaCounts[AreaIndex] : 0.f;
+}
+
+float UPeopleCounterAreaAggregatorComponent::GetAreaCountSmoothed(FName Area) const
+{
+    return GetAreaCountSmoothedByIndex(GetAreaIndex(Area));
+}
+
+float UPeopleCounterAreaAggregatorComponent::GetAreaCountSmoothedByIndex(int32 AreaIndex) const
+{
+    // Tempo del frame: tutte le query dello stesso frame vedono lo stesso istante
+    return GetAreaCountAtTime(AreaIndex, FApp::GetCurrentTime());
+}
+
+float UPeopleCounterAreaAggregatorComponent::GetAreaCountAtTime(int32 AreaIndex, double EngineSeconds) const
+{
+    if (!AreaCounts.IsValidIndex(AreaIndex)) return 0.f;
+    const float To = AreaCounts[AreaIndex];
+    if (TimeSmoothing == EPeopleCounterAreaTimeSmoothing::None) return To;
+
+    const double Delay = InterpolationDelaySeconds > 0.f ? InterpolationDelaySeconds : MeanPacketIntervalSeconds;
+    const double Time = EngineSeconds - Delay;
+    const float From = AreaFromCounts[AreaIndex];
+    const double FromSeconds = AreaFromSeconds[AreaIndex];
+    const double ToSeconds = AreaToSeconds[AreaIndex];
+    const double Span = ToSeconds - FromSeconds;
+
+    if (Time <= FromSeconds) return From;
+    if (Time < ToSeconds)
+    {
+        return FMath::Lerp(From, To, static_cast<float>((Time - FromSeconds) / Span));
+    }
+
+    // Si estrapola solo se l'ultimo pacchetto ha cambiato l'area: dopo, il valore e' confermato
+    if (TimeSmoothing != EPeopleCounterAreaTimeSmoothing::Extrapolate || ToSeconds < LastPacketSeconds || Span <= UE_DOUBLE_SMALL_NUMBER)
+    {
+        return To;
+    }
+    const double Ahead = FMath::Min(Time - ToSeconds, static_cast<double>(MaxExtrapolationSeconds));
+    return FMath::Max(0.f, To + static_cast<float>((To - From) * Ahead / Span));
+}
+
+int32 UPeopleCounterAreaAggregatorComponent::GetAreaIndex(FName Area) const
+{
+    const int32* Found = AreaIndexByName.Find(Area);
+    return Found ? *Found : INDEX_NONE;
+}
+
+bool UPeopleCounterAreaAggregatorComponent::GetMostPopulatedArea(FName& OutArea, float& OutCount) const
+{
+    if (MostPopulatedIndex == INDEX_NONE)
+    {
+        OutArea = NAME_None;
+        OutCount = 0.f;
+        return false;
+    }
+    OutArea = AreaNames[MostPopulatedIndex];
+    OutCount = AreaCounts[MostPopulatedIndex];
+    return true;
+}
@@ -0,0 +1,353 @@
+#include "PeopleCounterAreaClassifier.h"
+#include "Math/VectorRegister.h"
+#include "Algo/StableSort.h"
+
+namespace
+{
+    // Test pari/dispari completo, solo in Build
+    bool IsInsidePolygon(TConstArrayView<FVector2f> Vertices, FVector2f Point)
+    {
+        bool bInside = false;
+        for (int32 i = 0, j = Vertices.Num() - 1; i < Vertices.Num(); j = i++)
+        {
+            const FVector2f A = Vertices[j];
+            const FVector2f B = Vertices[i];
+            if ((A.Y > Point.Y) != (B.Y > Point.Y)
+                && Point.X < A.X + (Point.Y - A.Y) * (B.X - A.X) / (B.Y - A.Y))
+            {
+                bInside = !bInside;
+            }
+        }
+        return bInside;
+    }
+
+    // Eliminazione di Gauss con pivot parziale; A e' N x N per righe, B diventa la soluzione
+    template <int32 N>
+    bool SolveLinear(double (&A)[N][N], double (&B)[N])
+    {
+        for (int32 Col = 0; Col < N; ++Col)
+        {
+            int32 Pivot = Col;
+            for (int32 Row = Col + 1; Row < N; ++Row)
+            {
+                if (FMath::Abs(A[Row][Col]) > FMath::Abs(A[Pivot][Col])) Pivot = Row;
+            }
+            if (FMath::Abs(A[Pivot][Col]) < 1e-12) return false;
+            if (Pivot != Col)
+            {
+                for (int32 k = 0; k < N; ++k) Swap(A[Col][k], A[Pivot][k]);
+                Swap(B[Col], B[Pivot]);
+            }
+            for (int32 Row = Col + 1; Row < N; ++Row)
+            {
+                const double F = A[Row][Col] / A[Col][Col];
+                for (int32 k = Col; k < N; ++k) A[Row][k] -= F * A[Col][k];
+                B[Row] -= F * B[Col];
+            }
+        }
+        for (int32 Row = N - 1; Row >= 0; --Row)
+        {
+            double Sum = B[Row];
+            for (int32 k = Row + 1; k < N; ++k) Sum -= A[Row][k] * B[k];
+            B[Row] = Sum / A[Row][Row];
+        }
+        return true;
+    }
+
+    // Centro nell'origine e distanza media sqrt(2), come nella DLT normalizzata di Hartley
+    void ComputeNormalization(TConstArrayView<FVector2D> Points, FVector2D& OutCenter, double& OutScale)
+    {
+        OutCenter = FVector2D::ZeroVector;
+        for (const FVector2D& P : Points) OutCenter += P;
+        OutCenter /= Points.Num();
+        double MeanDistance = 0.0;
+        for (const FVector2D& P : Points) MeanDistance += FVector2D::Distance(P, OutCenter);
+        MeanDistance /= Points.Num();
+        OutScale = MeanDistance > UE_DOUBLE_SMALL_NUMBER ? UE_DOUBLE_SQRT_2 / MeanDistance : 1.0;
+    }
+}
+
+bool FPeopleCounterHomography::Fit(TConstArrayView<FVector2D> From, TConstArrayView<FVector2D> To)
+{
+    if (From.Num() < 4 || From.Num() != To.Num()) return false;
+
+    FVector2D FromCenter, ToCenter;
+    double FromScale = 1.0, ToScale = 1.0;
+    ComputeNormalization(From, FromCenter, FromScale);
+    ComputeNormalization(To, ToCenter, ToScale);
+
+    // Equazioni normali di A h = b con h33 = 1: due righe per corrispondenza
+    double AtA[8][8] = {};
+    double Atb[8] = {};
+    auto Accumulate = [&AtA, &Atb](const double (&Row)[8], double Rhs)
+    {
+        for (int32 i = 0; i < 8; ++i)
+        {
+            for (int32 j = 0; j < 8; ++j) AtA[i][j] += Row[i] * Row[j];
+            Atb[i] += Row[i] * Rhs;
+        }
+    };
+    for (int32 i = 0; i < From.Num(); ++i)
+    {
+        const double U = (From[i].X - FromCenter.X) * FromScale;
+        const double V = (From[i].Y - FromCenter.Y) * FromScale;
+        const double X = (To[i].X - ToCenter.X) * ToScale;
+        const double Y = (To[i].Y - ToCenter.Y) * ToScale;
+        const double RowX[8] = { U, V, 1.0, 0.0, 0.0, 0.0, -U * X, -V * X };
+        const double RowY[8] = { 0.0, 0.0, 0.0, U, V, 1.0, -U * Y, -V * Y };
+        Accumulate(RowX, X);
+        Accumulate(RowY, Y);
+    }
+    if (!SolveLinear(AtA, Atb)) return false;
+
+    // M = T_to^-1 * Hn * T_from
+    const double Hn[9] = { Atb[0], Atb[1], Atb[2], Atb[3], Atb[4], Atb[5], Atb[6], Atb[7], 1.0 };
+    const double TFrom[9] = { FromScale, 0.0, -FromScale * FromCenter.X, 0.0, FromScale, -FromScale * FromCenter.Y, 0.0, 0.0, 1.0 };
+    const double TToInv[9] = { 1.0 / ToScale, 0.0, ToCenter.X, 0.0, 1.0 / ToScale, ToCenter.Y, 0.0, 0.0, 1.0 };
+    auto Multiply = [](const double (&L)[9], const double (&R)[9], double (&Out)[9])
+    {
+        for (int32 r = 0; r < 3; ++r)
+        {
+            for (int32 c = 0; c < 3; ++c)
+            {
+                Out[r * 3 + c] = L[r * 3] * R[c] + L[r * 3 + 1] * R[3 + c] + L[r * 3 + 2] * R[6 + c];
+            }
+        }
+    };
+    double Tmp[9];
+    double Result[9];
+    Multiply(Hn, TFrom, Tmp);
+    Multiply(TToInv, Tmp, Result);
+    if (FMath::Abs(Result[8]) < UE_DOUBLE_SMALL_NUMBER) return false;
+    for (int32 i = 0; i < 9; ++i)
+    {
+        M[i] = Result[i] / Result[8];
+    }
+    return true;
+}
+
+FVector2f FPeopleCounterHomography::Project(FVector2f Point) const
+{
+    const double W = M[6] * Point.X + M[7] * Point.Y + M[8];
+    const double InvW = FMath::Abs(W) > UE_DOUBLE_SMALL_NUMBER ? 1.0 / W : 0.0;
+    return FVector2f(
+        static_cast<float>((M[0] * Point.X + M[1] * Point.Y + M[2]) * InvW),
+        static_cast<float>((M[3] * Point.X + M[4] * Point.Y + M[5]) * InvW));
+}
+
+void FPeopleCounterAreaClassifier::Reset()
+{
+    CellEntryStart.Reset();
+    Entries.Reset();
+    EdgeAX.Reset();
+    EdgeAY.Reset();
+    EdgeEX.Reset();
+    EdgeEY.Reset();
+    EdgeD1.Reset();
+    PolygonArea.Reset();
+    NumCellsX = NumCellsY = 0;
+    NumAreas = 0;
+}
+
+FVector2f FPeopleCounterAreaClassifier::GetCellCenter(int32 CellX, int32 CellY) const
+{
+    return GridMin + FVector2f((CellX + 0.5f) * CellSize, (CellY + 0.5f) * CellSize);
+}
+
+void FPeopleCounterAreaClassifier::Build(TConstArrayView<TArray<FVector2f>> Polygons, TConstArrayView<int32> PolygonAreas, int32 InNumAreas, int32 GridResolution)
+{
+    check(Polygons.Num() == PolygonAreas.Num());
+    Reset();
+    NumAreas = InNumAreas;
+    PolygonArea = PolygonAreas;
+
+    FBox2f Bounds(ForceInit);
+    for (const TArray<FVector2f>& Polygon : Polygons)
+    {
+        if (Polygon.Num() < 3) continue;
+        for (const FVector2f& V : Polygon) Bounds += V;
+    }
+    if (!Bounds.bIsValid) return;
+
+    // Celle quadrate, GridResolution sul lato lungo; un filo di margine per i vertici sul bordo
+    const FVector2f Extent = Bounds.GetSize();
+    CellSize = FMath::Max(FMath::Max(Extent.X, Extent.Y) / FMath::Max(GridResolution, 1), 1e-3f) * 1.0001f;
+    InvCellSize = 1.f / CellSize;
+    GridMin = Bounds.Min;
+    NumCellsX = FMath::Max(1, FMath::CeilToInt(Extent.X * InvCellSize));
+    NumCellsY = FMath::Max(1, FMath::CeilToInt(Extent.Y * InvCellSize));
+
+    struct FPendingEntry
+    {
+        int32 Cell;
+        FCellEntry Entry;
+    };
+    TArray<FPendingEntry> Pending;
+    TArray<int32> CellEdges;
+
+    for (int32 PolygonIndex = 0; PolygonIndex < Polygons.Num(); ++PolygonIndex)
+    {
+        const TArray<FVector2f>& Polygon = Polygons[PolygonIndex];
+        if (Polygon.Num() < 3) continue;
+
+        FBox2f PolygonBounds(Polygon);
+        const int32 MinX = FMath::Clamp(FMath::FloorToInt((PolygonBounds.Min.X - GridMin.X) * InvCellSize), 0, NumCellsX - 1);
+        const int32 MaxX = FMath::Clamp(FMath::FloorToInt((PolygonBounds.Max.X - GridMin.X) * InvCellSize), 0, NumCellsX - 1);
+        const int32 MinY = FMath::Clamp(FMath::FloorToInt((PolygonBounds.Min.Y - GridMin.Y) * InvCellSize), 0, NumCellsY - 1);
+        const int32 MaxY = FMath::Clamp(FMath::FloorToInt((PolygonBounds.Max.Y - GridMin.Y) * InvCellSize), 0, NumCellsY - 1);
+
+        for (int32 CellY = MinY; CellY <= MaxY; ++CellY)
+        {
+            for (int32 CellX = MinX; CellX <= MaxX; ++CellX)
+            {
+                const FVector2f CellMin = GridMin + FVector2f(CellX * CellSize, CellY * CellSize);
+                const FBox2f CellBox(CellMin, CellMin + FVector2f(CellSize, CellSize));
+                const FVector2f Center = CellBox.GetCenter();
+
+                // Lati il cui box tocca la cella: per eccesso, il test di taglio resta esatto
+                CellEdges.Reset();
+                for (int32 i = 0, j = Polygon.Num() - 1; i < Polygon.Num(); j = i++)
+                {
+                    const FBox2f EdgeBox(FVector2f::Min(Polygon[j], Polygon[i]), FVector2f::Max(Polygon[j], Polygon[i]));
+                    if (EdgeBox.Intersect(CellBox))
+                    {
+                        CellEdges.Add(j);
+                    }
+                }
+
+                const bool bCenterInside = IsInsidePolygon(Polygon, Center);
+                if (CellEdges.Num() == 0 && !bCenterInside) continue;
+
+                FPendingEntry& Out = Pending.AddDefaulted_GetRef();
+                Out.Cell = CellY * NumCellsX + CellX;
+                Out.Entry.Polygon = PolygonIndex;
+                Out.Entry.bCenterInside = bCenterInside;
+                Out.Entry.EdgeStart = EdgeAX.Num();
+                Out.Entry.NumEdges = CellEdges.Num();
+                for (int32 j : CellEdges)
+                {
+                    const FVector2f A = Polygon[j];
+                    const FVector2f E = Polygon[(j + 1) % Polygon.Num()] - A;
+                    EdgeAX.Add(A.X);
+                    EdgeAY.Add(A.Y);
+                    EdgeEX.Add(E.X);
+                    EdgeEY.Add(E.Y);
+                    EdgeD1.Add(E.X * (Center.Y - A.Y) - E.Y * (Center.X - A.X));
+                }
+                // Gruppi completi da 4: lati nulli (orient sempre 0, nessun taglio)
+                while (EdgeAX.Num() % 4 != 0)
+                {
+                    EdgeAX.Add(0.f);
+                    EdgeAY.Add(0.f);
+                    EdgeEX.Add(0.f);
+                    EdgeEY.Add(0.f);
+                    EdgeD1.Add(0.f);
+                }
+            }
+        }
+    }
+
+    // CSR per cella, mantenendo l'ordine dei poligoni dentro la cella
+    Algo::StableSortBy(Pending, &FPendingEntry::Cell);
+    CellEntryStart.Init(0, NumCellsX * NumCellsY + 1);
+    Entries.Reserve(Pending.Num());
+    for (const FPendingEntry& P : Pending)
+    {
+        ++CellEntryStart[P.Cell + 1];
+        Entries.Add(P.Entry);
+    }
+    for (int32 Cell = 0; Cell < NumCellsX * NumCellsY; ++Cell)
+    {
+        CellEntryStart[Cell + 1] += CellEntryStart[Cell];
+    }
+}
+
+bool FPeopleCounterAreaClassifier::IsInside(const FCellEntry& Entry, FVector2f Center, FVector2f Point) const
+{
+    if (Entry.NumEdges == 0) return Entry.bCenterInside;
+
+    // Segmento C -> P contro 4 lati A -> A+E alla volta: lo taglia se C e P stanno da parti opposte
+    // del lato (D1 * D2 < 0) e A, B da parti opposte del segmento (D3 * D4 < 0)
+    const VectorRegister4Float Px = VectorSetFloat1(Point.X);
+    const VectorRegister4Float Py = VectorSetFloat1(Point.Y);
+    const VectorRegister4Float Cx = VectorSetFloat1(Center.X);
+    const VectorRegister4Float Cy = VectorSetFloat1(Center.Y);
+    const VectorRegister4Float Dx = VectorSetFloat1(Point.X - Center.X);
+    const VectorRegister4Float Dy = VectorSetFloat1(Point.Y - Center.Y);
+    const VectorRegister4Float Zero = VectorZeroFloat();
+
+    uint32 Crossings = 0;
+    const int32 End = Entry.EdgeStart + Entry.NumEdges;
+    for (int32 e = Entry.EdgeStart; e < End; e += 4)
+    {
+        const VectorRegister4Float Ax = VectorLoad(&EdgeAX[e]);
+        const VectorRegister4Float Ay = VectorLoad(&EdgeAY[e]);
+        const VectorRegister4Float Ex = VectorLoad(&EdgeEX[e]);
+        const VectorRegister4Float Ey = VectorLoad(&EdgeEY[e]);
+        const VectorRegister4Float D1 = VectorLoad(&EdgeD1[e]);
+
+        const VectorRegister4Float D2 = VectorSubtract(VectorMultiply(Ex, VectorSubtract(Py, Ay)), VectorMultiply(Ey, VectorSubtract(Px, Ax)));
+        const VectorRegister4Float D3 = VectorSubtract(VectorMultiply(Dx, VectorSubtract(Ay, Cy)), VectorMultiply(Dy, VectorSubtract(Ax, Cx)));
+        const VectorRegister4Float D4 = VectorAdd(D3, VectorSubtract(VectorMultiply(Dx, Ey), VectorMultiply(Dy, Ex)));
+
+        const VectorRegister4Float Mask = VectorBitwiseAnd(
+            VectorCompareLT(VectorMultiply(D1, D2), Zero),
+            VectorCompareLT(VectorMultiply(D3, D4), Zero));
+        Crossings += FPlatformMath::CountBits(static_cast<uint64>(VectorMaskBits(Mask)));
+    }
+    return Entry.bCenterInside != ((Crossings & 1) != 0);
+}
+
+template <typename VisitorType>
+void FPeopleCounterAreaClassifier::ForEachContainingPolygon(FVector2f Point, VisitorType&& Visit) const
+{
+    const FVector2f Rel = (Point - GridMin) * InvCellSize;
+    const int32 CellX = FMath::FloorToInt(Rel.X);
+    const int32 CellY = FMath::FloorToInt(Rel.Y);
+    if (CellX < 0 || CellY < 0 || CellX >= NumCellsX || CellY >= NumCellsY) return;
+
+    const int32 Cell = CellY * NumCellsX + CellX;
+    const FVector2f Center = GetCellCenter(CellX, CellY);
+    for (int32 i = CellEntryStart[Cell]; i < CellEntryStart[Cell + 1]; ++i)
+    {
+        const FCellEntry& Entry = Entries[i];
+        if (IsInside(Entry, Center, Point) && !Visit(Entry.Polygon))
+        {
+            return;
+        }
+    }
+}
+
+void FPeopleCounterAreaClassifier::CountPoints(TConstArrayView<FVector2f> Points, TArrayView<float> OutAreaCounts) const
+{
+    check(OutAreaCounts.Num() >= NumAreas);
+    if (IsEmpty()) return;
+
+    // Ultimo punto contato per area: piu' poligoni della stessa area contano una volta
+    TArray<int32, TInlineAllocator<64>> LastPointByArea;
+    LastPointByArea.Init(INDEX_NONE, NumAreas);
+    for (int32 PointIndex = 0; PointIndex < Points.Num(); ++PointIndex)
+    {
+        ForEachContainingPolygon(Points[PointIndex], [&](int32 Polygon)
+        {
+            const int32 Area = PolygonArea[Polygon];
+            if (LastPointByArea[Area] != PointIndex)
+            {
+                LastPointByArea[Area] = PointIndex;
+                OutAreaCounts[Area] += 1.f;
+            }
+            return true;
+        });
+    }
+}
+
+int32 FPeopleCounterAreaClassifier::ClassifyPoint(FVector2f Point) const
+{
+    int32 Found = INDEX_NONE;
+    ForEachContainingPolygon(Point, [&](int32 Polygon)
+    {
+        Found = PolygonArea[Polygon];
+        return false;
+    });
+    return Found;
+}
@@ -0,0 +1,315 @@
+#include "PeopleCounterAreaClassifierComponent.h"
+#include "PeopleCounterAreaAggregatorComponent.h"
+#include "UDPJsonReceiverComponent.h"
+#include "PeopleCounterSensorRegistry.h"
+#include "Components/SplineComponent.h"
+#include "GameFramework/Actor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterClassifier, Log, All);
+
+UPeopleCounterAreaClassifierComponent::UPeopleCounterAreaClassifierComponent()
+{
+    PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UPeopleCounterAreaClassifierComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    if (GetOwner())
+    {
+        if (!Receiver) Receiver = GetOwner()->FindComponentByClass<UUDPJsonReceiverComponent>();
+        if (!Aggregator) Aggregator = GetOwner()->FindComponentByClass<UPeopleCounterAreaAggregatorComponent>();
+    }
+    if (!Receiver)
+    {
+        UE_LOG(LogPeopleCounterClassifier, Warning, TEXT("%s: no UDPJsonReceiverComponent to read detections from"), *GetName());
+        return;
+    }
+    if (!Aggregator)
+    {
+        UE_LOG(LogPeopleCounterClassifier, Warning, TEXT("%s: no PeopleCounterAreaAggregatorComponent, area counts are only queryable here"), *GetName());
+    }
+
+    PacketHandle = Receiver->OnPeopleCountReceivedNative.AddUObject(this, &UPeopleCounterAreaClassifierComponent::HandlePacket);
+    Rebuild();
+}
+
+void UPeopleCounterAreaClassifierComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (Receiver)
+    {
+        Receiver->OnPeopleCountReceivedNative.Remove(PacketHandle);
+    }
+    PacketHandle.Reset();
+    Super::EndPlay(EndPlayReason);
+}
+
+void UPeopleCounterAreaClassifierComponent::AddPolygon(FName Area, TArray<FVector2f>&& Vertices)
+{
+    if (Area.IsNone() || Vertices.Num() < 3) return;
+    int32 AreaIndex = AreaNames.IndexOfByKey(Area);
+    if (AreaIndex == INDEX_NONE)
+    {
+        AreaIndex = AreaNames.Add(Area);
+    }
+    PendingPolygons.Add(MoveTemp(Vertices));
+    PendingPolygonAreas.Add(AreaIndex);
+}
+
+void UPeopleCounterAreaClassifierComponent::Rebuild()
+{
+    AreaNames.Reset();
+    PendingPolygons.Reset();
+    PendingPolygonAreas.Reset();
+    HomographyBySensor.Reset();
+    for (FSlotPoints& Slot : Slots)
+    {
+        Slot.State = -1;
+        Slot.Points.Reset();
+    }
+
+    if (AreaPolygonTable)
+    {
+        if (AreaPolygonTable->GetRowStruct() && AreaPolygonTable->GetRowStruct()->IsChildOf(FPeopleCounterAreaPolygonRow::StaticStruct()))
+        {
+            TArray<FPeopleCounterAreaPolygonRow*> Rows;
+            AreaPolygonTable->GetAllRows<FPeopleCounterAreaPolygonRow>(TEXT("PeopleCounterClassifier"), Rows);
+            for (const FPeopleCounterAreaPolygonRow* Row : Rows)
+            {
+                if (!Row) continue;
+                TArray<FVector2f> Vertices;
+                Vertices.Reserve(Row->Vertices.Num());
+                for (const FVector2D& V : Row->Vertices)
+                {
+                    Vertices.Add(FVector2f(V));
+                }
+                AddPolygon(Row->Area, MoveTemp(Vertices));
+            }
+        }
+        else
+        {
+            UE_LOG(LogPeopleCounterClassifier, Error, TEXT("%s: AreaPolygonTable %s must use FPeopleCounterAreaPolygonRow"), *GetName(), *AreaPolygonTable->GetName());
+        }
+    }
+
+    for (const AActor* Actor : AreaSplineActors)
+    {
+        const USplineComponent* Spline = Actor ? Actor->FindComponentByClass<USplineComponent>() : nullptr;
+        if (!Spline) continue;
+
+        // Il poligono si chiude comunque; le spline lineari bastano coi loro punti
+        const int32 NumPoints = Spline->GetNumberOfSplinePoints();
+        const int32 NumSegments = Spline->IsClosedLoop() ? NumPoints : NumPoints - 1;
+        bool bCurved = false;
+        for (int32 i = 0; i < NumPoints && !bCurved; ++i)
+        {
+            bCurved = Spline->GetSplinePointType(i) != ESplinePointType::Linear;
+        }
+        const int32 Samples = bCurved ? SplineSamplesPerSegment : 1;
+        TArray<FVector2f> Vertices;
+        Vertices.Reserve(NumSegments * Samples + 1);
+        for (int32 Segment = 0; Segment < NumSegments; ++Segment)
+        {
+            for (int32 k = 0; k < Samples; ++k)
+            {
+                const FVector Location = Spline->GetLocationAtSplineInputKey(Segment + static_cast<float>(k) / Samples, ESplineCoordinateSpace::World);
+                Vertices.Add(FVector2f(Location.X, Location.Y));
+            }
+        }
+        if (!Spline->IsClosedLoop() && NumPoints > 0)
+        {
+            const FVector Last = Spline->GetLocationAtSplinePoint(NumPoints - 1, ESplineCoordinateSpace::World);
+            Vertices.Add(FVector2f(Last.X, Last.Y));
+        }
+        AddPolygon(Actor->Tags.Num() > 0 ? Actor->Tags[0] : Actor->GetFName(), MoveTemp(Vertices));
+    }
+
+    Classifier.Build(PendingPolygons, PendingPolygonAreas, AreaNames.Num(), GridResolution);
+    AreaCounts.Init(0.f, AreaNames.Num());
+    AggregatorAreas.Init(INDEX_NONE, AreaNames.Num());
+
+    if (CalibrationTable)
+    {
+        if (CalibrationTable->GetRowStruct() && CalibrationTable->GetRowStruct()->IsChildOf(FPeopleCounterSensorCalibrationRow::StaticStruct()))
+        {
+            static const FVector2D ImageCorners[] = { FVector2D(0.0, 0.0), FVector2D(1.0, 0.0), FVector2D(1.0, 1.0), FVector2D(0.0, 1.0) };
+            TArray<FPeopleCounterSensorCalibrationRow*> Rows;
+            CalibrationTable->GetAllRows<FPeopleCounterSensorCalibrationRow>(TEXT("PeopleCounterClassifier"), Rows);
+            for (const FPeopleCounterSensorCalibrationRow* Row : Rows)
+            {
+                if (!Row || Row->SensorId.IsNone()) continue;
+                const TConstArrayView<FVector2D> Image = Row->ImagePoints.Num() > 0 ? TConstArrayView<FVector2D>(Row->ImagePoints) : MakeArrayView(ImageCorners);
+                FPeopleCounterHomography Homography;
+                if (!Homography.Fit(Image, Row->FloorPoints))
+                {
+                    UE_LOG(LogPeopleCounterClassifier, Error, TEXT("%s: calibration for %s needs at least 4 non-degenerate point pairs (%d image, %d floor)"),
+                        *GetName(), *Row->SensorId.ToString(), Image.Num(), Row->FloorPoints.Num());
+                    continue;
+                }
+                HomographyBySensor.Add(Row->SensorId, Homography);
+            }
+        }
+        else
+        {
+            UE_LOG(LogPeopleCounterClassifier, Error, TEXT("%s: CalibrationTable %s must use FPeopleCounterSensorCalibrationRow"), *GetName(), *CalibrationTable->GetName());
+        }
+    }
+
+    UE_LOG(LogPeopleCounterClassifier, Log, TEXT("%s: %d polygons in %d areas, %d calibrated sensors"),
+        *GetName(), PendingPolygons.Num(), AreaNames.Num(), HomographyBySensor.Num());
+}
+
+bool UPeopleCounterAreaClassifierComponent::ResolveCalibration(int32 SlotIndex, const FPeopleCounterSensorRegistry& Registry)
+{
+    FSlotPoints& Slot = Slots[SlotIndex];
+    // Seriale arrivato dopo (list_sensors) o camera sostituita: la calibrazione va riletta
+    FString Serial = Registry.GetSerial(SlotIndex);
+    if (Slot.State >= 0 && Serial != Slot.Serial)
+    {
+        Slot.State = -1;
+        Slot.Points.Reset();
+    }
+    if (Slot.State < 0)
+    {
+        // Il seriale e' unico tra gli hub e non dipende dalla numerazione SENSORE001..
+        const FName Key = Serial.IsEmpty() ? Registry.GetSensorId(SlotIndex) : FName(*Serial);
+        if (const FPeopleCounterHomography* Found = HomographyBySensor.Find(Key))
+        {
+            Slot.Homography = *Found;
+            Slot.State = 1;
+        }
+        else
+        {
+            UE_LOG(LogPeopleCounterClassifier, Warning, TEXT("%s: sensor %s has no calibration, its detections are ignored"), *GetName(), *Key.ToString());
+            Slot.State = 0;
+        }
+        Slot.Serial = MoveTemp(Serial);
+    }
+    return Slot.State > 0;
+}
+
+void UPeopleCounterAreaClassifierComponent::HandlePacket(const FPeopleCountPacket& Packet)
+{
+    if (Packet.Type != PeopleCounter::TypeDetections) return;
+
+    const double NowSeconds = FPlatformTime::Seconds();
+    const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = Receiver->GetSensorRegistry();
+    if (!Registry) return;
+    for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        if (Sensor.Slot < 0) continue;
+        if (Sensor.Slot >= Slots.Num())
+        {
+            Slots.SetNum(Sensor.Slot + 1);
+        }
+        // Slot del registro unito: seriale se noto, altrimenti id qualificato con l'hub
+        if (!ResolveCalibration(Sensor.Slot, *Registry)) continue;
+
+        FSlotPoints& Slot = Slots[Sensor.Slot];
+        Slot.Points.Reset();
+        const int32 End = FMath::Min(Sensor.FirstPoint + Sensor.NumPoints, Packet.Points.Num());
+        for (int32 i = FMath::Max(Sensor.FirstPoint, 0); i < End; ++i)
+        {
+            Slot.Points.Add(Slot.Homography.Project(FVector2f(Packet.Points[i])));
+        }
+        Slot.LastUpdateSeconds = NowSeconds;
+    }
+
+    // Pianta comune: ultimi punti di tutti i sensori ancora vivi (anche di altri hub)
+    MergedPoints.Reset();
+    MergedSlots.Reset();
+    const double ExpireBefore = PointTimeoutSeconds > 0.f ? NowSeconds - PointTimeoutSeconds : -UE_DOUBLE_BIG_NUMBER;
+    for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); ++SlotIndex)
+    {
+        FSlotPoints& Slot = Slots[SlotIndex];
+        if (Slot.Points.Num() == 0) continue;
+        if (Slot.LastUpdateSeconds < ExpireBefore)
+        {
+            Slot.Points.Reset();
+            continue;
+        }
+        MergedPoints.Append(Slot.Points);
+        for (int32 i = 0; i < Slot.Points.Num(); ++i)
+        {
+            MergedSlots.Add(SlotIndex);
+        }
+    }
+    MergeDuplicates();
+
+    FMemory::Memzero(AreaCounts.GetData(), AreaCounts.Num() * sizeof(float));
+    Classifier.CountPoints(MergedPoints, AreaCounts);
+
+    if (Aggregator)
+    {
+        // Per nome a ogni pacchetto: un RebuildFromTable dell'aggregatore puo' spostare gli indici
+        for (int32 AreaIndex = 0; AreaIndex < AreaNames.Num(); ++AreaIndex)
+        {
+            AggregatorAreas[AreaIndex] = Aggregator->AddExternalArea(AreaNames[AreaIndex]);
+        }
+        const double PacketSeconds = Packet.EngineTimestamp > 0.0 ? Packet.EngineTimestamp
+            : Packet.ReceivedSeconds > 0.0 ? Packet.ReceivedSeconds : NowSeconds;
+        Aggregator->SetExternalAreaCounts(AggregatorAreas, AreaCounts, PacketSeconds);
+    }
+}
+
+void UPeopleCounterAreaClassifierComponent::MergeDuplicates()
+{
+    if (DuplicateMergeDistance <= 0.f || MergedPoints.Num() < 2) return;
+
+    // Sweep lungo X: si confrontano solo i punti entro la distanza di fusione
+    SortOrder.SetNumUninitialized(MergedPoints.Num());
+    for (int32 i = 0; i < SortOrder.Num(); ++i)
+    {
+        SortOrder[i] = i;
+    }
+    SortOrder.Sort([this](int32 A, int32 B) { return MergedPoints[A].X < MergedPoints[B].X; });
+
+    const float Radius = DuplicateMergeDistance;
+    const float RadiusSq = Radius * Radius;
+    Duplicate.Init(false, MergedPoints.Num());
+    for (int32 i = 0; i < SortOrder.Num(); ++i)
+    {
+        const int32 A = SortOrder[i];
+        if (Duplicate[A]) continue;
+        for (int32 j = i + 1; j < SortOrder.Num(); ++j)
+        {
+            const int32 B = SortOrder[j];
+            if (MergedPoints[B].X - MergedPoints[A].X > Radius) break;
+            // Due persone vicine nella stessa camera restano due
+            if (Duplicate[B] || MergedSlots[B] == MergedSlots[A]) continue;
+            if (FVector2f::DistSquared(MergedPoints[A], MergedPoints[B]) <= RadiusSq)
+            {
+                Duplicate[B] = true;
+            }
+        }
+    }
+
+    int32 Write = 0;
+    for (int32 i = 0; i < MergedPoints.Num(); ++i)
+    {
+        if (Duplicate[i]) continue;
+        MergedPoints[Write] = MergedPoints[i];
+        MergedSlots[Write] = MergedSlots[i];
+        ++Write;
+    }
+    MergedPoints.SetNum(Write, EAllowShrinking::No);
+    MergedSlots.SetNum(Write, EAllowShrinking::No);
+}
+
+TArray<FVector2D> UPeopleCounterAreaClassifierComponent::GetFloorPositions() const
+{
+    TArray<FVector2D> Out;
+    Out.Reserve(MergedPoints.Num());
+    for (const FVector2f& Point : MergedPoints)
+    {
+        Out.Add(FVector2D(Point));
+    }
+    return Out;
+}
+
+FName UPeopleCounterAreaClassifierComponent::ClassifyFloorPoint(FVector2D FloorPoint) const
+{
+    const int32 AreaIndex = Classifier.ClassifyPoint(FVector2f(FloorPoint));
+    return AreaNames.IsValidIndex(AreaIndex) ? AreaNames[AreaIndex] : NAME_None;
+}
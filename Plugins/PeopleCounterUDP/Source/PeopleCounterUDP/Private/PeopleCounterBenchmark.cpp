@@ -0,0 +1,545 @@
+#include "PeopleCounterBenchmark.h"
+#include "HAL/MallocBase.h"
+#include "HAL/PlatformTLS.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/Package.h"
+#include "PeopleCounterAreaAggregatorComponent.h"
+#include "PeopleCounterBinaryProtocol.h"
+#include "PeopleCounterChannel.h"
+#include "PeopleCounterFastParser.h"
+#include "PeopleCounterJsonLib.h"
+#include "PeopleCounterLoadGenerator.h"
+#include "PeopleCounterSessionLog.h"
+#include "PeopleCounterSessionReplay.h"
+#include "UDPJsonReceiverComponent.h"
+#include "UDPJsonSenderComponent.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterBench, Log, All);
+
+// Il proxy di GMalloc solo nei build di sviluppo: in Shipping l'allocatore non si tocca mai
+#define PEOPLECOUNTER_BENCH_COUNT_ALLOCATIONS (!UE_BUILD_SHIPPING && !PLATFORM_USES_FIXED_GMalloc_CLASS)
+
+namespace
+{
+    constexpr int32 WarmupCalls = 8;
+    constexpr int32 MaxBatchCalls = 1 << 16;
+    // Dopo la fine del generatore: code e dispatch si svuotano prima di chiudere il canale
+    constexpr double LoopbackDrainSeconds = 0.5;
+
+    // Proxy di GMalloc che conta le allocazioni del thread che misura. Installato solo durante
+    // la parte cronometrata di un caso; resta in vita fino all'uscita del processo perche' un
+    // altro thread puo' aver letto GMalloc prima del ripristino e chiamarlo dopo.
+    // Dove FMemory usa una classe fissa (PLATFORM_USES_FIXED_GMalloc_CLASS) GMalloc viene
+    // scavalcato, e in Shipping il proxy non c'e': le allocazioni risultano -1.
+    class FCountingMalloc final : public FMalloc
+    {
+    public:
+        static FCountingMalloc& Get()
+        {
+            static FCountingMalloc Instance;
+            return Instance;
+        }
+
+        static constexpr bool IsSupported() { return PEOPLECOUNTER_BENCH_COUNT_ALLOCATIONS; }
+
+        void Begin()
+        {
+#if PEOPLECOUNTER_BENCH_COUNT_ALLOCATIONS
+            Inner = GMalloc;
+            ThreadId = FPlatformTLS::GetCurrentThreadId();
+            Allocations = 0;
+            Bytes = 0;
+            GMalloc = this;
+#endif
+        }
+
+        void End()
+        {
+#if PEOPLECOUNTER_BENCH_COUNT_ALLOCATIONS
+            GMalloc = Inner;
+            ThreadId = 0;
+#endif
+        }
+
+        int64 GetAllocations() const { return Allocations; }
+        int64 GetBytes() const { return Bytes; }
+
+        virtual void* Malloc(SIZE_T Count, uint32 Alignment) override { Note(Count); return Inner->Malloc(Count, Alignment); }
+        virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override { Note(Count); return Inner->TryMalloc(Count, Alignment); }
+        virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override { Note(Count); return Inner->Realloc(Original, Count, Alignment); }
+        virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override { Note(Count); return Inner->TryRealloc(Original, Count, Alignment); }
+        virtual void Free(void* Original) override { Inner->Free(Original); }
+        virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+        virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+        virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+        virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+        virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+        virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+        virtual void UpdateStats() override { Inner->UpdateStats(); }
+        virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+        virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+        virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+        virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+        virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+    private:
+        void Note(SIZE_T Count)
+        {
+            // Free e Realloc a zero non contano; gli altri thread passano senza toccare i contatori
+            if (Count > 0 && FPlatformTLS::GetCurrentThreadId() == ThreadId)
+            {
+                ++Allocations;
+                Bytes += static_cast<int64>(Count);
+            }
+        }
+
+        FMalloc* Inner = nullptr;
+        TAtomic<uint32> ThreadId { 0 };
+        int64 Allocations = 0;
+        int64 Bytes = 0;
+    };
+
+    // Percentile su campioni gia' ordinati
+    float Percentile(const TArray<float>& Sorted, float Fraction)
+    {
+        if (Sorted.Num() == 0) return 0.f;
+        const int32 Index = FMath::Clamp(FMath::CeilToInt(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+        return Sorted[Index];
+    }
+
+    TSharedRef<FJsonObject> LatencyResult(const TCHAR* Name, int32 NumSensors, TArray<float>& Micros)
+    {
+        Micros.Sort();
+        double Sum = 0.0;
+        for (const float Value : Micros)
+        {
+            Sum += Value;
+        }
+        TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+        Result->SetStringField(TEXT("name"), Name);
+        Result->SetNumberField(TEXT("sensors"), NumSensors);
+        Result->SetNumberField(TEXT("samples"), Micros.Num());
+        Result->SetNumberField(TEXT("mean_us"), Micros.Num() > 0 ? Sum / Micros.Num() : 0.0);
+        Result->SetNumberField(TEXT("p50_us"), Percentile(Micros, 0.50f));
+        Result->SetNumberField(TEXT("p95_us"), Percentile(Micros, 0.95f));
+        Result->SetNumberField(TEXT("p99_us"), Percentile(Micros, 0.99f));
+        Result->SetNumberField(TEXT("max_us"), Micros.Num() > 0 ? Micros.Last() : 0.f);
+        UE_LOG(LogPeopleCounterBench, Display, TEXT("%-32s %5d sensors  %8d samples  p50 %9.1f us  p99 %9.1f us"),
+            Name, NumSensors, Micros.Num(), Percentile(Micros, 0.50f), Percentile(Micros, 0.99f));
+        return Result;
+    }
+
+    double UnixNowSeconds()
+    {
+        return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalSeconds();
+    }
+}
+
+FPeopleCounterBenchmark::FPeopleCounterBenchmark(const FPeopleCounterBenchmarkSettings& InSettings)
+    : Settings(InSettings)
+{
+    OutputPath = Settings.OutputPath.IsEmpty()
+        ? PeopleCounter::SessionLog::ResolvePath(FString::Printf(TEXT("Benchmarks/bench-%s.json"), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S"))))
+        : PeopleCounter::SessionLog::ResolvePath(Settings.OutputPath);
+}
+
+FPeopleCounterBenchmark::~FPeopleCounterBenchmark()
+{
+    FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+    if (LoopbackGenerator)
+    {
+        LoopbackGenerator->StopAndWait();
+    }
+    if (LoopbackChannel)
+    {
+        LoopbackChannel->OnPacket.Remove(LoopbackPacketHandle);
+        LoopbackChannel->Stop();
+    }
+}
+
+void FPeopleCounterBenchmark::Start()
+{
+    check(IsInGameThread());
+    Results.Reset();
+    bFinished = false;
+    if (!FCountingMalloc::IsSupported())
+    {
+        UE_LOG(LogPeopleCounterBench, Warning, TEXT("Allocation counting is not available on this platform or build: allocations are reported as -1"));
+    }
+
+    for (const int32 NumSensors : Settings.SensorCounts)
+    {
+        RunParsers(NumSensors);
+        RunAggregation(NumSensors);
+        RunSend(NumSensors);
+    }
+    RunSession();
+
+    if (!StartLoopback())
+    {
+        WriteResults();
+    }
+}
+
+void FPeopleCounterBenchmark::Measure(const FString& Name, int32 NumSensors, int32 OpsPerCall, TFunctionRef<void()> Op)
+{
+    // Cache, pool e scratch al regime prima di misurare
+    for (int32 i = 0; i < WarmupCalls; ++i)
+    {
+        Op();
+    }
+
+    FCountingMalloc& Counter = FCountingMalloc::Get();
+    int64 Calls = 0;
+    int32 Batch = 1;
+    double Elapsed = 0.0;
+    if (FCountingMalloc::IsSupported())
+    {
+        Counter.Begin();
+    }
+    const double StartSeconds = FPlatformTime::Seconds();
+    do
+    {
+        for (int32 i = 0; i < Batch; ++i)
+        {
+            Op();
+        }
+        Calls += Batch;
+        Batch = FMath::Min(Batch * 2, MaxBatchCalls);
+        Elapsed = FPlatformTime::Seconds() - StartSeconds;
+    }
+    while (Elapsed < Settings.MinSecondsPerCase);
+    if (FCountingMalloc::IsSupported())
+    {
+        Counter.End();
+    }
+
+    const double Ops = static_cast<double>(Calls) * FMath::Max(1, OpsPerCall);
+    const double NsPerOp = Elapsed * 1e9 / Ops;
+    const double AllocsPerOp = FCountingMalloc::IsSupported() ? Counter.GetAllocations() / Ops : -1.0;
+    const double BytesPerOp = FCountingMalloc::IsSupported() ? Counter.GetBytes() / Ops : -1.0;
+
+    TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+    Result->SetStringField(TEXT("name"), Name);
+    Result->SetNumberField(TEXT("sensors"), NumSensors);
+    Result->SetNumberField(TEXT("ops"), Ops);
+    Result->SetNumberField(TEXT("ns_per_op"), NsPerOp);
+    Result->SetNumberField(TEXT("allocs_per_op"), AllocsPerOp);
+    Result->SetNumberField(TEXT("alloc_bytes_per_op"), BytesPerOp);
+    Results.Add(MakeShared<FJsonValueObject>(Result));
+    UE_LOG(LogPeopleCounterBench, Display, TEXT("%-32s %5d sensors  %12.1f ns/op  %8.2f allocs/op"), *Name, NumSensors, NsPerOp, AllocsPerOp);
+}
+
+void FPeopleCounterBenchmark::RunParsers(int32 NumSensors)
+{
+    FPeopleCounterLoadSettings LoadSettings;
+    LoadSettings.NumSensors = NumSensors;
+    FPeopleCounterLoadGenerator JsonSource(LoadSettings);
+    TArray<uint8> Json;
+    JsonSource.BuildMessage(Json);
+    const FString JsonString = FString(StringCast<TCHAR>(reinterpret_cast<const UTF8CHAR*>(Json.GetData()), Json.Num()));
+
+    LoadSettings.bBinary = true;
+    FPeopleCounterLoadGenerator BinarySource(LoadSettings);
+    TArray<uint8> Binary;
+    BinarySource.BuildMessage(Binary);
+
+    // Stesse condizioni del thread RX: pacchetto e scratch riusati tra una chiamata e l'altra
+    FPeopleCountPacket Packet;
+    TArray<TPeopleCountSensorView<UTF8CHAR>> Scratch;
+    Scratch.SetNum(NumSensors);
+    TMap<FString, int32> SensorMap;
+    double Timestamp = 0.0;
+
+    Measure(TEXT("parse.dom"), NumSensors, 1, [&]()
+    {
+        SensorMap.Reset();
+        UPeopleCounterJsonLib::ParsePeopleCountPacket(JsonString, SensorMap, Timestamp);
+    });
+    Measure(TEXT("parse.dom_struct"), NumSensors, 1, [&]()
+    {
+        UPeopleCounterJsonLib::ParsePeopleCountPacketStruct(JsonString, Packet);
+    });
+    Measure(TEXT("parse.fast_view"), NumSensors, 1, [&]()
+    {
+        TPeopleCountPacketView<UTF8CHAR> View;
+        View.SensorStorage = Scratch;
+        PeopleCounter::FastParsePacket(FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(Json.GetData()), Json.Num()), View);
+    });
+    Measure(TEXT("parse.utf8_packet"), NumSensors, 1, [&]()
+    {
+        UPeopleCounterJsonLib::ParsePeopleCountPacketUtf8(Json.GetData(), Json.Num(), Scratch, Packet);
+    });
+    Measure(TEXT("parse.binary"), NumSensors, 1, [&]()
+    {
+        PeopleCounter::Binary::DecodePacket(Binary.GetData(), Binary.Num(), Packet);
+    });
+    Measure(TEXT("encode.json"), NumSensors, 1, [&]()
+    {
+        JsonSource.BuildMessage(Json);
+    });
+}
+
+void FPeopleCounterBenchmark::RunAggregation(int32 NumSensors)
+{
+    // Il registro esiste solo con il receiver avviato: porta di loopback libera, nessun traffico
+    UUDPJsonReceiverComponent* Receiver = NewObject<UUDPJsonReceiverComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+    Receiver->bUseSharedChannel = false;
+    Receiver->ListenAddress = TEXT("127.0.0.1");
+    Receiver->ListenPort = Settings.LoopbackPort + 2;
+    if (!Receiver->StartReceiver())
+    {
+        UE_LOG(LogPeopleCounterBench, Warning, TEXT("Port %d unavailable: skipping the aggregation benchmark"), Receiver->ListenPort);
+        return;
+    }
+
+    // Un'area ogni dieci sensori; un sensore su quattro inquadra anche l'area vicina (peso 0.5)
+    const int32 NumAreas = FMath::Max(1, NumSensors / 10);
+    UDataTable* Table = NewObject<UDataTable>(GetTransientPackage(), NAME_None, RF_Transient);
+    Table->RowStruct = FPeopleCounterAreaMembershipRow::StaticStruct();
+    int32 RowIndex = 0;
+    for (int32 i = 0; i < NumSensors; ++i)
+    {
+        FPeopleCounterAreaMembershipRow Row;
+        Row.SensorId = PeopleCounter::Binary::SensorNameForIndex(i + 1);
+        Row.Area = FName(TEXT("Area"), i % NumAreas + 1);
+        Table->AddRow(FName(TEXT("Row"), ++RowIndex), Row);
+        if (i % 4 == 0 && NumAreas > 1)
+        {
+            Row.Area = FName(TEXT("Area"), (i + 1) % NumAreas + 1);
+            Row.Weight = 0.5f;
+            Table->AddRow(FName(TEXT("Row"), ++RowIndex), Row);
+        }
+    }
+
+    UPeopleCounterAreaAggregatorComponent* Aggregator = NewObject<UPeopleCounterAreaAggregatorComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+    Aggregator->Receiver = Receiver;
+    Aggregator->AreaTable = Table;
+    Aggregator->RebuildFromTable();
+
+    // Due pacchetti alternati in cui cambiano tutti i sensori: ogni chiamata ricalcola tutte le aree
+    FPeopleCountPacket Packets[2];
+    for (int32 p = 0; p < 2; ++p)
+    {
+        Packets[p].Type = PeopleCounter::TypeSnapshotCounts;
+        Packets[p].Sensors.SetNum(NumSensors);
+        for (int32 i = 0; i < NumSensors; ++i)
+        {
+            FPeopleCountSensor& Sensor = Packets[p].Sensors[i];
+            Sensor.Id = PeopleCounter::Binary::SensorNameForIndex(i + 1);
+            Sensor.Slot = Receiver->GetSensorIndex(Sensor.Id);
+            Sensor.Count = i % 5 + p;
+        }
+    }
+    int32 Next = 0;
+    Measure(TEXT("aggregate.all_changed"), NumSensors, 1, [&]()
+    {
+        Aggregator->HandlePacket(Packets[Next]);
+        Next ^= 1;
+    });
+
+    // Un sensore cambiato per pacchetto: il caso tipico a regime
+    Packets[1] = Packets[0];
+    Packets[1].Sensors[0].Count += 1;
+    Measure(TEXT("aggregate.one_changed"), NumSensors, 1, [&]()
+    {
+        Aggregator->HandlePacket(Packets[Next]);
+        Next ^= 1;
+    });
+    Receiver->StopReceiver();
+}
+
+void FPeopleCounterBenchmark::RunSend(int32 NumSensors)
+{
+    FPeopleCounterLoadSettings LoadSettings;
+    LoadSettings.NumSensors = NumSensors;
+    FPeopleCounterLoadGenerator Source(LoadSettings);
+    TArray<uint8> Json;
+    Source.BuildMessage(Json);
+    const FString JsonString = FString(StringCast<TCHAR>(reinterpret_cast<const UTF8CHAR*>(Json.GetData()), Json.Num()));
+    if (Json.Num() > 65507) return;
+
+    // Verso una porta senza receiver su loopback: conta solo il costo dell'invio
+    UUDPJsonSenderComponent* Sender = NewObject<UUDPJsonSenderComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+    Sender->TargetHost = TEXT("127.0.0.1");
+    Sender->TargetPort = Settings.LoopbackPort + 1;
+    Measure(TEXT("send.json_string"), NumSensors, 1, [&]()
+    {
+        Sender->SendJsonString(JsonString);
+    });
+    Sender->Disconnect();
+}
+
+void FPeopleCounterBenchmark::RunSession()
+{
+    if (Settings.SessionPath.IsEmpty()) return;
+
+    FPeopleCounterSessionReplay Session;
+    if (!Session.Open(PeopleCounter::SessionLog::ResolvePath(Settings.SessionPath)) || Session.NumRecords() == 0) return;
+
+    // Una passata su tutti i datagram della sessione per chiamata, per datagram nel risultato
+    int32 MaxSensors = 0;
+    FPeopleCountPacket Packet;
+    TArray<TPeopleCountSensorView<UTF8CHAR>> Scratch;
+    Scratch.SetNum(4096);
+    Session.ForEachRecord([&](const PeopleCounter::SessionLog::FRecord& Record)
+    {
+        if (UPeopleCounterJsonLib::ParsePeopleCountPacketUtf8(Record.Data, Record.Num, Scratch, Packet))
+        {
+            MaxSensors = FMath::Max(MaxSensors, Packet.Sensors.Num());
+        }
+    });
+    Measure(TEXT("parse.session"), MaxSensors, Session.NumRecords(), [&]()
+    {
+        Session.ForEachRecord([&](const PeopleCounter::SessionLog::FRecord& Record)
+        {
+            if (PeopleCounter::Binary::IsBinaryPacket(Record.Data, Record.Num))
+            {
+                PeopleCounter::Binary::DecodePacket(Record.Data, Record.Num, Packet);
+            }
+            else
+            {
+                UPeopleCounterJsonLib::ParsePeopleCountPacketUtf8(Record.Data, Record.Num, Scratch, Packet);
+            }
+        });
+    });
+}
+
+bool FPeopleCounterBenchmark::StartLoopback()
+{
+    if (Settings.LoopbackSeconds <= 0.f) return false;
+
+    FPeopleCounterChannelSettings ChannelSettings;
+    ChannelSettings.ListenAddress = TEXT("127.0.0.1");
+    ChannelSettings.ListenPort = Settings.LoopbackPort;
+    ChannelSettings.bRawJson = false;
+    ChannelSettings.bClusterSync = false;
+    LoopbackChannel = MakeShared<FPeopleCounterChannel, ESPMode::ThreadSafe>(ChannelSettings);
+    if (!LoopbackChannel->Start())
+    {
+        UE_LOG(LogPeopleCounterBench, Warning, TEXT("Loopback port %d unavailable: skipping the latency benchmark"), Settings.LoopbackPort);
+        LoopbackChannel.Reset();
+        return false;
+    }
+    LoopbackPacketHandle = LoopbackChannel->OnPacket.AddRaw(this, &FPeopleCounterBenchmark::HandleLoopbackPacket);
+
+    FPeopleCounterLoadSettings LoadSettings;
+    LoadSettings.TargetHost = TEXT("127.0.0.1");
+    LoadSettings.TargetPort = Settings.LoopbackPort;
+    LoadSettings.NumSensors = Settings.LoopbackSensors;
+    LoadSettings.PacketsPerSecond = Settings.LoopbackRate;
+    LoadSettings.DurationSeconds = Settings.LoopbackSeconds;
+    LoopbackGenerator = MakeUnique<FPeopleCounterLoadGenerator>(LoadSettings);
+    if (!LoopbackGenerator->Start())
+    {
+        LoopbackGenerator.Reset();
+        LoopbackChannel->OnPacket.Remove(LoopbackPacketHandle);
+        LoopbackChannel->Stop();
+        LoopbackChannel.Reset();
+        return false;
+    }
+
+    const int32 Expected = FMath::CeilToInt(Settings.LoopbackRate * Settings.LoopbackSeconds);
+    SocketToBroadcastMicros.Reset(Expected);
+    SendToBroadcastMicros.Reset(Expected);
+    LoopbackFinishedSeconds = 0.0;
+    FrameSecondsSum = 0.0;
+    NumFrames = 0;
+    TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FPeopleCounterBenchmark::TickLoopback));
+    return true;
+}
+
+void FPeopleCounterBenchmark::HandleLoopbackPacket(const FPeopleCountPacket& Packet)
+{
+    const double Now = FPlatformTime::Seconds();
+    if (Packet.ReceivedSeconds > 0.0)
+    {
+        SocketToBroadcastMicros.Add(static_cast<float>((Now - Packet.ReceivedSeconds) * 1e6));
+    }
+    // Stessa macchina: il timestamp del generatore e l'orologio di sistema coincidono
+    if (Packet.Timestamp > 0.0)
+    {
+        SendToBroadcastMicros.Add(static_cast<float>((UnixNowSeconds() - Packet.Timestamp) * 1e6));
+    }
+}
+
+bool FPeopleCounterBenchmark::TickLoopback(float DeltaTime)
+{
+    FrameSecondsSum += DeltaTime;
+    ++NumFrames;
+    if (LoopbackGenerator->IsRunning()) return true;
+
+    const double Now = FPlatformTime::Seconds();
+    if (LoopbackFinishedSeconds <= 0.0)
+    {
+        LoopbackFinishedSeconds = Now;
+        return true;
+    }
+    if (Now - LoopbackFinishedSeconds < LoopbackDrainSeconds) return true;
+
+    TickerHandle.Reset();
+    FinishLoopback();
+    WriteResults();
+    return false;
+}
+
+void FPeopleCounterBenchmark::FinishLoopback()
+{
+    LoopbackGenerator->StopAndWait();
+    LoopbackChannel->OnPacket.Remove(LoopbackPacketHandle);
+    const FPeopleCounterReceiverStats Stats = LoopbackChannel->GetStats();
+
+    const int32 NumSensors = Settings.LoopbackSensors;
+    Results.Add(MakeShared<FJsonValueObject>(LatencyResult(TEXT("loopback.socket_to_broadcast"), NumSensors, SocketToBroadcastMicros)));
+    Results.Add(MakeShared<FJsonValueObject>(LatencyResult(TEXT("loopback.send_to_broadcast"), NumSensors, SendToBroadcastMicros)));
+
+    TSharedRef<FJsonObject> Throughput = MakeShared<FJsonObject>();
+    Throughput->SetStringField(TEXT("name"), TEXT("loopback.throughput"));
+    Throughput->SetNumberField(TEXT("sensors"), NumSensors);
+    Throughput->SetNumberField(TEXT("requested_per_second"), Settings.LoopbackRate);
+    Throughput->SetNumberField(TEXT("sent"), LoopbackGenerator->GetSentDatagrams());
+    Throughput->SetNumberField(TEXT("received"), Stats.PacketsReceived);
+    Throughput->SetNumberField(TEXT("broadcast"), SocketToBroadcastMicros.Num());
+    Throughput->SetNumberField(TEXT("queue_overflows"), Stats.QueueOverflows);
+    Throughput->SetNumberField(TEXT("superseded"), Stats.SupersededPackets);
+    Throughput->SetNumberField(TEXT("mean_frame_ms"), NumFrames > 0 ? FrameSecondsSum * 1000.0 / NumFrames : 0.0);
+    Results.Add(MakeShared<FJsonValueObject>(Throughput));
+
+    LoopbackChannel->Stop();
+    LoopbackChannel.Reset();
+    LoopbackGenerator.Reset();
+}
+
+void FPeopleCounterBenchmark::WriteResults()
+{
+    TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+    Root->SetStringField(TEXT("schema"), TEXT("people_count_bench_v1"));
+    Root->SetStringField(TEXT("engine"), FEngineVersion::Current().ToString());
+    Root->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+    Root->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+    Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+    Root->SetNumberField(TEXT("min_seconds_per_case"), Settings.MinSecondsPerCase);
+    Root->SetArrayField(TEXT("results"), Results);
+
+    FString Json;
+    FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Json));
+    if (FFileHelper::SaveStringToFile(Json, *OutputPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+    {
+        UE_LOG(LogPeopleCounterBench, Display, TEXT("Benchmark results written to %s"), *OutputPath);
+    }
+    else
+    {
+        UE_LOG(LogPeopleCounterBench, Error, TEXT("Cannot write benchmark results to %s"), *OutputPath);
+    }
+    bFinished = true;
+
+    if (Settings.bExitWhenDone)
+    {
+        FPlatformMisc::RequestExit(false, TEXT("PeopleCounter.Bench"));
+    }
+}
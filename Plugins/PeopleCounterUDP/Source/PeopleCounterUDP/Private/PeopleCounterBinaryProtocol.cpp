@@ -0,0 +1,170 @@
+#include "PeopleCounterBinaryProtocol.h"
+#include "Misc/ScopeRWLock.h"
+#include "PeopleCounterUDPStats.h"
+
+namespace PeopleCounter::Binary
+{
+    const FName SchemaV2(TEXT("people_count_v2"));
+
+    namespace
+    {
+        static_assert(PLATFORM_LITTLE_ENDIAN, "people_count_v2 viene letto con memcpy little-endian");
+
+        template <typename T>
+        T ReadLE(const uint8* Data)
+        {
+            T Value;
+            FMemory::Memcpy(&Value, Data, sizeof(T));
+            return Value;
+        }
+
+        template <typename T>
+        void WriteLE(uint8* Data, T Value)
+        {
+            FMemory::Memcpy(Data, &Value, sizeof(T));
+        }
+
+        // Cache indice -> FName, cresce solo la prima volta che un indice compare
+        FRWLock SensorNamesLock;
+        TArray<FName> SensorNames;
+    }
+
+    FName SensorNameForIndex(int32 Index)
+    {
+        if (Index < 0) return NAME_None;
+        {
+            FRWScopeLock Lock(SensorNamesLock, SLT_ReadOnly);
+            if (SensorNames.IsValidIndex(Index) && !SensorNames[Index].IsNone())
+            {
+                return SensorNames[Index];
+            }
+        }
+
+        FRWScopeLock Lock(SensorNamesLock, SLT_Write);
+        if (Index >= SensorNames.Num())
+        {
+            SensorNames.SetNum(Index + 1);
+        }
+        if (SensorNames[Index].IsNone())
+        {
+            // Stessa forma dell'hub: f"SENSORE{idx:03d}"
+            SensorNames[Index] = FName(*FString::Printf(TEXT("SENSORE%03d"), Index));
+        }
+        return SensorNames[Index];
+    }
+
+    int32 SensorIndexFromName(FName Id)
+    {
+        TCHAR Buffer[NAME_SIZE];
+        const int32 Len = Id.ToString(Buffer);
+        static const int32 PrefixLen = FCString::Strlen(TEXT("SENSORE"));
+        if (Len <= PrefixLen || FCString::Strncmp(Buffer, TEXT("SENSORE"), PrefixLen) != 0)
+        {
+            return INDEX_NONE;
+        }
+        int32 Index = 0;
+        for (int32 i = PrefixLen; i < Len; ++i)
+        {
+            if (!FChar::IsDigit(Buffer[i]) || Index > MAX_uint16) return INDEX_NONE;
+            Index = Index * 10 + (Buffer[i] - TEXT('0'));
+        }
+        return Index <= MAX_uint16 ? Index : INDEX_NONE;
+    }
+
+    bool DecodePacket(const uint8* Data, int32 Num, FPeopleCountPacket& OutPacket)
+    {
+        PEOPLECOUNTER_SCOPE(Parse);
+        OutPacket.Reset();
+        if (!IsBinaryPacket(Data, Num) || Data[4] != Version)
+        {
+            return false;
+        }
+
+        const uint8 Flags = Data[5];
+        const int32 NumEntries = ReadLE<uint16>(Data + 6);
+        int32 EntriesOffset = HeaderSize + ((Flags & FlagRequestId) ? RequestIdSize : 0);
+        int32 HubIdOffset = INDEX_NONE;
+        int32 HubIdLen = 0;
+        if (Flags & FlagHubId)
+        {
+            if (Num <= EntriesOffset)
+            {
+                return false;
+            }
+            HubIdLen = Data[EntriesOffset];
+            HubIdOffset = EntriesOffset + 1;
+            EntriesOffset = HubIdOffset + HubIdLen;
+        }
+        if (Num < EntriesOffset + NumEntries * EntrySize)
+        {
+            return false;
+        }
+
+        OutPacket.Schema = SchemaV2;
+        OutPacket.Type = (Flags & FlagDelta) ? PeopleCounter::TypeDeltaCounts : PeopleCounter::TypeSnapshotCounts;
+        OutPacket.Sequence = ReadLE<uint32>(Data + 8);
+        OutPacket.Timestamp = ReadLE<double>(Data + 12);
+        if (Flags & FlagRequestId)
+        {
+            OutPacket.RequestId = ReadLE<uint32>(Data + HeaderSize);
+        }
+        if (HubIdLen > 0)
+        {
+            OutPacket.Source = FName(HubIdLen, reinterpret_cast<const ANSICHAR*>(Data + HubIdOffset));
+        }
+
+        OutPacket.Sensors.SetNum(NumEntries, EAllowShrinking::No);
+        const uint8* Entry = Data + EntriesOffset;
+        for (int32 i = 0; i < NumEntries; ++i, Entry += EntrySize)
+        {
+            OutPacket.Sensors[i].Id = SensorNameForIndex(ReadLE<uint16>(Entry));
+            OutPacket.Sensors[i].Count = ReadLE<uint16>(Entry + 2);
+            OutPacket.Sensors[i].Slot = INDEX_NONE;
+        }
+        return true;
+    }
+
+    void EncodePacket(const FPeopleCountPacket& Packet, TArray<uint8>& OutBytes)
+    {
+        const bool bHasRequestId = Packet.RequestId >= 0;
+        TCHAR HubId[NAME_SIZE];
+        const int32 HubIdLen = Packet.Source.IsNone() ? 0 : FMath::Min<int32>(Packet.Source.ToString(HubId), MAX_uint8);
+        const int32 HubIdOffset = HeaderSize + (bHasRequestId ? RequestIdSize : 0);
+        const int32 EntriesOffset = HubIdOffset + (HubIdLen > 0 ? 1 + HubIdLen : 0);
+        OutBytes.SetNumUninitialized(EntriesOffset + Packet.Sensors.Num() * EntrySize, EAllowShrinking::No);
+        uint8* Data = OutBytes.GetData();
+
+        FMemory::Memcpy(Data, Magic, sizeof(Magic));
+        Data[4] = Version;
+        Data[5] = (Packet.Type == PeopleCounter::TypeDeltaCounts ? FlagDelta : 0) | (bHasRequestId ? FlagRequestId : 0) | (HubIdLen > 0 ? FlagHubId : 0);
+        WriteLE<uint32>(Data + 8, static_cast<uint32>(FMath::Max<int64>(Packet.Sequence, 0)));
+        WriteLE<double>(Data + 12, Packet.Timestamp);
+        if (bHasRequestId)
+        {
+            WriteLE<uint32>(Data + HeaderSize, static_cast<uint32>(Packet.RequestId));
+        }
+        if (HubIdLen > 0)
+        {
+            // Solo ASCII sul filo
+            Data[HubIdOffset] = static_cast<uint8>(HubIdLen);
+            for (int32 i = 0; i < HubIdLen; ++i)
+            {
+                Data[HubIdOffset + 1 + i] = HubId[i] < 128 ? static_cast<uint8>(HubId[i]) : '?';
+            }
+        }
+
+        uint16 NumEntries = 0;
+        uint8* Entry = Data + EntriesOffset;
+        for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+        {
+            const int32 Index = SensorIndexFromName(Sensor.Id);
+            if (Index == INDEX_NONE) continue;
+            WriteLE<uint16>(Entry, static_cast<uint16>(Index));
+            WriteLE<uint16>(Entry + 2, static_cast<uint16>(FMath::Clamp(Sensor.Count, 0, static_cast<int32>(MAX_uint16))));
+            Entry += EntrySize;
+            ++NumEntries;
+        }
+        WriteLE<uint16>(Data + 6, NumEntries);
+        OutBytes.SetNum(EntriesOffset + NumEntries * EntrySize, EAllowShrinking::No);
+    }
+}
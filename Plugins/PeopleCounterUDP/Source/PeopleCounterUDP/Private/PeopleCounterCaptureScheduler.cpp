@@ -0,0 +1,212 @@
+#include "PeopleCounterCaptureScheduler.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "Misc/DateTime.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterSchedule, Log, All);
+
+namespace
+{
+    // Ultimo tratto prima dello slot in giro stretto: l'attesa sull'evento puo' sforare di un tick del timer
+    constexpr double SpinSeconds = 0.002;
+    // Passo massimo di attesa sull'evento
+    constexpr double MaxWaitStepSeconds = 0.1;
+    // Ogni quanto si rilegge l'orologio di sistema per seguire le correzioni NTP
+    constexpr double WallClockResampleSeconds = 10.0;
+    constexpr float MinIntervalSeconds = 0.01f;
+}
+
+FPeopleCounterCaptureScheduler::FPeopleCounterCaptureScheduler(FSocket* InSocket, const TSharedRef<FInternetAddr>& InTargetAddr,
+    const FPeopleCounterCaptureScheduleSettings& InSettings)
+    : Settings(InSettings)
+    , Socket(InSocket)
+    , TargetAddr(InTargetAddr)
+{
+    Stats.IntervalSeconds = FMath::Max(Settings.IntervalSeconds, MinIntervalSeconds);
+    Stats.bAlignedToWallClock = Settings.bAlignToWallClock;
+}
+
+FPeopleCounterCaptureScheduler::~FPeopleCounterCaptureScheduler()
+{
+    StopAndWait();
+}
+
+bool FPeopleCounterCaptureScheduler::Start()
+{
+    if (Thread) return true;
+    if (!Socket || Settings.Payload.Num() == 0)
+    {
+        UE_LOG(LogPeopleCounterSchedule, Error, TEXT("Scheduled capture needs a socket and a payload"));
+        return false;
+    }
+
+    bStopping = false;
+    bFinished = false;
+    WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+    // Il thread dorme quasi sempre: la priorita' alta serve solo a svegliarsi in orario
+    Thread = FRunnableThread::Create(this, TEXT("PeopleCounterUDP_Schedule"), 64 * 1024, TPri_TimeCritical);
+    UE_LOG(LogPeopleCounterSchedule, Log, TEXT("Scheduled capture -> %s every %.3f s%s"),
+        *TargetAddr->ToString(true), Stats.IntervalSeconds,
+        Settings.bAlignToWallClock ? *FString::Printf(TEXT(", aligned to wall clock (phase %.3f s)"), Settings.PhaseSeconds) : TEXT(""));
+    return true;
+}
+
+void FPeopleCounterCaptureScheduler::Stop()
+{
+    bStopping = true;
+    if (WakeEvent)
+    {
+        WakeEvent->Trigger();
+    }
+}
+
+void FPeopleCounterCaptureScheduler::StopAndWait()
+{
+    if (Thread)
+    {
+        Stop();
+        Thread->WaitForCompletion();
+        delete Thread;
+        Thread = nullptr;
+    }
+    if (WakeEvent)
+    {
+        FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+        WakeEvent = nullptr;
+    }
+    if (Socket)
+    {
+        Socket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+        Socket = nullptr;
+    }
+}
+
+void FPeopleCounterCaptureScheduler::SetInterval(float IntervalSeconds)
+{
+    {
+        FScopeLock Lock(&Mutex);
+        PendingIntervalSeconds = FMath::Max(IntervalSeconds, MinIntervalSeconds);
+        bIntervalChanged = true;
+    }
+    if (WakeEvent)
+    {
+        WakeEvent->Trigger();
+    }
+}
+
+FPeopleCounterScheduleStats FPeopleCounterCaptureScheduler::GetStats() const
+{
+    FScopeLock Lock(&Mutex);
+    FPeopleCounterScheduleStats Out = Stats;
+    Out.bRunning = IsRunning();
+    return Out;
+}
+
+void FPeopleCounterCaptureScheduler::SampleWallClockOffset()
+{
+    WallClockOffsetSeconds = (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalSeconds() - FPlatformTime::Seconds();
+}
+
+double FPeopleCounterCaptureScheduler::NextSlotAfter(double NowSeconds, double IntervalSeconds) const
+{
+    const double Wall = NowSeconds + WallClockOffsetSeconds - Settings.PhaseSeconds;
+    const double Slot = (FMath::FloorToDouble(Wall / IntervalSeconds) + 1.0) * IntervalSeconds;
+    return Slot + Settings.PhaseSeconds - WallClockOffsetSeconds;
+}
+
+uint32 FPeopleCounterCaptureScheduler::Run()
+{
+    SampleWallClockOffset();
+    double NowSeconds = FPlatformTime::Seconds();
+    double NextResampleSeconds = NowSeconds + WallClockResampleSeconds;
+    double Interval = Stats.IntervalSeconds;
+    // Senza allineamento il primo invio parte subito
+    double NextSlot = Settings.bAlignToWallClock ? NextSlotAfter(NowSeconds, Interval) : NowSeconds;
+    double LastSlot = 0.0;
+
+    while (!bStopping)
+    {
+        {
+            FScopeLock Lock(&Mutex);
+            if (bIntervalChanged)
+            {
+                bIntervalChanged = false;
+                Interval = PendingIntervalSeconds;
+                Stats.IntervalSeconds = PendingIntervalSeconds;
+                NowSeconds = FPlatformTime::Seconds();
+                NextSlot = Settings.bAlignToWallClock ? NextSlotAfter(NowSeconds, Interval)
+                    : (LastSlot > 0.0 ? FMath::Max(NowSeconds, LastSlot + Interval) : NowSeconds);
+            }
+        }
+
+        NowSeconds = FPlatformTime::Seconds();
+        const double RemainingSeconds = NextSlot - NowSeconds;
+        if (RemainingSeconds > SpinSeconds)
+        {
+            const double WaitSeconds = FMath::Min(RemainingSeconds - SpinSeconds, MaxWaitStepSeconds);
+            WakeEvent->Wait(FMath::Max(1u, static_cast<uint32>(WaitSeconds * 1000.0)));
+            continue;
+        }
+        while (!bStopping && (NowSeconds = FPlatformTime::Seconds()) < NextSlot)
+        {
+            FPlatformProcess::YieldThread();
+        }
+        if (bStopping) break;
+
+        int32 BytesSent = 0;
+        const bool bSent = Socket->SendTo(Settings.Payload.GetData(), Settings.Payload.Num(), BytesSent, *TargetAddr);
+        const double LatenessUs = (NowSeconds - NextSlot) * 1e6;
+        {
+            FScopeLock Lock(&Mutex);
+            if (bSent)
+            {
+                ++Stats.CapturesSent;
+                LatenessTotalUs += LatenessUs;
+                Stats.LatenessMeanUs = static_cast<float>(LatenessTotalUs / Stats.CapturesSent);
+                Stats.LatenessMaxUs = FMath::Max(Stats.LatenessMaxUs, static_cast<float>(LatenessUs));
+            }
+            else
+            {
+                ++Stats.SendFailures;
+            }
+            Stats.LastSlotUnixSeconds = NextSlot + WallClockOffsetSeconds;
+        }
+        LastSlot = NextSlot;
+
+        if (NowSeconds >= NextResampleSeconds)
+        {
+            SampleWallClockOffset();
+            NextResampleSeconds = NowSeconds + WallClockResampleSeconds;
+        }
+
+        // Slot successivo; quelli gia' passati (thread sospeso) si saltano invece di recuperarli a raffica
+        double Following = 0.0;
+        if (Settings.bAlignToWallClock)
+        {
+            // Mezzo periodo di margine: un offset ricampionato all'indietro non ripete lo stesso slot
+            Following = NextSlotAfter(FMath::Max(NowSeconds, NextSlot + 0.5 * Interval), Interval);
+        }
+        else
+        {
+            Following = NextSlot + Interval;
+            if (Following <= NowSeconds)
+            {
+                Following += (FMath::FloorToDouble((NowSeconds - Following) / Interval) + 1.0) * Interval;
+            }
+        }
+        const int64 Missed = FMath::RoundToInt64((Following - NextSlot) / Interval) - 1;
+        if (Missed > 0)
+        {
+            FScopeLock Lock(&Mutex);
+            Stats.MissedSlots += Missed;
+        }
+        NextSlot = Following;
+    }
+
+    bFinished = true;
+    return 0;
+}
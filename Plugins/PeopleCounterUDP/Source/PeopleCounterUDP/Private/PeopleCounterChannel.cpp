@@ -0,0 +1,1621 @@
+#include "PeopleCounterChannel.h"
+
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Misc/ScopeRWLock.h"
+#include "Async/Async.h"
+#include "Misc/ScopeExit.h"
+#include "CoreGlobals.h"
+#include "Tasks/Pipe.h"
+#include "Features/IModularFeatures.h"
+#include "PeopleCounterJsonLib.h"
+#include "PeopleCounterBinaryProtocol.h"
+#include "PeopleCounterFragmentProtocol.h"
+#include "PeopleCounterUDPStats.h"
+#include "PeopleCounterReceiveWorker.h"
+#include "PeopleCounterPacketPool.h"
+#include "PeopleCounterClusterBridge.h"
+#include "PeopleCounterSessionRecorder.h"
+#include "PeopleCounterSessionReplay.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterUDP_RX, Log, All);
+
+namespace
+{
+    // Un salto all'indietro piu' ampio e' un riavvio dell'hub, non un riordino
+    constexpr int64 SequenceRestartWindow = 1024;
+
+    // Limiti superiori dei bucket di latenza (ms)
+    constexpr float LatencyBucketUpperMs[] = { 1.f, 2.f, 5.f, 10.f, 20.f, 35.f, 50.f, 100.f, 200.f, 500.f, 1000.f, 5000.f };
+
+    static_assert(UE_ARRAY_COUNT(LatencyBucketUpperMs) == 12, "Update FPeopleCounterChannel::NumLatencyBuckets");
+
+    // UTF-8 -> FString riusando la capacita' gia' allocata della stringa
+    void AssignUtf8(FString& Out, const uint8* Data, int32 Num)
+    {
+        const UTF8CHAR* Source = reinterpret_cast<const UTF8CHAR*>(Data);
+        const int32 Length = FPlatformString::ConvertedLength<TCHAR>(Source, Num);
+        TArray<TCHAR, FString::AllocatorType>& Chars = Out.GetCharArray();
+        Chars.SetNumUninitialized(Length + 1, EAllowShrinking::No);
+        FPlatformString::Convert(Chars.GetData(), Length, Source, Num);
+        Chars[Length] = TEXT('\0');
+    }
+
+    // snapshot_counts equivalente a un delta gia' applicato, per chi legge il JSON grezzo
+    void BuildSnapshotJson(const FPeopleCountPacket& Packet, const TArray<FPeopleCountSensor>& Sensors, FString& Out)
+    {
+        Out.Reset();
+        Out.Appendf(TEXT("{\"schema\":\"%s\",\"type\":\"%s\",\"timestamp\":%.6f,\"seq\":%lld"),
+            *Packet.Schema.ToString(), *PeopleCounter::TypeSnapshotCounts.ToString(), Packet.Timestamp, Packet.Sequence);
+        if (!Packet.Source.IsNone())
+        {
+            Out.Appendf(TEXT(",\"hub_id\":\"%s\""), *Packet.Source.ToString().ReplaceCharWithEscapedChar());
+        }
+        if (Packet.RequestId >= 0)
+        {
+            Out.Appendf(TEXT(",\"request_id\":%lld"), Packet.RequestId);
+        }
+        Out += TEXT(",\"sensors\":[");
+        for (int32 i = 0; i < Sensors.Num(); ++i)
+        {
+            Out.Appendf(TEXT("%s{\"id\":\"%s\",\"count\":%d}"), i > 0 ? TEXT(",") : TEXT(""),
+                *Sensors[i].Id.ToString().ReplaceCharWithEscapedChar(), Sensors[i].Count);
+        }
+        Out += TEXT("]}");
+    }
+
+    // I chunk devono piastrellare il messaggio come split_fragments dell'hub: tutti di ChunkSize
+    // byte a Index * ChunkSize, l'ultimo piu' corto fino a TotalSize. ChunkSize (0 = ignoto)
+    // viene fissato dal primo chunk che lo determina e controllato sugli altri.
+    bool MatchesChunkLayout(const PeopleCounter::Fragment::FHeader& Header, int32& ChunkSize)
+    {
+        const bool bLast = Header.ChunkIndex == Header.ChunkCount - 1;
+        int32 Size = Header.PayloadSize;
+        if (bLast && Header.ChunkCount > 1)
+        {
+            if (Header.Offset % (Header.ChunkCount - 1) != 0) return false;
+            Size = Header.Offset / (Header.ChunkCount - 1);
+        }
+        if (Size <= 0 || (ChunkSize != 0 && ChunkSize != Size)) return false;
+        if (static_cast<int64>(Header.ChunkIndex) * Size != Header.Offset) return false;
+        if (bLast && (Header.PayloadSize > Size || Header.Offset + Header.PayloadSize != Header.TotalSize)) return false;
+        const int64 FullChunksBytes = static_cast<int64>(Header.ChunkCount - 1) * Size;
+        if (FullChunksBytes >= Header.TotalSize || FullChunksBytes + Size < Header.TotalSize) return false;
+        ChunkSize = Size;
+        return true;
+    }
+
+    double UnixNowSeconds()
+    {
+        return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalSeconds();
+    }
+
+    // Slot -> indice nello stato ricostruito; INDEX_NONE dove il sensore non c'e'
+    void GrowSlotIndex(TArray<int32>& IndexBySlot, int32 Slot)
+    {
+        if (Slot >= IndexBySlot.Num())
+        {
+            IndexBySlot.Reserve(Slot + 1);
+            while (IndexBySlot.Num() <= Slot)
+            {
+                IndexBySlot.Add(INDEX_NONE);
+            }
+        }
+    }
+}
+
+FString FPeopleCounterChannelSettings::GetKey() const
+{
+    FString Key = FString::Printf(TEXT("%s:%d"), *ListenAddress, ListenPort);
+    for (const int32 Port : AdditionalPorts)
+    {
+        Key += FString::Printf(TEXT("+%d"), Port);
+    }
+    if (!MulticastGroup.IsEmpty())
+    {
+        Key += TEXT("@") + MulticastGroup;
+    }
+    return Key;
+}
+
+IPeopleCounterClusterBridge* IPeopleCounterClusterBridge::Get()
+{
+    IModularFeatures& Features = IModularFeatures::Get();
+    if (!Features.IsModularFeatureAvailable(GetModularFeatureName())) return nullptr;
+    return &Features.GetModularFeature<IPeopleCounterClusterBridge>(GetModularFeatureName());
+}
+
+FPeopleCounterChannel::FSource::~FSource() = default;
+
+FPeopleCounterChannel::FPeopleCounterChannel(const FPeopleCounterChannelSettings& InSettings)
+    : Settings(InSettings)
+    , Recorder(MakeUnique<FPeopleCounterSessionRecorder>())
+{
+    // Senza parsing il JSON grezzo e' l'unica cosa consegnabile
+    Settings.bRawJson = Settings.bRawJson || !Settings.bParse;
+    Settings.ResyncCooldownSeconds = FMath::Max(0.f, Settings.ResyncCooldownSeconds);
+    Settings.AdditionalPorts.Remove(Settings.ListenPort);
+
+    // Profilo 0 per tutti, poi uno per ogni sensore con impostazioni proprie
+    TArray<FPeopleCounterFilterSettings> Profiles;
+    Profiles.Add(Settings.CountFilter);
+    for (const TPair<FName, FPeopleCounterFilterSettings>& Pair : Settings.SensorFilters)
+    {
+        Profiles.Add(Pair.Value);
+    }
+    CountFilter.SetProfiles(Profiles);
+}
+
+// Definito qui dove FPeopleCounterReceiveWorker, il pool e FPipe sono completi
+FPeopleCounterChannel::~FPeopleCounterChannel()
+{
+    Stop();
+}
+
+void FPeopleCounterChannel::RegisterSensors(TConstArrayView<FName> SensorIds)
+{
+    for (const FName& SensorId : SensorIds)
+    {
+        SensorRegistry->FindOrAddSlot(SensorId);
+    }
+}
+
+bool FPeopleCounterChannel::CreateSockets()
+{
+    if (ListenSockets.Num() > 0) return true;
+
+    FIPv4Address Group;
+    FIPv4Address Interface = FIPv4Address::Any;
+    const bool bMulticast = !Settings.MulticastGroup.IsEmpty();
+    if (bMulticast)
+    {
+        if (!FIPv4Address::Parse(Settings.MulticastGroup, Group) || !Group.IsMulticastAddress())
+        {
+            UE_LOG(LogPeopleCounterUDP_RX, Error, TEXT("Invalid MulticastGroup: %s"), *Settings.MulticastGroup);
+            return false;
+        }
+        if (!Settings.MulticastInterface.IsEmpty() && !FIPv4Address::Parse(Settings.MulticastInterface, Interface))
+        {
+            UE_LOG(LogPeopleCounterUDP_RX, Error, TEXT("Invalid MulticastInterface: %s"), *Settings.MulticastInterface);
+            return false;
+        }
+    }
+
+    TArray<int32> Ports;
+    Ports.Add(Settings.ListenPort);
+    Ports.Append(Settings.AdditionalPorts);
+
+    for (const int32 Port : Ports)
+    {
+        bool bIsValid = false;
+        TSharedRef<FInternetAddr> Addr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+        Addr->SetIp(*Settings.ListenAddress, bIsValid);
+        if (!bIsValid)
+        {
+            UE_LOG(LogPeopleCounterUDP_RX, Error, TEXT("Invalid ListenAddress: %s"), *Settings.ListenAddress);
+            DestroySockets();
+            return false;
+        }
+        Addr->SetPort(Port);
+
+        FUdpSocketBuilder Builder = FUdpSocketBuilder(TEXT("PeopleCounterUDP_RX"))
+            .AsNonBlocking()
+            .AsReusable()
+            .BoundToEndpoint(FIPv4Endpoint(Addr))
+            .WithReceiveBufferSize(2 * 1024 * 1024);
+        if (bMulticast)
+        {
+            // Ogni nodo del cluster si iscrive allo stesso gruppo: un invio dell'hub, nessun relay
+            Builder.JoinedToGroup(Group, Interface);
+            if (Settings.bMulticastLoopback)
+            {
+                Builder.WithMulticastLoopback();
+            }
+        }
+
+        FSocket* Socket = Builder.Build();
+        if (!Socket)
+        {
+            UE_LOG(LogPeopleCounterUDP_RX, Error, TEXT("Failed to create UDP listen socket on port %d."), Port);
+            DestroySockets();
+            return false;
+        }
+        ListenSockets.Add(Socket);
+    }
+    return true;
+}
+
+void FPeopleCounterChannel::DestroySockets()
+{
+    for (TUniquePtr<FUdpSocketReceiver>& SocketReceiver : SocketReceivers)
+    {
+        SocketReceiver->Stop();
+    }
+    SocketReceivers.Reset();
+    for (TUniquePtr<FPeopleCounterReceiveWorker>& ReceiveWorker : ReceiveWorkers)
+    {
+        ReceiveWorker->StopAndWait();
+    }
+    ReceiveWorkers.Reset();
+    for (FSocket* Socket : ListenSockets)
+    {
+        Socket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+    }
+    ListenSockets.Reset();
+}
+
+bool FPeopleCounterChannel::Start()
+{
+    if (bRunning) return true;
+
+    // Nodo secondario di un cluster: nessun socket, lo stato arriva dal primario
+    IPeopleCounterClusterBridge* Bridge = Settings.bClusterSync ? IPeopleCounterClusterBridge::Get() : nullptr;
+    ClusterBridge = Bridge && Bridge->IsClusterActive() ? Bridge : nullptr;
+    bClusterSecondary = ClusterBridge && !ClusterBridge->IsPrimaryNode();
+    if (bClusterSecondary)
+    {
+        ++RunGeneration;
+        ResetStats();
+        bRunning = true;
+        UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("UDP Receiver %s: cluster secondary, state comes from the primary node"), *Settings.GetKey());
+        return true;
+    }
+    if (!CreateSockets()) return false;
+
+    ++RunGeneration;
+    bUsePipes = Settings.bParallelSources || ListenSockets.Num() > 1;
+    ResetStats();
+    // Gli hub ripartono da capo: niente storia da prima dello Stop
+    CountFilter.Reset();
+    RateWindowStartMicros = static_cast<int64>(FPlatformTime::Seconds() * 1e6);
+    RateWindowPackets = 0;
+    if (Settings.DispatchMode != EPeopleCounterDispatchMode::PerPacket)
+    {
+        // Svuotata una volta per frame, indipendentemente da world e componenti
+        DrainTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FPeopleCounterChannel::TickDrain));
+    }
+    // Tutti i buffer di ricezione esistono da qui in poi; il thread RX non alloca piu'
+    PacketPool = MakeShared<FPacketPool, ESPMode::ThreadSafe>(FMath::Max(1, Settings.PacketPoolSize));
+
+    // Raw: i thread RX vengono fermati in Stop prima che il canale sparisca
+    for (FSocket* Socket : ListenSockets)
+    {
+        if (Settings.ReceiveMode == EPeopleCounterReceiveMode::BlockingThread)
+        {
+            TUniquePtr<FPeopleCounterReceiveWorker>& ReceiveWorker = ReceiveWorkers.Add_GetRef(MakeUnique<FPeopleCounterReceiveWorker>(
+                Socket, FTimespan::FromMilliseconds(FMath::Max(1, Settings.ReceiveWaitMilliseconds)), TEXT("PeopleCounterUDP_RX")));
+            ReceiveWorker->OnDatagram().BindRaw(this, &FPeopleCounterChannel::HandleDatagram, false);
+            ReceiveWorker->Start();
+        }
+        else
+        {
+            TUniquePtr<FUdpSocketReceiver>& SocketReceiver = SocketReceivers.Add_GetRef(MakeUnique<FUdpSocketReceiver>(
+                Socket, FTimespan::FromMilliseconds(2), TEXT("PeopleCounterUDP_RX")));
+            SocketReceiver->OnDataReceived().BindRaw(this, &FPeopleCounterChannel::HandlePacket);
+            SocketReceiver->Start();
+        }
+    }
+
+    bRunning = true;
+    UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("UDP Receiver started on %s%s%s"), *Settings.GetKey(),
+        bUsePipes ? TEXT(" (parallel sources)") : TEXT(""), ClusterBridge ? TEXT(" (cluster primary)") : TEXT(""));
+    return true;
+}
+
+void FPeopleCounterChannel::Stop()
+{
+    if (!bRunning) return;
+    bRunning = false;
+    // Prima si fermano i thread RX (e il replay) e il lavoro delle sorgenti, poi si liberano le code che alimentano
+    StopReplay();
+    DestroySockets();
+    // Senza thread RX la mappa non cambia piu'; niente lock: RenameSource in una pipe lo vuole in scrittura
+    for (const TPair<FSourceKey, TUniquePtr<FSource>>& Pair : Sources)
+    {
+        if (Pair.Value->Pipe)
+        {
+            Pair.Value->Pipe->WaitUntilEmpty();
+        }
+    }
+    if (DrainTickerHandle.IsValid())
+    {
+        FTSTicker::GetCoreTicker().RemoveTicker(DrainTickerHandle);
+        DrainTickerHandle.Reset();
+    }
+    {
+        FRWScopeLock Lock(SourcesLock, SLT_Write);
+        Sources.Reset();
+    }
+    // I dispatch PerPacket ancora in volo tengono vivo il pool fino al rilascio
+    PacketPool.Reset();
+    ClusterBridge = nullptr;
+    bClusterSecondary = false;
+    UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("UDP Receiver stopped on %s"), *Settings.GetKey());
+}
+
+bool FPeopleCounterChannel::StartRecording(const FString& Path)
+{
+    return Recorder->Start(Path);
+}
+
+void FPeopleCounterChannel::StopRecording()
+{
+    Recorder->Stop();
+}
+
+bool FPeopleCounterChannel::IsRecording() const
+{
+    return Recorder->IsRecording();
+}
+
+bool FPeopleCounterChannel::StartReplay(const FString& Path, float Speed, bool bLoop)
+{
+    StopReplay();
+    if (!bRunning || !PacketPool)
+    {
+        UE_LOG(LogPeopleCounterUDP_RX, Warning, TEXT("UDP Receiver %s: replay needs a running channel that receives locally"), *Settings.GetKey());
+        return false;
+    }
+    TUniquePtr<FPeopleCounterSessionReplay> NewReplay = MakeUnique<FPeopleCounterSessionReplay>();
+    if (!NewReplay->Open(Path)) return false;
+
+    // Come un thread RX in piu', stesso pool; sorgenti sue anche se l'hub registrato trasmette ancora dal vivo
+    NewReplay->OnDatagram().BindRaw(this, &FPeopleCounterChannel::HandleDatagram, true);
+    // Pacchetti in volo sotto la coda verso il GameThread e con margine per i thread RX veri
+    const int32 MaxInFlight = FMath::Max(1, FMath::Min(PacketPool->GetCapacity() * 3 / 4, Settings.MaxQueuedPackets / 2));
+    NewReplay->OnCanSend().BindLambda([Pool = PacketPool, MaxInFlight]()
+    {
+        return Pool->GetCapacity() - Pool->GetNumFree() < MaxInFlight;
+    });
+    Replay = MoveTemp(NewReplay);
+    Replay->Start(Speed, bLoop);
+    UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("UDP Receiver %s: replaying %s at %s"), *Settings.GetKey(), *Path,
+        Speed > 0.f ? *FString::Printf(TEXT("%.2fx"), Speed) : TEXT("full speed"));
+    return true;
+}
+
+void FPeopleCounterChannel::StopReplay()
+{
+    if (Replay)
+    {
+        Replay->StopAndWait();
+        Replay.Reset();
+    }
+}
+
+bool FPeopleCounterChannel::IsReplaying() const
+{
+    return Replay && Replay->IsRunning();
+}
+
+FPeopleCounterSensorRegistry* FPeopleCounterChannel::FindOrAddSourceRegistry(FName Name)
+{
+    {
+        FRWScopeLock Lock(SourceRegistriesLock, SLT_ReadOnly);
+        if (const TSharedRef<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>* Found = SourceRegistries.Find(Name))
+        {
+            return &Found->Get();
+        }
+    }
+    FRWScopeLock Lock(SourceRegistriesLock, SLT_Write);
+    if (const TSharedRef<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>* Found = SourceRegistries.Find(Name))
+    {
+        return &Found->Get();
+    }
+    return &SourceRegistries.Add(Name, MakeShared<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>()).Get();
+}
+
+FPeopleCounterChannel::FSource& FPeopleCounterChannel::FindOrAddSource(const FIPv4Endpoint& Endpoint, bool bReplayed)
+{
+    const FSourceKey Key { Endpoint, bReplayed };
+    {
+        FRWScopeLock Lock(SourcesLock, SLT_ReadOnly);
+        if (const TUniquePtr<FSource>* Found = Sources.Find(Key))
+        {
+            return **Found;
+        }
+    }
+
+    // Primo datagram da questo mittente: unica allocazione per sorgente
+    TUniquePtr<FSource> NewSource = MakeUnique<FSource>();
+    NewSource->Endpoint = Endpoint;
+    // Senza hub_id il replay non scrive nel registro del mittente dal vivo
+    NewSource->EndpointName = FName(bReplayed ? *FString::Printf(TEXT("%s (replay)"), *Endpoint.ToString()) : *Endpoint.ToString());
+    NewSource->Name = NewSource->EndpointName;
+    NewSource->Registry = FindOrAddSourceRegistry(NewSource->Name);
+    NewSource->FastParseScratch.SetNum(FastParseMaxSensors);
+    NewSource->FastParsePointScratch.SetNum(FastParseMaxPoints);
+    NewSource->Reassemblies.SetNum(FSource::MaxReassemblies);
+    if (bUsePipes)
+    {
+        NewSource->Pipe = MakeUnique<UE::Tasks::FPipe>(TEXT("PeopleCounterUDP_Source"));
+    }
+    if (Settings.DispatchMode != EPeopleCounterDispatchMode::PerPacket)
+    {
+        // TCircularQueue tiene uno slot libero: +1 per avere esattamente MaxQueuedPackets.
+        // In Coalesced la coda porta solo i pacchetti che non sono snapshot_counts.
+        NewSource->PendingPackets = MakeUnique<TCircularQueue<FReceivedPacket*>>(FMath::Max(1, Settings.MaxQueuedPackets) + 1);
+    }
+
+    FRWScopeLock Lock(SourcesLock, SLT_Write);
+    // Un altro thread RX (altra porta) puo' averla appena aggiunta
+    if (const TUniquePtr<FSource>* Found = Sources.Find(Key))
+    {
+        return **Found;
+    }
+    UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("New source %s"), *NewSource->EndpointName.ToString());
+    return *Sources.Add(Key, MoveTemp(NewSource));
+}
+
+void FPeopleCounterChannel::RenameSource(FSource& Source, FName NewName)
+{
+    UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("Source %s is hub '%s'"), *Source.Endpoint.ToString(), *NewName.ToString());
+    FPeopleCounterSensorRegistry* Registry = FindOrAddSourceRegistry(NewName);
+    {
+        // GetSources legge il nome dal GameThread
+        FRWScopeLock Lock(SourcesLock, SLT_Write);
+        Source.Name = NewName;
+        Source.bQualified = true;
+        Source.Registry = Registry;
+    }
+    // Slot diversi: lo stato ricostruito va rifatto dal prossimo keyframe
+    Source.MergedSlotBySourceSlot.Reset();
+    Source.Stream.StateSensors.Reset();
+    Source.Stream.StateIndexBySlot.Reset();
+    Source.Stream.bSynced = false;
+    Source.bSynced = false;
+}
+
+void FPeopleCounterChannel::ResolveSource(FSource& Source, FReceivedPacket& Received)
+{
+    FPeopleCountPacket& Packet = Received.Packet;
+    if (!Packet.Source.IsNone() && Packet.Source != Source.Name)
+    {
+        RenameSource(Source, Packet.Source);
+    }
+    Packet.Source = Source.Name;
+    Received.SourceRegistry = Source.Registry;
+    Received.bQualifiedIds = Source.bQualified;
+
+    // Slot della sorgente, poi slot del registro unito (stringhe solo la prima volta)
+    Source.Registry->ResolveSlots(Packet.Sensors);
+    for (FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        Sensor.SourceSlot = Sensor.Slot;
+        if (Sensor.SourceSlot == INDEX_NONE) continue;
+
+        GrowSlotIndex(Source.MergedSlotBySourceSlot, Sensor.SourceSlot);
+        int32& Merged = Source.MergedSlotBySourceSlot[Sensor.SourceSlot];
+        if (Merged == INDEX_NONE)
+        {
+            const FName MergedId = Source.bQualified
+                ? FName(*FString::Printf(TEXT("%s.%s"), *Source.Name.ToString(), *Sensor.Id.ToString()))
+                : Sensor.Id;
+            Merged = SensorRegistry->FindOrAddSlot(MergedId);
+        }
+        Sensor.Slot = Merged;
+    }
+}
+
+void FPeopleCounterChannel::BuildReceivedPacket(FSource& Source, const uint8* Data, int32 Num, FReceivedPacket& Out)
+{
+    // Buffer riusati: Reset mantiene la capacita'. Con le pipe il datagram e' gia' in RawBytes.
+    const bool bOwnedBytes = Data == Out.RawBytes.GetData();
+    Out.bParsed = false;
+    Out.bDeferredJson = false;
+    Out.bSnapshotJson = false;
+    Out.Json.Reset();
+    if (!bOwnedBytes)
+    {
+        Out.RawBytes.Reset();
+    }
+
+    if (PeopleCounter::Binary::IsBinaryPacket(Data, Num))
+    {
+        // people_count_v2: nessuna stringa, nessun JSON grezzo da consegnare
+        Out.bParsed = PeopleCounter::Binary::DecodePacket(Data, Num, Out.Packet);
+        if (!Out.bParsed)
+        {
+            // Un header mezzo decodificato non deve rinominare la sorgente ne' registrare sensori
+            ++ParseFailureCount;
+            Out.Packet.Reset();
+            return;
+        }
+        ResolveSource(Source, Out);
+        if (Settings.bLogPackets)
+        {
+            UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("RX from %s: binary v2 seq=%lld sensors=%d"),
+                *Source.Name.ToString(), Out.Packet.Sequence, Out.Packet.Sensors.Num());
+        }
+        return;
+    }
+
+    if (Settings.bParse)
+    {
+        // Parser veloce direttamente sui byte UTF-8, nessuna FString intermedia
+        Out.bParsed = UPeopleCounterJsonLib::ParsePeopleCountPacketUtf8(Data, Num, Source.FastParseScratch, Out.Packet, Source.FastParsePointScratch);
+        if (!Out.bParsed)
+        {
+            ++ParseFailureCount;
+        }
+    }
+    else
+    {
+        Out.Packet.Reset();
+    }
+    ResolveSource(Source, Out);
+
+    if (Settings.bRawJson)
+    {
+        if (Settings.DispatchMode == EPeopleCounterDispatchMode::Coalesced)
+        {
+            // Conversione rimandata al dispatch: i pacchetti superati non la pagano mai
+            if (!bOwnedBytes)
+            {
+                Out.RawBytes.Append(Data, Num);
+            }
+            Out.bDeferredJson = true;
+        }
+        else
+        {
+            PEOPLECOUNTER_SCOPE(Utf8Convert);
+            AssignUtf8(Out.Json, Data, Num);
+        }
+    }
+
+    if (Settings.bLogPackets)
+    {
+        FUTF8ToTCHAR Conv(reinterpret_cast<const ANSICHAR*>(Data), Num);
+        UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("RX from %s: %s"), *Source.Name.ToString(), *FString(Conv.Length(), Conv.Get()));
+    }
+}
+
+void FPeopleCounterChannel::HandlePacket(const FArrayReaderPtr& Data, const FIPv4Endpoint& Endpoint)
+{
+    // FUdpSocketReceiver alloca gia' un FArrayReader per datagram; da qui in poi come il worker
+    HandleDatagram(Data->GetData(), Data->Num(), Endpoint, false);
+}
+
+void FPeopleCounterChannel::UpdateRateWindow()
+{
+    // Finestra di un secondo per stat/CSV "Packets/s"; la chiude un solo thread RX
+    ++RateWindowPackets;
+    const int64 NowMicros = static_cast<int64>(FPlatformTime::Seconds() * 1e6);
+    int64 WindowStart = RateWindowStartMicros.Load(EMemoryOrder::Relaxed);
+    if (NowMicros - WindowStart >= 1000000 && RateWindowStartMicros.CompareExchange(WindowStart, NowMicros))
+    {
+        const int32 PacketsPerSecond = FMath::RoundToInt32(RateWindowPackets.Exchange(0) * 1e6 / (NowMicros - WindowStart));
+        SET_DWORD_STAT(STAT_PeopleCounterUDP_PacketsPerSecond, PacketsPerSecond);
+        CSV_CUSTOM_STAT(PeopleCounterUDP, PacketsPerSecond, PacketsPerSecond, ECsvCustomStatOp::Set);
+    }
+}
+
+void FPeopleCounterChannel::HandleDatagram(const uint8* Data, int32 Num, const FIPv4Endpoint& Endpoint, bool bReplayed)
+{
+    PEOPLECOUNTER_SCOPE(Receive);
+    INC_DWORD_STAT(STAT_PeopleCounterUDP_PacketsReceived);
+    const double ArrivalSeconds = FPlatformTime::Seconds();
+    if (Recorder->IsRecording())
+    {
+        Recorder->Append(Data, Num, Endpoint, ArrivalSeconds);
+    }
+
+    ++PacketsReceivedCount;
+    BytesReceivedCount += Num;
+    UpdateRateWindow();
+
+    FSource& Source = FindOrAddSource(Endpoint, bReplayed);
+    ++Source.PacketsReceived;
+    if (Source.NumReassembling > 0)
+    {
+        ExpireReassemblies(Source, ArrivalSeconds);
+    }
+    if (PeopleCounter::Fragment::IsFragment(Data, Num))
+    {
+        HandleFragment(Source, Endpoint, ArrivalSeconds, Data, Num);
+        return;
+    }
+
+    FReceivedPacket* Received = PacketPool->Acquire();
+    if (!Received)
+    {
+        // GameThread in ritardo di PacketPoolSize pacchetti: si scarta come una coda piena
+        ++PacketPoolExhaustedCount;
+        DropInSourceContext(Source);
+        return;
+    }
+    Received->Endpoint = Endpoint;
+    Received->ArrivalSeconds = ArrivalSeconds;
+
+    if (!Source.Pipe)
+    {
+        ProcessReceived(Source, Received, Data, Num);
+        return;
+    }
+
+    // Il buffer del thread RX viene riusato subito: il worker lavora su una copia nel pacchetto
+    Received->RawBytes.Reset();
+    Received->RawBytes.Append(Data, Num);
+    ProcessOwnedPacket(Source, Received);
+}
+
+void FPeopleCounterChannel::ProcessOwnedPacket(FSource& Source, FReceivedPacket* Received)
+{
+    if (!Source.Pipe)
+    {
+        ProcessReceived(Source, Received, Received->RawBytes.GetData(), Received->RawBytes.Num());
+        return;
+    }
+    // Stop aspetta le pipe prima di distruggere sorgenti e canale
+    Source.Pipe->Launch(TEXT("PeopleCounterUDP_Parse"), [this, &Source, Received]()
+    {
+        ProcessReceived(Source, Received, Received->RawBytes.GetData(), Received->RawBytes.Num());
+    }, UE::Tasks::ETaskPriority::High);
+}
+
+void FPeopleCounterChannel::DropInSourceContext(FSource& Source)
+{
+    if (Source.Pipe)
+    {
+        Source.Pipe->Launch(TEXT("PeopleCounterUDP_Drop"), [this, &Source]() { DropForSource(Source); });
+    }
+    else
+    {
+        DropForSource(Source);
+    }
+}
+
+void FPeopleCounterChannel::HandleFragment(FSource& Source, const FIPv4Endpoint& Endpoint, double ArrivalSeconds, const uint8* Data, int32 Num)
+{
+    PeopleCounter::Fragment::FHeader Header;
+    if (!PeopleCounter::Fragment::ParseHeader(Data, Num, Header) || Header.TotalSize > Settings.MaxMessageBytes)
+    {
+        ++ReassemblyFailureCount;
+        UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("Invalid or oversized chunk from %s"), *Source.Name.ToString());
+        return;
+    }
+
+    // Messaggio completo o pool esaurito: gestiti fuori dal lock
+    FReceivedPacket* Completed = nullptr;
+    bool bPoolExhausted = false;
+    {
+        FScopeLock Lock(&Source.ReassemblyLock);
+
+        FSource::FReassembly* Slot = nullptr;
+        FSource::FReassembly* Free = nullptr;
+        FSource::FReassembly* Oldest = nullptr;
+        for (FSource::FReassembly& Candidate : Source.Reassemblies)
+        {
+            if (!Candidate.Packet)
+            {
+                Free = Free ? Free : &Candidate;
+            }
+            else if (Candidate.MessageId == Header.MessageId)
+            {
+                Slot = &Candidate;
+                break;
+            }
+            else if (!Oldest || Candidate.FirstArrivalSeconds < Oldest->FirstArrivalSeconds)
+            {
+                Oldest = &Candidate;
+            }
+        }
+        if (Slot && (Slot->ChunkCount != Header.ChunkCount || Slot->Packet->RawBytes.Num() != Header.TotalSize))
+        {
+            // Stesso id con un'altra forma: l'hub e' ripartito, il messaggio vecchio non arrivera' piu'
+            AbandonReassembly(Source, *Slot);
+            Free = Slot;
+            Slot = nullptr;
+        }
+
+        if (!Slot)
+        {
+            if (!Free)
+            {
+                AbandonReassembly(Source, *Oldest);
+                Free = Oldest;
+            }
+            FReceivedPacket* Received = PacketPool->Acquire();
+            if (!Received)
+            {
+                bPoolExhausted = true;
+            }
+            else
+            {
+                // Capacita' del pacchetto riusata: a regime nessuna allocazione neanche per i messaggi grandi
+                Received->RawBytes.SetNumUninitialized(Header.TotalSize, EAllowShrinking::No);
+                Free->MessageId = Header.MessageId;
+                Free->Packet = Received;
+                Free->ChunksReceived.Init(false, Header.ChunkCount);
+                Free->ChunkCount = Header.ChunkCount;
+                Free->ChunksPending = Header.ChunkCount;
+                Free->ChunkSize = 0;
+                Free->FirstArrivalSeconds = ArrivalSeconds;
+                ++Source.NumReassembling;
+                Slot = Free;
+            }
+        }
+
+        if (Slot && !Slot->ChunksReceived[Header.ChunkIndex])
+        {
+            if (!MatchesChunkLayout(Header, Slot->ChunkSize))
+            {
+                // Offset che si sovrappongono o lasciano buchi: il messaggio avrebbe byte mai scritti
+                UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("Chunk %d of message %u from %s does not match the message layout"),
+                    Header.ChunkIndex, Header.MessageId, *Source.Name.ToString());
+                AbandonReassembly(Source, *Slot);
+            }
+            else
+            {
+                Slot->ChunksReceived[Header.ChunkIndex] = true;
+                // Unica copia: dal buffer del thread RX alla sua posizione nel messaggio finale
+                FMemory::Memcpy(Slot->Packet->RawBytes.GetData() + Header.Offset, Header.Payload, Header.PayloadSize);
+                if (--Slot->ChunksPending == 0)
+                {
+                    Completed = Slot->Packet;
+                    Slot->Packet = nullptr;
+                    --Source.NumReassembling;
+                    ++ReassembledMessageCount;
+                }
+            }
+        }
+        // Altrimenti chunk duplicato dalla rete
+    }
+
+    if (bPoolExhausted)
+    {
+        ++PacketPoolExhaustedCount;
+        DropInSourceContext(Source);
+        return;
+    }
+    if (Completed)
+    {
+        // Arrivo dell'ultimo chunk: il messaggio esiste solo da adesso
+        Completed->Endpoint = Endpoint;
+        Completed->ArrivalSeconds = ArrivalSeconds;
+        ProcessOwnedPacket(Source, Completed);
+    }
+}
+
+void FPeopleCounterChannel::ExpireReassemblies(FSource& Source, double NowSeconds)
+{
+    // Controllato all'arrivo del datagram successivo della sorgente: un hub muto tiene al piu'
+    // MaxReassemblies pacchetti del pool fino a Stop
+    FScopeLock Lock(&Source.ReassemblyLock);
+    for (FSource::FReassembly& Reassembly : Source.Reassemblies)
+    {
+        if (Reassembly.Packet && NowSeconds - Reassembly.FirstArrivalSeconds > Settings.ReassemblyTimeoutSeconds)
+        {
+            AbandonReassembly(Source, Reassembly);
+        }
+    }
+}
+
+void FPeopleCounterChannel::AbandonReassembly(FSource& Source, FSource::FReassembly& Reassembly)
+{
+    // Un chunk perso: se era un conteggio, il buco di seq del messaggio dopo chiede il resync
+    UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("Dropping message %u from %s: %d of %d chunks missing"),
+        Reassembly.MessageId, *Source.Name.ToString(), Reassembly.ChunksPending, Reassembly.ChunkCount);
+    PacketPool->Release(Reassembly.Packet);
+    Reassembly.Packet = nullptr;
+    --Source.NumReassembling;
+    ++ReassemblyFailureCount;
+}
+
+void FPeopleCounterChannel::ProcessReceived(FSource& Source, FReceivedPacket* Received, const uint8* Data, int32 Num)
+{
+    BuildReceivedPacket(Source, Data, Num, *Received);
+    Received->Packet.ReceivedSeconds = Received->ArrivalSeconds;
+    UpdateStreamStats(Source, *Received);
+    if (!ApplySequencing(Source, *Received))
+    {
+        PacketPool->Release(Received);
+        return;
+    }
+    // Messaggi completi, non datagram: un snapshot in 3 chunk conta una volta
+    if (Received->bParsed && PeopleCounter::IsCountsType(Received->Packet.Type) && Received->Packet.RequestId < 0)
+    {
+        ++Source.CountsReceived;
+    }
+
+    if (Settings.DispatchMode == EPeopleCounterDispatchMode::Coalesced)
+    {
+        // Solo gli snapshot si possono sostituire; risposte come sensor_list o con request_id vanno in coda.
+        // Senza parsing non si conosce il type: si tiene comunque l'ultimo.
+        if (!Received->bParsed || (Received->Packet.Type == PeopleCounter::TypeSnapshotCounts && Received->Packet.RequestId < 0))
+        {
+            StoreCoalesced(Source, Received);
+            return;
+        }
+    }
+
+    if (Settings.DispatchMode != EPeopleCounterDispatchMode::PerPacket)
+    {
+        // Consegna rimandata al prossimo tick; una coda per sorgente, un solo producer ciascuna
+        const bool bCounts = Received->bParsed && PeopleCounter::IsCountsType(Received->Packet.Type) && Received->Packet.Sequence >= 0;
+        if (!Source.PendingPackets->Enqueue(Received))
+        {
+            ++QueueOverflowCount;
+            PacketPool->Release(Received);
+            if (bCounts)
+            {
+                DropForSource(Source);
+            }
+        }
+        return;
+    }
+
+    // Dispatch su GameThread; il pool viaggia con il task e sopravvive a Stop
+    TWeakPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> WeakThis = AsShared();
+    AsyncTask(ENamedThreads::GameThread, [WeakThis, Pool = PacketPool, Received]()
+    {
+        if (TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> This = WeakThis.Pin())
+        {
+            This->DispatchReceivedPacket(*Received);
+        }
+        Pool->Release(Received);
+    });
+}
+
+void FPeopleCounterChannel::DropForSource(FSource& Source)
+{
+    // Pacchetto perso in locale: lo stato a valle non e' piu' allineato
+    if (Source.Stream.LastSequence >= 0)
+    {
+        Source.Stream.bSynced = false;
+        Source.bSynced = false;
+        RequestResyncFromSource(Source);
+    }
+}
+
+void FPeopleCounterChannel::UpdateStreamStats(FSource& Source, const FReceivedPacket& Received)
+{
+    if (!Received.bParsed)
+    {
+        return;
+    }
+
+    const FPeopleCountPacket& Packet = Received.Packet;
+    FSourceStreamState& State = Source.Stream;
+
+    bool bInOrder = true;
+    if (Packet.Sequence >= 0)
+    {
+        const int64 Highest = State.HighestSequence;
+        if (Highest < 0 || Packet.Sequence == Highest + 1 || Highest - Packet.Sequence >= SequenceRestartWindow)
+        {
+            State.HighestSequence = Packet.Sequence;
+        }
+        else if (Packet.Sequence > Highest)
+        {
+            SequenceGapCount += Packet.Sequence - Highest - 1;
+            Source.SequenceGaps += Packet.Sequence - Highest - 1;
+            State.HighestSequence = Packet.Sequence;
+        }
+        else if (Packet.Sequence == Highest)
+        {
+            ++DuplicateCount;
+            bInOrder = false;
+        }
+        else
+        {
+            ++OutOfOrderCount;
+            bInOrder = false;
+        }
+    }
+
+    // Solo i pacchetti in ordine: uno in ritardo falserebbe intervalli e jitter.
+    // Arrivo preso all'uscita dal socket: con le pipe l'attesa del worker non conta.
+    const double ArrivalSeconds = Received.ArrivalSeconds;
+    if (bInOrder)
+    {
+        if (State.LastArrivalSeconds >= 0.0)
+        {
+            const double InterArrival = ArrivalSeconds - State.LastArrivalSeconds;
+            InterArrivalMicrosSum += static_cast<int64>(InterArrival * 1e6);
+            ++InterArrivalSamples;
+
+            if (Packet.Timestamp > 0.0 && State.LastHubTimestamp > 0.0)
+            {
+                // RFC 3550: J += (|D| - J) / 16, per sorgente
+                const double Transit = InterArrival - (Packet.Timestamp - State.LastHubTimestamp);
+                const int64 Jitter = Source.JitterMicros.Load(EMemoryOrder::Relaxed);
+                Source.JitterMicros.Store(Jitter + (static_cast<int64>(FMath::Abs(Transit) * 1e6) - Jitter) / 16, EMemoryOrder::Relaxed);
+            }
+        }
+        State.LastArrivalSeconds = ArrivalSeconds;
+        State.LastHubTimestamp = Packet.Timestamp;
+    }
+}
+
+void FPeopleCounterChannel::RecordDispatchLatency(const FPeopleCountPacket& Packet)
+{
+    if (Packet.Timestamp <= 0.0)
+    {
+        return;
+    }
+    // Con la stima dell'orologio dell'hub la latenza e' vera; senza include lo scarto tra gli orologi
+    const double LatencyMs = Packet.EndToEndLatencyMs >= 0.f
+        ? Packet.EndToEndLatencyMs
+        : (UnixNowSeconds() - Packet.Timestamp) * 1000.0;
+
+    int32 Bucket = 0;
+    while (Bucket < NumLatencyBuckets && LatencyMs > LatencyBucketUpperMs[Bucket])
+    {
+        ++Bucket;
+    }
+    ++LatencyBuckets[Bucket];
+
+    LatencyMinMs = LatencySamples > 0 ? FMath::Min(LatencyMinMs, LatencyMs) : LatencyMs;
+    LatencyMaxMs = LatencySamples > 0 ? FMath::Max(LatencyMaxMs, LatencyMs) : LatencyMs;
+    LatencySumMs += LatencyMs;
+    ++LatencySamples;
+}
+
+void FPeopleCounterChannel::HandlePong(const FPeopleCountPacket& Packet)
+{
+    // t3 e' l'uscita dal socket, non il dispatch: l'attesa della coda non entra nel round trip
+    FPeopleCounterClockEstimator& Clock = ClockBySource.FindOrAdd(Packet.Source);
+    const bool bWasSynced = Clock.IsSynced();
+    if (!Clock.AddSample(Packet.ClockT0, Packet.ClockT1, Packet.Timestamp, Packet.ReceivedSeconds))
+    {
+        UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("Ignoring pong from %s: inconsistent timestamps"), *Packet.Source.ToString());
+        return;
+    }
+    if (!bWasSynced)
+    {
+        const FPeopleCounterClockInfo Info = Clock.GetInfo();
+        UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("Clock of %s: offset %.1f ms from local UTC, round trip %.2f ms"),
+            *Packet.Source.ToString(), Info.OffsetMs, Info.RoundTripMs);
+    }
+}
+
+void FPeopleCounterChannel::StampEngineTime(FPeopleCountPacket& Packet) const
+{
+    Packet.EngineTimestamp = 0.0;
+    Packet.EndToEndLatencyMs = -1.f;
+    if (Packet.Timestamp <= 0.0) return;
+
+    const FPeopleCounterClockEstimator* Clock = ClockBySource.Find(Packet.Source);
+    if (Clock && Clock->IsSynced())
+    {
+        Packet.EngineTimestamp = Clock->HubToEngineSeconds(Packet.Timestamp);
+        Packet.EndToEndLatencyMs = static_cast<float>((FPlatformTime::Seconds() - Packet.EngineTimestamp) * 1000.0);
+    }
+}
+
+FPeopleCounterClockInfo FPeopleCounterChannel::GetClockInfo(FName Source) const
+{
+    const FPeopleCounterClockEstimator* Clock = ClockBySource.Find(Source);
+    return Clock ? Clock->GetInfo() : FPeopleCounterClockInfo();
+}
+
+bool FPeopleCounterChannel::HubToEngineSeconds(FName Source, double HubSeconds, double& OutEngineSeconds) const
+{
+    const FPeopleCounterClockEstimator* Clock = ClockBySource.Find(Source);
+    if (!Clock || !Clock->IsSynced()) return false;
+    OutEngineSeconds = Clock->HubToEngineSeconds(HubSeconds);
+    return true;
+}
+
+FPeopleCounterReceiverStats FPeopleCounterChannel::GetStats() const
+{
+    FPeopleCounterReceiverStats Stats;
+    Stats.ElapsedSeconds = bRunning ? FPlatformTime::Seconds() - StatsStartSeconds : 0.0;
+    Stats.PacketsReceived = PacketsReceivedCount.Load();
+    Stats.BytesReceived = BytesReceivedCount.Load();
+    Stats.PacketsPerSecond = Stats.ElapsedSeconds > 0.0 ? static_cast<float>(Stats.PacketsReceived / Stats.ElapsedSeconds) : 0.f;
+    Stats.ParseFailures = ParseFailureCount.Load();
+    Stats.SequenceGaps = SequenceGapCount.Load();
+    Stats.OutOfOrderPackets = OutOfOrderCount.Load();
+    Stats.DuplicatePackets = DuplicateCount.Load();
+    Stats.PacketsLost = FMath::Max<int64>(0, Stats.SequenceGaps - Stats.OutOfOrderPackets);
+    Stats.QueueOverflows = QueueOverflowCount.Load();
+    Stats.SupersededPackets = SupersededPacketCount.Load();
+    Stats.DiscardedDeltas = DiscardedDeltaCount.Load();
+    Stats.ReassembledMessages = ReassembledMessageCount.Load();
+    Stats.ReassemblyFailures = ReassemblyFailureCount.Load();
+
+    const int64 NumInterArrivals = InterArrivalSamples.Load();
+    Stats.MeanInterArrivalMs = NumInterArrivals > 0 ? static_cast<float>(InterArrivalMicrosSum.Load() / 1000.0 / NumInterArrivals) : 0.f;
+    {
+        // Jitter della sorgente peggiore
+        FRWScopeLock Lock(SourcesLock, SLT_ReadOnly);
+        for (const TPair<FSourceKey, TUniquePtr<FSource>>& Pair : Sources)
+        {
+            Stats.JitterMs = FMath::Max(Stats.JitterMs, static_cast<float>(Pair.Value->JitterMicros.Load() / 1000.0));
+        }
+    }
+
+    Stats.LatencySamples = LatencySamples;
+    Stats.LatencyBucketUpperMs.Append(LatencyBucketUpperMs, NumLatencyBuckets);
+    Stats.LatencyBucketCounts.Append(LatencyBuckets, NumLatencyBuckets + 1);
+    if (LatencySamples > 0)
+    {
+        Stats.LatencyMinMs = static_cast<float>(LatencyMinMs);
+        Stats.LatencyMaxMs = static_cast<float>(LatencyMaxMs);
+        Stats.LatencyMeanMs = static_cast<float>(LatencySumMs / LatencySamples);
+
+        auto Percentile = [this](double Fraction)
+        {
+            const int64 Target = FMath::Max<int64>(1, FMath::CeilToInt64(Fraction * LatencySamples));
+            int64 Cumulative = 0;
+            for (int32 Bucket = 0; Bucket < NumLatencyBuckets; ++Bucket)
+            {
+                Cumulative += LatencyBuckets[Bucket];
+                if (Cumulative >= Target)
+                {
+                    return FMath::Min(LatencyBucketUpperMs[Bucket], static_cast<float>(LatencyMaxMs));
+                }
+            }
+            return static_cast<float>(LatencyMaxMs);
+        };
+        Stats.LatencyP50Ms = Percentile(0.50);
+        Stats.LatencyP95Ms = Percentile(0.95);
+        Stats.LatencyP99Ms = Percentile(0.99);
+    }
+
+    Stats.RequestsAnswered = RequestsAnswered;
+    Stats.RequestTimeouts = RequestTimeouts;
+    if (RequestsAnswered > 0)
+    {
+        Stats.RoundTripMinMs = static_cast<float>(RoundTripMinMs);
+        Stats.RoundTripMeanMs = static_cast<float>(RoundTripSumMs / RequestsAnswered);
+        Stats.RoundTripMaxMs = static_cast<float>(RoundTripMaxMs);
+    }
+
+    Stats.QueueDepth = PacketPool ? PacketPool->GetCapacity() - PacketPool->GetNumFree() : 0;
+    Stats.DispatchFrames = DispatchFrames;
+    Stats.DispatchTotalMs = DispatchTotalMs;
+    Stats.DispatchMeanMs = DispatchFrames > 0 ? static_cast<float>(DispatchTotalMs / DispatchFrames) : 0.f;
+    Stats.DispatchMaxMs = static_cast<float>(DispatchMaxMs);
+    return Stats;
+}
+
+void FPeopleCounterChannel::RecordRequestRoundTrip(double RoundTripMs)
+{
+    RoundTripMinMs = RequestsAnswered > 0 ? FMath::Min(RoundTripMinMs, RoundTripMs) : RoundTripMs;
+    RoundTripMaxMs = RequestsAnswered > 0 ? FMath::Max(RoundTripMaxMs, RoundTripMs) : RoundTripMs;
+    RoundTripSumMs += RoundTripMs;
+    ++RequestsAnswered;
+}
+
+void FPeopleCounterChannel::ResetStats()
+{
+    // I contatori RX possono avanzare durante il reset: va bene per delle statistiche
+    PacketsReceivedCount = 0;
+    BytesReceivedCount = 0;
+    ParseFailureCount = 0;
+    SequenceGapCount = 0;
+    OutOfOrderCount = 0;
+    DuplicateCount = 0;
+    InterArrivalMicrosSum = 0;
+    InterArrivalSamples = 0;
+    {
+        FRWScopeLock Lock(SourcesLock, SLT_ReadOnly);
+        for (const TPair<FSourceKey, TUniquePtr<FSource>>& Pair : Sources)
+        {
+            Pair.Value->PacketsReceived = 0;
+            Pair.Value->CountsReceived = 0;
+            Pair.Value->SequenceGaps = 0;
+            Pair.Value->JitterMicros = 0;
+        }
+    }
+    QueueOverflowCount = 0;
+    SupersededPacketCount = 0;
+    DiscardedDeltaCount = 0;
+    ReassembledMessageCount = 0;
+    ReassemblyFailureCount = 0;
+    StatsStartSeconds = FPlatformTime::Seconds();
+
+    FMemory::Memzero(LatencyBuckets);
+    LatencySamples = 0;
+    LatencySumMs = 0.0;
+    LatencyMinMs = 0.0;
+    LatencyMaxMs = 0.0;
+
+    RequestsAnswered = 0;
+    RequestTimeouts = 0;
+    RoundTripSumMs = 0.0;
+    RoundTripMinMs = 0.0;
+    RoundTripMaxMs = 0.0;
+
+    DispatchFrames = 0;
+    DispatchTotalMs = 0.0;
+    DispatchMaxMs = 0.0;
+}
+
+TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> FPeopleCounterChannel::GetSourceRegistry(FName Source) const
+{
+    FRWScopeLock Lock(SourceRegistriesLock, SLT_ReadOnly);
+    const TSharedRef<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>* Found = SourceRegistries.Find(Source);
+    return Found ? TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>(*Found) : nullptr;
+}
+
+void FPeopleCounterChannel::GetSources(TArray<FPeopleCounterSourceInfo>& OutSources) const
+{
+    FRWScopeLock Lock(SourcesLock, SLT_ReadOnly);
+    OutSources.Reset(Sources.Num());
+    for (const TPair<FSourceKey, TUniquePtr<FSource>>& Pair : Sources)
+    {
+        const FSource& Source = *Pair.Value;
+        FPeopleCounterSourceInfo& Info = OutSources.AddDefaulted_GetRef();
+        Info.Source = Source.Name;
+        Info.Endpoint = Source.Endpoint.ToString();
+        Info.PacketsReceived = Source.PacketsReceived.Load();
+        Info.CountsReceived = Source.CountsReceived.Load();
+        Info.SequenceGaps = Source.SequenceGaps.Load();
+        Info.LastSequence = Source.LastSequence.Load();
+        Info.bSynced = Source.bSynced.Load();
+        Info.NumSensors = Source.Registry->Num();
+        Info.JitterMs = static_cast<float>(Source.JitterMicros.Load() / 1000.0);
+        Info.Clock = GetClockInfo(Source.Name);
+    }
+}
+
+bool FPeopleCounterChannel::ApplySequencing(FSource& Source, FReceivedPacket& Received)
+{
+    FPeopleCountPacket& Packet = Received.Packet;
+    if (!Received.bParsed || Packet.Sequence < 0 || !PeopleCounter::IsCountsType(Packet.Type))
+    {
+        // Hub senza "seq" o pacchetto non di conteggi: consegna invariata
+        return true;
+    }
+
+    FSourceStreamState& State = Source.Stream;
+    const bool bDelta = Packet.Type == PeopleCounter::TypeDeltaCounts;
+
+    if (!bDelta)
+    {
+        // Un keyframe vecchio arrivato in ritardo riporterebbe indietro lo stato
+        if (State.bSynced && Packet.Sequence <= State.LastSequence && State.LastSequence - Packet.Sequence < SequenceRestartWindow)
+        {
+            return false;
+        }
+        // Keyframe: riallinea, anche dopo un riavvio dell'hub (seq che riparte)
+        State.LastSequence = Packet.Sequence;
+        State.bSynced = true;
+        State.StateSensors = Packet.Sensors;
+        State.StateIndexBySlot.Reset();
+        for (int32 i = 0; i < State.StateSensors.Num(); ++i)
+        {
+            const int32 Slot = State.StateSensors[i].Slot;
+            if (Slot == INDEX_NONE) continue;
+            GrowSlotIndex(State.StateIndexBySlot, Slot);
+            State.StateIndexBySlot[Slot] = i;
+        }
+        Source.LastSequence = State.LastSequence;
+        Source.bSynced = true;
+        return true;
+    }
+
+    if (State.bSynced && Packet.Sequence <= State.LastSequence && State.LastSequence - Packet.Sequence < SequenceRestartWindow)
+    {
+        // Duplicato o arrivato fuori ordine: lo stato lo contiene gia' (o lo ha superato)
+        ++DiscardedDeltaCount;
+        return false;
+    }
+    if (!State.bSynced || Packet.Sequence != State.LastSequence + 1)
+    {
+        if (State.bSynced)
+        {
+            UE_LOG(LogPeopleCounterUDP_RX, Warning, TEXT("Sequence gap from %s: expected %lld, got %lld"),
+                *Source.Name.ToString(), State.LastSequence + 1, Packet.Sequence);
+        }
+        State.bSynced = false;
+        Source.bSynced = false;
+        ++DiscardedDeltaCount;
+        RequestResyncFromSource(Source);
+        return false;
+    }
+
+    State.LastSequence = Packet.Sequence;
+    Source.LastSequence = State.LastSequence;
+    for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        if (Sensor.Slot == INDEX_NONE) continue;
+        GrowSlotIndex(State.StateIndexBySlot, Sensor.Slot);
+        int32& Index = State.StateIndexBySlot[Sensor.Slot];
+        if (State.StateSensors.IsValidIndex(Index) && State.StateSensors[Index].Slot == Sensor.Slot)
+        {
+            State.StateSensors[Index].Count = Sensor.Count;
+        }
+        else
+        {
+            Index = State.StateSensors.Add(Sensor);
+        }
+    }
+
+    if (Settings.DispatchMode == EPeopleCounterDispatchMode::Coalesced)
+    {
+        // Un delta sostituito nello slot perderebbe le sue modifiche: si consegna lo stato completo
+        Packet.Type = PeopleCounter::TypeSnapshotCounts;
+        Packet.Sensors = State.StateSensors;
+    }
+    if (Settings.bRawJson)
+    {
+        // OnJsonReceived leggerebbe il delta come uno snapshot: riceve lo stato completo.
+        // In Coalesced lo costruisce il dispatch, solo per il pacchetto che non viene superato.
+        Received.bDeferredJson = false;
+        if (Settings.DispatchMode == EPeopleCounterDispatchMode::Coalesced)
+        {
+            Received.bSnapshotJson = true;
+        }
+        else
+        {
+            BuildSnapshotJson(Packet, State.StateSensors, Received.Json);
+        }
+    }
+    return true;
+}
+
+void FPeopleCounterChannel::RequestResyncFromSource(FSource& Source)
+{
+    const double NowSeconds = FPlatformTime::Seconds();
+    FSourceStreamState& State = Source.Stream;
+    if (State.LastResyncRequestSeconds >= 0.0 && NowSeconds - State.LastResyncRequestSeconds < Settings.ResyncCooldownSeconds)
+    {
+        return;
+    }
+    State.LastResyncRequestSeconds = NowSeconds;
+
+    // I sender sono UObject: l'invio parte dal GameThread, da chi ha un canale comandi verso l'hub
+    TWeakPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> WeakThis = AsShared();
+    AsyncTask(ENamedThreads::GameThread, [WeakThis, Name = Source.Name, Endpoint = Source.Endpoint]()
+    {
+        TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> This = WeakThis.Pin();
+        if (!This) return;
+        // Copia: un responder puo' togliersi durante l'invio
+        const TArray<TPair<FDelegateHandle, FPeopleCounterResyncResponder>> Responders = This->ResyncResponders;
+        for (const TPair<FDelegateHandle, FPeopleCounterResyncResponder>& Responder : Responders)
+        {
+            if (Responder.Value.IsBound() && Responder.Value.Execute(Name, Endpoint))
+            {
+                return;
+            }
+        }
+        UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("No command sender for source %s (%s)"), *Name.ToString(), *Endpoint.ToString());
+    });
+}
+
+FDelegateHandle FPeopleCounterChannel::AddResyncResponder(FPeopleCounterResyncResponder Responder)
+{
+    check(IsInGameThread());
+    const FDelegateHandle Handle(FDelegateHandle::GenerateNewHandle);
+    ResyncResponders.Emplace(Handle, MoveTemp(Responder));
+    return Handle;
+}
+
+void FPeopleCounterChannel::RemoveResyncResponder(FDelegateHandle Handle)
+{
+    check(IsInGameThread());
+    ResyncResponders.RemoveAll([Handle](const TPair<FDelegateHandle, FPeopleCounterResyncResponder>& Responder) { return Responder.Key == Handle; });
+}
+
+void FPeopleCounterChannel::StoreCoalesced(FSource& Source, FReceivedPacket* Received)
+{
+    FReceivedPacket* Previous = Source.Latest.Exchange(Received);
+    if (Previous)
+    {
+        ++SupersededPacketCount;
+        PacketPool->Release(Previous);
+    }
+}
+
+void FPeopleCounterChannel::RecordDispatchCost(double Seconds)
+{
+    // Piu' dispatch nello stesso frame (Batched, o i task di PerPacket) si sommano
+    const double Ms = Seconds * 1000.0;
+    if (DispatchFrameNumber != GFrameCounter)
+    {
+        DispatchFrameNumber = GFrameCounter;
+        FrameDispatchMs = 0.0;
+        ++DispatchFrames;
+    }
+    FrameDispatchMs += Ms;
+    DispatchTotalMs += Ms;
+    DispatchMaxMs = FMath::Max(DispatchMaxMs, FrameDispatchMs);
+}
+
+void FPeopleCounterChannel::DispatchReceivedPacket(FReceivedPacket& Received)
+{
+    PEOPLECOUNTER_SCOPE(Dispatch);
+    INC_DWORD_STAT(STAT_PeopleCounterUDP_PacketsDispatched);
+    // Listener compresi: e' il costo che il canale mette sul GameThread
+    const double DispatchStartSeconds = FPlatformTime::Seconds();
+    ON_SCOPE_EXIT { RecordDispatchCost(FPlatformTime::Seconds() - DispatchStartSeconds); };
+    if (Received.bSnapshotJson && OnJson.IsBound())
+    {
+        // Prima del filtro: il JSON grezzo riporta i conteggi dell'hub
+        BuildSnapshotJson(Received.Packet, Received.Packet.Sensors, Received.Json);
+        Received.bSnapshotJson = false;
+    }
+    if (Received.bParsed)
+    {
+        if (Received.Packet.Type == PeopleCounter::TypePong)
+        {
+            // Solo per la stima dell'orologio: non arriva ai listener (ne' come JSON) e,
+            // in cluster, resta sul primario che ha inviato il ping
+            HandlePong(Received.Packet);
+            return;
+        }
+        StampEngineTime(Received.Packet);
+        if (CountFilter.IsActive() && PeopleCounter::IsCountsType(Received.Packet.Type))
+        {
+            FilterCounts(Received);
+        }
+        if (ClusterBridge)
+        {
+            // Applicato da tutti i nodi insieme quando il bridge lo riconsegna
+            ClusterBridge->ForwardPacket(*this, Received.Packet, Received.bQualifiedIds);
+        }
+        else
+        {
+            RecordDispatchLatency(Received.Packet);
+            ApplyToRegistry(Received.Packet, Received.SourceRegistry, Received.bQualifiedIds);
+            OnPacket.Broadcast(Received.Packet);
+        }
+    }
+    if (Settings.bRawJson && OnJson.IsBound())
+    {
+        if (Received.bDeferredJson)
+        {
+            PEOPLECOUNTER_SCOPE(Utf8Convert);
+            AssignUtf8(Received.Json, Received.RawBytes.GetData(), Received.RawBytes.Num());
+            Received.bDeferredJson = false;
+        }
+        OnJson.Broadcast(Received.Json);
+    }
+}
+
+void FPeopleCounterChannel::ResolveFilterSlot(const FPeopleCountSensor& Sensor, FPeopleCounterSensorRegistry* SourceRegistry)
+{
+    const int32 Slot = Sensor.Slot;
+    if (Slot >= FilterResolved.Num())
+    {
+        FilterResolved.Add(false, Slot + 1 - FilterResolved.Num());
+        FilterSourceRegistry.SetNumZeroed(Slot + 1);
+        FilterSourceSlot.SetNumZeroed(Slot + 1);
+    }
+    if (!FilterResolved[Slot] || FilterSourceRegistry[Slot] != SourceRegistry)
+    {
+        // Id passato a un altro hub: lo slot segue il ritmo della nuova sorgente
+        if (TArray<int32>* Previous = FilterResolved[Slot] ? FilterSlotsBySource.Find(FilterSourceRegistry[Slot]) : nullptr)
+        {
+            Previous->RemoveSwap(Slot);
+        }
+        FilterSlotsBySource.FindOrAdd(SourceRegistry).Add(Slot);
+    }
+    FilterResolved[Slot] = true;
+    FilterSourceRegistry[Slot] = SourceRegistry;
+    FilterSourceSlot[Slot] = Sensor.SourceSlot;
+
+    // Profilo = posizione in SensorFilters + 1 (stesso ordine di SetProfiles)
+    const FName MergedId = SensorRegistry->GetSensorId(Slot);
+    int32 Profile = 0;
+    int32 Index = 1;
+    for (const TPair<FName, FPeopleCounterFilterSettings>& Pair : Settings.SensorFilters)
+    {
+        if (Pair.Key == MergedId || Pair.Key == Sensor.Id)
+        {
+            Profile = Index;
+            break;
+        }
+        ++Index;
+    }
+    CountFilter.SetSlotProfile(Slot, Profile);
+}
+
+void FPeopleCounterChannel::FilterCounts(FReceivedPacket& Received)
+{
+    PEOPLECOUNTER_SCOPE(Filter);
+    FPeopleCountPacket& Packet = Received.Packet;
+    for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        if (Sensor.Slot == INDEX_NONE) continue;
+        // Un hub che riparte (o un id che cambia sorgente) rifa' la risoluzione
+        if (!FilterResolved.IsValidIndex(Sensor.Slot) || !FilterResolved[Sensor.Slot]
+            || FilterSourceRegistry[Sensor.Slot] != Received.SourceRegistry)
+        {
+            ResolveFilterSlot(Sensor, Received.SourceRegistry);
+        }
+        CountFilter.SetInput(Sensor.Slot, static_cast<float>(Sensor.Count));
+    }
+
+    const double Seconds = Packet.EngineTimestamp > 0.0 ? Packet.EngineTimestamp
+        : Packet.ReceivedSeconds > 0.0 ? Packet.ReceivedSeconds : FPlatformTime::Seconds();
+    FilterChanged.Reset();
+    if (const TArray<int32>* SourceSlots = FilterSlotsBySource.Find(Received.SourceRegistry))
+    {
+        CountFilter.Step(Seconds, *SourceSlots, FilterChanged);
+    }
+
+    FilterInPacket.Init(false, CountFilter.Num());
+    for (FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        if (Sensor.Slot == INDEX_NONE) continue;
+        Sensor.Count = FMath::RoundToInt(CountFilter.GetOutput(Sensor.Slot));
+        FilterInPacket[Sensor.Slot] = true;
+    }
+    // Slot della sorgente che il filtro sta ancora muovendo: entrano nel pacchetto
+    // come se l'hub li avesse inviati (un delta non li riporterebbe)
+    for (const int32 Slot : FilterChanged)
+    {
+        if (FilterInPacket[Slot]) continue;
+        const int32 Count = FMath::RoundToInt(CountFilter.GetOutput(Slot));
+        if (Count == SensorRegistry->GetCount(Slot)) continue;
+
+        FPeopleCountSensor& Sensor = Packet.Sensors.AddDefaulted_GetRef();
+        Sensor.Slot = Slot;
+        Sensor.SourceSlot = FilterSourceSlot[Slot];
+        Sensor.Id = Received.SourceRegistry ? Received.SourceRegistry->GetSensorId(Sensor.SourceSlot) : SensorRegistry->GetSensorId(Slot);
+        Sensor.Count = Count;
+    }
+}
+
+int32 FPeopleCounterChannel::GetRawCount(int32 Slot) const
+{
+    if (CountFilter.IsActive() && Slot >= 0 && Slot < CountFilter.Num())
+    {
+        return FMath::RoundToInt(CountFilter.GetInput(Slot));
+    }
+    return SensorRegistry->GetCount(Slot);
+}
+
+void FPeopleCounterChannel::ApplyReplicatedPacket(const FPeopleCountPacket& Packet, bool bQualifiedIds)
+{
+    if (!bRunning) return;
+    PEOPLECOUNTER_SCOPE(Dispatch);
+    INC_DWORD_STAT(STAT_PeopleCounterUDP_PacketsDispatched);
+    RecordDispatchLatency(Packet);
+    ApplyToRegistry(Packet, Packet.Source.IsNone() ? nullptr : FindOrAddSourceRegistry(Packet.Source), bQualifiedIds);
+    OnPacket.Broadcast(Packet);
+}
+
+void FPeopleCounterChannel::EndReplicatedBatch()
+{
+    if (bRunning)
+    {
+        OnDrained.Broadcast();
+    }
+}
+
+void FPeopleCounterChannel::ApplyToRegistry(const FPeopleCountPacket& Packet, FPeopleCounterSensorRegistry* SourceRegistry, bool bQualifiedIds)
+{
+    if (Packet.Type == PeopleCounter::TypeSensorList)
+    {
+        if (SourceRegistry)
+        {
+            SourceRegistry->SeedFromSerials(Packet.Serials);
+        }
+        SensorRegistry->SeedFromSerials(Packet.Serials, bQualifiedIds ? FString::Printf(TEXT("%s."), *Packet.Source.ToString()) : FString());
+        return;
+    }
+    // I conteggi arrivano gia' col pacchetto counts dello stesso frame; qui solo gli slot per i punti
+    if (Packet.Type == PeopleCounter::TypeDetections)
+    {
+        return;
+    }
+    // Slot gia' risolti sul thread RX: qui solo scritture indicizzate, vista unita e sorgente
+    for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        SensorRegistry->SetCount(Sensor.Slot, Sensor.Count);
+    }
+    if (SourceRegistry)
+    {
+        for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+        {
+            SourceRegistry->SetCount(Sensor.SourceSlot, Sensor.Count);
+        }
+    }
+}
+
+bool FPeopleCounterChannel::TickDrain(float DeltaTime)
+{
+    DrainPendingPackets();
+    return true;
+}
+
+void FPeopleCounterChannel::DrainCoalescedPackets(const TSharedRef<FPacketPool, ESPMode::ThreadSafe>& Pool, uint32 Generation)
+{
+    DrainedCoalesced.Reset();
+    for (FSource* Source : DrainSources)
+    {
+        if (FReceivedPacket* Latest = Source->Latest.Exchange(nullptr))
+        {
+            DrainedCoalesced.Add(Latest);
+        }
+    }
+
+    for (int32 i = 0; i < DrainedCoalesced.Num(); ++i)
+    {
+        FReceivedPacket* Received = DrainedCoalesced[i];
+        if (bRunning && RunGeneration == Generation)
+        {
+            DispatchReceivedPacket(*Received);
+        }
+        // Se un listener ha fermato il canale i restanti tornano solo al pool
+        Pool->Release(Received);
+    }
+    DrainedCoalesced.Reset();
+}
+
+void FPeopleCounterChannel::DrainPendingPackets()
+{
+    if (!bRunning || !PacketPool) return;
+
+    // Riferimenti locali: un listener che ferma il canale (o lo rilascia) non lo distrugge sotto i piedi
+    const TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe> KeepAlive = AsShared();
+    const TSharedRef<FPacketPool, ESPMode::ThreadSafe> Pool = PacketPool.ToSharedRef();
+    const uint32 Generation = RunGeneration;
+
+    // Le sorgenti vivono fino a Stop; Stop durante il drain si riconosce da bRunning/RunGeneration
+    DrainSources.Reset();
+    int32 QueueDepth = 0;
+    {
+        FRWScopeLock Lock(SourcesLock, SLT_ReadOnly);
+        for (const TPair<FSourceKey, TUniquePtr<FSource>>& Pair : Sources)
+        {
+            DrainSources.Add(Pair.Value.Get());
+            QueueDepth += static_cast<int32>(Pair.Value->PendingPackets->Count());
+        }
+    }
+    INC_DWORD_STAT_BY(STAT_PeopleCounterUDP_QueueDepth, QueueDepth);
+    CSV_CUSTOM_STAT(PeopleCounterUDP, QueueDepth, QueueDepth, ECsvCustomStatOp::Accumulate);
+
+    // Prima le code (risposte ai comandi), a turno tra le sorgenti, poi gli ultimi snapshot
+    const double StartSeconds = FPlatformTime::Seconds();
+    const double BudgetSeconds = Settings.MaxDispatchMicrosecondsPerFrame > 0 ? Settings.MaxDispatchMicrosecondsPerFrame * 1e-6 : 0.0;
+
+    int32 NumDispatched = 0;
+    bool bBudgetLeft = true;
+    bool bProgress = true;
+    while (bBudgetLeft && bProgress)
+    {
+        bProgress = false;
+        for (FSource* Source : DrainSources)
+        {
+            if (Settings.MaxPacketsPerFrame > 0 && NumDispatched >= Settings.MaxPacketsPerFrame)
+            {
+                bBudgetLeft = false;
+                break;
+            }
+            FReceivedPacket* Received = nullptr;
+            if (!Source->PendingPackets->Dequeue(Received))
+            {
+                continue;
+            }
+            DispatchReceivedPacket(*Received);
+            Pool->Release(Received);
+            ++NumDispatched;
+            bProgress = true;
+
+            if (!bRunning || RunGeneration != Generation)
+            {
+                // Sorgenti distrutte da Stop: i puntatori non vanno piu' toccati
+                DrainSources.Reset();
+                return;
+            }
+            // Il resto delle code aspetta il frame successivo
+            if (BudgetSeconds > 0.0 && FPlatformTime::Seconds() - StartSeconds >= BudgetSeconds)
+            {
+                bBudgetLeft = false;
+                break;
+            }
+        }
+    }
+
+    if (Settings.DispatchMode == EPeopleCounterDispatchMode::Coalesced)
+    {
+        DrainCoalescedPackets(Pool, Generation);
+    }
+    DrainSources.Reset();
+
+    if (bRunning && RunGeneration == Generation)
+    {
+        OnDrained.Broadcast();
+    }
+}
@@ -0,0 +1,152 @@
+#include "PeopleCounterClockSync.h"
+
+namespace
+{
+    // Oltre e' una risposta a un ping vecchio o una rete inutilizzabile per la stima
+    constexpr double MaxRoundTripSeconds = 1.0;
+    // Servono campioni distribuiti su qualche secondo prima di fidarsi della pendenza
+    constexpr double MinDriftSpanSeconds = 4.0;
+    // Oscillatori reali stanno sotto 100 ppm; oltre e' rumore della stima
+    constexpr double MaxDrift = 500e-6;
+    // Scarto oltre l'incertezza del campione: l'orologio dell'hub e' saltato (riavvio, NTP)
+    constexpr double StepMarginSeconds = 0.05;
+
+    double UnixNowSeconds()
+    {
+        return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalSeconds();
+    }
+}
+
+bool FPeopleCounterClockEstimator::AddSample(double T0, double T1, double T2, double T3)
+{
+    double RoundTrip = (T3 - T0) - (T2 - T1);
+    if (T0 <= 0.0 || T3 < T0 || RoundTrip > MaxRoundTripSeconds || RoundTrip < -1e-3)
+    {
+        return false;
+    }
+    // Arrotondamenti del timestamp dell'hub
+    RoundTrip = FMath::Max(RoundTrip, 0.0);
+
+    FSample Sample;
+    Sample.EngineSeconds = 0.5 * (T0 + T3);
+    Sample.Offset = 0.5 * ((T1 - T0) + (T2 - T3));
+    Sample.RoundTrip = RoundTrip;
+
+    if (bSynced)
+    {
+        const double Predicted = Offset + Drift * (Sample.EngineSeconds - ReferenceSeconds);
+        if (FMath::Abs(Sample.Offset - Predicted) > 0.5 * RoundTrip + StepMarginSeconds)
+        {
+            // Nessun errore di rete spiega lo scarto: si riparte da questo campione
+            Reset();
+        }
+    }
+
+    if (Samples.Num() < MaxSamples)
+    {
+        Samples.Add(Sample);
+    }
+    else
+    {
+        Samples[NextSample] = Sample;
+    }
+    NextSample = (NextSample + 1) % MaxSamples;
+    Refit();
+    return true;
+}
+
+void FPeopleCounterClockEstimator::Reset()
+{
+    Samples.Reset();
+    NextSample = 0;
+    ReferenceSeconds = 0.0;
+    Offset = 0.0;
+    Drift = 0.0;
+    MinRoundTrip = 0.0;
+    bSynced = false;
+}
+
+void FPeopleCounterClockEstimator::Refit()
+{
+    if (Samples.Num() == 0)
+    {
+        bSynced = false;
+        return;
+    }
+
+    const FSample* Best = &Samples[0];
+    for (const FSample& Sample : Samples)
+    {
+        if (Sample.RoundTrip < Best->RoundTrip)
+        {
+            Best = &Sample;
+        }
+    }
+    MinRoundTrip = Best->RoundTrip;
+
+    // Solo i campioni vicini al round trip minimo: gli altri hanno attraversato code piene
+    const double MaxUsedRoundTrip = 2.0 * MinRoundTrip + 0.5e-3;
+    // Coordinate relative al campione migliore: offset e tempi epoch in double perderebbero cifre
+    double SumX = 0.0, SumY = 0.0, SumXX = 0.0, SumXY = 0.0;
+    double MinX = 0.0, MaxX = 0.0;
+    int32 Used = 0;
+    for (const FSample& Sample : Samples)
+    {
+        if (Sample.RoundTrip > MaxUsedRoundTrip) continue;
+        const double X = Sample.EngineSeconds - Best->EngineSeconds;
+        const double Y = Sample.Offset - Best->Offset;
+        SumX += X;
+        SumY += Y;
+        SumXX += X * X;
+        SumXY += X * Y;
+        MinX = Used > 0 ? FMath::Min(MinX, X) : X;
+        MaxX = Used > 0 ? FMath::Max(MaxX, X) : X;
+        ++Used;
+    }
+
+    const double MeanX = SumX / Used;
+    const double MeanY = SumY / Used;
+    const double VarX = SumXX / Used - MeanX * MeanX;
+    if (Used >= 3 && MaxX - MinX >= MinDriftSpanSeconds && VarX > UE_DOUBLE_SMALL_NUMBER)
+    {
+        Drift = FMath::Clamp((SumXY / Used - MeanX * MeanY) / VarX, -MaxDrift, MaxDrift);
+        ReferenceSeconds = Best->EngineSeconds + MeanX;
+        Offset = Best->Offset + MeanY;
+    }
+    else
+    {
+        // Troppi pochi campioni per la pendenza: offset del campione migliore
+        Drift = 0.0;
+        ReferenceSeconds = Best->EngineSeconds;
+        Offset = Best->Offset;
+    }
+    bSynced = true;
+}
+
+double FPeopleCounterClockEstimator::HubToEngineSeconds(double HubSeconds) const
+{
+    if (!bSynced) return HubSeconds;
+    // hub = e + Offset + Drift * (e - Ref), risolta per e
+    return (HubSeconds - Offset + Drift * ReferenceSeconds) / (1.0 + Drift);
+}
+
+double FPeopleCounterClockEstimator::EngineToHubSeconds(double EngineSeconds) const
+{
+    if (!bSynced) return EngineSeconds;
+    return EngineSeconds + Offset + Drift * (EngineSeconds - ReferenceSeconds);
+}
+
+FPeopleCounterClockInfo FPeopleCounterClockEstimator::GetInfo() const
+{
+    FPeopleCounterClockInfo Info;
+    Info.bSynced = bSynced;
+    Info.NumSamples = Samples.Num();
+    if (bSynced)
+    {
+        // Ora dell'hub adesso contro l'ora UTC locale: confrontabile tra macchine
+        Info.OffsetMs = static_cast<float>((EngineToHubSeconds(FPlatformTime::Seconds()) - UnixNowSeconds()) * 1000.0);
+        Info.DriftPpm = static_cast<float>(Drift * 1e6);
+        Info.RoundTripMs = static_cast<float>(MinRoundTrip * 1000.0);
+    }
+    return Info;
+}
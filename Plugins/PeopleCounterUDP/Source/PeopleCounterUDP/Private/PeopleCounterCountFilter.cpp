@@ -0,0 +1,183 @@
+#include "PeopleCounterCountFilter.h"
+
+namespace
+{
+    // Differenze piu' piccole sono arrotondamenti, non un cambio
+    constexpr float MinChange = 1e-3f;
+}
+
+void FPeopleCounterCountFilter::SetProfiles(TConstArrayView<FPeopleCounterFilterSettings> InProfiles)
+{
+    Profiles = InProfiles;
+    if (Profiles.Num() == 0)
+    {
+        Profiles.AddDefaulted();
+    }
+    // Lo slot tiene l'indice in un byte
+    Profiles.SetNum(FMath::Min(Profiles.Num(), static_cast<int32>(MAX_uint8) + 1));
+    bActive = false;
+    for (FPeopleCounterFilterSettings& Profile : Profiles)
+    {
+        Profile.MedianWindow = FMath::Clamp(Profile.MedianWindow, 1, MaxMedianWindow);
+        bActive |= Profile.bEnabled;
+    }
+    Reset();
+}
+
+void FPeopleCounterCountFilter::SetSlotProfile(int32 Slot, int32 Profile)
+{
+    if (Slot < 0) return;
+    if (Slot >= Num())
+    {
+        SetNum(Slot + 1);
+    }
+    SlotProfile[Slot] = static_cast<uint8>(Profiles.IsValidIndex(Profile) ? Profile : 0);
+    // Stato del profilo precedente non piu' valido
+    Seeded[Slot] = false;
+}
+
+void FPeopleCounterCountFilter::SetNum(int32 NumSlots)
+{
+    const int32 Old = Num();
+    if (NumSlots <= Old) return;
+    SlotProfile.SetNumZeroed(NumSlots);
+    HasInput.Add(false, NumSlots - Old);
+    Seeded.Add(false, NumSlots - Old);
+    Input.SetNumZeroed(NumSlots);
+    Output.SetNumZeroed(NumSlots);
+    Ema.SetNumZeroed(NumSlots);
+    LastSeconds.SetNumZeroed(NumSlots);
+    PendingSide.SetNumZeroed(NumSlots);
+    PendingSinceSeconds.SetNumZeroed(NumSlots);
+    MedianRing.SetNumZeroed(NumSlots * MaxMedianWindow);
+    MedianHead.SetNumZeroed(NumSlots);
+    MedianCount.SetNumZeroed(NumSlots);
+}
+
+void FPeopleCounterCountFilter::Reset()
+{
+    // Profili degli slot mantenuti, stato da rifare col prossimo campione
+    Seeded.Init(false, Num());
+}
+
+void FPeopleCounterCountFilter::SetInput(int32 Slot, float Value)
+{
+    if (Slot < 0) return;
+    if (Slot >= Num())
+    {
+        SetNum(Slot + 1);
+    }
+    Input[Slot] = Value;
+    HasInput[Slot] = true;
+}
+
+void FPeopleCounterCountFilter::Step(double Seconds, TArray<int32>& OutChanged)
+{
+    const int32 NumSlots = Num();
+    for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+    {
+        StepSlot(Slot, Seconds, OutChanged);
+    }
+}
+
+void FPeopleCounterCountFilter::Step(double Seconds, TConstArrayView<int32> Slots, TArray<int32>& OutChanged)
+{
+    for (const int32 Slot : Slots)
+    {
+        if (Slot >= 0 && Slot < Num())
+        {
+            StepSlot(Slot, Seconds, OutChanged);
+        }
+    }
+}
+
+void FPeopleCounterCountFilter::StepSlot(int32 Slot, double Seconds, TArray<int32>& OutChanged)
+{
+    if (!HasInput[Slot]) return;
+    const FPeopleCounterFilterSettings& P = Profiles[SlotProfile[Slot]];
+    float X = Input[Slot];
+    const float Previous = Output[Slot];
+
+    if (!P.bEnabled)
+    {
+        Output[Slot] = X;
+    }
+    else if (!Seeded[Slot])
+    {
+        // Primo campione: nessuna storia da filtrare
+        Seeded[Slot] = true;
+        Ema[Slot] = X;
+        LastSeconds[Slot] = Seconds;
+        PendingSide[Slot] = 0;
+        MedianRing[Slot * MaxMedianWindow] = X;
+        MedianHead[Slot] = 1 % MaxMedianWindow;
+        MedianCount[Slot] = 1;
+        Output[Slot] = X;
+    }
+    else
+    {
+        if (P.MedianWindow > 1)
+        {
+            float* Ring = &MedianRing[Slot * MaxMedianWindow];
+            Ring[MedianHead[Slot]] = X;
+            MedianHead[Slot] = static_cast<uint8>((MedianHead[Slot] + 1) % MaxMedianWindow);
+            MedianCount[Slot] = static_cast<uint8>(FMath::Min<int32>(MedianCount[Slot] + 1, MaxMedianWindow));
+
+            // Ultimi N del ring in ordine (N <= 15: insertion sort sullo stack)
+            const int32 N = FMath::Min<int32>(MedianCount[Slot], P.MedianWindow);
+            float Window[MaxMedianWindow];
+            for (int32 i = 0; i < N; ++i)
+            {
+                const float V = Ring[(MedianHead[Slot] + MaxMedianWindow - 1 - i) % MaxMedianWindow];
+                int32 j = i;
+                for (; j > 0 && Window[j - 1] > V; --j)
+                {
+                    Window[j] = Window[j - 1];
+                }
+                Window[j] = V;
+            }
+            X = (N & 1) ? Window[N / 2] : 0.5f * (Window[N / 2 - 1] + Window[N / 2]);
+        }
+
+        if (P.EmaTimeConstantSeconds > 0.f)
+        {
+            const double Dt = FMath::Max(Seconds - LastSeconds[Slot], 0.0);
+            const float Alpha = 1.f - static_cast<float>(FMath::Exp(-Dt / P.EmaTimeConstantSeconds));
+            Ema[Slot] += Alpha * (X - Ema[Slot]);
+            X = Ema[Slot];
+        }
+        LastSeconds[Slot] = Seconds;
+
+        if (P.HysteresisBand > 0.f || P.MinDwellSeconds > 0.f)
+        {
+            const float Diff = X - Output[Slot];
+            const int8 Side = FMath::Abs(Diff) >= FMath::Max(P.HysteresisBand, MinChange) ? (Diff > 0.f ? 1 : -1) : 0;
+            if (Side == 0)
+            {
+                PendingSide[Slot] = 0;
+            }
+            else
+            {
+                if (Side != PendingSide[Slot])
+                {
+                    PendingSide[Slot] = Side;
+                    PendingSinceSeconds[Slot] = Seconds;
+                }
+                if (Seconds - PendingSinceSeconds[Slot] >= P.MinDwellSeconds)
+                {
+                    Output[Slot] = X;
+                    PendingSide[Slot] = 0;
+                }
+            }
+        }
+        else
+        {
+            Output[Slot] = X;
+        }
+    }
+
+    if (FMath::Abs(Output[Slot] - Previous) >= MinChange)
+    {
+        OutChanged.Add(Slot);
+    }
+}
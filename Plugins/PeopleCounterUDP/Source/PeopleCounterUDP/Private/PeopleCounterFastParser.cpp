@@ -0,0 +1,347 @@
+#include "PeopleCounterFastParser.h"
+
+namespace
+{
+    // Potenze di 10 esatte in double
+    const double GPow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    template <typename CharType>
+    class TPeopleCountTokenizer
+    {
+    public:
+        TPeopleCountTokenizer(const CharType* InBegin, int32 InLen)
+            : Cur(InBegin), End(InBegin + InLen)
+        {
+        }
+
+        EPeopleCounterFastParseResult Parse(TPeopleCountPacketView<CharType>& Out)
+        {
+            Out.Schema = TStringView<CharType>();
+            Out.Type = TStringView<CharType>();
+            Out.Timestamp = 0.0;
+            Out.Sequence = -1;
+            Out.RequestId = -1;
+            Out.ClockT0 = 0.0;
+            Out.ClockT1 = 0.0;
+            Out.HubId = TStringView<CharType>();
+            Out.NumSensors = 0;
+            Out.NumPoints = 0;
+
+            bool bHasSchema = false;
+            if (!Expect('{')) return Result;
+            if (!Peek('}'))
+            {
+                do
+                {
+                    TStringView<CharType> Key;
+                    if (!ParseString(Key) || !Expect(':')) return Result;
+
+                    if (Equals(Key, "schema"))
+                    {
+                        if (!ParseString(Out.Schema)) return Result;
+                        bHasSchema = true;
+                    }
+                    else if (Equals(Key, "type"))
+                    {
+                        if (!ParseString(Out.Type)) return Result;
+                    }
+                    else if (Equals(Key, "timestamp"))
+                    {
+                        if (!ParseNumber(Out.Timestamp)) return Result;
+                    }
+                    else if (Equals(Key, "seq"))
+                    {
+                        double Sequence = 0.0;
+                        if (!ParseNumber(Sequence) || Sequence < 0.0) return Result;
+                        Out.Sequence = static_cast<int64>(Sequence);
+                    }
+                    else if (Equals(Key, "request_id"))
+                    {
+                        double RequestId = 0.0;
+                        if (!ParseNumber(RequestId) || RequestId < 0.0) return Result;
+                        Out.RequestId = static_cast<int64>(RequestId);
+                    }
+                    else if (Equals(Key, "t0"))
+                    {
+                        if (!ParseNumber(Out.ClockT0)) return Result;
+                    }
+                    else if (Equals(Key, "t1"))
+                    {
+                        if (!ParseNumber(Out.ClockT1)) return Result;
+                    }
+                    else if (Equals(Key, "hub_id"))
+                    {
+                        if (!ParseString(Out.HubId)) return Result;
+                    }
+                    else if (Equals(Key, "sensors"))
+                    {
+                        if (!ParseSensors(Out)) return Result;
+                    }
+                    else
+                    {
+                        // Campo non previsto dallo schema: decide il DOM
+                        return EPeopleCounterFastParseResult::Unsupported;
+                    }
+                }
+                while (Consume(','));
+            }
+            if (!Expect('}')) return Result;
+
+            SkipWhitespace();
+            if (Cur != End) return EPeopleCounterFastParseResult::Malformed;
+
+            // Senza schema o con uno schema diverso la forma non e' garantita
+            if (!bHasSchema || !Equals(Out.Schema, "people_count_v1"))
+            {
+                return EPeopleCounterFastParseResult::Unsupported;
+            }
+            return EPeopleCounterFastParseResult::Ok;
+        }
+
+    private:
+        const CharType* Cur;
+        const CharType* End;
+        EPeopleCounterFastParseResult Result = EPeopleCounterFastParseResult::Malformed;
+
+        static bool IsDigit(CharType C) { return C >= '0' && C <= '9'; }
+
+        template <int32 N>
+        static bool Equals(TStringView<CharType> View, const ANSICHAR (&Literal)[N])
+        {
+            if (View.Len() != N - 1) return false;
+            for (int32 i = 0; i < N - 1; ++i)
+            {
+                if (View[i] != static_cast<CharType>(Literal[i])) return false;
+            }
+            return true;
+        }
+
+        void SkipWhitespace()
+        {
+            while (Cur < End && (*Cur == ' ' || *Cur == '\t' || *Cur == '\n' || *Cur == '\r'))
+            {
+                ++Cur;
+            }
+        }
+
+        bool Peek(CharType C)
+        {
+            SkipWhitespace();
+            return Cur < End && *Cur == C;
+        }
+
+        bool Consume(CharType C)
+        {
+            if (Peek(C))
+            {
+                ++Cur;
+                return true;
+            }
+            return false;
+        }
+
+        bool Expect(CharType C)
+        {
+            if (Consume(C)) return true;
+            Result = EPeopleCounterFastParseResult::Malformed;
+            return false;
+        }
+
+        bool ParseString(TStringView<CharType>& Out)
+        {
+            if (!Expect('"')) return false;
+            const CharType* Begin = Cur;
+            while (Cur < End && *Cur != '"')
+            {
+                if (*Cur == '\\')
+                {
+                    // Gli escape richiederebbero una copia: lascia fare al DOM
+                    Result = EPeopleCounterFastParseResult::Unsupported;
+                    return false;
+                }
+                ++Cur;
+            }
+            if (Cur == End)
+            {
+                Result = EPeopleCounterFastParseResult::Malformed;
+                return false;
+            }
+            Out = TStringView<CharType>(Begin, static_cast<int32>(Cur - Begin));
+            ++Cur;
+            return true;
+        }
+
+        // -?(0|[1-9]\d*)(\.\d+)?([eE][+-]?\d+)?
+        bool ParseNumber(double& Out)
+        {
+            SkipWhitespace();
+            Result = EPeopleCounterFastParseResult::Malformed;
+
+            const bool bNegative = Cur < End && *Cur == '-';
+            if (bNegative) ++Cur;
+            if (Cur == End || !IsDigit(*Cur)) return false;
+
+            uint64 Mantissa = 0;
+            int32 NumDigits = 0;
+            int32 Exponent = 0;
+            while (Cur < End && IsDigit(*Cur))
+            {
+                if (NumDigits < 19)
+                {
+                    Mantissa = Mantissa * 10 + static_cast<uint64>(*Cur - '0');
+                    ++NumDigits;
+                }
+                else
+                {
+                    ++Exponent;
+                }
+                ++Cur;
+            }
+            if (Cur < End && *Cur == '.')
+            {
+                ++Cur;
+                if (Cur == End || !IsDigit(*Cur)) return false;
+                while (Cur < End && IsDigit(*Cur))
+                {
+                    if (NumDigits < 19)
+                    {
+                        Mantissa = Mantissa * 10 + static_cast<uint64>(*Cur - '0');
+                        ++NumDigits;
+                        --Exponent;
+                    }
+                    ++Cur;
+                }
+            }
+            if (Cur < End && (*Cur == 'e' || *Cur == 'E'))
+            {
+                ++Cur;
+                bool bNegativeExp = false;
+                if (Cur < End && (*Cur == '+' || *Cur == '-'))
+                {
+                    bNegativeExp = *Cur == '-';
+                    ++Cur;
+                }
+                if (Cur == End || !IsDigit(*Cur)) return false;
+                int32 Exp = 0;
+                while (Cur < End && IsDigit(*Cur))
+                {
+                    Exp = FMath::Min(Exp * 10 + static_cast<int32>(*Cur - '0'), 10000);
+                    ++Cur;
+                }
+                Exponent += bNegativeExp ? -Exp : Exp;
+            }
+
+            double Value = static_cast<double>(Mantissa);
+            if (Exponent > 0)
+            {
+                Value *= Exponent < static_cast<int32>(UE_ARRAY_COUNT(GPow10)) ? GPow10[Exponent] : FMath::Pow(10.0, static_cast<double>(Exponent));
+            }
+            else if (Exponent < 0)
+            {
+                Value /= -Exponent < static_cast<int32>(UE_ARRAY_COUNT(GPow10)) ? GPow10[-Exponent] : FMath::Pow(10.0, static_cast<double>(-Exponent));
+            }
+            Out = bNegative ? -Value : Value;
+            return true;
+        }
+
+        bool ParseSensors(TPeopleCountPacketView<CharType>& Out)
+        {
+            if (!Expect('[')) return false;
+            if (Consume(']')) return true;
+            do
+            {
+                if (Out.NumSensors >= Out.SensorStorage.Num())
+                {
+                    // Storage del chiamante esaurito
+                    Result = EPeopleCounterFastParseResult::Unsupported;
+                    return false;
+                }
+                TPeopleCountSensorView<CharType>& Sensor = Out.SensorStorage[Out.NumSensors];
+                Sensor.Id = TStringView<CharType>();
+                Sensor.Count = 0;
+                Sensor.FirstPoint = Out.NumPoints;
+                Sensor.NumPoints = 0;
+
+                if (!Expect('{')) return false;
+                if (!Peek('}'))
+                {
+                    do
+                    {
+                        TStringView<CharType> Key;
+                        if (!ParseString(Key) || !Expect(':')) return false;
+                        if (Equals(Key, "id"))
+                        {
+                            if (!ParseString(Sensor.Id)) return false;
+                        }
+                        else if (Equals(Key, "count"))
+                        {
+                            double Count = 0.0;
+                            if (!ParseNumber(Count)) return false;
+                            Sensor.Count = static_cast<int32>(FMath::Clamp(Count, static_cast<double>(MIN_int32), static_cast<double>(MAX_int32)));
+                        }
+                        else if (Equals(Key, "points"))
+                        {
+                            if (!ParsePoints(Out)) return false;
+                            Sensor.NumPoints = Out.NumPoints - Sensor.FirstPoint;
+                        }
+                        else
+                        {
+                            Result = EPeopleCounterFastParseResult::Unsupported;
+                            return false;
+                        }
+                    }
+                    while (Consume(','));
+                }
+                if (!Expect('}')) return false;
+
+                // Come il DOM: sensori senza id vengono ignorati, con i loro punti
+                if (!Sensor.Id.IsEmpty())
+                {
+                    ++Out.NumSensors;
+                }
+                else
+                {
+                    Out.NumPoints = Sensor.FirstPoint;
+                }
+            }
+            while (Consume(','));
+            return Expect(']');
+        }
+
+        // [x0, y0, x1, y1, ...] in coppie
+        bool ParsePoints(TPeopleCountPacketView<CharType>& Out)
+        {
+            if (!Expect('[')) return false;
+            if (Consume(']')) return true;
+            do
+            {
+                if (Out.NumPoints >= Out.PointStorage.Num())
+                {
+                    Result = EPeopleCounterFastParseResult::Unsupported;
+                    return false;
+                }
+                double X = 0.0, Y = 0.0;
+                if (!ParseNumber(X) || !Expect(',') || !ParseNumber(Y)) return false;
+                Out.PointStorage[Out.NumPoints++] = FVector2f(static_cast<float>(X), static_cast<float>(Y));
+            }
+            while (Consume(','));
+            return Expect(']');
+        }
+    };
+}
+
+namespace PeopleCounter
+{
+    EPeopleCounterFastParseResult FastParsePacket(FUtf8StringView Json, TPeopleCountPacketView<UTF8CHAR>& Out)
+    {
+        return TPeopleCountTokenizer<UTF8CHAR>(Json.GetData(), Json.Len()).Parse(Out);
+    }
+
+    EPeopleCounterFastParseResult FastParsePacket(FStringView Json, TPeopleCountPacketView<TCHAR>& Out)
+    {
+        return TPeopleCountTokenizer<TCHAR>(Json.GetData(), Json.Len()).Parse(Out);
+    }
+}
@@ -0,0 +1,335 @@
+#include "PeopleCounterHeatmapComponent.h"
+#include "UDPJsonReceiverComponent.h"
+#include "PeopleCounterSensorRegistry.h"
+#include "Engine/Texture2D.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "GameFramework/Actor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterHeatmap, Log, All);
+
+namespace
+{
+    // La gaussiana si taglia a questa distanza (in sigma): oltre pesa meno dell'1%
+    constexpr float SplatExtentSigmas = 3.f;
+    // Sotto questa frazione di Intensity la scia si considera spenta
+    constexpr float DecayCutoff = 1e-3f;
+}
+
+struct UPeopleCounterHeatmapComponent::FStagingBuffer
+{
+    TArray<FFloat16> Texels;
+    // Deve restare valida fino alla fine dell'upload sul render thread
+    FUpdateTextureRegion2D Region;
+    TAtomic<bool> bInFlight { false };
+};
+
+UPeopleCounterHeatmapComponent::UPeopleCounterHeatmapComponent()
+{
+    // Tick solo con un upload o una scia in corso
+    PrimaryComponentTick.bCanEverTick = true;
+    PrimaryComponentTick.bStartWithTickEnabled = false;
+    // Dopo tutti gli handler del frame: un solo upload anche con piu' pacchetti
+    PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void UPeopleCounterHeatmapComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    const int32 NumTexels = ResolutionX * ResolutionY;
+    Occupancy.Init(0.f, NumTexels);
+    Density.Init(0.f, NumTexels);
+    for (TSharedPtr<FStagingBuffer, ESPMode::ThreadSafe>& Buffer : Staging)
+    {
+        Buffer = MakeShared<FStagingBuffer, ESPMode::ThreadSafe>();
+        Buffer->Texels.SetNumZeroed(NumTexels);
+        Buffer->Region = FUpdateTextureRegion2D(0, 0, 0, 0, ResolutionX, ResolutionY);
+    }
+
+    Texture = UTexture2D::CreateTransient(ResolutionX, ResolutionY, PF_R16F, MakeUniqueObjectName(this, UTexture2D::StaticClass(), TEXT("PeopleCounterHeatmap")));
+    if (Texture)
+    {
+        // Valori lineari, non colori
+        Texture->SRGB = false;
+        Texture->CompressionSettings = TC_HDR;
+        Texture->Filter = TF_Bilinear;
+        Texture->AddressX = TA_Clamp;
+        Texture->AddressY = TA_Clamp;
+        Texture->UpdateResource();
+        bNeedsUpload = true;
+        RequestTick();
+    }
+
+    if (!Receiver && GetOwner())
+    {
+        Receiver = GetOwner()->FindComponentByClass<UUDPJsonReceiverComponent>();
+    }
+    if (!Receiver)
+    {
+        UE_LOG(LogPeopleCounterHeatmap, Warning, TEXT("%s: no UDPJsonReceiverComponent to read detections from"), *GetName());
+        return;
+    }
+    PacketHandle = Receiver->OnPeopleCountReceivedNative.AddUObject(this, &UPeopleCounterHeatmapComponent::HandlePacket);
+}
+
+void UPeopleCounterHeatmapComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (Receiver)
+    {
+        Receiver->OnPeopleCountReceivedNative.Remove(PacketHandle);
+    }
+    PacketHandle.Reset();
+    // Un upload in volo tiene vivo il suo buffer da solo
+    Staging[0].Reset();
+    Staging[1].Reset();
+    Super::EndPlay(EndPlayReason);
+}
+
+void UPeopleCounterHeatmapComponent::BindToMaterial(UMaterialInstanceDynamic* Material, FName ParameterName)
+{
+    if (Material && Texture)
+    {
+        Material->SetTextureParameterValue(ParameterName, Texture);
+    }
+}
+
+void UPeopleCounterHeatmapComponent::RefreshPlacements()
+{
+    for (FSlotPoints& Slot : Slots)
+    {
+        Slot.State = -1;
+    }
+    bOccupancyDirty = true;
+    RequestTick();
+}
+
+void UPeopleCounterHeatmapComponent::ClearHeatmap()
+{
+    for (FSlotPoints& Slot : Slots)
+    {
+        Slot.Points.Reset();
+    }
+    FMemory::Memzero(Density.GetData(), Density.Num() * sizeof(float));
+    bOccupancyDirty = true;
+    RequestTick();
+}
+
+bool UPeopleCounterHeatmapComponent::ResolvePlacement(int32 SlotIndex)
+{
+    FSlotPoints& Slot = Slots[SlotIndex];
+    if (Slot.State < 0)
+    {
+        const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = Receiver ? Receiver->GetSensorRegistry() : nullptr;
+        const FName SensorId = Registry ? Registry->GetSensorId(SlotIndex) : NAME_None;
+        if (const FPeopleCounterHeatmapPlacement* Found = SensorPlacements.Find(SensorId))
+        {
+            Slot.Placement = *Found;
+            Slot.State = 1;
+        }
+        else
+        {
+            Slot.Placement = FPeopleCounterHeatmapPlacement();
+            Slot.State = bIncludeUnplacedSensors ? 1 : 0;
+        }
+    }
+    return Slot.State > 0;
+}
+
+void UPeopleCounterHeatmapComponent::HandlePacket(const FPeopleCountPacket& Packet)
+{
+    if (Packet.Type != PeopleCounter::TypeDetections) return;
+
+    const double NowSeconds = FPlatformTime::Seconds();
+    for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        if (Sensor.Slot < 0) continue;
+        if (Sensor.Slot >= Slots.Num())
+        {
+            Slots.SetNum(Sensor.Slot + 1);
+        }
+        if (!ResolvePlacement(Sensor.Slot)) continue;
+
+        // Lista del sensore sostituita per intero: nessuna persona resta indietro
+        FSlotPoints& Slot = Slots[Sensor.Slot];
+        Slot.Points.Reset();
+        const int32 End = FMath::Min(Sensor.FirstPoint + Sensor.NumPoints, Packet.Points.Num());
+        for (int32 i = FMath::Max(Sensor.FirstPoint, 0); i < End; ++i)
+        {
+            Slot.Points.Add(FVector2f(Packet.Points[i]));
+        }
+        Slot.LastUpdateSeconds = NowSeconds;
+        bOccupancyDirty = true;
+    }
+    if (bOccupancyDirty)
+    {
+        RequestTick();
+    }
+}
+
+void UPeopleCounterHeatmapComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    bool bAnyPoints = false;
+    if (PointTimeoutSeconds > 0.f)
+    {
+        const double ExpireBefore = FPlatformTime::Seconds() - PointTimeoutSeconds;
+        for (FSlotPoints& Slot : Slots)
+        {
+            if (Slot.Points.Num() == 0) continue;
+            if (Slot.LastUpdateSeconds < ExpireBefore)
+            {
+                Slot.Points.Reset();
+                bOccupancyDirty = true;
+                continue;
+            }
+            bAnyPoints = true;
+        }
+    }
+
+    if (bOccupancyDirty)
+    {
+        RebuildOccupancy();
+        bOccupancyDirty = false;
+        bNeedsUpload = true;
+    }
+
+    bool bDecaying = false;
+    if (DecayHalfLifeSeconds > 0.f)
+    {
+        const float Factor = FMath::Exp2(-DeltaTime / DecayHalfLifeSeconds);
+        const float Cutoff = DecayCutoff * Intensity;
+        for (int32 i = 0; i < Density.Num(); ++i)
+        {
+            const float Decayed = Density[i] * Factor;
+            if (Decayed > Occupancy[i] && Decayed > Cutoff)
+            {
+                Density[i] = Decayed;
+                bDecaying = true;
+            }
+            else if (Density[i] != Occupancy[i])
+            {
+                Density[i] = Occupancy[i];
+                bNeedsUpload = true;
+            }
+        }
+        bNeedsUpload |= bDecaying;
+    }
+    else if (bNeedsUpload)
+    {
+        Density = Occupancy;
+    }
+
+    if (bNeedsUpload)
+    {
+        Upload();
+    }
+
+    // Senza lavoro si spegne; un pacchetto lo riaccende
+    if (!bNeedsUpload && !bDecaying && !bOccupancyDirty && !(bAnyPoints && PointTimeoutSeconds > 0.f))
+    {
+        SetComponentTickEnabled(false);
+    }
+}
+
+void UPeopleCounterHeatmapComponent::RebuildOccupancy()
+{
+    FMemory::Memzero(Occupancy.GetData(), Occupancy.Num() * sizeof(float));
+    for (const FSlotPoints& Slot : Slots)
+    {
+        if (Slot.Points.Num() == 0) continue;
+
+        const FPeopleCounterHeatmapPlacement& P = Slot.Placement;
+        float Sin = 0.f, Cos = 1.f;
+        FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(P.RotationDegrees));
+        const FVector2f Size(P.Size);
+        const FVector2f Center = FVector2f(P.Origin) + 0.5f * Size;
+        for (FVector2f Point : Slot.Points)
+        {
+            if (P.bFlipX)
+            {
+                Point.X = 1.f - Point.X;
+            }
+            // Immagine del sensore -> UV della pianta -> texel (centri a +0.5)
+            const FVector2f Local = (Point - FVector2f(0.5f, 0.5f)) * Size;
+            const FVector2f UV = Center + FVector2f(Local.X * Cos - Local.Y * Sin, Local.X * Sin + Local.Y * Cos);
+            Splat(UV.X * ResolutionX - 0.5f, UV.Y * ResolutionY - 0.5f);
+        }
+    }
+}
+
+void UPeopleCounterHeatmapComponent::Splat(float X, float Y)
+{
+    // Gaussiana separabile: due righe di pesi invece di un exp per texel
+    const float Sigma = FMath::Max(SplatRadius, 0.25f);
+    const float InvTwoSigmaSq = 1.f / (2.f * Sigma * Sigma);
+    const int32 Extent = FMath::CeilToInt(SplatExtentSigmas * Sigma);
+
+    const int32 MinX = FMath::Max(FMath::FloorToInt(X) - Extent, 0);
+    const int32 MaxX = FMath::Min(FMath::CeilToInt(X) + Extent, ResolutionX - 1);
+    const int32 MinY = FMath::Max(FMath::FloorToInt(Y) - Extent, 0);
+    const int32 MaxY = FMath::Min(FMath::CeilToInt(Y) + Extent, ResolutionY - 1);
+    if (MinX > MaxX || MinY > MaxY) return;
+
+    TArray<float, TInlineAllocator<64>> WeightX;
+    WeightX.SetNumUninitialized(MaxX - MinX + 1);
+    for (int32 TX = MinX; TX <= MaxX; ++TX)
+    {
+        const float D = TX - X;
+        WeightX[TX - MinX] = FMath::Exp(-D * D * InvTwoSigmaSq);
+    }
+    for (int32 TY = MinY; TY <= MaxY; ++TY)
+    {
+        const float D = TY - Y;
+        const float WeightY = Intensity * FMath::Exp(-D * D * InvTwoSigmaSq);
+        float* Row = Occupancy.GetData() + TY * ResolutionX;
+        for (int32 TX = MinX; TX <= MaxX; ++TX)
+        {
+            Row[TX] += WeightY * WeightX[TX - MinX];
+        }
+    }
+}
+
+void UPeopleCounterHeatmapComponent::Upload()
+{
+    if (!Texture || !Texture->GetResource()) return;
+
+    // Entrambi ancora sul render thread: si riprova al prossimo frame, niente attesa
+    int32 FreeIndex = INDEX_NONE;
+    for (int32 i = 0; i < UE_ARRAY_COUNT(Staging); ++i)
+    {
+        if (Staging[i] && !Staging[i]->bInFlight)
+        {
+            FreeIndex = i;
+            break;
+        }
+    }
+    if (FreeIndex == INDEX_NONE) return;
+    FStagingBuffer* Free = Staging[FreeIndex].Get();
+
+    float Peak = 0.f;
+    for (int32 i = 0; i < Density.Num(); ++i)
+    {
+        Free->Texels[i] = FFloat16(Density[i]);
+        Peak = FMath::Max(Peak, Density[i]);
+    }
+    PeakValue = Peak;
+
+    Free->bInFlight = true;
+    TSharedPtr<FStagingBuffer, ESPMode::ThreadSafe> Keep = Staging[FreeIndex];
+    Texture->UpdateTextureRegions(0, 1, &Free->Region, ResolutionX * sizeof(FFloat16), sizeof(FFloat16),
+        reinterpret_cast<uint8*>(Free->Texels.GetData()),
+        [Keep](uint8*, const FUpdateTextureRegion2D*)
+        {
+            Keep->bInFlight = false;
+        });
+    bNeedsUpload = false;
+}
+
+void UPeopleCounterHeatmapComponent::RequestTick()
+{
+    if (!IsComponentTickEnabled())
+    {
+        SetComponentTickEnabled(true);
+    }
+}
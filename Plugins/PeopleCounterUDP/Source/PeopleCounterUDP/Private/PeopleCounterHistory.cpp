@@ -0,0 +1,136 @@
+#include "PeopleCounterHistory.h"
+
+void FPeopleCounterHistory::Init(int32 InNumSeries, int32 InCapacity)
+{
+    Series = FMath::Max(0, InNumSeries);
+    Capacity = FMath::Max(1, InCapacity);
+    Values.SetNumZeroed(Series * Capacity);
+    Prefix.SetNumZeroed(Series * (Capacity + 1));
+    for (FMonotonicQueue* Queue : { &MaxQueue, &MinQueue })
+    {
+        Queue->Indices.SetNumZeroed(Series * Capacity);
+        Queue->Head.SetNumZeroed(Series);
+        Queue->Tail.SetNumZeroed(Series);
+    }
+    NumPushed = 0;
+}
+
+void FPeopleCounterHistory::Reset()
+{
+    // Il contenuto dei ring non conta: le query guardano solo gli ultimi NumPushed campioni
+    NumPushed = 0;
+    for (FMonotonicQueue* Queue : { &MaxQueue, &MinQueue })
+    {
+        FMemory::Memzero(Queue->Head.GetData(), Queue->Head.Num() * sizeof(int64));
+        FMemory::Memzero(Queue->Tail.GetData(), Queue->Tail.Num() * sizeof(int64));
+    }
+}
+
+void FPeopleCounterHistory::Push(TConstArrayView<float> InValues)
+{
+    check(InValues.Num() == Series);
+    const int64 Sample = NumPushed;
+    const int32 Position = static_cast<int32>(Sample % Capacity);
+    const int32 PrefixStride = Capacity + 1;
+    const int32 PrefixPosition = static_cast<int32>(Sample % PrefixStride);
+    const int32 PreviousPrefixPosition = static_cast<int32>((Sample + PrefixStride - 1) % PrefixStride);
+
+    for (int32 SeriesIndex = 0; SeriesIndex < Series; ++SeriesIndex)
+    {
+        const float Value = InValues[SeriesIndex];
+        // Il campione sovrascritto (Sample - Capacity) esce dalla finestra piu' lunga
+        Values[SeriesIndex * Capacity + Position] = Value;
+        double* SeriesPrefix = &Prefix[SeriesIndex * PrefixStride];
+        SeriesPrefix[PrefixPosition] = (Sample > 0 ? SeriesPrefix[PreviousPrefixPosition] : 0.0) + Value;
+
+        PushQueue(MaxQueue, SeriesIndex, Value, true);
+        PushQueue(MinQueue, SeriesIndex, Value, false);
+    }
+    ++NumPushed;
+}
+
+void FPeopleCounterHistory::PushQueue(FMonotonicQueue& Queue, int32 SeriesIndex, float Value, bool bMax)
+{
+    const int64 Sample = NumPushed;
+    int64* Indices = &Queue.Indices[SeriesIndex * Capacity];
+    int64& Head = Queue.Head[SeriesIndex];
+    int64& Tail = Queue.Tail[SeriesIndex];
+
+    // Davanti: campioni non piu' nel ring
+    while (Head < Tail && Indices[Head % Capacity] <= Sample - Capacity)
+    {
+        ++Head;
+    }
+    // Dietro: campioni che il nuovo domina per tutte le finestre che li contengono
+    while (Head < Tail)
+    {
+        const float Back = ValueAt(SeriesIndex, Indices[(Tail - 1) % Capacity]);
+        if (bMax ? Back > Value : Back < Value) break;
+        --Tail;
+    }
+    Indices[Tail % Capacity] = Sample;
+    ++Tail;
+}
+
+int64 FPeopleCounterHistory::FindInQueue(const FMonotonicQueue& Queue, int32 SeriesIndex, int64 FirstSample) const
+{
+    const int64* Indices = &Queue.Indices[SeriesIndex * Capacity];
+    int64 Low = Queue.Head[SeriesIndex];
+    int64 High = Queue.Tail[SeriesIndex] - 1;
+    // L'ultimo elemento e' l'ultimo campione: sta in ogni finestra
+    while (Low < High)
+    {
+        const int64 Mid = Low + (High - Low) / 2;
+        if (Indices[Mid % Capacity] >= FirstSample)
+        {
+            High = Mid;
+        }
+        else
+        {
+            Low = Mid + 1;
+        }
+    }
+    return Indices[Low % Capacity];
+}
+
+int32 FPeopleCounterHistory::ClampWindow(int32 WindowSamples) const
+{
+    return FMath::Clamp(WindowSamples, 1, NumAvailable());
+}
+
+float FPeopleCounterHistory::GetLatest(int32 SeriesIndex) const
+{
+    if (NumPushed == 0 || SeriesIndex < 0 || SeriesIndex >= Series) return 0.f;
+    return ValueAt(SeriesIndex, NumPushed - 1);
+}
+
+float FPeopleCounterHistory::GetAverage(int32 SeriesIndex, int32 WindowSamples) const
+{
+    if (NumPushed == 0 || SeriesIndex < 0 || SeriesIndex >= Series) return 0.f;
+    const int32 Window = ClampWindow(WindowSamples);
+    const int32 PrefixStride = Capacity + 1;
+    const double* SeriesPrefix = &Prefix[SeriesIndex * PrefixStride];
+    const int64 Last = NumPushed - 1;
+    const int64 BeforeFirst = Last - Window;
+    const double Sum = SeriesPrefix[Last % PrefixStride] - (BeforeFirst >= 0 ? SeriesPrefix[BeforeFirst % PrefixStride] : 0.0);
+    return static_cast<float>(Sum / Window);
+}
+
+float FPeopleCounterHistory::GetMin(int32 SeriesIndex, int32 WindowSamples) const
+{
+    if (NumPushed == 0 || SeriesIndex < 0 || SeriesIndex >= Series) return 0.f;
+    return ValueAt(SeriesIndex, FindInQueue(MinQueue, SeriesIndex, NumPushed - ClampWindow(WindowSamples)));
+}
+
+float FPeopleCounterHistory::GetMax(int32 SeriesIndex, int32 WindowSamples) const
+{
+    if (NumPushed == 0 || SeriesIndex < 0 || SeriesIndex >= Series) return 0.f;
+    return ValueAt(SeriesIndex, FindInQueue(MaxQueue, SeriesIndex, NumPushed - ClampWindow(WindowSamples)));
+}
+
+int32 FPeopleCounterHistory::GetMaxAge(int32 SeriesIndex, int32 WindowSamples) const
+{
+    if (NumPushed == 0 || SeriesIndex < 0 || SeriesIndex >= Series) return 0;
+    const int64 Sample = FindInQueue(MaxQueue, SeriesIndex, NumPushed - ClampWindow(WindowSamples));
+    return static_cast<int32>(NumPushed - 1 - Sample);
+}
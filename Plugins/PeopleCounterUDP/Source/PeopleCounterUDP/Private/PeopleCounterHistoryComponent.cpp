@@ -0,0 +1,246 @@
+#include "PeopleCounterHistoryComponent.h"
+#include "UDPJsonReceiverComponent.h"
+#include "PeopleCounterAreaAggregatorComponent.h"
+#include "PeopleCounterSensorRegistry.h"
+#include "GameFramework/Actor.h"
+#include "Misc/App.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterHistory, Log, All);
+
+UPeopleCounterHistoryComponent::UPeopleCounterHistoryComponent()
+{
+    PrimaryComponentTick.bCanEverTick = true;
+    // Dopo i pacchetti del frame: il campione vede gli ultimi conteggi
+    PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void UPeopleCounterHistoryComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    if (!Receiver && GetOwner())
+    {
+        Receiver = GetOwner()->FindComponentByClass<UUDPJsonReceiverComponent>();
+    }
+    if (!Aggregator && GetOwner())
+    {
+        Aggregator = GetOwner()->FindComponentByClass<UPeopleCounterAreaAggregatorComponent>();
+    }
+    if (!Receiver && !Aggregator)
+    {
+        UE_LOG(LogPeopleCounterHistory, Warning, TEXT("%s: no UDPJsonReceiverComponent or aggregator to record"), *GetName());
+        SetComponentTickEnabled(false);
+        return;
+    }
+
+    SampleIntervalSeconds = FMath::Max(SampleIntervalSeconds, 0.01f);
+    const int32 Capacity = FMath::Max(1, FMath::CeilToInt(HistorySeconds / SampleIntervalSeconds));
+    History.Init(FMath::Max(0, MaxAreas) + FMath::Max(0, MaxSensors), Capacity);
+    SampleScratch.SetNumZeroed(History.NumSeries());
+    NextSampleSeconds = 0.0;
+    AreaSeriesByName.Reset();
+    SeriesByAreaIndex.Reset();
+    bAreaSeriesDirty = true;
+    if (Aggregator)
+    {
+        AreasRebuiltHandle = Aggregator->OnAreasRebuiltNative.AddWeakLambda(this, [this]() { bAreaSeriesDirty = true; });
+    }
+    // I campioni dovuti si recuperano dal tempo trascorso: basta un tick per intervallo
+    SetComponentTickInterval(SampleIntervalSeconds * 0.5f);
+
+    UE_LOG(LogPeopleCounterHistory, Log, TEXT("%s: %d series x %d samples (%.1f KB)"), *GetName(), History.NumSeries(), Capacity,
+        History.NumSeries() * (Capacity * (sizeof(float) + 2 * sizeof(int64)) + (Capacity + 1) * sizeof(double)) / 1024.0);
+}
+
+void UPeopleCounterHistoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (Aggregator)
+    {
+        Aggregator->OnAreasRebuiltNative.Remove(AreasRebuiltHandle);
+    }
+    AreasRebuiltHandle.Reset();
+    Super::EndPlay(EndPlayReason);
+}
+
+void UPeopleCounterHistoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    const double NowSeconds = FApp::GetCurrentTime();
+    if (NextSampleSeconds <= 0.0)
+    {
+        NextSampleSeconds = NowSeconds;
+    }
+    if (NowSeconds < NextSampleSeconds) return;
+
+    // Dopo un frame lungo il valore corrente copre tutti i campioni saltati (al massimo una storia piena)
+    const int64 Due = static_cast<int64>((NowSeconds - NextSampleSeconds) / SampleIntervalSeconds) + 1;
+    NextSampleSeconds += Due * SampleIntervalSeconds;
+    Sample(static_cast<int32>(FMath::Min<int64>(Due, History.GetCapacity())));
+}
+
+void UPeopleCounterHistoryComponent::Sample(int32 NumSamples)
+{
+    const int32 NumAreaSeries = FMath::Max(0, MaxAreas);
+    if (Aggregator)
+    {
+        const TConstArrayView<float> AreaCounts = Aggregator->GetAreaCounts();
+        // AddExternalArea aggiunge in coda senza rebuild
+        if (bAreaSeriesDirty || SeriesByAreaIndex.Num() != AreaCounts.Num())
+        {
+            BindAreaSeries();
+        }
+        for (int32 AreaIndex = 0; AreaIndex < AreaCounts.Num(); ++AreaIndex)
+        {
+            if (SeriesByAreaIndex[AreaIndex] != INDEX_NONE)
+            {
+                SampleScratch[SeriesByAreaIndex[AreaIndex]] = AreaCounts[AreaIndex];
+            }
+        }
+    }
+    if (const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = Receiver ? Receiver->GetSensorRegistry() : nullptr)
+    {
+        const TConstArrayView<int32> SensorCounts = Registry->GetCounts();
+        const int32 NumSensors = FMath::Min(SensorCounts.Num(), History.NumSeries() - NumAreaSeries);
+        for (int32 Slot = 0; Slot < NumSensors; ++Slot)
+        {
+            SampleScratch[NumAreaSeries + Slot] = static_cast<float>(SensorCounts[Slot]);
+        }
+    }
+    for (int32 i = 0; i < NumSamples; ++i)
+    {
+        History.Push(SampleScratch);
+    }
+}
+
+void UPeopleCounterHistoryComponent::BindAreaSeries()
+{
+    bAreaSeriesDirty = false;
+    const int32 NumAreaSeries = FMath::Min(FMath::Max(0, MaxAreas), History.NumSeries());
+    // Le aree sparite restano a 0; quelle presenti vengono riscritte a ogni campione
+    FMemory::Memzero(SampleScratch.GetData(), NumAreaSeries * sizeof(float));
+
+    const TArray<FName>& AreaNames = Aggregator->GetAreaNames();
+    SeriesByAreaIndex.SetNumUninitialized(AreaNames.Num());
+    int32 Unrecorded = 0;
+    for (int32 AreaIndex = 0; AreaIndex < AreaNames.Num(); ++AreaIndex)
+    {
+        const int32* Series = AreaSeriesByName.Find(AreaNames[AreaIndex]);
+        if (!Series && AreaSeriesByName.Num() < NumAreaSeries)
+        {
+            Series = &AreaSeriesByName.Add(AreaNames[AreaIndex], AreaSeriesByName.Num());
+        }
+        SeriesByAreaIndex[AreaIndex] = Series ? *Series : INDEX_NONE;
+        Unrecorded += Series ? 0 : 1;
+    }
+    if (Unrecorded > 0)
+    {
+        UE_LOG(LogPeopleCounterHistory, Warning, TEXT("%s: %d areas without history, MaxAreas (%d) series already assigned"), *GetName(), Unrecorded, MaxAreas);
+    }
+}
+
+void UPeopleCounterHistoryComponent::ClearHistory()
+{
+    History.Reset();
+    NextSampleSeconds = 0.0;
+}
+
+float UPeopleCounterHistoryComponent::GetRecordedSeconds() const
+{
+    return History.NumAvailable() * SampleIntervalSeconds;
+}
+
+int32 UPeopleCounterHistoryComponent::SecondsToSamples(float Seconds) const
+{
+    return FMath::Max(1, FMath::RoundToInt(Seconds / SampleIntervalSeconds));
+}
+
+int32 UPeopleCounterHistoryComponent::GetAreaSeries(FName Area) const
+{
+    const int32* Series = AreaSeriesByName.Find(Area);
+    return Series ? *Series : INDEX_NONE;
+}
+
+int32 UPeopleCounterHistoryComponent::GetSensorSeries(FName SensorId) const
+{
+    const int32 Slot = Receiver ? Receiver->GetSensorIndex(SensorId) : INDEX_NONE;
+    const int32 Series = Slot >= 0 ? FMath::Max(0, MaxAreas) + Slot : INDEX_NONE;
+    return Series >= 0 && Series < History.NumSeries() ? Series : INDEX_NONE;
+}
+
+float UPeopleCounterHistoryComponent::GetAreaAverage(FName Area, float Seconds) const
+{
+    return History.GetAverage(GetAreaSeries(Area), SecondsToSamples(Seconds));
+}
+
+float UPeopleCounterHistoryComponent::GetAreaMin(FName Area, float Seconds) const
+{
+    return History.GetMin(GetAreaSeries(Area), SecondsToSamples(Seconds));
+}
+
+float UPeopleCounterHistoryComponent::GetAreaMax(FName Area, float Seconds) const
+{
+    return History.GetMax(GetAreaSeries(Area), SecondsToSamples(Seconds));
+}
+
+bool UPeopleCounterHistoryComponent::GetAreaPeak(FName Area, float Seconds, float& OutPeak, float& OutSecondsAgo) const
+{
+    return GetPeak(GetAreaSeries(Area), Seconds, OutPeak, OutSecondsAgo);
+}
+
+float UPeopleCounterHistoryComponent::GetSensorAverage(FName SensorId, float Seconds) const
+{
+    return History.GetAverage(GetSensorSeries(SensorId), SecondsToSamples(Seconds));
+}
+
+float UPeopleCounterHistoryComponent::GetSensorMin(FName SensorId, float Seconds) const
+{
+    return History.GetMin(GetSensorSeries(SensorId), SecondsToSamples(Seconds));
+}
+
+float UPeopleCounterHistoryComponent::GetSensorMax(FName SensorId, float Seconds) const
+{
+    return History.GetMax(GetSensorSeries(SensorId), SecondsToSamples(Seconds));
+}
+
+bool UPeopleCounterHistoryComponent::GetSensorPeak(FName SensorId, float Seconds, float& OutPeak, float& OutSecondsAgo) const
+{
+    return GetPeak(GetSensorSeries(SensorId), Seconds, OutPeak, OutSecondsAgo);
+}
+
+bool UPeopleCounterHistoryComponent::GetPeak(int32 Series, float Seconds, float& OutPeak, float& OutSecondsAgo) const
+{
+    if (Series == INDEX_NONE || History.NumAvailable() == 0)
+    {
+        OutPeak = 0.f;
+        OutSecondsAgo = 0.f;
+        return false;
+    }
+    const int32 Window = SecondsToSamples(Seconds);
+    OutPeak = History.GetMax(Series, Window);
+    OutSecondsAgo = History.GetMaxAge(Series, Window) * SampleIntervalSeconds;
+    return true;
+}
+
+bool UPeopleCounterHistoryComponent::GetHighestAverageArea(float Seconds, FName& OutArea, float& OutAverage) const
+{
+    OutArea = NAME_None;
+    OutAverage = 0.f;
+    if (!Aggregator) return false;
+
+    // Una sottrazione per area; a parita' vince l'area definita prima, come GetMostPopulatedArea
+    const int32 Window = SecondsToSamples(Seconds);
+    const TArray<FName>& AreaNames = Aggregator->GetAreaNames();
+    for (int32 AreaIndex = 0; AreaIndex < AreaNames.Num(); ++AreaIndex)
+    {
+        const int32 Series = GetAreaSeries(AreaNames[AreaIndex]);
+        if (Series == INDEX_NONE) continue;
+        const float Average = History.GetAverage(Series, Window);
+        if (Average > OutAverage)
+        {
+            OutAverage = Average;
+            OutArea = AreaNames[AreaIndex];
+        }
+    }
+    return !OutArea.IsNone();
+}
@@ -2,14 +2,139 @@
 #include "Dom/JsonObject.h"
 #include "Serialization/JsonReader.h"
 #include "Serialization/JsonSerializer.h"
+#include "PeopleCounterFastParser.h"
+#include "PeopleCounterUDPStats.h"
+
+namespace PeopleCounter
+{
+    const FName SchemaV1(TEXT("people_count_v1"));
+    const FName TypeSnapshotCounts(TEXT("snapshot_counts"));
+    const FName TypeSensorList(TEXT("sensor_list"));
+    const FName TypeDeltaCounts(TEXT("delta_counts"));
+    const FName TypePong(TEXT("pong"));
+    const FName TypeDetections(TEXT("detections"));
+    const FName TypeInterval(TEXT("interval"));
+}
+
+FString FPeopleCounterReceiverStats::ToString() const
+{
+    return FString::Printf(
+        TEXT("%.1fs: %lld pkts (%.1f/s), %lld bytes, parse failures %lld | gaps %lld, out-of-order %lld, duplicates %lld, lost ~%lld | ")
+        TEXT("queue overflow %lld, superseded %lld, discarded deltas %lld | reassembled %lld, reassembly failures %lld | inter-arrival %.2f ms, jitter %.2f ms | ")
+        TEXT("latency n=%lld min %.1f mean %.1f p50 %.1f p95 %.1f p99 %.1f max %.1f ms | ")
+        TEXT("requests %lld answered, %lld timed out, rtt min %.1f mean %.1f max %.1f ms | ")
+        TEXT("queue depth %d, dispatch mean %.3f max %.3f ms/frame"),
+        ElapsedSeconds, PacketsReceived, PacketsPerSecond, BytesReceived, ParseFailures,
+        SequenceGaps, OutOfOrderPackets, DuplicatePackets, PacketsLost,
+        QueueOverflows, SupersededPackets, DiscardedDeltas, ReassembledMessages, ReassemblyFailures, MeanInterArrivalMs, JitterMs,
+        LatencySamples, LatencyMinMs, LatencyMeanMs, LatencyP50Ms, LatencyP95Ms, LatencyP99Ms, LatencyMaxMs,
+        RequestsAnswered, RequestTimeouts, RoundTripMinMs, RoundTripMeanMs, RoundTripMaxMs,
+        QueueDepth, DispatchMeanMs, DispatchMaxMs);
+}
+
+namespace
+{
+    // Storage sullo stack per il parser veloce; oltre si passa dal DOM
+    constexpr int32 InlineFastParseSensors = 64;
+    constexpr int32 InlineFastParsePoints = 256;
+
+    template <typename CharType>
+    FName ToName(TStringView<CharType> View)
+    {
+        if (View.IsEmpty()) return NAME_None;
+        return FName(View.Len(), View.GetData());
+    }
+
+    FName ToName(FUtf8StringView View)
+    {
+        if (View.IsEmpty()) return NAME_None;
+        // FName non ha un costruttore UTF-8 con lunghezza: gli id del protocollo sono ASCII
+        for (UTF8CHAR C : View)
+        {
+            if (static_cast<uint8>(C) >= 0x80)
+            {
+                FUTF8ToTCHAR Conv(reinterpret_cast<const ANSICHAR*>(View.GetData()), View.Len());
+                return FName(Conv.Length(), Conv.Get());
+            }
+        }
+        return FName(View.Len(), reinterpret_cast<const ANSICHAR*>(View.GetData()));
+    }
+
+    template <typename CharType, int32 N>
+    bool MatchesLiteral(TStringView<CharType> View, const ANSICHAR (&Literal)[N])
+    {
+        if (View.Len() != N - 1) return false;
+        for (int32 i = 0; i < N - 1; ++i)
+        {
+            if (View[i] != static_cast<CharType>(Literal[i])) return false;
+        }
+        return true;
+    }
+
+    template <typename CharType>
+    FName ToSchemaOrTypeName(TStringView<CharType> View)
+    {
+        // Valori noti senza passare dalla tabella dei nomi
+        if (MatchesLiteral(View, "people_count_v1")) return PeopleCounter::SchemaV1;
+        if (MatchesLiteral(View, "snapshot_counts")) return PeopleCounter::TypeSnapshotCounts;
+        if (MatchesLiteral(View, "delta_counts")) return PeopleCounter::TypeDeltaCounts;
+        if (MatchesLiteral(View, "pong")) return PeopleCounter::TypePong;
+        if (MatchesLiteral(View, "detections")) return PeopleCounter::TypeDetections;
+        return ToName(View);
+    }
+
+    template <typename CharType>
+    void CopyView(const TPeopleCountPacketView<CharType>& View, FPeopleCountPacket& OutPacket)
+    {
+        OutPacket.Schema = ToSchemaOrTypeName(View.Schema);
+        OutPacket.Type = ToSchemaOrTypeName(View.Type);
+        OutPacket.Timestamp = View.Timestamp;
+        OutPacket.Sequence = View.Sequence;
+        OutPacket.RequestId = View.RequestId;
+        OutPacket.ClockT0 = View.ClockT0;
+        OutPacket.ClockT1 = View.ClockT1;
+        OutPacket.Source = View.HubId.IsEmpty() ? NAME_None : ToName(View.HubId);
+        OutPacket.Serials.Reset();
+        OutPacket.Sensors.SetNum(View.NumSensors, EAllowShrinking::No);
+        for (int32 i = 0; i < View.NumSensors; ++i)
+        {
+            OutPacket.Sensors[i].Id = ToName(View.SensorStorage[i].Id);
+            OutPacket.Sensors[i].Count = View.SensorStorage[i].Count;
+            OutPacket.Sensors[i].Slot = INDEX_NONE;
+            OutPacket.Sensors[i].FirstPoint = View.SensorStorage[i].FirstPoint;
+            OutPacket.Sensors[i].NumPoints = View.SensorStorage[i].NumPoints;
+        }
+        OutPacket.Points.SetNum(View.NumPoints, EAllowShrinking::No);
+        for (int32 i = 0; i < View.NumPoints; ++i)
+        {
+            OutPacket.Points[i] = FVector2D(View.PointStorage[i]);
+        }
+    }
+}
 
 bool UPeopleCounterJsonLib::ParsePeopleCountPacket(const FString& JsonString,
     TMap<FString, int32>& OutSensors,
     double& OutTimestamp)
 {
+    PEOPLECOUNTER_SCOPE(Parse);
     OutSensors.Empty();
     OutTimestamp = 0.0;
 
+    // Percorso veloce per la forma nota people_count_v1
+    TPeopleCountSensorView<TCHAR> Storage[InlineFastParseSensors];
+    TPeopleCountPacketView<TCHAR> View;
+    View.SensorStorage = MakeArrayView(Storage);
+    if (PeopleCounter::FastParsePacket(FStringView(JsonString), View) == EPeopleCounterFastParseResult::Ok)
+    {
+        OutTimestamp = View.Timestamp;
+        OutSensors.Reserve(View.NumSensors);
+        for (const TPeopleCountSensorView<TCHAR>& Sensor : View.GetSensors())
+        {
+            OutSensors.Add(FString(Sensor.Id), Sensor.Count);
+        }
+        return true;
+    }
+
     TSharedPtr<FJsonObject> Root;
     const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
     if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid())
@@ -43,3 +168,125 @@ bool UPeopleCounterJsonLib::ParsePeopleCountPacket(const FString& JsonString,
     }
     return true;
 }
+
+bool UPeopleCounterJsonLib::ParsePeopleCountPacketStruct(const FString& JsonString,
+    FPeopleCountPacket& OutPacket)
+{
+    PEOPLECOUNTER_SCOPE(Parse);
+    OutPacket.Reset();
+
+    TPeopleCountSensorView<TCHAR> Storage[InlineFastParseSensors];
+    FVector2f PointStorage[InlineFastParsePoints];
+    TPeopleCountPacketView<TCHAR> View;
+    View.SensorStorage = MakeArrayView(Storage);
+    View.PointStorage = MakeArrayView(PointStorage);
+    if (PeopleCounter::FastParsePacket(FStringView(JsonString), View) == EPeopleCounterFastParseResult::Ok)
+    {
+        CopyView(View, OutPacket);
+        return true;
+    }
+
+    TSharedPtr<FJsonObject> Root;
+    const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+    if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid())
+    {
+        return false;
+    }
+
+    FString Schema, Type;
+    if (Root->TryGetStringField(TEXT("schema"), Schema))
+    {
+        OutPacket.Schema = FName(*Schema);
+    }
+    if (Root->TryGetStringField(TEXT("type"), Type))
+    {
+        OutPacket.Type = FName(*Type);
+    }
+    Root->TryGetNumberField(TEXT("timestamp"), OutPacket.Timestamp);
+    Root->TryGetNumberField(TEXT("seq"), OutPacket.Sequence);
+    Root->TryGetNumberField(TEXT("request_id"), OutPacket.RequestId);
+    Root->TryGetNumberField(TEXT("t0"), OutPacket.ClockT0);
+    Root->TryGetNumberField(TEXT("t1"), OutPacket.ClockT1);
+    Root->TryGetNumberField(TEXT("seconds"), OutPacket.IntervalSeconds);
+    Root->TryGetNumberField(TEXT("previous_seconds"), OutPacket.PreviousIntervalSeconds);
+    FString HubId;
+    if (Root->TryGetStringField(TEXT("hub_id"), HubId) && !HubId.IsEmpty())
+    {
+        OutPacket.Source = FName(*HubId);
+    }
+
+    const TArray<TSharedPtr<FJsonValue>>* SensorsArray = nullptr;
+    if (Root->TryGetArrayField(TEXT("sensors"), SensorsArray))
+    {
+        OutPacket.Sensors.Reserve(SensorsArray->Num());
+        for (const TSharedPtr<FJsonValue>& V : *SensorsArray)
+        {
+            if (!V.IsValid() || V->Type != EJson::Object) continue;
+            TSharedPtr<FJsonObject> Obj = V->AsObject();
+            if (!Obj.IsValid()) continue;
+
+            FString Id;
+            int32 Count = 0;
+            Obj->TryGetStringField(TEXT("id"), Id);
+            Obj->TryGetNumberField(TEXT("count"), Count);
+            if (!Id.IsEmpty())
+            {
+                FPeopleCountSensor& Sensor = OutPacket.Sensors.AddDefaulted_GetRef();
+                Sensor.Id = FName(*Id);
+                Sensor.Count = Count;
+                Sensor.FirstPoint = OutPacket.Points.Num();
+
+                const TArray<TSharedPtr<FJsonValue>>* PointsArray = nullptr;
+                if (Obj->TryGetArrayField(TEXT("points"), PointsArray))
+                {
+                    for (int32 i = 0; i + 1 < PointsArray->Num(); i += 2)
+                    {
+                        double X = 0.0, Y = 0.0;
+                        if ((*PointsArray)[i].IsValid() && (*PointsArray)[i + 1].IsValid()
+                            && (*PointsArray)[i]->TryGetNumber(X) && (*PointsArray)[i + 1]->TryGetNumber(Y))
+                        {
+                            OutPacket.Points.Emplace(X, Y);
+                        }
+                    }
+                }
+                Sensor.NumPoints = OutPacket.Points.Num() - Sensor.FirstPoint;
+            }
+        }
+    }
+
+    const TArray<TSharedPtr<FJsonValue>>* SerialsArray = nullptr;
+    if (Root->TryGetArrayField(TEXT("serials"), SerialsArray))
+    {
+        OutPacket.Serials.Reserve(SerialsArray->Num());
+        for (const TSharedPtr<FJsonValue>& V : *SerialsArray)
+        {
+            FString Serial;
+            if (V.IsValid() && V->TryGetString(Serial))
+            {
+                OutPacket.Serials.Add(MoveTemp(Serial));
+            }
+        }
+    }
+    return true;
+}
+
+bool UPeopleCounterJsonLib::ParsePeopleCountPacketUtf8(const uint8* Data, int32 Num,
+    TArrayView<TPeopleCountSensorView<UTF8CHAR>> Scratch,
+    FPeopleCountPacket& OutPacket,
+    TArrayView<FVector2f> PointScratch)
+{
+    PEOPLECOUNTER_SCOPE(Parse);
+    TPeopleCountPacketView<UTF8CHAR> View;
+    View.SensorStorage = Scratch;
+    View.PointStorage = PointScratch;
+    const FUtf8StringView Json(reinterpret_cast<const UTF8CHAR*>(Data), Num);
+    if (PeopleCounter::FastParsePacket(Json, View) == EPeopleCounterFastParseResult::Ok)
+    {
+        CopyView(View, OutPacket);
+        return true;
+    }
+
+    // Fallback DOM: schema sconosciuto, campi extra (es. sensor_list), troppi sensori o punti
+    FUTF8ToTCHAR Conv(reinterpret_cast<const ANSICHAR*>(Data), Num);
+    return ParsePeopleCountPacketStruct(FString(Conv.Length(), Conv.Get()), OutPacket);
+}
@@ -0,0 +1,376 @@
+#include "PeopleCounterLoadGenerator.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "Common/UdpSocketBuilder.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/StringBuilder.h"
+#include "PeopleCounterBinaryProtocol.h"
+#include "PeopleCounterFragmentProtocol.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterLoad, Log, All);
+
+namespace
+{
+    // Passo massimo di attesa: Stop viene notato entro questo tempo
+    constexpr double MaxWaitStepSeconds = 0.05;
+    // Sender piu' lento del profilo: si perde il ritardo oltre questi messaggi invece di recuperarlo
+    constexpr double MaxBacklogMessages = 256.0;
+    constexpr int32 MaxSensors = 65535;
+
+    double UnixNowSeconds()
+    {
+        return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalSeconds();
+    }
+}
+
+FPeopleCounterLoadGenerator::FPeopleCounterLoadGenerator(const FPeopleCounterLoadSettings& InSettings)
+    : Settings(InSettings)
+    , Random(InSettings.Seed)
+{
+    Settings.NumSensors = FMath::Clamp(Settings.NumSensors, 1, MaxSensors);
+    Settings.MaxCount = FMath::Clamp(Settings.MaxCount, 0, static_cast<int32>(MAX_uint16));
+    Settings.ChangesPerPacket = FMath::Clamp(Settings.ChangesPerPacket, 0, Settings.NumSensors);
+    Settings.MaxDatagramBytes = FMath::Clamp(Settings.MaxDatagramBytes, PeopleCounter::Fragment::HeaderSize + 1, 65507);
+
+    Counts.SetNumUninitialized(Settings.NumSensors);
+    for (uint16& Count : Counts)
+    {
+        Count = static_cast<uint16>(Random.RandRange(0, Settings.MaxCount));
+    }
+    ChangedMask.Init(false, Settings.NumSensors);
+    Changed.Reserve(Settings.ChangesPerPacket);
+
+    // Id e sorgente una volta sola: a ogni pacchetto cambiano solo i conteggi
+    BinaryPacket.Source = Settings.HubId.IsEmpty() ? NAME_None : FName(*Settings.HubId);
+    BinaryPacket.Sensors.SetNum(Settings.NumSensors);
+    for (int32 i = 0; i < Settings.NumSensors; ++i)
+    {
+        BinaryPacket.Sensors[i].Id = PeopleCounter::Binary::SensorNameForIndex(i + 1);
+    }
+}
+
+FPeopleCounterLoadGenerator::~FPeopleCounterLoadGenerator()
+{
+    StopAndWait();
+}
+
+bool FPeopleCounterLoadGenerator::Start()
+{
+    if (Thread) return true;
+
+    ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+    bool bIsValid = false;
+    TargetAddr = SocketSubsystem->CreateInternetAddr();
+    TargetAddr->SetIp(*Settings.TargetHost, bIsValid);
+    if (!bIsValid)
+    {
+        UE_LOG(LogPeopleCounterLoad, Error, TEXT("Invalid load target host: %s"), *Settings.TargetHost);
+        return false;
+    }
+    TargetAddr->SetPort(Settings.TargetPort);
+
+    // Socket bloccante: un buffer di invio pieno rallenta il generatore invece di scartare in silenzio
+    Socket = FUdpSocketBuilder(TEXT("PeopleCounterUDP_Load"))
+        .AsBlocking()
+        .AsReusable()
+        .WithBroadcast()
+        .WithSendBufferSize(4 * 1024 * 1024)
+        .Build();
+    if (!Socket)
+    {
+        UE_LOG(LogPeopleCounterLoad, Error, TEXT("Cannot create the load generator socket"));
+        return false;
+    }
+
+    bStopping = false;
+    bFinished = false;
+    StartSeconds = FPlatformTime::Seconds();
+    EndSeconds = 0.0;
+    Thread = FRunnableThread::Create(this, TEXT("PeopleCounterUDP_Load"), 128 * 1024, TPri_AboveNormal);
+    UE_LOG(LogPeopleCounterLoad, Log, TEXT("Load test -> %s:%d: %d sensors, %.0f msg/s, %s%s"),
+        *Settings.TargetHost, Settings.TargetPort, Settings.NumSensors, Settings.PacketsPerSecond,
+        Settings.bBinary ? TEXT("people_count_v2") : TEXT("people_count_v1"),
+        Settings.DurationSeconds > 0.f ? *FString::Printf(TEXT(", %.1f s"), Settings.DurationSeconds) : TEXT(""));
+    return true;
+}
+
+void FPeopleCounterLoadGenerator::StopAndWait()
+{
+    if (Thread)
+    {
+        bStopping = true;
+        Thread->WaitForCompletion();
+        delete Thread;
+        Thread = nullptr;
+    }
+    if (Socket)
+    {
+        Socket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+        Socket = nullptr;
+    }
+}
+
+double FPeopleCounterLoadGenerator::GetElapsedSeconds() const
+{
+    if (StartSeconds <= 0.0) return 0.0;
+    return (EndSeconds > 0.0 ? EndSeconds : FPlatformTime::Seconds()) - StartSeconds;
+}
+
+float FPeopleCounterLoadGenerator::RateAt(double Seconds) const
+{
+    if (Settings.BurstPeriodSeconds > 0.f && Settings.BurstSeconds > 0.f
+        && FMath::Fmod(Seconds, static_cast<double>(Settings.BurstPeriodSeconds)) < Settings.BurstSeconds)
+    {
+        return Settings.PacketsPerSecond * Settings.BurstRateMultiplier;
+    }
+    return Settings.PacketsPerSecond;
+}
+
+void FPeopleCounterLoadGenerator::StepCounts()
+{
+    for (const int32 Index : Changed)
+    {
+        ChangedMask[Index] = false;
+    }
+    Changed.Reset();
+
+    // Passeggiata casuale di +-1 su sensori distinti
+    while (Changed.Num() < Settings.ChangesPerPacket)
+    {
+        const int32 Index = Random.RandHelper(Settings.NumSensors);
+        if (ChangedMask[Index]) continue;
+        ChangedMask[Index] = true;
+        Changed.Add(Index);
+
+        const int32 Step = Random.RandHelper(2) == 0 ? -1 : 1;
+        int32 Count = static_cast<int32>(Counts[Index]) + Step;
+        if (Count < 0 || Count > Settings.MaxCount)
+        {
+            Count -= 2 * Step;
+        }
+        Counts[Index] = static_cast<uint16>(FMath::Clamp(Count, 0, Settings.MaxCount));
+    }
+}
+
+void FPeopleCounterLoadGenerator::BuildMessage(TArray<uint8>& OutBytes)
+{
+    OutBytes.Reset();
+    if (Sequence > 0)
+    {
+        StepCounts();
+    }
+    const bool bDelta = Sequence > 0 && Settings.DeltaFraction > 0.f && Random.FRand() < Settings.DeltaFraction;
+    if (Settings.bBinary)
+    {
+        EncodeBinary(bDelta, OutBytes);
+    }
+    else
+    {
+        EncodeJson(bDelta, OutBytes);
+    }
+    ++Sequence;
+    ++GeneratedMessages;
+}
+
+void FPeopleCounterLoadGenerator::EncodeJson(bool bDelta, TArray<uint8>& OutBytes)
+{
+    // Stessa forma di UdpEndpoints.send_counts dell'hub, senza spazi
+    TAnsiStringBuilder<4096> Json;
+    Json.Appendf("{\"schema\":\"people_count_v1\",\"type\":\"%s\",\"timestamp\":%.6f,\"seq\":%lld",
+        bDelta ? "delta_counts" : "snapshot_counts", UnixNowSeconds(), Sequence);
+    if (!Settings.HubId.IsEmpty())
+    {
+        Json << ",\"hub_id\":\"" << TCHAR_TO_UTF8(*Settings.HubId) << "\"";
+    }
+    Json << ",\"sensors\":[";
+
+    auto AppendSensor = [this, &Json](int32 Index, bool bFirst)
+    {
+        Json.Appendf("%s{\"id\":\"SENSORE%03d\",\"count\":%d}", bFirst ? "" : ",", Index + 1, static_cast<int32>(Counts[Index]));
+    };
+    if (bDelta)
+    {
+        for (int32 i = 0; i < Changed.Num(); ++i)
+        {
+            AppendSensor(Changed[i], i == 0);
+        }
+    }
+    else
+    {
+        for (int32 i = 0; i < Counts.Num(); ++i)
+        {
+            AppendSensor(i, i == 0);
+        }
+    }
+    Json << "]}";
+    OutBytes.Append(reinterpret_cast<const uint8*>(Json.GetData()), Json.Len());
+}
+
+void FPeopleCounterLoadGenerator::EncodeBinary(bool bDelta, TArray<uint8>& OutBytes)
+{
+    BinaryPacket.Type = bDelta ? PeopleCounter::TypeDeltaCounts : PeopleCounter::TypeSnapshotCounts;
+    BinaryPacket.Timestamp = UnixNowSeconds();
+    BinaryPacket.Sequence = Sequence;
+    if (bDelta)
+    {
+        // Il pacchetto delta e' temporaneo: quello completo resta pronto per i prossimi snapshot
+        FPeopleCountPacket Delta;
+        Delta.Type = BinaryPacket.Type;
+        Delta.Timestamp = BinaryPacket.Timestamp;
+        Delta.Sequence = BinaryPacket.Sequence;
+        Delta.Source = BinaryPacket.Source;
+        Delta.Sensors.SetNum(Changed.Num());
+        for (int32 i = 0; i < Changed.Num(); ++i)
+        {
+            Delta.Sensors[i].Id = BinaryPacket.Sensors[Changed[i]].Id;
+            Delta.Sensors[i].Count = Counts[Changed[i]];
+        }
+        PeopleCounter::Binary::EncodePacket(Delta, OutBytes);
+        return;
+    }
+    for (int32 i = 0; i < Counts.Num(); ++i)
+    {
+        BinaryPacket.Sensors[i].Count = Counts[i];
+    }
+    PeopleCounter::Binary::EncodePacket(BinaryPacket, OutBytes);
+}
+
+void FPeopleCounterLoadGenerator::SendDatagram(const uint8* Data, int32 Num)
+{
+    int32 BytesSent = 0;
+    if (Socket->SendTo(Data, Num, BytesSent, *TargetAddr) && BytesSent == Num)
+    {
+        ++SentDatagrams;
+        SentBytes += Num;
+    }
+    else
+    {
+        ++SendFailures;
+    }
+}
+
+void FPeopleCounterLoadGenerator::SendMessage(const TArray<uint8>& Message)
+{
+    if (Message.Num() <= Settings.MaxDatagramBytes)
+    {
+        SendDatagram(Message.GetData(), Message.Num());
+        return;
+    }
+
+    // Come split_fragments dell'hub: chunk in ordine, message id che cresce a ogni messaggio
+    const int32 ChunkSize = Settings.MaxDatagramBytes - PeopleCounter::Fragment::HeaderSize;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(Message.Num(), ChunkSize);
+    if (ChunkCount > MAX_uint16)
+    {
+        ++SendFailures;
+        return;
+    }
+    const uint32 Id = MessageId++;
+    const uint32 Total = static_cast<uint32>(Message.Num());
+    const uint16 Count = static_cast<uint16>(ChunkCount);
+    for (int32 Index = 0; Index < ChunkCount; ++Index)
+    {
+        const uint32 Offset = static_cast<uint32>(Index * ChunkSize);
+        const int32 Size = FMath::Min(ChunkSize, Message.Num() - static_cast<int32>(Offset));
+        const uint16 ChunkIndex = static_cast<uint16>(Index);
+        Chunk.SetNumUninitialized(PeopleCounter::Fragment::HeaderSize + Size, EAllowShrinking::No);
+        FMemory::Memcpy(&Chunk[0], PeopleCounter::Fragment::Magic, 4);
+        FMemory::Memcpy(&Chunk[4], &Id, 4);
+        FMemory::Memcpy(&Chunk[8], &ChunkIndex, 2);
+        FMemory::Memcpy(&Chunk[10], &Count, 2);
+        FMemory::Memcpy(&Chunk[12], &Total, 4);
+        FMemory::Memcpy(&Chunk[16], &Offset, 4);
+        FMemory::Memcpy(&Chunk[PeopleCounter::Fragment::HeaderSize], Message.GetData() + Offset, Size);
+        SendDatagram(Chunk.GetData(), Chunk.Num());
+    }
+}
+
+uint32 FPeopleCounterLoadGenerator::Run()
+{
+    TArray<uint8> Message;
+    TArray<uint8> Held;
+    bool bHolding = false;
+
+    const double StopAt = Settings.DurationSeconds > 0.f ? StartSeconds + Settings.DurationSeconds : 0.0;
+    double LastSeconds = StartSeconds;
+    // Il primo messaggio parte subito
+    double Due = 1.0;
+    while (!bStopping)
+    {
+        const double Now = FPlatformTime::Seconds();
+        if (StopAt > 0.0 && Now >= StopAt) break;
+
+        const float Rate = RateAt(Now - StartSeconds);
+        Due = FMath::Min(Due + Rate * (Now - LastSeconds), MaxBacklogMessages);
+        LastSeconds = Now;
+
+        while (Due >= 1.0 && !bStopping)
+        {
+            Due -= 1.0;
+            BuildMessage(Message);
+
+            // Numerato ma mai inviato: un buco di sequenza per il receiver
+            if (Settings.LossProbability > 0.f && Random.FRand() < Settings.LossProbability)
+            {
+                ++DroppedMessages;
+                continue;
+            }
+            // Trattenuto e inviato dopo il successivo
+            if (!bHolding && Settings.ReorderProbability > 0.f && Random.FRand() < Settings.ReorderProbability)
+            {
+                Swap(Held, Message);
+                bHolding = true;
+                ++ReorderedMessages;
+                continue;
+            }
+            SendMessage(Message);
+            if (Settings.DuplicateProbability > 0.f && Random.FRand() < Settings.DuplicateProbability)
+            {
+                SendMessage(Message);
+                ++DuplicatedMessages;
+            }
+            if (bHolding)
+            {
+                SendMessage(Held);
+                bHolding = false;
+            }
+        }
+
+        if (Rate <= 0.f)
+        {
+            FPlatformProcess::SleepNoStats(static_cast<float>(MaxWaitStepSeconds));
+            continue;
+        }
+        // Sotto il millisecondo lo sleep del sistema non e' affidabile: si cede e basta
+        const double Remaining = (1.0 - Due) / Rate;
+        FPlatformProcess::SleepNoStats(Remaining > 2e-3 ? static_cast<float>(FMath::Min(Remaining - 1e-3, MaxWaitStepSeconds)) : 0.f);
+    }
+    if (bHolding)
+    {
+        SendMessage(Held);
+    }
+
+    EndSeconds = FPlatformTime::Seconds();
+    bFinished = true;
+    UE_LOG(LogPeopleCounterLoad, Log, TEXT("Load test finished: %s"), *ToString());
+    return 0;
+}
+
+FString FPeopleCounterLoadGenerator::ToString() const
+{
+    // Ritmo medio del profilo, raffiche comprese
+    double Requested = Settings.PacketsPerSecond;
+    if (Settings.BurstPeriodSeconds > 0.f && Settings.BurstSeconds > 0.f)
+    {
+        const double BurstShare = FMath::Min(1.0, static_cast<double>(Settings.BurstSeconds) / Settings.BurstPeriodSeconds);
+        Requested *= 1.0 + (Settings.BurstRateMultiplier - 1.0) * BurstShare;
+    }
+    const double Elapsed = GetElapsedSeconds();
+    const int64 Generated = GeneratedMessages.Load();
+    return FString::Printf(
+        TEXT("%.1fs: %lld messages (%.1f/s of %.1f/s requested), %lld datagrams, %lld bytes, send failures %lld | injected: lost %lld, reordered %lld, duplicated %lld"),
+        Elapsed, Generated, Elapsed > 0.0 ? Generated / Elapsed : 0.0, Requested, SentDatagrams.Load(), SentBytes.Load(), SendFailures.Load(),
+        DroppedMessages.Load(), ReorderedMessages.Load(), DuplicatedMessages.Load());
+}
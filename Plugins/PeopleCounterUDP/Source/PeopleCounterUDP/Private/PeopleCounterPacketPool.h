@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LockFreeList.h"
+
+// Pool a capacita' fissa: tutti gli oggetti vengono creati in costruzione e riusati,
+// insieme ai loro buffer interni. Acquire/Release da qualunque thread, senza lock.
+// T::TrimForPool() al rilascio libera i buffer cresciuti oltre il normale.
+template <typename T>
+class TPeopleCounterObjectPool
+{
+public:
+    explicit TPeopleCounterObjectPool(int32 Capacity)
+    {
+        Storage.Reserve(Capacity);
+        for (int32 i = 0; i < Capacity; ++i)
+        {
+            T* Item = Storage.Emplace_GetRef(MakeUnique<T>()).Get();
+            FreeList.Push(Item);
+        }
+        NumFree = Capacity;
+    }
+
+    ~TPeopleCounterObjectPool()
+    {
+        // Gli oggetti appartengono a Storage: la lista contiene solo puntatori
+        while (FreeList.Pop()) {}
+    }
+
+    // nullptr se il pool e' esaurito
+    T* Acquire()
+    {
+        T* Item = FreeList.Pop();
+        if (Item)
+        {
+            --NumFree;
+        }
+        return Item;
+    }
+
+    void Release(T* Item)
+    {
+        check(Item);
+        Item->TrimForPool();
+        FreeList.Push(Item);
+        ++NumFree;
+    }
+
+    int32 GetCapacity() const { return Storage.Num(); }
+    int32 GetNumFree() const { return NumFree.Load(EMemoryOrder::Relaxed); }
+
+private:
+    TArray<TUniquePtr<T>> Storage;
+    TLockFreePointerListUnordered<T, PLATFORM_CACHE_LINE_SIZE> FreeList;
+    TAtomic<int32> NumFree { 0 };
+};
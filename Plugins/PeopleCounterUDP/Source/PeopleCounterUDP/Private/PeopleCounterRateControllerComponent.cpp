@@ -0,0 +1,285 @@
+#include "PeopleCounterRateControllerComponent.h"
+#include "UDPJsonReceiverComponent.h"
+#include "UDPJsonSenderComponent.h"
+#include "GameFramework/Actor.h"
+#include "CoreGlobals.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterRate, Log, All);
+
+UPeopleCounterRateControllerComponent::UPeopleCounterRateControllerComponent()
+{
+    PrimaryComponentTick.bCanEverTick = true;
+}
+
+void UPeopleCounterRateControllerComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    if (!Receiver && GetOwner())
+    {
+        Receiver = GetOwner()->FindComponentByClass<UUDPJsonReceiverComponent>();
+    }
+    if (!Sender && GetOwner())
+    {
+        Sender = GetOwner()->FindComponentByClass<UUDPJsonSenderComponent>();
+    }
+    if (!Receiver || !Sender)
+    {
+        UE_LOG(LogPeopleCounterRate, Warning, TEXT("%s: needs a UDPJsonReceiverComponent and a UDPJsonSenderComponent"), *GetName());
+        SetComponentTickEnabled(false);
+        return;
+    }
+
+    // Nessun invio qui: l'ordine dei BeginPlay col Sender (set_interval 0 della cattura programmata)
+    // non e' garantito, si decide alla prima finestra
+    bHasBaseline = false;
+    bActive = false;
+    LastIntervalQuerySeconds = -1.0;
+    SetComponentTickInterval(ControlPeriodSeconds);
+}
+
+void UPeopleCounterRateControllerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    ReleaseControl();
+    Super::EndPlay(EndPlayReason);
+}
+
+bool UPeopleCounterRateControllerComponent::TryActivate()
+{
+    if (Sender->IsScheduledCaptureRunning())
+    {
+        bControlsSchedule = true;
+        OriginalIntervalSeconds = Sender->ScheduledCaptureIntervalSeconds;
+    }
+    else if (Sender->GetHubIntervalSeconds() > 0.f)
+    {
+        bControlsSchedule = false;
+        OriginalIntervalSeconds = Sender->GetHubIntervalSeconds();
+    }
+    else
+    {
+        // Timer dell'hub non ancora noto: si chiede, e di nuovo ogni ResendSeconds (hub avviato dopo)
+        const double NowSeconds = FPlatformTime::Seconds();
+        if (Sender->GetHubIntervalSeconds() < 0.f
+            && (LastIntervalQuerySeconds < 0.0 || (ResendSeconds > 0.f && NowSeconds - LastIntervalQuerySeconds >= ResendSeconds)))
+        {
+            LastIntervalQuerySeconds = NowSeconds;
+            Sender->RequestHubInterval();
+        }
+        return false;
+    }
+
+    bActive = true;
+    bHasBaseline = false;
+    UE_LOG(LogPeopleCounterRate, Log, TEXT("%s: controlling the %s, original interval %.3f s"),
+        *GetName(), bControlsSchedule ? TEXT("scheduled capture") : TEXT("hub timer"), OriginalIntervalSeconds);
+    ApplyInterval(InitialIntervalSeconds, EPeopleCounterRateReason::Idle);
+    return true;
+}
+
+void UPeopleCounterRateControllerComponent::ReleaseControl()
+{
+    if (!bActive || !Sender) return;
+    bActive = false;
+    Decision = FPeopleCounterRateDecision();
+    if (bControlsSchedule)
+    {
+        // Schedule gia' fermo: non c'e' nulla da rimettere
+        if (Sender->IsScheduledCaptureRunning())
+        {
+            Sender->SetScheduledCaptureInterval(OriginalIntervalSeconds);
+        }
+    }
+    else if (!Sender->IsScheduledCaptureRunning())
+    {
+        // Con uno schedule partito nel frattempo il timer dell'hub e' del Sender
+        Sender->SendJsonString(FString::Printf(TEXT("{\"cmd\":\"set_interval\",\"seconds\":%.3f}"), OriginalIntervalSeconds));
+    }
+}
+
+void UPeopleCounterRateControllerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+    if (!Receiver || !Sender) return;
+
+    // Schedule avviato o fermato dopo l'attivazione: si restituisce e si riparte dal nuovo stato
+    if (bActive && bControlsSchedule != Sender->IsScheduledCaptureRunning())
+    {
+        ReleaseControl();
+    }
+    if (!bActive && !TryActivate()) return;
+
+    if (bEnabled)
+    {
+        Evaluate();
+    }
+    if (ResendSeconds > 0.f && FPlatformTime::Seconds() - LastSentSeconds >= ResendSeconds)
+    {
+        SendInterval();
+    }
+}
+
+void UPeopleCounterRateControllerComponent::SetCaptureInterval(float IntervalSeconds)
+{
+    ApplyInterval(IntervalSeconds, EPeopleCounterRateReason::Manual);
+}
+
+void UPeopleCounterRateControllerComponent::TakeBaseline(const FPeopleCounterReceiverStats& Stats, FBaseline& Out) const
+{
+    Out.Seconds = FPlatformTime::Seconds();
+    Out.Frame = GFrameCounter;
+    Out.PacketsReceived = Stats.PacketsReceived;
+    Out.Drops = Stats.QueueOverflows + Stats.PacketsLost;
+    Out.LatencySamples = Stats.LatencySamples;
+    Out.LatencyBuckets = Stats.LatencyBucketCounts;
+    Out.RequestsAnswered = Stats.RequestsAnswered;
+    Out.RoundTripTotalMs = static_cast<double>(Stats.RoundTripMeanMs) * Stats.RequestsAnswered;
+    Out.DispatchTotalMs = Stats.DispatchTotalMs;
+    Out.SourceCounts.Reset();
+    for (const FPeopleCounterSourceInfo& Source : Receiver->GetSources())
+    {
+        Out.SourceCounts.Add(Source.Source, Source.CountsReceived);
+    }
+}
+
+void UPeopleCounterRateControllerComponent::Evaluate()
+{
+    const FPeopleCounterReceiverStats Stats = Receiver->GetReceiverStats();
+    FBaseline Current;
+    TakeBaseline(Stats, Current);
+
+    // Statistiche azzerate (PeopleCounter.Stats reset, riavvio del canale): si riparte da qui
+    if (!bHasBaseline || Current.PacketsReceived < Baseline.PacketsReceived || Current.LatencySamples < Baseline.LatencySamples
+        || Current.DispatchTotalMs < Baseline.DispatchTotalMs || Current.LatencyBuckets.Num() != Baseline.LatencyBuckets.Num())
+    {
+        Baseline = MoveTemp(Current);
+        bHasBaseline = true;
+        return;
+    }
+
+    FPeopleCounterRateDecision Window;
+    Window.IntervalSeconds = Decision.IntervalSeconds;
+    Window.WindowSeconds = static_cast<float>(Current.Seconds - Baseline.Seconds);
+    if (Window.WindowSeconds <= 0.f) return;
+
+    // Arrivi per hub (snapshot/delta completi): piu' hub sullo stesso Receiver ricevono lo stesso set_interval
+    int64 WindowPackets = 0;
+    for (const TPair<FName, int64>& Pair : Current.SourceCounts)
+    {
+        const int64* Previous = Baseline.SourceCounts.Find(Pair.Key);
+        const int64 Delta = Pair.Value - (Previous ? *Previous : 0);
+        if (Delta > 0)
+        {
+            WindowPackets += Delta;
+            ++Window.ActiveSources;
+        }
+    }
+    Window.ArrivalsPerSecond = Window.ActiveSources > 0 ? WindowPackets / Window.WindowSeconds / Window.ActiveSources : 0.f;
+    Window.Drops = Current.Drops - Baseline.Drops;
+    Window.QueueDepth = Stats.QueueDepth;
+
+    // p95 della finestra dalle differenze dei bucket cumulativi
+    const int64 LatencySamples = Current.LatencySamples - Baseline.LatencySamples;
+    if (LatencySamples > 0)
+    {
+        const int64 Target = FMath::Max<int64>(1, FMath::CeilToInt64(0.95 * LatencySamples));
+        int64 Cumulative = 0;
+        Window.LatencyMs = Stats.LatencyMaxMs;
+        for (int32 Bucket = 0; Bucket < Stats.LatencyBucketUpperMs.Num(); ++Bucket)
+        {
+            Cumulative += Current.LatencyBuckets[Bucket] - Baseline.LatencyBuckets[Bucket];
+            if (Cumulative >= Target)
+            {
+                Window.LatencyMs = Stats.LatencyBucketUpperMs[Bucket];
+                break;
+            }
+        }
+    }
+    const int64 Requests = Current.RequestsAnswered - Baseline.RequestsAnswered;
+    if (Requests > 0)
+    {
+        Window.RoundTripMs = static_cast<float>((Current.RoundTripTotalMs - Baseline.RoundTripTotalMs) / Requests);
+    }
+    const uint64 Frames = Current.Frame - Baseline.Frame;
+    Window.DispatchMsPerFrame = Frames > 0 ? static_cast<float>((Current.DispatchTotalMs - Baseline.DispatchTotalMs) / Frames) : 0.f;
+    Baseline = MoveTemp(Current);
+
+    const float Interval = Decision.IntervalSeconds;
+    const float ObservedLatencyMs = FMath::Max(Window.LatencyMs, Window.RoundTripMs);
+    const bool bHubSaturated = Window.ArrivalsPerSecond > 0.f && Window.ArrivalsPerSecond < HubSaturationRatio / Interval;
+
+    // Prima i segnali di sovraccarico, in ordine di gravita'
+    float NewInterval = Interval;
+    EPeopleCounterRateReason Reason = EPeopleCounterRateReason::Hold;
+    if (WindowPackets == 0)
+    {
+        Reason = EPeopleCounterRateReason::NoData;
+    }
+    else if (Window.Drops > 0)
+    {
+        NewInterval = Interval * BackoffFactor;
+        Reason = EPeopleCounterRateReason::Drops;
+    }
+    else if (Window.QueueDepth > MaxQueueDepth)
+    {
+        NewInterval = Interval * BackoffFactor;
+        Reason = EPeopleCounterRateReason::QueueDepth;
+    }
+    else if (Window.DispatchMsPerFrame > DispatchBudgetMs)
+    {
+        NewInterval = Interval * BackoffFactor;
+        Reason = EPeopleCounterRateReason::DispatchBudget;
+    }
+    else if (bHubSaturated)
+    {
+        // Almeno l'intervallo che l'hub riesce davvero a tenere
+        NewInterval = FMath::Max(Interval * BackoffFactor, 1.f / Window.ArrivalsPerSecond);
+        Reason = EPeopleCounterRateReason::HubSaturated;
+    }
+    else if (ObservedLatencyMs > TargetLatencyMs * (1.f + Hysteresis))
+    {
+        NewInterval = Interval * BackoffFactor;
+        Reason = EPeopleCounterRateReason::Latency;
+    }
+    else if (ObservedLatencyMs < TargetLatencyMs * (1.f - Hysteresis) && Window.DispatchMsPerFrame < DispatchBudgetMs * (1.f - Hysteresis)
+        && Window.QueueDepth <= MaxQueueDepth / 2)
+    {
+        NewInterval = Interval * SpeedupFactor;
+        Reason = EPeopleCounterRateReason::Headroom;
+    }
+
+    Decision = Window;
+    Decision.Reason = Reason;
+    ApplyInterval(NewInterval, Reason);
+}
+
+void UPeopleCounterRateControllerComponent::ApplyInterval(float IntervalSeconds, EPeopleCounterRateReason Reason)
+{
+    const float Clamped = FMath::Clamp(IntervalSeconds, MinIntervalSeconds, FMath::Max(MinIntervalSeconds, MaxIntervalSeconds));
+    const bool bChanged = !FMath::IsNearlyEqual(Clamped, Decision.IntervalSeconds, Decision.IntervalSeconds * 0.01f);
+    Decision.Reason = Reason;
+    if (!bChanged && Reason != EPeopleCounterRateReason::Idle && Reason != EPeopleCounterRateReason::Manual) return;
+
+    Decision.IntervalSeconds = Clamped;
+    SendInterval();
+    if (bChanged)
+    {
+        UE_LOG(LogPeopleCounterRate, Log, TEXT("%s: capture interval %.3f s (%s; latency %.1f ms, dispatch %.3f ms/frame, queue %d, drops %lld, %.2f pkt/s per hub)"),
+            *GetName(), Clamped, *StaticEnum<EPeopleCounterRateReason>()->GetNameStringByValue(static_cast<int64>(Reason)),
+            FMath::Max(Decision.LatencyMs, Decision.RoundTripMs), Decision.DispatchMsPerFrame, Decision.QueueDepth, Decision.Drops, Decision.ArrivalsPerSecond);
+        OnCaptureIntervalChanged.Broadcast(Clamped, Reason);
+    }
+}
+
+bool UPeopleCounterRateControllerComponent::SendInterval()
+{
+    if (!Sender) return false;
+    LastSentSeconds = FPlatformTime::Seconds();
+    // Con la cattura programmata il ritmo lo decide il thread del sender, il timer dell'hub e' spento
+    if (Sender->IsScheduledCaptureRunning())
+    {
+        Sender->SetScheduledCaptureInterval(Decision.IntervalSeconds);
+        return true;
+    }
+    return Sender->SendJsonString(FString::Printf(TEXT("{\"cmd\":\"set_interval\",\"seconds\":%.3f}"), Decision.IntervalSeconds));
+}
@@ -0,0 +1,128 @@
+#include "PeopleCounterReceiveWorker.h"
+
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "SocketTypes.h"
+#include "IPAddress.h"
+#include "HAL/RunnableThread.h"
+#include "PeopleCounterUDPStats.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterUDP_Worker, Log, All);
+
+namespace
+{
+    // Payload UDP massimo su IPv4
+    constexpr int32 MaxDatagramSize = 65507;
+    // Datagram per chiamata RecvMulti
+    constexpr int32 RecvMultiBatchSize = 16;
+}
+
+FPeopleCounterReceiveWorker::FPeopleCounterReceiveWorker(FSocket* InSocket, const FTimespan& InWaitTime, const TCHAR* InThreadName)
+    : Socket(InSocket)
+    , WaitTime(InWaitTime)
+    , ThreadName(InThreadName)
+{
+    ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+    SenderAddr = SocketSubsystem->CreateInternetAddr();
+    if (SocketSubsystem->IsSocketRecvMultiSupported())
+    {
+        RecvMulti = SocketSubsystem->CreateRecvMulti(RecvMultiBatchSize, MaxDatagramSize);
+    }
+    if (!RecvMulti)
+    {
+        ReadBuffer.SetNumUninitialized(MaxDatagramSize);
+    }
+}
+
+FPeopleCounterReceiveWorker::~FPeopleCounterReceiveWorker()
+{
+    StopAndWait();
+}
+
+void FPeopleCounterReceiveWorker::Start()
+{
+    if (Thread) return;
+    bStopping = false;
+    Thread = FRunnableThread::Create(this, *ThreadName, 128 * 1024, TPri_AboveNormal);
+    UE_LOG(LogPeopleCounterUDP_Worker, Log, TEXT("%s started (%s)"), *ThreadName, RecvMulti ? TEXT("RecvMulti") : TEXT("RecvFrom"));
+}
+
+void FPeopleCounterReceiveWorker::StopAndWait()
+{
+    if (!Thread) return;
+    bStopping = true;
+    Thread->WaitForCompletion();
+    delete Thread;
+    Thread = nullptr;
+}
+
+uint32 FPeopleCounterReceiveWorker::Run()
+{
+    while (!bStopping)
+    {
+        // Bloccante finche' il socket e' leggibile: nessun risveglio quando l'hub tace
+        if (!Socket->Wait(ESocketWaitConditions::WaitForRead, WaitTime))
+        {
+            continue;
+        }
+
+        if (RecvMulti)
+        {
+            DrainMulti();
+        }
+        else
+        {
+            DrainSingle();
+        }
+    }
+    return 0;
+}
+
+void FPeopleCounterReceiveWorker::DrainSingle()
+{
+    uint32 PendingSize = 0;
+    while (!bStopping && Socket->HasPendingData(PendingSize))
+    {
+        int32 BytesRead = 0;
+        {
+            PEOPLECOUNTER_SCOPE(SocketRecv);
+            if (!Socket->RecvFrom(ReadBuffer.GetData(), ReadBuffer.Num(), BytesRead, *SenderAddr))
+            {
+                break;
+            }
+        }
+        DatagramDelegate.ExecuteIfBound(ReadBuffer.GetData(), BytesRead, FIPv4Endpoint(SenderAddr));
+    }
+}
+
+void FPeopleCounterReceiveWorker::DrainMulti()
+{
+    while (!bStopping)
+    {
+        {
+            PEOPLECOUNTER_SCOPE(SocketRecv);
+            if (!Socket->RecvMulti(*RecvMulti))
+            {
+                // Coda del socket vuota (o errore): si torna ad aspettare
+                return;
+            }
+        }
+
+        const int32 NumPackets = RecvMulti->GetNumPackets();
+        for (int32 PacketIdx = 0; PacketIdx < NumPackets; ++PacketIdx)
+        {
+            uint8* PacketData = nullptr;
+            int32 PacketSize = 0;
+            RecvMulti->GetPacket(PacketIdx, PacketData, PacketSize);
+            RecvMulti->GetPacketAddress(PacketIdx, *SenderAddr);
+
+            DatagramDelegate.ExecuteIfBound(PacketData, PacketSize, FIPv4Endpoint(SenderAddr));
+        }
+
+        // Batch non pieno: non c'e' altro in coda
+        if (NumPackets < RecvMultiBatchSize)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+
+class FSocket;
+class FRunnableThread;
+class FRecvMulti;
+class FInternetAddr;
+
+// Datagram valido solo durante la callback (buffer interno del worker, riusato)
+DECLARE_DELEGATE_ThreeParams(FOnPeopleCounterDatagram, const uint8* /*Data*/, int32 /*Num*/, const FIPv4Endpoint& /*Sender*/);
+
+// Thread RX dedicato: si blocca sul socket finche' arriva qualcosa (niente polling a 2 ms),
+// poi svuota tutti i datagram in coda. Dove la piattaforma lo supporta legge a blocchi (recvmmsg).
+class FPeopleCounterReceiveWorker : public FRunnable
+{
+public:
+    // WaitTime limita solo il ritardo con cui Stop viene notato
+    FPeopleCounterReceiveWorker(FSocket* InSocket, const FTimespan& InWaitTime, const TCHAR* InThreadName);
+    virtual ~FPeopleCounterReceiveWorker() override;
+
+    FOnPeopleCounterDatagram& OnDatagram() { return DatagramDelegate; }
+
+    void Start();
+    // Attende l'uscita del thread: dopo il ritorno la callback non viene piu' chiamata
+    void StopAndWait();
+
+    // FRunnable
+    virtual uint32 Run() override;
+    virtual void Stop() override { bStopping = true; }
+
+private:
+    FSocket* Socket;
+    FTimespan WaitTime;
+    FString ThreadName;
+    FRunnableThread* Thread = nullptr;
+    TAtomic<bool> bStopping { false };
+    FOnPeopleCounterDatagram DatagramDelegate;
+
+    // Buffer di RecvFrom, allocato una volta e riusato
+    TArray<uint8> ReadBuffer;
+    // Letture a blocchi; nullptr dove RecvMulti non e' supportato
+    TUniquePtr<FRecvMulti> RecvMulti;
+    TSharedPtr<FInternetAddr> SenderAddr;
+
+    void DrainSingle();
+    void DrainMulti();
+};
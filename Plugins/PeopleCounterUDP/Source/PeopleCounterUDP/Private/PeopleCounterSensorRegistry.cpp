@@ -0,0 +1,111 @@
+#include "PeopleCounterSensorRegistry.h"
+#include "PeopleCounterBinaryProtocol.h"
+#include "Misc/ScopeRWLock.h"
+
+int32 FPeopleCounterSensorRegistry::AddSlotLocked(FName Id)
+{
+    if (const int32* Existing = SlotById.Find(Id))
+    {
+        return *Existing;
+    }
+    const int32 Slot = Ids.Add(Id);
+    Serials.AddDefaulted();
+    SlotById.Add(Id, Slot);
+    return Slot;
+}
+
+int32 FPeopleCounterSensorRegistry::FindOrAddSlot(FName Id)
+{
+    if (Id.IsNone()) return INDEX_NONE;
+    {
+        FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+        if (const int32* Existing = SlotById.Find(Id))
+        {
+            return *Existing;
+        }
+    }
+    FRWScopeLock WriteLock(Lock, SLT_Write);
+    return AddSlotLocked(Id);
+}
+
+int32 FPeopleCounterSensorRegistry::FindSlot(FName Id) const
+{
+    FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+    const int32* Existing = SlotById.Find(Id);
+    return Existing ? *Existing : INDEX_NONE;
+}
+
+void FPeopleCounterSensorRegistry::ResolveSlots(TArrayView<FPeopleCountSensor> Sensors)
+{
+    bool bMissing = false;
+    {
+        FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+        for (FPeopleCountSensor& Sensor : Sensors)
+        {
+            const int32* Existing = SlotById.Find(Sensor.Id);
+            Sensor.Slot = Existing ? *Existing : INDEX_NONE;
+            bMissing |= Sensor.Slot == INDEX_NONE && !Sensor.Id.IsNone();
+        }
+    }
+    if (bMissing)
+    {
+        // Solo la prima volta che un sensore compare
+        FRWScopeLock WriteLock(Lock, SLT_Write);
+        for (FPeopleCountSensor& Sensor : Sensors)
+        {
+            if (Sensor.Slot == INDEX_NONE && !Sensor.Id.IsNone())
+            {
+                Sensor.Slot = AddSlotLocked(Sensor.Id);
+            }
+        }
+    }
+}
+
+FName FPeopleCounterSensorRegistry::GetSensorId(int32 Slot) const
+{
+    FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+    return Ids.IsValidIndex(Slot) ? Ids[Slot] : NAME_None;
+}
+
+FString FPeopleCounterSensorRegistry::GetSerial(int32 Slot) const
+{
+    FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+    return Serials.IsValidIndex(Slot) ? Serials[Slot] : FString();
+}
+
+int32 FPeopleCounterSensorRegistry::Num() const
+{
+    FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+    return Ids.Num();
+}
+
+void FPeopleCounterSensorRegistry::GetSensorIds(TArray<FName>& OutIds) const
+{
+    FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+    OutIds = Ids;
+}
+
+void FPeopleCounterSensorRegistry::SeedFromSerials(TConstArrayView<FString> InSerials, FStringView IdPrefix)
+{
+    // Stesso ordine di _tick_capture_and_send: sorted(serials), indici da 1
+    TArray<FString> Sorted(InSerials.GetData(), InSerials.Num());
+    Sorted.Sort();
+
+    FRWScopeLock WriteLock(Lock, SLT_Write);
+    for (int32 i = 0; i < Sorted.Num(); ++i)
+    {
+        const FName SensorId = PeopleCounter::Binary::SensorNameForIndex(i + 1);
+        const int32 Slot = AddSlotLocked(IdPrefix.IsEmpty() ? SensorId : FName(FString(IdPrefix) + SensorId.ToString()));
+        Serials[Slot] = Sorted[i];
+    }
+}
+
+void FPeopleCounterSensorRegistry::SetCount(int32 Slot, int32 Count)
+{
+    if (Slot < 0) return;
+    if (Slot >= Counts.Num())
+    {
+        Counts.SetNumZeroed(Slot + 1);
+    }
+    Counts[Slot] = Count;
+}
@@ -0,0 +1,120 @@
+#include "PeopleCounterSessionRecorder.h"
+#include "PeopleCounterSessionLog.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterRecorder, Log, All);
+
+namespace
+{
+    // Un buffer per scrittura; oltre questo arretrato su disco i datagram vengono scartati
+    constexpr int32 InitialBufferBytes = 256 * 1024;
+    constexpr int64 MaxQueuedBytes = 64 * 1024 * 1024;
+    constexpr float FlushIntervalSeconds = 0.25f;
+}
+
+FString PeopleCounter::SessionLog::ResolvePath(const FString& Path)
+{
+    if (!FPaths::IsRelative(Path)) return Path;
+    return FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("PeopleCounter") / Path);
+}
+
+FPeopleCounterSessionRecorder::~FPeopleCounterSessionRecorder()
+{
+    Stop();
+}
+
+bool FPeopleCounterSessionRecorder::Start(const FString& InPath)
+{
+    Stop();
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(InPath));
+    File.Reset(PlatformFile.OpenWrite(*InPath));
+    if (!File)
+    {
+        UE_LOG(LogPeopleCounterRecorder, Error, TEXT("Cannot open %s for recording"), *InPath);
+        return false;
+    }
+
+    TArray<uint8> Header;
+    PeopleCounter::SessionLog::WriteFileHeader(Header, (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalSeconds());
+    File->Write(Header.GetData(), Header.Num());
+
+    Path = InPath;
+    StartSeconds = FPlatformTime::Seconds();
+    RecordedPackets = 0;
+    DroppedPackets = 0;
+    QueuedBytes = 0;
+    {
+        FScopeLock Lock(&PendingLock);
+        Pending.Reset(InitialBufferBytes);
+        bRecording = true;
+    }
+    TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FPeopleCounterSessionRecorder::Tick), FlushIntervalSeconds);
+    UE_LOG(LogPeopleCounterRecorder, Log, TEXT("Recording received datagrams to %s"), *Path);
+    return true;
+}
+
+void FPeopleCounterSessionRecorder::Stop()
+{
+    if (!File) return;
+    {
+        FScopeLock Lock(&PendingLock);
+        bRecording = false;
+    }
+    FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+    TickerHandle.Reset();
+
+    Flush();
+    WritePipe.WaitUntilEmpty();
+    File->Flush();
+    File.Reset();
+    UE_LOG(LogPeopleCounterRecorder, Log, TEXT("Recorded %lld datagrams to %s (%lld dropped)"), RecordedPackets.Load(), *Path, DroppedPackets.Load());
+}
+
+void FPeopleCounterSessionRecorder::Append(const uint8* Data, int32 Num, const FIPv4Endpoint& Sender, double ArrivalSeconds)
+{
+    FScopeLock Lock(&PendingLock);
+    if (!bRecording) return;
+    // Disco piu' lento della rete: meglio un buco nella registrazione che memoria senza limite
+    if (QueuedBytes.Load(EMemoryOrder::Relaxed) + Pending.Num() > MaxQueuedBytes)
+    {
+        ++DroppedPackets;
+        return;
+    }
+    PeopleCounter::SessionLog::AppendRecord(Pending, ArrivalSeconds - StartSeconds, Sender, Data, Num);
+    ++RecordedPackets;
+}
+
+bool FPeopleCounterSessionRecorder::Tick(float DeltaTime)
+{
+    Flush();
+    return true;
+}
+
+void FPeopleCounterSessionRecorder::Flush()
+{
+    TArray<uint8> Buffer;
+    {
+        FScopeLock Lock(&PendingLock);
+        if (Pending.Num() == 0) return;
+        Buffer = MoveTemp(Pending);
+        if (SpareBuffers.Num() > 0)
+        {
+            Pending = SpareBuffers.Pop(EAllowShrinking::No);
+        }
+        Pending.Reset(InitialBufferBytes);
+        QueuedBytes += Buffer.Num();
+    }
+
+    // In ordine sulla pipe: i record restano nell'ordine di arrivo
+    WritePipe.Launch(UE_SOURCE_LOCATION, [this, Buffer = MoveTemp(Buffer)]() mutable
+    {
+        File->Write(Buffer.GetData(), Buffer.Num());
+        QueuedBytes -= Buffer.Num();
+        Buffer.Reset();
+        FScopeLock Lock(&PendingLock);
+        SpareBuffers.Add(MoveTemp(Buffer));
+    });
+}
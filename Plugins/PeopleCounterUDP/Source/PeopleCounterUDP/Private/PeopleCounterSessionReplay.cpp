@@ -0,0 +1,228 @@
+#include "PeopleCounterSessionReplay.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterReplay, Log, All);
+
+namespace
+{
+    // Passo massimo di attesa: Stop viene notato entro questo tempo
+    constexpr double MaxWaitStepSeconds = 0.05;
+}
+
+FPeopleCounterSessionReplay::FPeopleCounterSessionReplay() = default;
+
+FPeopleCounterSessionReplay::~FPeopleCounterSessionReplay()
+{
+    StopAndWait();
+}
+
+bool FPeopleCounterSessionReplay::Open(const FString& InPath)
+{
+    check(!Thread);
+    MappedRegion.Reset();
+    MappedFile.Reset();
+    OwnedBytes.Reset();
+    Bytes = nullptr;
+    NumBytes = 0;
+    RecordCount = 0;
+    DurationSeconds = 0.0;
+    Path = InPath;
+
+    IPlatformFile::FOpenMappedResult Mapped = FPlatformFileManager::Get().GetPlatformFile().OpenMappedEx(*Path);
+    if (Mapped.HasValue())
+    {
+        MappedFile = Mapped.StealValue();
+        MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+    }
+    if (MappedRegion)
+    {
+        Bytes = MappedRegion->GetMappedPtr();
+        NumBytes = MappedRegion->GetMappedSize();
+    }
+    else
+    {
+        // Piattaforme (o file system) senza mapping: una lettura sola
+        MappedFile.Reset();
+        if (!FFileHelper::LoadFileToArray(OwnedBytes, *Path))
+        {
+            UE_LOG(LogPeopleCounterReplay, Error, TEXT("Cannot open %s for replay"), *Path);
+            return false;
+        }
+        Bytes = OwnedBytes.GetData();
+        NumBytes = OwnedBytes.Num();
+    }
+
+    double StartUnixSeconds = 0.0;
+    if (!PeopleCounter::SessionLog::ParseFileHeader(Bytes, NumBytes, StartUnixSeconds))
+    {
+        if (PeopleCounter::SessionLog::IsSessionLog(Bytes, NumBytes))
+        {
+            UE_LOG(LogPeopleCounterReplay, Error, TEXT("%s: unsupported recording version"), *Path);
+            return false;
+        }
+        // Non e' una registrazione: events.ndjson dell'hub
+        if (!ImportHubEvents(Bytes, NumBytes))
+        {
+            UE_LOG(LogPeopleCounterReplay, Error, TEXT("%s is neither a PCRL recording nor a hub events.ndjson"), *Path);
+            return false;
+        }
+        MappedRegion.Reset();
+        MappedFile.Reset();
+        Bytes = OwnedBytes.GetData();
+        NumBytes = OwnedBytes.Num();
+    }
+
+    ForEachRecord([this](const PeopleCounter::SessionLog::FRecord& Record)
+    {
+        ++RecordCount;
+        DurationSeconds = FMath::Max(DurationSeconds, Record.ArrivalSeconds);
+    });
+    UE_LOG(LogPeopleCounterReplay, Log, TEXT("%s: %d datagrams over %.1f s (%s)"), *Path, RecordCount, DurationSeconds,
+        MappedRegion ? TEXT("mapped") : TEXT("in memory"));
+    return true;
+}
+
+bool FPeopleCounterSessionReplay::ImportHubEvents(const uint8* Data, int64 Num)
+{
+    // Una riga {"t": secondi Unix, "sensors": [{"id", "count"}, ...], "session_total": n} per tick
+    TArray<uint8> Converted;
+    PeopleCounter::SessionLog::WriteFileHeader(Converted, 0.0);
+    const FIPv4Endpoint Sender(FIPv4Address(127, 0, 0, 1), 0);
+    double FirstSeconds = -1.0;
+    int32 NumLines = 0;
+
+    FString Line;
+    FString Json;
+    int64 LineStart = 0;
+    while (LineStart < Num)
+    {
+        int64 LineEnd = LineStart;
+        while (LineEnd < Num && Data[LineEnd] != '\n')
+        {
+            ++LineEnd;
+        }
+        const int64 LineLength = LineEnd - LineStart;
+        const int64 NextLine = LineEnd + 1;
+        if (LineLength <= 1)
+        {
+            LineStart = NextLine;
+            continue;
+        }
+
+        const auto Text = StringCast<TCHAR>(reinterpret_cast<const UTF8CHAR*>(Data + LineStart), static_cast<int32>(LineLength));
+        Line = FString(Text.Length(), Text.Get());
+        LineStart = NextLine;
+
+        TSharedPtr<FJsonObject> Event;
+        double EventSeconds = 0.0;
+        if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Line), Event) || !Event.IsValid()
+            || !Event->TryGetNumberField(TEXT("t"), EventSeconds) || !Event->HasTypedField<EJson::Array>(TEXT("sensors")))
+        {
+            // Prima riga non valida: non e' un log dell'hub
+            if (NumLines == 0) return false;
+            continue;
+        }
+        ++NumLines;
+        if (FirstSeconds < 0.0)
+        {
+            FirstSeconds = EventSeconds;
+            FMemory::Memcpy(&Converted[8], &EventSeconds, sizeof(double));
+        }
+
+        TSharedRef<FJsonObject> Packet = MakeShared<FJsonObject>();
+        Packet->SetStringField(TEXT("schema"), TEXT("people_count_v1"));
+        Packet->SetStringField(TEXT("type"), TEXT("snapshot_counts"));
+        Packet->SetNumberField(TEXT("timestamp"), EventSeconds);
+        Packet->SetField(TEXT("sensors"), Event->TryGetField(TEXT("sensors")));
+        Json.Reset();
+        FJsonSerializer::Serialize(Packet, TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json));
+
+        const FTCHARToUTF8 Utf8(*Json, Json.Len());
+        PeopleCounter::SessionLog::AppendRecord(Converted, FMath::Max(0.0, EventSeconds - FirstSeconds), Sender,
+            reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+    }
+    if (NumLines == 0) return false;
+    OwnedBytes = MoveTemp(Converted);
+    return true;
+}
+
+void FPeopleCounterSessionReplay::ForEachRecord(TFunctionRef<void(const PeopleCounter::SessionLog::FRecord&)> Visitor) const
+{
+    int64 Offset = PeopleCounter::SessionLog::FileHeaderSize;
+    PeopleCounter::SessionLog::FRecord Record;
+    while (PeopleCounter::SessionLog::ReadRecord(Bytes, NumBytes, Offset, Record))
+    {
+        Visitor(Record);
+    }
+}
+
+void FPeopleCounterSessionReplay::Start(float InSpeed, bool bInLoop)
+{
+    if (Thread || !Bytes) return;
+    Speed = InSpeed;
+    bLoop = bInLoop;
+    bStopping = false;
+    bFinished = false;
+    SentPackets = 0;
+    Thread = FRunnableThread::Create(this, TEXT("PeopleCounterUDP_Replay"), 128 * 1024, TPri_AboveNormal);
+}
+
+void FPeopleCounterSessionReplay::StopAndWait()
+{
+    if (!Thread) return;
+    bStopping = true;
+    Thread->WaitForCompletion();
+    delete Thread;
+    Thread = nullptr;
+}
+
+bool FPeopleCounterSessionReplay::WaitUntil(double TargetSeconds) const
+{
+    for (;;)
+    {
+        if (bStopping) return false;
+        const double Remaining = TargetSeconds - FPlatformTime::Seconds();
+        if (Remaining <= 0.0) return true;
+        // Sotto il millisecondo lo sleep del sistema non e' affidabile: si cede e basta
+        FPlatformProcess::SleepNoStats(Remaining > 2e-3 ? static_cast<float>(FMath::Min(Remaining - 1e-3, MaxWaitStepSeconds)) : 0.f);
+    }
+}
+
+uint32 FPeopleCounterSessionReplay::Run()
+{
+    const bool bRealTime = Speed > 0.f;
+    do
+    {
+        const double StartSeconds = FPlatformTime::Seconds();
+        int64 Offset = PeopleCounter::SessionLog::FileHeaderSize;
+        PeopleCounter::SessionLog::FRecord Record;
+        while (!bStopping && PeopleCounter::SessionLog::ReadRecord(Bytes, NumBytes, Offset, Record))
+        {
+            if (bRealTime)
+            {
+                if (!WaitUntil(StartSeconds + Record.ArrivalSeconds / Speed)) break;
+            }
+            else
+            {
+                // Piu' veloce della pipeline: si aspetta che si svuoti invece di perdere pacchetti
+                while (!bStopping && CanSendDelegate.IsBound() && !CanSendDelegate.Execute())
+                {
+                    FPlatformProcess::SleepNoStats(0.f);
+                }
+            }
+            DatagramDelegate.ExecuteIfBound(Record.Data, Record.Num, Record.Sender);
+            ++SentPackets;
+        }
+    }
+    while (bLoop && !bStopping && RecordCount > 0);
+
+    bFinished = true;
+    return 0;
+}
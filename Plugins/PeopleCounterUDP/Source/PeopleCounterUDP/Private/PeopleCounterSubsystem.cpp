@@ -0,0 +1,375 @@
+#include "PeopleCounterSubsystem.h"
+
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Parse.h"
+#include "PeopleCounterSessionLog.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterUDP_Subsystem, Log, All);
+
+static TAutoConsoleVariable<bool> CVarPeopleCounterKeepIdleChannels(
+    TEXT("PeopleCounter.KeepIdleChannels"),
+    true,
+    TEXT("Keep UDP channels open when their last receiver goes away (socket and sensor state survive PIE sessions)."));
+
+// PeopleCounter.Stats [reset]: statistiche di tutti i canali aperti
+static FAutoConsoleCommand GPeopleCounterStatsCommand(
+    TEXT("PeopleCounter.Stats"),
+    TEXT("Logs PeopleCounter UDP channel stats (loss, reordering, jitter, latency). 'reset' clears them."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        UPeopleCounterSubsystem* Subsystem = UPeopleCounterSubsystem::Get();
+        if (!Subsystem) return;
+
+        const bool bReset = Args.Num() > 0 && Args[0].Equals(TEXT("reset"), ESearchCase::IgnoreCase);
+        TArray<TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe>> OpenChannels;
+        Subsystem->GetChannels(OpenChannels);
+        for (const TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe>& Channel : OpenChannels)
+        {
+            if (!Channel->IsRunning()) continue;
+            UE_LOG(LogPeopleCounterUDP_Subsystem, Display, TEXT("%s %s"), *Channel->GetSettings().GetKey(), *Channel->GetStats().ToString());
+            if (bReset)
+            {
+                Channel->ResetStats();
+            }
+        }
+    }));
+
+namespace
+{
+    // Primo canale avviato che riceve in locale (i comandi di registrazione/replay ne usano uno)
+    TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> FindLocalChannel()
+    {
+        UPeopleCounterSubsystem* Subsystem = UPeopleCounterSubsystem::Get();
+        if (!Subsystem) return nullptr;
+        TArray<TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe>> OpenChannels;
+        Subsystem->GetChannels(OpenChannels);
+        for (const TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe>& Channel : OpenChannels)
+        {
+            if (Channel->IsRunning() && !Channel->IsClusterSecondary())
+            {
+                return Channel;
+            }
+        }
+        UE_LOG(LogPeopleCounterUDP_Subsystem, Warning, TEXT("No running PeopleCounter channel"));
+        return nullptr;
+    }
+}
+
+// PeopleCounter.Record <file> | stop: registra i datagram del primo canale avviato
+static FAutoConsoleCommand GPeopleCounterRecordCommand(
+    TEXT("PeopleCounter.Record"),
+    TEXT("Records every datagram received by the first running channel to a .pcrl file (relative to Saved/PeopleCounter). 'stop' closes it."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel = FindLocalChannel();
+        if (!Channel) return;
+        if (Args.Num() == 0 || Args[0].Equals(TEXT("stop"), ESearchCase::IgnoreCase))
+        {
+            Channel->StopRecording();
+            return;
+        }
+        Channel->StartRecording(PeopleCounter::SessionLog::ResolvePath(Args[0]));
+    }));
+
+// PeopleCounter.Replay <file> [speed] [loop] | stop: speed 0 = il piu' in fretta possibile
+static FAutoConsoleCommand GPeopleCounterReplayCommand(
+    TEXT("PeopleCounter.Replay"),
+    TEXT("Replays a .pcrl recording or a hub events.ndjson into the first running channel. Args: <file> [speed, 0 = as fast as possible] [loop] | stop."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel = FindLocalChannel();
+        if (!Channel) return;
+        if (Args.Num() == 0 || Args[0].Equals(TEXT("stop"), ESearchCase::IgnoreCase))
+        {
+            Channel->StopReplay();
+            return;
+        }
+        const float Speed = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 1.f;
+        const bool bLoop = Args.Num() > 2 && Args[2].Equals(TEXT("loop"), ESearchCase::IgnoreCase);
+        Channel->StartReplay(PeopleCounter::SessionLog::ResolvePath(Args[0]), Speed, bLoop);
+    }));
+
+// PeopleCounter.LoadTest [Sensors= Rate= Seconds= ...] | stop: carico sintetico verso un canale
+static FAutoConsoleCommand GPeopleCounterLoadTestCommand(
+    TEXT("PeopleCounter.LoadTest"),
+    TEXT("Sends synthetic people_count traffic and logs throughput, drops and latency of the receiving channel. ")
+    TEXT("Args: Sensors= Rate= Seconds= (0 = until stop) Binary= Delta= Changes= MaxCount= BurstPeriod= BurstSeconds= BurstRate= ")
+    TEXT("Loss= Reorder= Duplicate= MaxDatagram= Host= Port= (default: first running channel) HubId= Seed= | stop."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        UPeopleCounterSubsystem* Subsystem = UPeopleCounterSubsystem::Get();
+        if (!Subsystem) return;
+        if (Args.Num() > 0 && Args[0].Equals(TEXT("stop"), ESearchCase::IgnoreCase))
+        {
+            Subsystem->StopLoadTest();
+            return;
+        }
+
+        const FString Line = FString::Join(Args, TEXT(" "));
+        const TCHAR* Cmd = *Line;
+        FPeopleCounterLoadSettings Settings;
+        if (!FParse::Value(Cmd, TEXT("Port="), Settings.TargetPort))
+        {
+            if (const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel = FindLocalChannel())
+            {
+                Settings.TargetPort = Channel->GetSettings().ListenPort;
+            }
+        }
+        FParse::Value(Cmd, TEXT("Host="), Settings.TargetHost);
+        FParse::Value(Cmd, TEXT("HubId="), Settings.HubId);
+        FParse::Value(Cmd, TEXT("Sensors="), Settings.NumSensors);
+        FParse::Value(Cmd, TEXT("Rate="), Settings.PacketsPerSecond);
+        FParse::Value(Cmd, TEXT("Seconds="), Settings.DurationSeconds);
+        FParse::Bool(Cmd, TEXT("Binary="), Settings.bBinary);
+        FParse::Value(Cmd, TEXT("Delta="), Settings.DeltaFraction);
+        FParse::Value(Cmd, TEXT("Changes="), Settings.ChangesPerPacket);
+        FParse::Value(Cmd, TEXT("MaxCount="), Settings.MaxCount);
+        FParse::Value(Cmd, TEXT("BurstPeriod="), Settings.BurstPeriodSeconds);
+        FParse::Value(Cmd, TEXT("BurstSeconds="), Settings.BurstSeconds);
+        FParse::Value(Cmd, TEXT("BurstRate="), Settings.BurstRateMultiplier);
+        FParse::Value(Cmd, TEXT("Loss="), Settings.LossProbability);
+        FParse::Value(Cmd, TEXT("Reorder="), Settings.ReorderProbability);
+        FParse::Value(Cmd, TEXT("Duplicate="), Settings.DuplicateProbability);
+        FParse::Value(Cmd, TEXT("MaxDatagram="), Settings.MaxDatagramBytes);
+        FParse::Value(Cmd, TEXT("Seed="), Settings.Seed);
+        Subsystem->StartLoadTest(Settings);
+    }));
+
+// PeopleCounter.Bench [Sensors=3,20,200,2000 Seconds= ...]: risultati in JSON sotto Saved/PeopleCounter/Benchmarks
+static FAutoConsoleCommand GPeopleCounterBenchCommand(
+    TEXT("PeopleCounter.Bench"),
+    TEXT("Benchmarks parsing, sending, area aggregation and loopback dispatch latency; writes ns/op and allocs/op as JSON. ")
+    TEXT("Args: Sensors=3,20,200,2000 Seconds= (per case) Port= LoopbackSensors= LoopbackRate= LoopbackSeconds= (0 = skip) Session= Out= Quit=1."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        UPeopleCounterSubsystem* Subsystem = UPeopleCounterSubsystem::Get();
+        if (!Subsystem) return;
+
+        const FString Line = FString::Join(Args, TEXT(" "));
+        const TCHAR* Cmd = *Line;
+        FPeopleCounterBenchmarkSettings Settings;
+        FString SensorList;
+        if (FParse::Value(Cmd, TEXT("Sensors="), SensorList, false))
+        {
+            TArray<FString> Parts;
+            SensorList.ParseIntoArray(Parts, TEXT(","));
+            Settings.SensorCounts.Reset();
+            for (const FString& Part : Parts)
+            {
+                const int32 NumSensors = FCString::Atoi(*Part);
+                if (NumSensors > 0)
+                {
+                    Settings.SensorCounts.Add(NumSensors);
+                }
+            }
+        }
+        FParse::Value(Cmd, TEXT("Seconds="), Settings.MinSecondsPerCase);
+        FParse::Value(Cmd, TEXT("Port="), Settings.LoopbackPort);
+        FParse::Value(Cmd, TEXT("LoopbackSensors="), Settings.LoopbackSensors);
+        FParse::Value(Cmd, TEXT("LoopbackRate="), Settings.LoopbackRate);
+        FParse::Value(Cmd, TEXT("LoopbackSeconds="), Settings.LoopbackSeconds);
+        FParse::Value(Cmd, TEXT("Session="), Settings.SessionPath);
+        FParse::Value(Cmd, TEXT("Out="), Settings.OutputPath);
+        FParse::Bool(Cmd, TEXT("Quit="), Settings.bExitWhenDone);
+        Subsystem->StartBenchmark(Settings);
+    }));
+
+UPeopleCounterSubsystem* UPeopleCounterSubsystem::Get()
+{
+    return GEngine ? GEngine->GetEngineSubsystem<UPeopleCounterSubsystem>() : nullptr;
+}
+
+void UPeopleCounterSubsystem::Deinitialize()
+{
+    StopLoadTest();
+    Benchmark.Reset();
+    for (TPair<FString, FChannelEntry>& Pair : Channels)
+    {
+        Pair.Value.Channel->Stop();
+    }
+    Channels.Reset();
+    Super::Deinitialize();
+}
+
+TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe> UPeopleCounterSubsystem::FindOrCreateChannel(const FPeopleCounterChannelSettings& Settings)
+{
+    check(IsInGameThread());
+    FChannelEntry& Entry = Channels.FindOrAdd(Settings.GetKey());
+    if (!Entry.Channel)
+    {
+        Entry.Channel = MakeShared<FPeopleCounterChannel, ESPMode::ThreadSafe>(Settings);
+    }
+    return Entry.Channel.ToSharedRef();
+}
+
+TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> UPeopleCounterSubsystem::AcquireChannel(const FPeopleCounterChannelSettings& Settings)
+{
+    const TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel = FindOrCreateChannel(Settings);
+    FChannelEntry& Entry = Channels.FindChecked(Settings.GetKey());
+
+    const FPeopleCounterChannelSettings& Active = Channel->GetSettings();
+    if (Entry.NumSubscribers > 0
+        && (Active.DispatchMode != Settings.DispatchMode || Active.ReceiveMode != Settings.ReceiveMode || Active.bParse != Settings.bParse
+            || Active.bParallelSources != Settings.bParallelSources || Active.bClusterSync != Settings.bClusterSync
+            || (Settings.bRawJson && !Active.bRawJson)))
+    {
+        UE_LOG(LogPeopleCounterUDP_Subsystem, Warning, TEXT("%s is shared: keeping the settings of its first receiver"), *Settings.GetKey());
+    }
+
+    if (!Channel->IsRunning() && !Channel->Start())
+    {
+        return nullptr;
+    }
+    ++Entry.NumSubscribers;
+    return Channel;
+}
+
+void UPeopleCounterSubsystem::ReleaseChannel(const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe>& Channel)
+{
+    check(IsInGameThread());
+    if (!Channel) return;
+
+    const FString Key = Channel->GetSettings().GetKey();
+    FChannelEntry* Entry = Channels.Find(Key);
+    if (!Entry || Entry->Channel != Channel) return;
+
+    Entry->NumSubscribers = FMath::Max(0, Entry->NumSubscribers - 1);
+    if (Entry->NumSubscribers == 0 && !CVarPeopleCounterKeepIdleChannels.GetValueOnGameThread())
+    {
+        Entry->Channel->Stop();
+        Channels.Remove(Key);
+    }
+}
+
+TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> UPeopleCounterSubsystem::FindChannel(const FString& Key) const
+{
+    const FChannelEntry* Entry = Channels.Find(Key);
+    return Entry ? Entry->Channel : nullptr;
+}
+
+void UPeopleCounterSubsystem::GetChannels(TArray<TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe>>& OutChannels) const
+{
+    OutChannels.Reset(Channels.Num());
+    for (const TPair<FString, FChannelEntry>& Pair : Channels)
+    {
+        OutChannels.Add(Pair.Value.Channel.ToSharedRef());
+    }
+}
+
+int32 UPeopleCounterSubsystem::GetNumOpenChannels() const
+{
+    int32 NumOpen = 0;
+    for (const TPair<FString, FChannelEntry>& Pair : Channels)
+    {
+        NumOpen += Pair.Value.Channel->IsRunning() ? 1 : 0;
+    }
+    return NumOpen;
+}
+
+void UPeopleCounterSubsystem::CloseIdleChannels()
+{
+    for (auto It = Channels.CreateIterator(); It; ++It)
+    {
+        if (It->Value.NumSubscribers == 0)
+        {
+            It->Value.Channel->Stop();
+            It.RemoveCurrent();
+        }
+    }
+}
+
+bool UPeopleCounterSubsystem::StartLoadTest(const FPeopleCounterLoadSettings& Settings)
+{
+    check(IsInGameThread());
+    StopLoadTest();
+
+    // Il canale che ascolta sulla porta di destinazione: le sue statistiche diventano quelle del test
+    LoadChannel.Reset();
+    for (const TPair<FString, FChannelEntry>& Pair : Channels)
+    {
+        const FPeopleCounterChannelSettings& ChannelSettings = Pair.Value.Channel->GetSettings();
+        if (Pair.Value.Channel->IsRunning()
+            && (ChannelSettings.ListenPort == Settings.TargetPort || ChannelSettings.AdditionalPorts.Contains(Settings.TargetPort)))
+        {
+            LoadChannel = Pair.Value.Channel;
+            Pair.Value.Channel->ResetStats();
+            break;
+        }
+    }
+    if (!LoadChannel.IsValid())
+    {
+        UE_LOG(LogPeopleCounterUDP_Subsystem, Warning, TEXT("No running channel on port %d: the load test reports only what it sent"), Settings.TargetPort);
+    }
+
+    LoadGenerator = MakeUnique<FPeopleCounterLoadGenerator>(Settings);
+    if (!LoadGenerator->Start())
+    {
+        LoadGenerator.Reset();
+        return false;
+    }
+    LoadFinishedSeconds = 0.0;
+    LoadTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UPeopleCounterSubsystem::TickLoadTest), 0.25f);
+    return true;
+}
+
+void UPeopleCounterSubsystem::StopLoadTest()
+{
+    if (!LoadGenerator) return;
+    FTSTicker::GetCoreTicker().RemoveTicker(LoadTickerHandle);
+    LoadTickerHandle.Reset();
+    LoadGenerator->StopAndWait();
+    ReportLoadTest();
+    LoadGenerator.Reset();
+    LoadChannel.Reset();
+}
+
+bool UPeopleCounterSubsystem::TickLoadTest(float DeltaTime)
+{
+    if (!LoadGenerator || LoadGenerator->IsRunning()) return true;
+
+    // Un attimo per svuotare code e dispatch prima di leggere le statistiche del receiver
+    const double Now = FPlatformTime::Seconds();
+    if (LoadFinishedSeconds <= 0.0)
+    {
+        LoadFinishedSeconds = Now;
+        return true;
+    }
+    if (Now - LoadFinishedSeconds < 0.5) return true;
+
+    LoadTickerHandle.Reset();
+    LoadGenerator->StopAndWait();
+    ReportLoadTest();
+    LoadGenerator.Reset();
+    LoadChannel.Reset();
+    return false;
+}
+
+void UPeopleCounterSubsystem::ReportLoadTest()
+{
+    UE_LOG(LogPeopleCounterUDP_Subsystem, Display, TEXT("Load test sender %s"), *LoadGenerator->ToString());
+
+    const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel = LoadChannel.Pin();
+    if (!Channel) return;
+    const FPeopleCounterReceiverStats Stats = Channel->GetStats();
+    const int64 Sent = LoadGenerator->GetSentDatagrams();
+    UE_LOG(LogPeopleCounterUDP_Subsystem, Display,
+        TEXT("Load test receiver %s: %lld of %lld datagrams received (%lld missing before the socket), queue overflows %lld, ")
+        TEXT("dispatch latency p50 %.1f p95 %.1f p99 %.1f max %.1f ms"),
+        *Channel->GetSettings().GetKey(), Stats.PacketsReceived, Sent, FMath::Max<int64>(0, Sent - Stats.PacketsReceived),
+        Stats.QueueOverflows, Stats.LatencyP50Ms, Stats.LatencyP95Ms, Stats.LatencyP99Ms, Stats.LatencyMaxMs);
+    UE_LOG(LogPeopleCounterUDP_Subsystem, Display, TEXT("Load test receiver %s"), *Stats.ToString());
+}
+
+bool UPeopleCounterSubsystem::StartBenchmark(const FPeopleCounterBenchmarkSettings& Settings)
+{
+    check(IsInGameThread());
+    if (Benchmark && !Benchmark->IsFinished())
+    {
+        UE_LOG(LogPeopleCounterUDP_Subsystem, Warning, TEXT("A PeopleCounter benchmark is already running"));
+        return false;
+    }
+    Benchmark = MakeUnique<FPeopleCounterBenchmark>(Settings);
+    Benchmark->Start();
+    return true;
+}
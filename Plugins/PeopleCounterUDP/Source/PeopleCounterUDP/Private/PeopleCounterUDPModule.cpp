@@ -1,6 +1,23 @@
 // PeopleCounterUDPModule.cpp
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "PeopleCounterUDPStats.h"
+
+DEFINE_STAT(STAT_PeopleCounterUDP_SocketRecv);
+DEFINE_STAT(STAT_PeopleCounterUDP_Receive);
+DEFINE_STAT(STAT_PeopleCounterUDP_Utf8Convert);
+DEFINE_STAT(STAT_PeopleCounterUDP_Parse);
+DEFINE_STAT(STAT_PeopleCounterUDP_Dispatch);
+DEFINE_STAT(STAT_PeopleCounterUDP_Filter);
+DEFINE_STAT(STAT_PeopleCounterUDP_Send);
+DEFINE_STAT(STAT_PeopleCounterUDP_PacketsReceived);
+DEFINE_STAT(STAT_PeopleCounterUDP_PacketsDispatched);
+DEFINE_STAT(STAT_PeopleCounterUDP_QueueDepth);
+DEFINE_STAT(STAT_PeopleCounterUDP_PacketsPerSecond);
+
+UE_TRACE_CHANNEL_DEFINE(PeopleCounterUDPChannel);
+
+CSV_DEFINE_CATEGORY(PeopleCounterUDP, true);
 
 class FPeopleCounterUDPModule : public IModuleInterface
 {
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Trace/Trace.h"
+
+// Strumentazione della pipeline: "stat PeopleCounterUDP", canale Insights "PeopleCounterUDP"
+// (-trace=cpu,PeopleCounterUDP) e categoria CSV "PeopleCounterUDP" (csvprofile start)
+
+DECLARE_STATS_GROUP(TEXT("PeopleCounterUDP"), STATGROUP_PeopleCounterUDP, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Socket Recv"), STAT_PeopleCounterUDP_SocketRecv, STATGROUP_PeopleCounterUDP, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Receive"), STAT_PeopleCounterUDP_Receive, STATGROUP_PeopleCounterUDP, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UTF-8 Convert"), STAT_PeopleCounterUDP_Utf8Convert, STATGROUP_PeopleCounterUDP, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Parse"), STAT_PeopleCounterUDP_Parse, STATGROUP_PeopleCounterUDP, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Dispatch"), STAT_PeopleCounterUDP_Dispatch, STATGROUP_PeopleCounterUDP, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Count Filter"), STAT_PeopleCounterUDP_Filter, STATGROUP_PeopleCounterUDP, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Send"), STAT_PeopleCounterUDP_Send, STATGROUP_PeopleCounterUDP, );
+
+// Azzerati a ogni frame
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Packets Received"), STAT_PeopleCounterUDP_PacketsReceived, STATGROUP_PeopleCounterUDP, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Packets Dispatched"), STAT_PeopleCounterUDP_PacketsDispatched, STATGROUP_PeopleCounterUDP, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Queue Depth"), STAT_PeopleCounterUDP_QueueDepth, STATGROUP_PeopleCounterUDP, );
+// Aggiornato una volta al secondo dal thread RX
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Packets/s"), STAT_PeopleCounterUDP_PacketsPerSecond, STATGROUP_PeopleCounterUDP, );
+
+UE_TRACE_CHANNEL_EXTERN(PeopleCounterUDPChannel);
+
+CSV_DECLARE_CATEGORY_EXTERN(PeopleCounterUDP);
+
+// Un solo scope per stat, Insights e CSV
+#define PEOPLECOUNTER_SCOPE(Name) \
+    SCOPE_CYCLE_COUNTER(STAT_PeopleCounterUDP_##Name); \
+    TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(PeopleCounterUDP_##Name, PeopleCounterUDPChannel); \
+    CSV_SCOPED_TIMING_STAT(PeopleCounterUDP, Name)
@@ -0,0 +1,91 @@
+#include "Misc/AutomationTest.h"
+#include "PeopleCounterAreaClassifier.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+    constexpr EAutomationTestFlags PeopleCounterTestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter;
+
+    // Omografia nota con cui generare le corrispondenze
+    FVector2D ApplyReference(const FVector2D& P)
+    {
+        const double W = 0.1 * P.X + 0.05 * P.Y + 1.0;
+        return FVector2D((2.0 * P.X + 0.1 * P.Y + 5.0) / W, (0.2 * P.X + 3.0 * P.Y + 7.0) / W);
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterHomographyTest, "PeopleCounter.Areas.Homography", PeopleCounterTestFlags)
+
+bool FPeopleCounterHomographyTest::RunTest(const FString& Parameters)
+{
+    FPeopleCounterHomography Identity;
+    TestTrue(TEXT("Default is the identity"), Identity.Project(FVector2f(0.3f, 0.7f)).Equals(FVector2f(0.3f, 0.7f), 1e-6f));
+
+    // Affine: angoli dell'immagine normalizzata su un rettangolo della pianta
+    const TArray<FVector2D> Corners = { FVector2D(0, 0), FVector2D(1, 0), FVector2D(1, 1), FVector2D(0, 1) };
+    const TArray<FVector2D> Floor = { FVector2D(100, -50), FVector2D(500, -50), FVector2D(500, 250), FVector2D(100, 250) };
+    FPeopleCounterHomography Affine;
+    if (!TestTrue(TEXT("Fit on four corners"), Affine.Fit(Corners, Floor))) return false;
+    TestTrue(TEXT("Affine projection"), Affine.Project(FVector2f(0.5f, 0.25f)).Equals(FVector2f(300.f, 25.f), 1e-2f));
+
+    // Prospettiva vera, con un punto in piu' ai minimi quadrati
+    TArray<FVector2D> From = { FVector2D(0, 0), FVector2D(1, 0), FVector2D(1, 1), FVector2D(0, 1), FVector2D(0.3, 0.6) };
+    TArray<FVector2D> To;
+    for (const FVector2D& P : From)
+    {
+        To.Add(ApplyReference(P));
+    }
+    FPeopleCounterHomography Perspective;
+    if (!TestTrue(TEXT("Fit on five points"), Perspective.Fit(From, To))) return false;
+    const FVector2D Expected = ApplyReference(FVector2D(0.8, 0.2));
+    TestTrue(TEXT("Perspective projection"), Perspective.Project(FVector2f(0.8f, 0.2f)).Equals(FVector2f(Expected), 1e-3f));
+
+    const TArray<FVector2D> Collinear = { FVector2D(0, 0), FVector2D(1, 1), FVector2D(2, 2), FVector2D(3, 3) };
+    FPeopleCounterHomography Degenerate;
+    TestFalse(TEXT("Collinear points"), Degenerate.Fit(Collinear, Floor));
+    TestFalse(TEXT("Fewer than four points"), Degenerate.Fit(MakeArrayView(Corners.GetData(), 3), MakeArrayView(Floor.GetData(), 3)));
+    TestFalse(TEXT("Mismatched counts"), Degenerate.Fit(Corners, MakeArrayView(Floor.GetData(), 3)));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterAreaClassifierTest, "PeopleCounter.Areas.Classifier", PeopleCounterTestFlags)
+
+bool FPeopleCounterAreaClassifierTest::RunTest(const FString& Parameters)
+{
+    // Due quadrati che si sovrappongono e una L concava sopra
+    TArray<TArray<FVector2f>> Polygons;
+    Polygons.Add({ FVector2f(0, 0), FVector2f(100, 0), FVector2f(100, 100), FVector2f(0, 100) });
+    Polygons.Add({ FVector2f(50, 0), FVector2f(150, 0), FVector2f(150, 100), FVector2f(50, 100) });
+    Polygons.Add({ FVector2f(0, 200), FVector2f(100, 200), FVector2f(100, 250), FVector2f(50, 250), FVector2f(50, 300), FVector2f(0, 300) });
+    const TArray<int32> PolygonAreas = { 0, 1, 2 };
+
+    // Griglia grossa e fine: stesso risultato, cambia solo quanti lati ha ogni cella
+    for (const int32 Resolution : { 2, 64 })
+    {
+        FPeopleCounterAreaClassifier Classifier;
+        Classifier.Build(Polygons, PolygonAreas, 3, Resolution);
+        const FString Grid = FString::Printf(TEXT("grid %d: "), Resolution);
+        if (!TestFalse(*(Grid + TEXT("built")), Classifier.IsEmpty())) return false;
+
+        TestEqual(*(Grid + TEXT("first square")), Classifier.ClassifyPoint(FVector2f(25, 50)), 0);
+        TestEqual(*(Grid + TEXT("second square")), Classifier.ClassifyPoint(FVector2f(125, 50)), 1);
+        TestEqual(*(Grid + TEXT("overlap goes to the first polygon")), Classifier.ClassifyPoint(FVector2f(75, 50)), 0);
+        TestEqual(*(Grid + TEXT("gap between the shapes")), Classifier.ClassifyPoint(FVector2f(75, 150)), static_cast<int32>(INDEX_NONE));
+        TestEqual(*(Grid + TEXT("outside the grid")), Classifier.ClassifyPoint(FVector2f(-10, 50)), static_cast<int32>(INDEX_NONE));
+        TestEqual(*(Grid + TEXT("L, lower arm")), Classifier.ClassifyPoint(FVector2f(75, 225)), 2);
+        TestEqual(*(Grid + TEXT("L, upper arm")), Classifier.ClassifyPoint(FVector2f(25, 275)), 2);
+        TestEqual(*(Grid + TEXT("L, notch")), Classifier.ClassifyPoint(FVector2f(75, 275)), static_cast<int32>(INDEX_NONE));
+
+        const TArray<FVector2f> Points = { FVector2f(25, 50), FVector2f(75, 50), FVector2f(125, 50), FVector2f(75, 275), FVector2f(25, 275) };
+        TArray<float> Counts;
+        Counts.SetNumZeroed(3);
+        Classifier.CountPoints(Points, Counts);
+        TestEqual(*(Grid + TEXT("first area count")), Counts[0], 2.f);
+        TestEqual(*(Grid + TEXT("overlapping areas both count")), Counts[1], 2.f);
+        TestEqual(*(Grid + TEXT("L count")), Counts[2], 1.f);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include "Misc/AutomationTest.h"
+#include "PeopleCounterCountFilter.h"
+#include "PeopleCounterHistory.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+    constexpr EAutomationTestFlags PeopleCounterTestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter;
+
+    FPeopleCounterCountFilter MakeFilter(const FPeopleCounterFilterSettings& Profile)
+    {
+        FPeopleCounterCountFilter Filter;
+        Filter.SetProfiles(MakeArrayView(&Profile, 1));
+        return Filter;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterCountFilterMedianTest, "PeopleCounter.Filter.Median", PeopleCounterTestFlags)
+
+bool FPeopleCounterCountFilterMedianTest::RunTest(const FString& Parameters)
+{
+    FPeopleCounterFilterSettings Profile;
+    Profile.bEnabled = true;
+    Profile.MedianWindow = 3;
+    FPeopleCounterCountFilter Filter = MakeFilter(Profile);
+
+    // Un picco di un frame non passa, un cambio che dura si'
+    const float Inputs[] = { 0.f, 0.f, 10.f, 0.f, 0.f, 4.f, 4.f };
+    const float Expected[] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 4.f };
+    TArray<int32> Changed;
+    for (int32 i = 0; i < static_cast<int32>(UE_ARRAY_COUNT(Inputs)); ++i)
+    {
+        Filter.SetInput(0, Inputs[i]);
+        Filter.Step(i * 0.1, Changed);
+        TestEqual(*FString::Printf(TEXT("Output at step %d"), i), Filter.GetOutput(0), Expected[i]);
+    }
+    TestEqual(TEXT("Only the last step changes the output"), Changed.Num(), 1);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterCountFilterDwellTest, "PeopleCounter.Filter.HysteresisDwell", PeopleCounterTestFlags)
+
+bool FPeopleCounterCountFilterDwellTest::RunTest(const FString& Parameters)
+{
+    FPeopleCounterFilterSettings Profile;
+    Profile.bEnabled = true;
+    Profile.HysteresisBand = 1.f;
+    Profile.MinDwellSeconds = 0.5f;
+    FPeopleCounterCountFilter Filter = MakeFilter(Profile);
+
+    TArray<int32> Changed;
+    Filter.SetInput(0, 0.f);
+    Filter.Step(0.0, Changed);
+    Filter.SetInput(0, 0.5f);
+    Filter.Step(0.2, Changed);
+    TestEqual(TEXT("Inside the band"), Filter.GetOutput(0), 0.f);
+
+    Filter.SetInput(0, 2.f);
+    Filter.Step(1.0, Changed);
+    TestEqual(TEXT("Outside the band, dwell not reached"), Filter.GetOutput(0), 0.f);
+    // Campione a tenuta: senza SetInput lo slot continua ad avanzare
+    Filter.Step(1.6, Changed);
+    TestEqual(TEXT("Dwell reached"), Filter.GetOutput(0), 2.f);
+    TestEqual(TEXT("Changed slots"), Changed, TArray<int32>({ 0 }));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterCountFilterSlotsTest, "PeopleCounter.Filter.SourceSlots", PeopleCounterTestFlags)
+
+bool FPeopleCounterCountFilterSlotsTest::RunTest(const FString& Parameters)
+{
+    FPeopleCounterFilterSettings Smooth;
+    Smooth.bEnabled = true;
+    Smooth.MedianWindow = 3;
+    FPeopleCounterFilterSettings Off;
+    const TArray<FPeopleCounterFilterSettings> Profiles = { Smooth, Off };
+    FPeopleCounterCountFilter Filter;
+    Filter.SetProfiles(Profiles);
+    Filter.SetSlotProfile(1, 1);
+    TestTrue(TEXT("Active with one enabled profile"), Filter.IsActive());
+
+    TArray<int32> Changed;
+    Filter.SetInput(0, 1.f);
+    Filter.SetInput(1, 1.f);
+    Filter.Step(0.0, Changed);
+    Filter.SetInput(0, 5.f);
+    Filter.SetInput(1, 5.f);
+
+    // Solo lo slot 1 (profilo spento): lo slot 0 non avanza
+    const int32 Slots[] = { 1, 7 };
+    Changed.Reset();
+    Filter.Step(0.1, Slots, Changed);
+    TestEqual(TEXT("Slot without filter follows the input"), Filter.GetOutput(1), 5.f);
+    TestEqual(TEXT("Slot not stepped keeps its output"), Filter.GetOutput(0), 1.f);
+    TestEqual(TEXT("Out of range slots are ignored"), Changed, TArray<int32>({ 1 }));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterHistoryTest, "PeopleCounter.History.Windows", PeopleCounterTestFlags)
+
+bool FPeopleCounterHistoryTest::RunTest(const FString& Parameters)
+{
+    FPeopleCounterHistory History;
+    History.Init(2, 4);
+    TestEqual(TEXT("Empty history"), History.GetAverage(0, 4), 0.f);
+
+    // Serie 0: 1..6 (il ring ne tiene 4); serie 1: 6..1
+    for (int32 i = 1; i <= 6; ++i)
+    {
+        const float Values[] = { static_cast<float>(i), static_cast<float>(7 - i) };
+        History.Push(Values);
+    }
+    TestEqual(TEXT("Available samples capped at capacity"), History.NumAvailable(), 4);
+    TestEqual(TEXT("Latest"), History.GetLatest(0), 6.f);
+    TestEqual(TEXT("Average of the full ring"), History.GetAverage(0, 4), 4.5f);
+    TestEqual(TEXT("Average of the last two"), History.GetAverage(0, 2), 5.5f);
+    TestEqual(TEXT("Window clamped to capacity"), History.GetAverage(0, 100), 4.5f);
+    TestEqual(TEXT("Min"), History.GetMin(0, 4), 3.f);
+    TestEqual(TEXT("Max"), History.GetMax(1, 4), 4.f);
+    TestEqual(TEXT("Min of the decreasing series"), History.GetMin(1, 2), 1.f);
+    TestEqual(TEXT("Age of the max, increasing series"), History.GetMaxAge(0, 4), 0);
+    TestEqual(TEXT("Age of the max, decreasing series"), History.GetMaxAge(1, 4), 3);
+
+    History.Reset();
+    TestEqual(TEXT("Reset empties the windows"), History.NumAvailable(), 0);
+    return true;
+}
+
+#endif
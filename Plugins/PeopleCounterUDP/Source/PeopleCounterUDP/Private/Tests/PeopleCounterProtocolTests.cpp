@@ -0,0 +1,178 @@
+#include "Misc/AutomationTest.h"
+#include "PeopleCounterBinaryProtocol.h"
+#include "PeopleCounterFastParser.h"
+#include "PeopleCounterFragmentProtocol.h"
+#include "PeopleCounterSensorRegistry.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+    constexpr EAutomationTestFlags PeopleCounterTestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter;
+
+    // Come struct.pack("<4sIHHII", b"PCF1", msg_id, index, count, total, offset) + chunk
+    TArray<uint8> MakeFragment(uint32 MessageId, uint16 Index, uint16 Count, uint32 Total, uint32 Offset, int32 PayloadSize)
+    {
+        TArray<uint8> Out;
+        Out.Append(PeopleCounter::Fragment::Magic, UE_ARRAY_COUNT(PeopleCounter::Fragment::Magic));
+        auto WriteU16 = [&Out](uint16 Value) { Out.Add(Value & 0xFF); Out.Add(Value >> 8); };
+        auto WriteU32 = [&Out](uint32 Value) { for (int32 i = 0; i < 4; ++i) { Out.Add((Value >> (8 * i)) & 0xFF); } };
+        WriteU32(MessageId);
+        WriteU16(Index);
+        WriteU16(Count);
+        WriteU32(Total);
+        WriteU32(Offset);
+        for (int32 i = 0; i < PayloadSize; ++i)
+        {
+            Out.Add(static_cast<uint8>(i));
+        }
+        return Out;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterFragmentHeaderTest, "PeopleCounter.Protocol.FragmentHeader", PeopleCounterTestFlags)
+
+bool FPeopleCounterFragmentHeaderTest::RunTest(const FString& Parameters)
+{
+    using namespace PeopleCounter::Fragment;
+
+    const TArray<uint8> Chunk = MakeFragment(42, 1, 3, 2500, 1000, 1000);
+    FHeader Header;
+    TestTrue(TEXT("Valid chunk parses"), ParseHeader(Chunk.GetData(), Chunk.Num(), Header));
+    TestEqual(TEXT("MessageId"), Header.MessageId, 42u);
+    TestEqual(TEXT("ChunkIndex"), Header.ChunkIndex, 1);
+    TestEqual(TEXT("ChunkCount"), Header.ChunkCount, 3);
+    TestEqual(TEXT("TotalSize"), Header.TotalSize, 2500);
+    TestEqual(TEXT("Offset"), Header.Offset, 1000);
+    TestEqual(TEXT("PayloadSize"), Header.PayloadSize, 1000);
+    TestTrue(TEXT("Payload follows the header"), Header.Payload == Chunk.GetData() + HeaderSize);
+
+    const TArray<uint8> PastEnd = MakeFragment(42, 2, 3, 2500, 2000, 1000);
+    TestFalse(TEXT("Chunk past the message end"), ParseHeader(PastEnd.GetData(), PastEnd.Num(), Header));
+    const TArray<uint8> BadIndex = MakeFragment(42, 3, 3, 2500, 0, 10);
+    TestFalse(TEXT("Index >= count"), ParseHeader(BadIndex.GetData(), BadIndex.Num(), Header));
+    const TArray<uint8> Empty = MakeFragment(42, 0, 1, 10, 0, 0);
+    TestFalse(TEXT("Chunk without payload"), ParseHeader(Empty.GetData(), Empty.Num(), Header));
+    const TArray<uint8> ZeroTotal = MakeFragment(42, 0, 1, 0, 0, 10);
+    TestFalse(TEXT("Zero total size"), ParseHeader(ZeroTotal.GetData(), ZeroTotal.Num(), Header));
+
+    TArray<uint8> Json = MakeFragment(42, 0, 1, 10, 0, 10);
+    Json[0] = '{';
+    TestFalse(TEXT("JSON is not a fragment"), IsFragment(Json.GetData(), Json.Num()));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterBinaryRoundTripTest, "PeopleCounter.Protocol.BinaryRoundTrip", PeopleCounterTestFlags)
+
+bool FPeopleCounterBinaryRoundTripTest::RunTest(const FString& Parameters)
+{
+    using namespace PeopleCounter::Binary;
+
+    TestEqual(TEXT("SensorNameForIndex"), SensorNameForIndex(7), FName(TEXT("SENSORE007")));
+    TestEqual(TEXT("SensorIndexFromName"), SensorIndexFromName(FName(TEXT("SENSORE1234"))), 1234);
+    TestEqual(TEXT("Foreign id"), SensorIndexFromName(FName(TEXT("Sala1.SENSORE001"))), static_cast<int32>(INDEX_NONE));
+
+    FPeopleCountPacket Packet;
+    Packet.Type = PeopleCounter::TypeDeltaCounts;
+    Packet.Timestamp = 1700000000.25;
+    Packet.Sequence = 99;
+    Packet.RequestId = 5;
+    Packet.Source = FName(TEXT("Sala1"));
+    auto AddSensor = [&Packet](const TCHAR* Id, int32 Count)
+    {
+        FPeopleCountSensor& Sensor = Packet.Sensors.AddDefaulted_GetRef();
+        Sensor.Id = FName(Id);
+        Sensor.Count = Count;
+    };
+    AddSensor(TEXT("SENSORE001"), 3);
+    AddSensor(TEXT("Lobby"), 1);
+    AddSensor(TEXT("SENSORE010"), 70000);
+
+    TArray<uint8> Bytes;
+    EncodePacket(Packet, Bytes);
+    TestTrue(TEXT("Encoded bytes look binary"), IsBinaryPacket(Bytes.GetData(), Bytes.Num()));
+    TestEqual(TEXT("Size: header, request id, hub id, two entries"), Bytes.Num(), HeaderSize + RequestIdSize + 1 + 5 + 2 * EntrySize);
+
+    FPeopleCountPacket Decoded;
+    if (!TestTrue(TEXT("Decode"), DecodePacket(Bytes.GetData(), Bytes.Num(), Decoded))) return false;
+    TestEqual(TEXT("Schema"), Decoded.Schema, SchemaV2);
+    TestEqual(TEXT("Type"), Decoded.Type, PeopleCounter::TypeDeltaCounts);
+    TestEqual(TEXT("Timestamp"), Decoded.Timestamp, Packet.Timestamp);
+    TestEqual(TEXT("Sequence"), Decoded.Sequence, Packet.Sequence);
+    TestEqual(TEXT("RequestId"), Decoded.RequestId, Packet.RequestId);
+    TestEqual(TEXT("Source"), Decoded.Source, Packet.Source);
+    if (!TestEqual(TEXT("Sensors without the SENSORE form are skipped"), Decoded.Sensors.Num(), 2)) return false;
+    TestEqual(TEXT("First id"), Decoded.Sensors[0].Id, FName(TEXT("SENSORE001")));
+    TestEqual(TEXT("First count"), Decoded.Sensors[0].Count, 3);
+    TestEqual(TEXT("Count clamped to uint16"), Decoded.Sensors[1].Count, static_cast<int32>(MAX_uint16));
+
+    TestFalse(TEXT("Truncated packet"), DecodePacket(Bytes.GetData(), Bytes.Num() - 1, Decoded));
+    Bytes[4] = Version + 1;
+    TestFalse(TEXT("Unknown version"), DecodePacket(Bytes.GetData(), Bytes.Num(), Decoded));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterFastParserTest, "PeopleCounter.Protocol.FastParser", PeopleCounterTestFlags)
+
+bool FPeopleCounterFastParserTest::RunTest(const FString& Parameters)
+{
+    TPeopleCountSensorView<TCHAR> Sensors[4];
+    FVector2f Points[4];
+    TPeopleCountPacketView<TCHAR> View;
+    View.SensorStorage = Sensors;
+    View.PointStorage = Points;
+
+    const FStringView Snapshot = TEXTVIEW("{\"schema\":\"people_count_v1\",\"type\":\"snapshot_counts\",\"timestamp\":12.5,\"seq\":7,\"hub_id\":\"Sala1\","
+        "\"sensors\":[{\"id\":\"SENSORE001\",\"count\":3},{\"id\":\"SENSORE002\",\"count\":0}]}");
+    if (!TestEqual(TEXT("Snapshot parses"), PeopleCounter::FastParsePacket(Snapshot, View), EPeopleCounterFastParseResult::Ok)) return false;
+    TestTrue(TEXT("Type"), View.Type == TEXTVIEW("snapshot_counts"));
+    TestEqual(TEXT("Timestamp"), View.Timestamp, 12.5);
+    TestEqual(TEXT("Sequence"), View.Sequence, static_cast<int64>(7));
+    TestTrue(TEXT("HubId"), View.HubId == TEXTVIEW("Sala1"));
+    if (!TestEqual(TEXT("Sensors"), View.NumSensors, 2)) return false;
+    TestTrue(TEXT("Id is a view on the buffer"), View.GetSensors()[0].Id == TEXTVIEW("SENSORE001"));
+    TestEqual(TEXT("Count"), View.GetSensors()[0].Count, 3);
+
+    const FStringView Detections = TEXTVIEW("{\"schema\":\"people_count_v1\",\"type\":\"detections\",\"sensors\":[{\"id\":\"SENSORE001\",\"count\":2,\"points\":[0.25,0.5,1e-1,0.75]}]}");
+    if (!TestEqual(TEXT("Detections parse"), PeopleCounter::FastParsePacket(Detections, View), EPeopleCounterFastParseResult::Ok)) return false;
+    TestEqual(TEXT("Points"), View.NumPoints, 2);
+    TestEqual(TEXT("Sensor points"), View.GetSensors()[0].NumPoints, 2);
+    TestTrue(TEXT("Second point"), Points[1].Equals(FVector2f(0.1f, 0.75f), 1e-6f));
+
+    TestEqual(TEXT("Escapes go to the DOM"), PeopleCounter::FastParsePacket(TEXTVIEW("{\"schema\":\"people_count_v1\",\"hub_id\":\"a\\\"b\"}"), View),
+        EPeopleCounterFastParseResult::Unsupported);
+    TestEqual(TEXT("Unknown fields go to the DOM"), PeopleCounter::FastParsePacket(TEXTVIEW("{\"schema\":\"people_count_v1\",\"extra\":1}"), View),
+        EPeopleCounterFastParseResult::Unsupported);
+    TestEqual(TEXT("Other schemas go to the DOM"), PeopleCounter::FastParsePacket(TEXTVIEW("{\"schema\":\"people_count_v9\"}"), View),
+        EPeopleCounterFastParseResult::Unsupported);
+    TestEqual(TEXT("Truncated JSON"), PeopleCounter::FastParsePacket(TEXTVIEW("{\"schema\":\"people_count_v1\",\"seq\":"), View),
+        EPeopleCounterFastParseResult::Malformed);
+    TestEqual(TEXT("Trailing bytes"), PeopleCounter::FastParsePacket(TEXTVIEW("{\"schema\":\"people_count_v1\"} x"), View),
+        EPeopleCounterFastParseResult::Malformed);
+
+    TPeopleCountPacketView<TCHAR> Small;
+    Small.SensorStorage = MakeArrayView(Sensors, 1);
+    TestEqual(TEXT("Full storage goes to the DOM"), PeopleCounter::FastParsePacket(Snapshot, Small), EPeopleCounterFastParseResult::Unsupported);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPeopleCounterRegistrySeedTest, "PeopleCounter.Protocol.RegistrySeed", PeopleCounterTestFlags)
+
+bool FPeopleCounterRegistrySeedTest::RunTest(const FString& Parameters)
+{
+    // Stessa numerazione dell'hub: SENSORE001.. sui seriali ordinati
+    const TArray<FString> Serials = { TEXT("935322071"), TEXT("123456789"), TEXT("555000111") };
+    FPeopleCounterSensorRegistry Registry;
+    Registry.SeedFromSerials(Serials);
+    TestEqual(TEXT("Smallest serial is SENSORE001"), Registry.GetSerial(Registry.FindSlot(FName(TEXT("SENSORE001")))), FString(TEXT("123456789")));
+    TestEqual(TEXT("Largest serial is SENSORE003"), Registry.GetSerial(Registry.FindSlot(FName(TEXT("SENSORE003")))), FString(TEXT("935322071")));
+
+    FPeopleCounterSensorRegistry Merged;
+    Merged.SeedFromSerials(Serials, TEXTVIEW("Sala1."));
+    const int32 Slot = Merged.FindSlot(FName(TEXT("Sala1.SENSORE002")));
+    TestTrue(TEXT("Prefixed id"), Slot != INDEX_NONE);
+    TestEqual(TEXT("Prefixed serial"), Merged.GetSerial(Slot), FString(TEXT("555000111")));
+    return true;
+}
+
+#endif
@@ -1,25 +1,26 @@
 #include "UDPJsonReceiverComponent.h"
 
-#include "Sockets.h"
-#include "SocketSubsystem.h"
-#include "IPAddress.h"
-#include "Common/UdpSocketBuilder.h"
-#include "HAL/RunnableThread.h"
-#include "Misc/ScopeLock.h"
-#include "Common/UdpSocketBuilder.h"
-#include "Interfaces/IPv4/IPv4Endpoint.h"   // << questa riga
-#include "Async/Async.h"            // 🔧 per AsyncTask
+#include "UDPJsonSenderComponent.h"
+#include "PeopleCounterSubsystem.h"
+#include "PeopleCounterSessionLog.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterUDP_RX, Log, All);
 
 UUDPJsonReceiverComponent::UUDPJsonReceiverComponent()
 {
+    // Il canale svuota la sua coda da solo (core ticker): niente tick per componente
     PrimaryComponentTick.bCanEverTick = false;
 }
 
+UUDPJsonReceiverComponent::~UUDPJsonReceiverComponent() = default;
+
 void UUDPJsonReceiverComponent::BeginPlay()
 {
     Super::BeginPlay();
+    if (!CommandSender && GetOwner())
+    {
+        CommandSender = GetOwner()->FindComponentByClass<UUDPJsonSenderComponent>();
+    }
     if (bAutoStart)
     {
         StartReceiver();
@@ -32,94 +33,321 @@ void UUDPJsonReceiverComponent::EndPlay(const EEndPlayReason::Type EndPlayReason
     Super::EndPlay(EndPlayReason);
 }
 
-bool UUDPJsonReceiverComponent::CreateSocket()
+FPeopleCounterChannelSettings UUDPJsonReceiverComponent::MakeChannelSettings() const
+{
+    FPeopleCounterChannelSettings Settings;
+    Settings.ListenAddress = ListenAddress;
+    Settings.ListenPort = ListenPort;
+    Settings.AdditionalPorts = AdditionalListenPorts;
+    Settings.MulticastGroup = MulticastGroup;
+    Settings.MulticastInterface = MulticastInterface;
+    Settings.bMulticastLoopback = bMulticastLoopback;
+    Settings.ReceiveMode = ReceiveMode;
+    Settings.ReceiveWaitMilliseconds = ReceiveWaitMilliseconds;
+    Settings.DispatchMode = DispatchMode;
+    Settings.bParse = bParseOnReceiveThread;
+    Settings.bRawJson = bBroadcastRawJson;
+    Settings.bLogPackets = bLogPackets;
+    Settings.bParallelSources = bProcessSourcesInParallel;
+    // Il bridge ritrova i canali per chiave nel subsystem: i canali privati non si replicano
+    Settings.bClusterSync = bSyncInCluster && bUseSharedChannel;
+    Settings.MaxQueuedPackets = MaxQueuedPackets;
+    Settings.MaxPacketsPerFrame = MaxPacketsPerFrame;
+    Settings.MaxDispatchMicrosecondsPerFrame = MaxDispatchMicrosecondsPerFrame;
+    Settings.PacketPoolSize = PacketPoolSize;
+    Settings.ResyncCooldownSeconds = ResyncCooldownSeconds;
+    Settings.ReassemblyTimeoutSeconds = ReassemblyTimeoutSeconds;
+    Settings.MaxMessageBytes = MaxMessageBytes;
+    Settings.CountFilter = CountFilter;
+    Settings.SensorFilters = SensorFilters;
+    return Settings;
+}
+
+bool UUDPJsonReceiverComponent::StartReceiver()
 {
-    if (ListenSocket) return true;
+    if (bRunning) return true;
 
-    bool bIsValid = false;
-    TSharedRef<FInternetAddr> Addr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
-    Addr->SetIp(*ListenAddress, bIsValid);
-    if (!bIsValid)
+    // Il canale di un avvio precedente puo' riferirsi a una porta cambiata nel frattempo
+    if (Channel && Channel->GetSettings().GetKey() != MakeChannelSettings().GetKey())
     {
-        UE_LOG(LogPeopleCounterUDP_RX, Error, TEXT("Invalid ListenAddress: %s"), *ListenAddress);
-        return false;
+        Channel.Reset();
+    }
+
+    UPeopleCounterSubsystem* Subsystem = bUseSharedChannel ? UPeopleCounterSubsystem::Get() : nullptr;
+    if (Subsystem)
+    {
+        Channel = Subsystem->AcquireChannel(MakeChannelSettings());
+        if (!Channel) return false;
+        bSharedChannel = true;
+    }
+    else
+    {
+        if (!Channel)
+        {
+            Channel = MakeShared<FPeopleCounterChannel, ESPMode::ThreadSafe>(MakeChannelSettings());
+        }
+        if (!Channel->Start()) return false;
+        bSharedChannel = false;
+    }
+
+    Channel->RegisterSensors(PreregisteredSensorIds);
+    PacketHandle = Channel->OnPacket.AddUObject(this, &UUDPJsonReceiverComponent::HandleChannelPacket);
+    JsonHandle = Channel->OnJson.AddUObject(this, &UUDPJsonReceiverComponent::HandleChannelJson);
+    DrainedHandle = Channel->OnDrained.AddUObject(this, &UUDPJsonReceiverComponent::HandleChannelDrained);
+    ResyncHandle = Channel->AddResyncResponder(FPeopleCounterResyncResponder::CreateUObject(this, &UUDPJsonReceiverComponent::HandleChannelResync));
+
+    bRunning = true;
+    OnReceiverStartedNative.Broadcast();
+    return true;
+}
+
+void UUDPJsonReceiverComponent::StopReceiver()
+{
+    if (!bRunning) return;
+    bRunning = false;
+
+    Channel->OnPacket.Remove(PacketHandle);
+    Channel->OnJson.Remove(JsonHandle);
+    Channel->OnDrained.Remove(DrainedHandle);
+    Channel->RemoveResyncResponder(ResyncHandle);
+    DrainedBatch.Reset();
+
+    if (bSharedChannel)
+    {
+        // Il socket resta aperto per gli altri iscritti (o per la prossima sessione PIE)
+        if (UPeopleCounterSubsystem* Subsystem = UPeopleCounterSubsystem::Get())
+        {
+            Subsystem->ReleaseChannel(Channel);
+        }
+    }
+    else
+    {
+        Channel->Stop();
+    }
+}
+
+void UUDPJsonReceiverComponent::HandleChannelPacket(const FPeopleCountPacket& Packet)
+{
+    // Registro gia' aggiornato dal canale
+    OnPeopleCountReceivedNative.Broadcast(Packet);
+    OnPeopleCountReceived.Broadcast(Packet);
+}
+
+void UUDPJsonReceiverComponent::HandleChannelJson(const FString& Json)
+{
+    // Su un canale condiviso il JSON arriva se un altro iscritto lo chiede
+    if (!bBroadcastRawJson && bParseOnReceiveThread)
+    {
+        return;
+    }
+    OnJsonReceived.Broadcast(Json);
+    // Copia solo se qualcuno ascolta il batch: senza listener il dispatch non alloca
+    if (OnJsonBatchReceived.IsBound())
+    {
+        DrainedBatch.Add(Json);
+    }
+}
+
+void UUDPJsonReceiverComponent::HandleChannelDrained()
+{
+    if (DrainedBatch.Num() > 0)
+    {
+        OnJsonBatchReceived.Broadcast(DrainedBatch);
+        DrainedBatch.Reset();
+    }
+}
+
+bool UUDPJsonReceiverComponent::HandleChannelResync(FName Source, const FIPv4Endpoint& Sender)
+{
+    // Solo chi ha un canale comandi verso quell'hub risponde; il canale passa al prossimo iscritto.
+    // Con un solo hub il CommandSender vale anche se punta a un altro indirizzo (NAT, 0.0.0.0).
+    TArray<FPeopleCounterSourceInfo> Sources;
+    Channel->GetSources(Sources);
+    if (CommandSender && CommandSender->IsConnected() && (Sources.Num() <= 1 || CommandSender->TargetsAddress(Sender.Address)))
+    {
+        return RequestResync();
     }
-    Addr->SetPort(ListenPort);
 
-    ListenSocket = FUdpSocketBuilder(TEXT("PeopleCounterUDP_RX"))
-        .AsNonBlocking()
-        .AsReusable()
-        .BoundToEndpoint(FIPv4Endpoint(Addr))
-        .WithReceiveBufferSize(2 * 1024 * 1024);
+    // Piu' hub: un sender per hub sullo stesso Actor
+    TArray<UUDPJsonSenderComponent*> Senders;
+    if (AActor* Owner = GetOwner())
+    {
+        Owner->GetComponents(Senders);
+    }
+    for (UUDPJsonSenderComponent* Candidate : Senders)
+    {
+        if (Candidate != CommandSender && Candidate->TargetsAddress(Sender.Address))
+        {
+            if (Candidate->SendJsonString(TEXT("{\"cmd\":\"resync\"}")))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
 
-    if (!ListenSocket)
+bool UUDPJsonReceiverComponent::RequestResync()
+{
+    if (!CommandSender || !CommandSender->IsConnected())
     {
-        UE_LOG(LogPeopleCounterUDP_RX, Error, TEXT("Failed to create UDP listen socket."));
+        UE_LOG(LogPeopleCounterUDP_RX, Warning, TEXT("RequestResync: no connected CommandSender"));
         return false;
     }
-    return true;
+    return CommandSender->SendJsonString(TEXT("{\"cmd\":\"resync\"}"));
+}
+
+int64 UUDPJsonReceiverComponent::GetQueueOverflowCount() const
+{
+    return Channel ? Channel->GetQueueOverflowCount() : 0;
 }
 
-void UUDPJsonReceiverComponent::DestroySocket()
+int64 UUDPJsonReceiverComponent::GetPacketPoolExhaustedCount() const
 {
-    if (SocketReceiver)
+    return Channel ? Channel->GetPacketPoolExhaustedCount() : 0;
+}
+
+int64 UUDPJsonReceiverComponent::GetSupersededPacketCount() const
+{
+    return Channel ? Channel->GetSupersededPacketCount() : 0;
+}
+
+int64 UUDPJsonReceiverComponent::GetSequenceGapCount() const
+{
+    return Channel ? Channel->GetSequenceGapCount() : 0;
+}
+
+int64 UUDPJsonReceiverComponent::GetDiscardedDeltaCount() const
+{
+    return Channel ? Channel->GetDiscardedDeltaCount() : 0;
+}
+
+FPeopleCounterReceiverStats UUDPJsonReceiverComponent::GetReceiverStats() const
+{
+    return Channel ? Channel->GetStats() : FPeopleCounterReceiverStats();
+}
+
+bool UUDPJsonReceiverComponent::StartRecording(const FString& FilePath)
+{
+    if (!Channel || !bRunning) return false;
+    return Channel->StartRecording(PeopleCounter::SessionLog::ResolvePath(FilePath));
+}
+
+void UUDPJsonReceiverComponent::StopRecording()
+{
+    if (Channel)
     {
-        SocketReceiver->Stop();
-        delete SocketReceiver;
-        SocketReceiver = nullptr;
+        Channel->StopRecording();
     }
-    if (ListenSocket)
+}
+
+bool UUDPJsonReceiverComponent::IsRecording() const
+{
+    return Channel && Channel->IsRecording();
+}
+
+bool UUDPJsonReceiverComponent::StartReplay(const FString& FilePath, float Speed, bool bLoop)
+{
+    if (!Channel || !bRunning) return false;
+    return Channel->StartReplay(PeopleCounter::SessionLog::ResolvePath(FilePath), Speed, bLoop);
+}
+
+void UUDPJsonReceiverComponent::StopReplay()
+{
+    if (Channel)
     {
-        ListenSocket->Close();
-        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ListenSocket);
-        ListenSocket = nullptr;
+        Channel->StopReplay();
     }
 }
 
-bool UUDPJsonReceiverComponent::StartReceiver()
+bool UUDPJsonReceiverComponent::IsReplaying() const
 {
-    if (bRunning) return true;
-    if (!CreateSocket()) return false;
+    return Channel && Channel->IsReplaying();
+}
 
-    SocketReceiver = new FUdpSocketReceiver(ListenSocket, FTimespan::FromMilliseconds(2), TEXT("PeopleCounterUDP_RX"));
-    SocketReceiver->OnDataReceived().BindUObject(this, &UUDPJsonReceiverComponent::HandlePacket);
-    SocketReceiver->Start();
+void UUDPJsonReceiverComponent::ResetReceiverStats()
+{
+    if (Channel)
+    {
+        Channel->ResetStats();
+    }
+}
 
-    bRunning = true;
-    UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("UDP Receiver started on %s:%d"), *ListenAddress, ListenPort);
-    return true;
+void UUDPJsonReceiverComponent::RecordRequestRoundTrip(double RoundTripMs)
+{
+    if (Channel)
+    {
+        Channel->RecordRequestRoundTrip(RoundTripMs);
+    }
 }
 
-void UUDPJsonReceiverComponent::StopReceiver()
+void UUDPJsonReceiverComponent::RecordRequestTimeout()
 {
-    if (!bRunning) return;
-    bRunning = false;
-    DestroySocket();
-    UE_LOG(LogPeopleCounterUDP_RX, Log, TEXT("UDP Receiver stopped"));
+    if (Channel)
+    {
+        Channel->RecordRequestTimeout();
+    }
 }
 
-void UUDPJsonReceiverComponent::HandlePacket(const FArrayReaderPtr& Data, const FIPv4Endpoint& Endpoint)
+TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> UUDPJsonReceiverComponent::GetSensorRegistry() const
 {
-    FString JsonStr;
-    JsonStr.Empty();
+    return Channel ? TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>(Channel->GetSensorRegistry()) : nullptr;
+}
 
-    // Copia sicura dei bytes
-    TArray<uint8> Bytes;
-    Bytes.SetNumUninitialized(Data->Num());
-    FMemory::Memcpy(Bytes.GetData(), Data->GetData(), Data->Num());
+TArray<FPeopleCounterSourceInfo> UUDPJsonReceiverComponent::GetSources() const
+{
+    TArray<FPeopleCounterSourceInfo> Sources;
+    if (Channel)
+    {
+        Channel->GetSources(Sources);
+    }
+    return Sources;
+}
 
-    // UTF-8 -> FString
-    FUTF8ToTCHAR Conv(reinterpret_cast<const ANSICHAR*>(Bytes.GetData()), Bytes.Num());
-    JsonStr = FString(Conv.Length(), Conv.Get());
+int32 UUDPJsonReceiverComponent::GetSourceSensorCount(FName Source, FName SensorId) const
+{
+    const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = Channel ? Channel->GetSourceRegistry(Source) : nullptr;
+    return Registry ? Registry->GetCount(Registry->FindSlot(SensorId)) : 0;
+}
 
-    if (bLogPackets)
+TArray<FName> UUDPJsonReceiverComponent::GetSourceSensorIds(FName Source) const
+{
+    TArray<FName> Ids;
+    if (const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = Channel ? Channel->GetSourceRegistry(Source) : nullptr)
     {
-        UE_LOG(LogPeopleCounterUDP_RX, Verbose, TEXT("RX from %s: %s"), *Endpoint.ToString(), *JsonStr);
+        Registry->GetSensorIds(Ids);
     }
+    return Ids;
+}
+
+FPeopleCounterClockInfo UUDPJsonReceiverComponent::GetSourceClock(FName Source) const
+{
+    return Channel ? Channel->GetClockInfo(Source) : FPeopleCounterClockInfo();
+}
 
-    // Dispatch su GameThread
-    AsyncTask(ENamedThreads::GameThread, [this, JsonStr]()
+int32 UUDPJsonReceiverComponent::GetSensorCount(FName SensorId) const
+{
+    const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = GetSensorRegistry();
+    return Registry ? Registry->GetCount(Registry->FindSlot(SensorId)) : 0;
+}
+
+int32 UUDPJsonReceiverComponent::GetSensorRawCount(FName SensorId) const
+{
+    return Channel ? Channel->GetRawCount(Channel->GetSensorRegistry()->FindSlot(SensorId)) : 0;
+}
+
+TArray<FName> UUDPJsonReceiverComponent::GetSensorIds() const
+{
+    TArray<FName> Ids;
+    if (const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = GetSensorRegistry())
     {
-        OnJsonReceived.Broadcast(JsonStr);
-    });
+        Registry->GetSensorIds(Ids);
+    }
+    return Ids;
+}
+
+FString UUDPJsonReceiverComponent::GetSensorSerial(FName SensorId) const
+{
+    const TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> Registry = GetSensorRegistry();
+    return Registry ? Registry->GetSerial(Registry->FindSlot(SensorId)) : FString();
 }
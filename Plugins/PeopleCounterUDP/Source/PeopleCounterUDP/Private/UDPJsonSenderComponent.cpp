@@ -3,9 +3,59 @@
 #include "SocketSubsystem.h"
 #include "IPAddress.h"
 #include "Common/UdpSocketBuilder.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "PeopleCounterUDPStats.h"
+#include "UDPJsonReceiverComponent.h"
+#include "LatentActions.h"
+#include "Engine/World.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterUDP_TX, Log, All);
 
+namespace
+{
+    // Unico per processo: piu' sender possono condividere lo stesso receiver
+    TAtomic<uint32> GNextRequestId { 1 };
+
+    // Ping iniziali ravvicinati: la stima dell'orologio e' buona dopo pochi campioni
+    constexpr int32 ClockSyncBurstPings = 4;
+    constexpr double ClockSyncBurstIntervalSeconds = 0.25;
+
+    // Attende il future di SendRequestAsync e riprende il Blueprint
+    class FPeopleCounterReplyLatentAction : public FPendingLatentAction
+    {
+    public:
+        FPeopleCounterReplyLatentAction(TFuture<FPeopleCounterCommandReply>&& InFuture, EPeopleCounterReplyResult& InResult,
+            FPeopleCounterCommandReply& InReply, const FLatentActionInfo& LatentInfo)
+            : Future(MoveTemp(InFuture))
+            , Result(InResult)
+            , Reply(InReply)
+            , ExecutionFunction(LatentInfo.ExecutionFunction)
+            , OutputLink(LatentInfo.Linkage)
+            , CallbackTarget(LatentInfo.CallbackTarget)
+        {
+        }
+
+        virtual void UpdateOperation(FLatentResponse& Response) override
+        {
+            if (!Future.IsReady())
+            {
+                return;
+            }
+            Reply = Future.Get();
+            Result = Reply.bReceived ? EPeopleCounterReplyResult::Received : EPeopleCounterReplyResult::TimedOut;
+            Response.FinishAndTriggerIf(true, ExecutionFunction, OutputLink, CallbackTarget);
+        }
+
+    private:
+        TFuture<FPeopleCounterCommandReply> Future;
+        EPeopleCounterReplyResult& Result;
+        FPeopleCounterCommandReply& Reply;
+        FName ExecutionFunction;
+        int32 OutputLink;
+        FWeakObjectPtr CallbackTarget;
+    };
+}
+
 UUDPJsonSenderComponent::UUDPJsonSenderComponent()
 {
     PrimaryComponentTick.bCanEverTick = false;
@@ -14,21 +64,61 @@ UUDPJsonSenderComponent::UUDPJsonSenderComponent()
 void UUDPJsonSenderComponent::BeginPlay()
 {
     Super::BeginPlay();
+    if (!ReplyReceiver && GetOwner())
+    {
+        ReplyReceiver = GetOwner()->FindComponentByClass<UUDPJsonReceiverComponent>();
+    }
+    if (ReplyReceiver)
+    {
+        ReplyReceiver->OnPeopleCountReceivedNative.AddUObject(this, &UUDPJsonSenderComponent::HandleReply);
+    }
     if (bAutoConnect)
     {
         Connect();
     }
+    if (ClockSyncIntervalSeconds > 0.f)
+    {
+        NextClockPingSeconds = 0.0;
+        ClockPingsSent = 0;
+        ClockSyncTickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+            FTickerDelegate::CreateUObject(this, &UUDPJsonSenderComponent::TickClockSync));
+    }
+    if (bScheduledCapture)
+    {
+        StartScheduledCapture();
+    }
 }
 
 void UUDPJsonSenderComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+    if (ReplyReceiver)
+    {
+        ReplyReceiver->OnPeopleCountReceivedNative.RemoveAll(this);
+    }
+    if (ClockSyncTickerHandle.IsValid())
+    {
+        FTSTicker::GetCoreTicker().RemoveTicker(ClockSyncTickerHandle);
+        ClockSyncTickerHandle.Reset();
+    }
+    StopScheduledCapture();
+    FailPendingRequests();
     Disconnect();
     Super::EndPlay(EndPlayReason);
 }
 
-bool UUDPJsonSenderComponent::CreateSocket()
+bool UUDPJsonSenderComponent::TargetsAddress(const FIPv4Address& Address) const
 {
-    if (SendSocket) return true;
+    if (!bConnected || !TargetAddr.IsValid()) return false;
+    const FIPv4Address Target = FIPv4Endpoint(TargetAddr).Address;
+    return Target == Address || Target.IsMulticastAddress();
+}
+
+bool UUDPJsonSenderComponent::ResolveTarget()
+{
+    if (TargetAddr.IsValid() && ResolvedPort == TargetPort && ResolvedHost == TargetHost)
+    {
+        return true;
+    }
 
     bool bIsValid = false;
     TSharedRef<FInternetAddr> Addr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
@@ -36,20 +126,81 @@ bool UUDPJsonSenderComponent::CreateSocket()
     if (!bIsValid)
     {
         UE_LOG(LogPeopleCounterUDP_TX, Error, TEXT("Invalid TargetHost: %s"), *TargetHost);
+        TargetAddr.Reset();
         return false;
     }
     Addr->SetPort(TargetPort);
 
-    SendSocket = FUdpSocketBuilder(TEXT("PeopleCounterUDP_TX"))
+    TargetAddr = Addr;
+    ResolvedHost = TargetHost;
+    ResolvedPort = TargetPort;
+
+    // TTL, loopback e interfaccia multicast si fissano alla creazione: passando tra unicast e
+    // multicast il socket va rifatto
+    const bool bMulticast = FIPv4Endpoint(TargetAddr).Address.IsMulticastAddress();
+    if (SendSocket && bMulticast != bSendSocketMulticast)
+    {
+        FSocket* Rebuilt = BuildSocket(TEXT("PeopleCounterUDP_TX"));
+        if (!Rebuilt)
+        {
+            UE_LOG(LogPeopleCounterUDP_TX, Error, TEXT("Failed to rebuild the UDP send socket for %s"), *TargetAddr->ToString(true));
+            DestroySocket();
+            return false;
+        }
+        SendSocket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(SendSocket);
+        SendSocket = Rebuilt;
+        bSendSocketMulticast = bMulticast;
+        UE_LOG(LogPeopleCounterUDP_TX, Log, TEXT("Send socket rebuilt for %s target %s"), bMulticast ? TEXT("multicast") : TEXT("unicast"), *TargetAddr->ToString(true));
+    }
+    return true;
+}
+
+FSocket* UUDPJsonSenderComponent::BuildSocket(const TCHAR* Description) const
+{
+    FUdpSocketBuilder Builder = FUdpSocketBuilder(Description)
         .AsNonBlocking()
         .AsReusable()
         .WithSendBufferSize(2 * 1024 * 1024);
 
+    const FIPv4Address Target = FIPv4Endpoint(TargetAddr).Address;
+    if (Target.IsMulticastAddress())
+    {
+        Builder.WithMulticastTtl(static_cast<uint8>(FMath::Clamp(MulticastTtl, 0, 255)));
+        if (bMulticastLoopback)
+        {
+            Builder.WithMulticastLoopback();
+        }
+        if (!MulticastInterface.IsEmpty())
+        {
+            FIPv4Address Interface;
+            if (!FIPv4Address::Parse(MulticastInterface, Interface))
+            {
+                UE_LOG(LogPeopleCounterUDP_TX, Error, TEXT("Invalid MulticastInterface: %s"), *MulticastInterface);
+                return nullptr;
+            }
+            Builder.WithMulticastInterface(Interface);
+        }
+    }
+    return Builder.Build();
+}
+
+bool UUDPJsonSenderComponent::CreateSocket()
+{
+    if (SendSocket) return true;
+    if (!ResolveTarget()) return false;
+
+    SendSocket = BuildSocket(TEXT("PeopleCounterUDP_TX"));
     if (!SendSocket)
     {
         UE_LOG(LogPeopleCounterUDP_TX, Error, TEXT("Failed to create UDP send socket."));
         return false;
     }
+    bSendSocketMulticast = FIPv4Endpoint(TargetAddr).Address.IsMulticastAddress();
+    if (bSendSocketMulticast)
+    {
+        UE_LOG(LogPeopleCounterUDP_TX, Log, TEXT("Sending to multicast group %s (ttl %d)"), *TargetAddr->ToString(true), MulticastTtl);
+    }
     bConnected = true;
     return true;
 }
@@ -62,6 +213,7 @@ void UUDPJsonSenderComponent::DestroySocket()
         ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(SendSocket);
         SendSocket = nullptr;
     }
+    TargetAddr.Reset();
     bConnected = false;
 }
 
@@ -77,29 +229,359 @@ void UUDPJsonSenderComponent::Disconnect()
 }
 
 bool UUDPJsonSenderComponent::SendJsonString(const FString& JsonString)
+{
+    PEOPLECOUNTER_SCOPE(Send);
+
+    FTCHARToUTF8 Conv(*JsonString);
+    return SendBytes(TArrayView<const uint8>(reinterpret_cast<const uint8*>(Conv.Get()), Conv.Length()));
+}
+
+bool UUDPJsonSenderComponent::SendBytes(TArrayView<const uint8> Payload)
 {
     if (!SendSocket)
     {
         if (!CreateSocket()) return false;
     }
+    if (!ResolveTarget()) return false;
 
-    bool bIsValid = false;
-    TSharedRef<FInternetAddr> Addr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
-    Addr->SetIp(*TargetHost, bIsValid);
-    if (!bIsValid)
+    int32 BytesSent = 0;
+    bool bOK = SendSocket->SendTo(Payload.GetData(), Payload.Num(), BytesSent, *TargetAddr);
+
+    if (!bOK)
     {
-        UE_LOG(LogPeopleCounterUDP_TX, Error, TEXT("Invalid TargetHost: %s"), *TargetHost);
+        UE_LOG(LogPeopleCounterUDP_TX, Warning, TEXT("SendTo failed to %s:%d"), *TargetHost, TargetPort);
+    }
+    return bOK;
+}
+
+bool UUDPJsonSenderComponent::SendClockPing()
+{
+    // t0 scritto il piu' tardi possibile; l'hub risponde dal suo thread RX con t1 e t2
+    const FString Payload = FString::Printf(TEXT("{\"cmd\":\"ping\",\"t0\":%.6f}"), FPlatformTime::Seconds());
+    return SendJsonString(Payload);
+}
+
+bool UUDPJsonSenderComponent::TickClockSync(float DeltaTime)
+{
+    if (ClockSyncIntervalSeconds <= 0.f)
+    {
+        ClockSyncTickerHandle.Reset();
         return false;
     }
-    Addr->SetPort(TargetPort);
+
+    const double NowSeconds = FPlatformTime::Seconds();
+    if (NowSeconds < NextClockPingSeconds || !bConnected)
+    {
+        return true;
+    }
+    // Su un secondario nDisplay il pong andrebbe al primario con un t0 di un altro orologio
+    if (!ReplyReceiver || !ReplyReceiver->IsClusterSecondary())
+    {
+        SendClockPing();
+    }
+    ++ClockPingsSent;
+    NextClockPingSeconds = NowSeconds + (ClockPingsSent < ClockSyncBurstPings ? ClockSyncBurstIntervalSeconds : ClockSyncIntervalSeconds);
+    return true;
+}
+
+bool UUDPJsonSenderComponent::StartScheduledCapture()
+{
+    if (CaptureScheduler) return true;
+    // Come per i ping: su un secondario nDisplay ogni capture sarebbe un doppione di quelle del primario
+    if (ReplyReceiver && ReplyReceiver->IsClusterSecondary())
+    {
+        UE_LOG(LogPeopleCounterUDP_TX, Log, TEXT("Scheduled capture skipped on a cluster secondary"));
+        return false;
+    }
+    if (ScheduledCaptureCommand.IsEmpty() || !ResolveTarget()) return false;
+
+    // Socket proprio del thread: Connect/Disconnect del GameThread non lo toccano
+    FSocket* ScheduleSocket = BuildSocket(TEXT("PeopleCounterUDP_Schedule"));
+    if (!ScheduleSocket)
+    {
+        UE_LOG(LogPeopleCounterUDP_TX, Error, TEXT("Failed to create the scheduled capture socket."));
+        return false;
+    }
+
+    FPeopleCounterCaptureScheduleSettings Settings;
+    Settings.IntervalSeconds = ScheduledCaptureIntervalSeconds;
+    Settings.bAlignToWallClock = bAlignScheduleToWallClock;
+    Settings.PhaseSeconds = ScheduledCapturePhaseSeconds;
+    FTCHARToUTF8 Conv(*ScheduledCaptureCommand);
+    Settings.Payload.Append(reinterpret_cast<const uint8*>(Conv.Get()), Conv.Length());
+
+    // Il timer dell'hub si spegne: le catture arrivano solo dagli slot
+    bHubTimerStopped = bStopHubTimerOnSchedule;
+    HubIntervalBeforeSchedule = -1.f;
+    const int32 Generation = ++ScheduleGeneration;
+    if (bHubTimerStopped && ReplyReceiver)
+    {
+        // La risposta dice che timer aveva l'hub: allo stop si rimette solo quello
+        SendRequestAsync(TEXT("{\"cmd\":\"set_interval\",\"seconds\":0}")).Next(
+            [WeakThis = TWeakObjectPtr<UUDPJsonSenderComponent>(this), Generation](FPeopleCounterCommandReply Reply)
+        {
+            UUDPJsonSenderComponent* This = WeakThis.Get();
+            if (This && This->ScheduleGeneration == Generation && Reply.bReceived && Reply.Packet.Type == PeopleCounter::TypeInterval
+                && Reply.Packet.PreviousIntervalSeconds >= 0.0)
+            {
+                This->HubIntervalBeforeSchedule = static_cast<float>(Reply.Packet.PreviousIntervalSeconds);
+            }
+        });
+    }
+    else if (bHubTimerStopped)
+    {
+        SendJsonString(TEXT("{\"cmd\":\"set_interval\",\"seconds\":0}"));
+    }
+
+    CaptureScheduler = MakeUnique<FPeopleCounterCaptureScheduler>(ScheduleSocket, TargetAddr->Clone(), Settings);
+    if (!CaptureScheduler->Start())
+    {
+        CaptureScheduler.Reset();
+        RestoreHubTimer();
+        return false;
+    }
+    return true;
+}
+
+void UUDPJsonSenderComponent::StopScheduledCapture()
+{
+    if (!CaptureScheduler) return;
+    CaptureScheduler->StopAndWait();
+    const FPeopleCounterScheduleStats Stats = CaptureScheduler->GetStats();
+    UE_LOG(LogPeopleCounterUDP_TX, Log, TEXT("Scheduled capture stopped: %lld sent, %lld missed slots, lateness mean %.0f max %.0f us"),
+        Stats.CapturesSent, Stats.MissedSlots, Stats.LatenessMeanUs, Stats.LatenessMaxUs);
+    CaptureScheduler.Reset();
+    RestoreHubTimer();
+}
+
+void UUDPJsonSenderComponent::RestoreHubTimer()
+{
+    if (!bHubTimerStopped) return;
+    bHubTimerStopped = false;
+    // Solo un intervallo riportato dall'hub; altrimenti resta a 0, come un hub avviato senza --interval
+    if (HubIntervalBeforeSchedule > 0.f)
+    {
+        SendJsonString(FString::Printf(TEXT("{\"cmd\":\"set_interval\",\"seconds\":%.3f}"), HubIntervalBeforeSchedule));
+        HubIntervalSeconds = HubIntervalBeforeSchedule;
+    }
+    else if (HubIntervalBeforeSchedule < 0.f)
+    {
+        UE_LOG(LogPeopleCounterUDP_TX, Log, TEXT("Scheduled capture stopped: the hub never reported its previous interval, its timer stays off"));
+    }
+}
+
+bool UUDPJsonSenderComponent::IsScheduledCaptureRunning() const
+{
+    return CaptureScheduler && CaptureScheduler->IsRunning();
+}
+
+void UUDPJsonSenderComponent::SetScheduledCaptureInterval(float IntervalSeconds)
+{
+    ScheduledCaptureIntervalSeconds = IntervalSeconds;
+    if (CaptureScheduler)
+    {
+        CaptureScheduler->SetInterval(IntervalSeconds);
+    }
+}
+
+FPeopleCounterScheduleStats UUDPJsonSenderComponent::GetScheduledCaptureStats() const
+{
+    return CaptureScheduler ? CaptureScheduler->GetStats() : FPeopleCounterScheduleStats();
+}
+
+bool UUDPJsonSenderComponent::RequestHubInterval()
+{
+    if (!ReplyReceiver) return false;
+    SendRequestAsync(TEXT("{\"cmd\":\"get_interval\"}"));
+    return true;
+}
+
+FPeopleCounterPreparedCommand UUDPJsonSenderComponent::PrepareCommand(const FString& JsonString)
+{
+    FPeopleCounterPreparedCommand Handle;
+    if (const int32* Existing = PreparedIndexByJson.Find(JsonString))
+    {
+        Handle.Index = *Existing;
+        return Handle;
+    }
 
     FTCHARToUTF8 Conv(*JsonString);
-    int32 BytesSent = 0;
-    bool bOK = SendSocket->SendTo((uint8*)Conv.Get(), Conv.Length(), BytesSent, *Addr);
+    Handle.Index = PreparedPayloads.Emplace(reinterpret_cast<const uint8*>(Conv.Get()), Conv.Length());
+    PreparedIndexByJson.Add(JsonString, Handle.Index);
+    return Handle;
+}
 
-    if (!bOK)
+bool UUDPJsonSenderComponent::SendPrepared(FPeopleCounterPreparedCommand Handle)
+{
+    PEOPLECOUNTER_SCOPE(Send);
+
+    if (!PreparedPayloads.IsValidIndex(Handle.Index))
     {
-        UE_LOG(LogPeopleCounterUDP_TX, Warning, TEXT("SendTo failed to %s:%d"), *TargetHost, TargetPort);
+        UE_LOG(LogPeopleCounterUDP_TX, Warning, TEXT("SendPrepared: invalid handle %d"), Handle.Index);
+        return false;
     }
-    return bOK;
+    return SendBytes(PreparedPayloads[Handle.Index]);
+}
+
+int32 UUDPJsonSenderComponent::SendMany(const TArray<FPeopleCounterPreparedCommand>& Handles)
+{
+    PEOPLECOUNTER_SCOPE(Send);
+
+    if (!SendSocket && !CreateSocket()) return 0;
+    if (!ResolveTarget()) return 0;
+
+    // FSocket non espone sendmmsg: un SendTo per datagram, risolvendo socket e indirizzo una volta
+    int32 NumSent = 0;
+    for (const FPeopleCounterPreparedCommand& Handle : Handles)
+    {
+        if (!PreparedPayloads.IsValidIndex(Handle.Index)) continue;
+        const TArray<uint8>& Payload = PreparedPayloads[Handle.Index];
+        int32 BytesSent = 0;
+        if (SendSocket->SendTo(Payload.GetData(), Payload.Num(), BytesSent, *TargetAddr))
+        {
+            ++NumSent;
+        }
+    }
+    if (NumSent < Handles.Num())
+    {
+        UE_LOG(LogPeopleCounterUDP_TX, Warning, TEXT("SendMany: %d of %d datagrams sent to %s:%d"), NumSent, Handles.Num(), *TargetHost, TargetPort);
+    }
+    return NumSent;
+}
+
+TFuture<FPeopleCounterCommandReply> UUDPJsonSenderComponent::SendRequestAsync(const FString& JsonObject, float TimeoutSeconds)
+{
+    const int64 RequestId = GNextRequestId++;
+
+    TUniquePtr<TPromise<FPeopleCounterCommandReply>> Promise = MakeUnique<TPromise<FPeopleCounterCommandReply>>();
+    TFuture<FPeopleCounterCommandReply> Future = Promise->GetFuture();
+
+    // "request_id" come ultimo campo dell'oggetto
+    int32 CloseIndex = INDEX_NONE;
+    JsonObject.FindLastChar(TEXT('}'), CloseIndex);
+    if (CloseIndex == INDEX_NONE)
+    {
+        UE_LOG(LogPeopleCounterUDP_TX, Warning, TEXT("SendRequestAsync: not a JSON object: %s"), *JsonObject);
+        FPeopleCounterCommandReply Failed;
+        Failed.RequestId = RequestId;
+        Promise->SetValue(MoveTemp(Failed));
+        return Future;
+    }
+    const FString Body = JsonObject.Left(CloseIndex).TrimEnd();
+    const TCHAR* Separator = Body.EndsWith(TEXT("{")) ? TEXT("") : TEXT(",");
+    const FString Payload = FString::Printf(TEXT("%s%s\"request_id\":%lld}"), *Body, Separator, RequestId);
+
+    if (!ReplyReceiver)
+    {
+        UE_LOG(LogPeopleCounterUDP_TX, Warning, TEXT("SendRequestAsync: no ReplyReceiver, request %lld can only time out"), RequestId);
+    }
+
+    const double NowSeconds = FPlatformTime::Seconds();
+    FPendingRequest& Pending = PendingRequests.Add(RequestId);
+    Pending.Promise = MoveTemp(Promise);
+    Pending.SentSeconds = NowSeconds;
+    Pending.DeadlineSeconds = NowSeconds + (TimeoutSeconds > 0.f ? TimeoutSeconds : DefaultRequestTimeoutSeconds);
+
+    if (!TimeoutTickerHandle.IsValid())
+    {
+        TimeoutTickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+            FTickerDelegate::CreateUObject(this, &UUDPJsonSenderComponent::TickRequestTimeouts));
+    }
+
+    // Un invio fallito scade come una risposta persa
+    SendJsonString(Payload);
+    return Future;
+}
+
+TFuture<FPeopleCounterCommandReply> UUDPJsonSenderComponent::RequestCaptureAsync(float TimeoutSeconds)
+{
+    return SendRequestAsync(TEXT("{\"cmd\":\"capture\"}"), TimeoutSeconds);
+}
+
+void UUDPJsonSenderComponent::SendCommandAndWait(const FString& JsonObject, float TimeoutSeconds, EPeopleCounterReplyResult& Result,
+    FPeopleCounterCommandReply& Reply, FLatentActionInfo LatentInfo)
+{
+    UWorld* World = GetWorld();
+    if (!World) return;
+
+    FLatentActionManager& LatentManager = World->GetLatentActionManager();
+    if (LatentManager.FindExistingAction<FPeopleCounterReplyLatentAction>(LatentInfo.CallbackTarget, LatentInfo.UUID))
+    {
+        // Nodo gia' in attesa: come Delay, una nuova esecuzione viene ignorata
+        return;
+    }
+    LatentManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID,
+        new FPeopleCounterReplyLatentAction(SendRequestAsync(JsonObject, TimeoutSeconds), Result, Reply, LatentInfo));
+}
+
+void UUDPJsonSenderComponent::HandleReply(const FPeopleCountPacket& Packet)
+{
+    // Vale anche se la richiesta e' scaduta o era di un altro sender
+    if (Packet.Type == PeopleCounter::TypeInterval && Packet.IntervalSeconds >= 0.0)
+    {
+        HubIntervalSeconds = static_cast<float>(Packet.IntervalSeconds);
+    }
+    if (Packet.RequestId < 0) return;
+
+    FPendingRequest* Found = PendingRequests.Find(Packet.RequestId);
+    if (!Found)
+    {
+        // Risposta a un altro sender o arrivata dopo il timeout
+        return;
+    }
+    FPendingRequest Pending = MoveTemp(*Found);
+    PendingRequests.Remove(Packet.RequestId);
+
+    FPeopleCounterCommandReply Reply;
+    Reply.bReceived = true;
+    Reply.RequestId = Packet.RequestId;
+    Reply.RoundTripMs = static_cast<float>((FPlatformTime::Seconds() - Pending.SentSeconds) * 1000.0);
+    Reply.Packet = Packet;
+    if (ReplyReceiver)
+    {
+        ReplyReceiver->RecordRequestRoundTrip(Reply.RoundTripMs);
+    }
+    Pending.Promise->SetValue(MoveTemp(Reply));
+}
+
+bool UUDPJsonSenderComponent::TickRequestTimeouts(float DeltaTime)
+{
+    const double NowSeconds = FPlatformTime::Seconds();
+    for (auto It = PendingRequests.CreateIterator(); It; ++It)
+    {
+        if (NowSeconds < It->Value.DeadlineSeconds) continue;
+
+        FPeopleCounterCommandReply Reply;
+        Reply.RequestId = It->Key;
+        Reply.RoundTripMs = static_cast<float>((NowSeconds - It->Value.SentSeconds) * 1000.0);
+        if (ReplyReceiver)
+        {
+            ReplyReceiver->RecordRequestTimeout();
+        }
+        It->Value.Promise->SetValue(MoveTemp(Reply));
+        It.RemoveCurrent();
+    }
+
+    if (PendingRequests.Num() == 0)
+    {
+        TimeoutTickerHandle.Reset();
+        return false;
+    }
+    return true;
+}
+
+void UUDPJsonSenderComponent::FailPendingRequests()
+{
+    if (TimeoutTickerHandle.IsValid())
+    {
+        FTSTicker::GetCoreTicker().RemoveTicker(TimeoutTickerHandle);
+        TimeoutTickerHandle.Reset();
+    }
+    for (TPair<int64, FPendingRequest>& Pair : PendingRequests)
+    {
+        FPeopleCounterCommandReply Reply;
+        Reply.RequestId = Pair.Key;
+        Pair.Value.Promise->SetValue(MoveTemp(Reply));
+    }
+    PendingRequests.Reset();
 }
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/DataTable.h"
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterCountFilter.h"
+#include "PeopleCounterAreaAggregatorComponent.generated.h"
+
+class UUDPJsonReceiverComponent;
+
+// Come si combinano i sensori di un'area
+UENUM(BlueprintType)
+enum class EPeopleCounterAreaCombine : uint8
+{
+    // Somma pesata: sensori con campi visivi disgiunti
+    Sum,
+    // Massimo pesato: sensori che inquadrano la stessa zona (niente doppio conteggio)
+    Max
+};
+
+// Come GetAreaCountSmoothed riporta i conteggi al tempo del frame
+UENUM(BlueprintType)
+enum class EPeopleCounterAreaTimeSmoothing : uint8
+{
+    // Valore dell'ultimo pacchetto, a scalini
+    None,
+    // Tra il valore precedente e l'ultimo, InterpolationDelaySeconds nel passato: continuo, mai oltre i dati
+    Interpolate,
+    // Come Interpolate, ma dopo l'ultimo cambio prosegue la sua pendenza per al massimo
+    // MaxExtrapolationSeconds: meno ritardo, puo' superare il valore vero
+    Extrapolate
+};
+
+// Riga del DataTable sensore -> area. Un sensore puo' comparire in piu' aree (campi visivi
+// condivisi): con Weight < 1 ogni area prende solo la sua quota del conteggio.
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterAreaMembershipRow : public FTableRowBase
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    FName SensorId;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    FName Area;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter", meta=(ClampMin="0"))
+    float Weight = 1.f;
+};
+
+// Soglia su un'area: evento quando il conteggio passa da sotto a >= Threshold o viceversa
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterAreaThreshold
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    FName Area;
+
+    // 1 = vuota <-> occupata
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    float Threshold = 1.f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnAreasUpdated);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FOnAreaThresholdCrossed, FName, Area, float, Threshold, bool, bAbove, float, Count);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnAreaCountChanged, FName, Area, int32, Count, int32, PreviousCount);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnDominantAreaChanged, FName, Area, FName, PreviousArea, float, Count);
+
+DECLARE_MULTICAST_DELEGATE_FourParams(FOnAreaThresholdCrossedNative, FName /*Area*/, float /*Threshold*/, bool /*bAbove*/, float /*Count*/);
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnAreaCountChangedNative, FName /*Area*/, int32 /*Count*/, int32 /*PreviousCount*/);
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnDominantAreaChangedNative, FName /*Area*/, FName /*PreviousArea*/, float /*Count*/);
+
+// Aggregazione sensori -> aree in C++. Il DataTable viene compilato una volta in array
+// piatti indicizzati per slot del registro sensori; ad ogni pacchetto si ricalcolano solo
+// le aree con un sensore cambiato. Le query sono O(1).
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PEOPLECOUNTERUDP_API UPeopleCounterAreaAggregatorComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Se vuoto si usa il primo UDPJsonReceiverComponent dello stesso Actor
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Areas")
+    TObjectPtr<UUDPJsonReceiverComponent> Receiver;
+
+    // Righe FPeopleCounterAreaMembershipRow
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Areas", meta=(RequiredAssetDataTags="RowStructure=/Script/PeopleCounterUDP.PeopleCounterAreaMembershipRow"))
+    TObjectPtr<UDataTable> AreaTable;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Areas")
+    EPeopleCounterAreaCombine DefaultCombine = EPeopleCounterAreaCombine::Sum;
+
+    // Modalita' per singola area, se diversa da DefaultCombine
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Areas")
+    TMap<FName, EPeopleCounterAreaCombine> AreaCombineOverrides;
+
+    // Filtro temporale del conteggio combinato di ogni area (dopo quello dei sensori del receiver):
+    // GetAreaCount, lo smoothing e OnAreasUpdated vedono il valore filtrato
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Filter")
+    FPeopleCounterFilterSettings AreaFilter;
+
+    // Filtro per singola area, al posto di AreaFilter
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Filter")
+    TMap<FName, FPeopleCounterFilterSettings> AreaFilterOverrides;
+
+    // Solo GetAreaCountSmoothed; GetAreaCount resta il valore dell'ultimo pacchetto
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Smoothing")
+    EPeopleCounterAreaTimeSmoothing TimeSmoothing = EPeopleCounterAreaTimeSmoothing::Interpolate;
+
+    // Ritardo di visualizzazione rispetto alla cattura; 0 = intervallo medio tra i pacchetti
+    // (cosi' c'e' quasi sempre un valore successivo verso cui interpolare)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Smoothing", meta=(ClampMin="0"))
+    float InterpolationDelaySeconds = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Smoothing", meta=(ClampMin="0"))
+    float MaxExtrapolationSeconds = 1.f;
+
+    // Soglie valutate in C++ a ogni cambio di un'area (vedi OnAreaThresholdCrossed); a runtime
+    // con AddAreaThreshold/RemoveAreaThreshold, o RebuildFromTable dopo averle modificate
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Events")
+    TArray<FPeopleCounterAreaThreshold> AreaThresholds;
+
+    // Scatta una volta per pacchetto, solo se almeno un'area e' cambiata
+    UPROPERTY(BlueprintAssignable, Category="PeopleCounter|Areas")
+    FOnAreasUpdated OnAreasUpdated;
+
+    // Eventi solo sui cambi che contano: il grafo Blueprint non gira a ogni pacchetto.
+    // Scattano dopo OnAreasUpdated, con GetAreaCount gia' aggiornato.
+
+    // Un'area ha attraversato una delle AreaThresholds (bAbove: ora Count >= Threshold)
+    UPROPERTY(BlueprintAssignable, Category="PeopleCounter|Events")
+    FOnAreaThresholdCrossed OnAreaThresholdCrossed;
+
+    // Il conteggio arrotondato di un'area e' cambiato
+    UPROPERTY(BlueprintAssignable, Category="PeopleCounter|Events")
+    FOnAreaCountChanged OnAreaCountChanged;
+
+    // L'area piu' popolata e' cambiata (None = tutte vuote)
+    UPROPERTY(BlueprintAssignable, Category="PeopleCounter|Events")
+    FOnDominantAreaChanged OnDominantAreaChanged;
+
+    // Gli stessi eventi per i consumer C++, prima di quelli Blueprint
+    FOnAreaThresholdCrossedNative OnAreaThresholdCrossedNative;
+    FOnAreaCountChangedNative OnAreaCountChangedNative;
+    FOnDominantAreaChangedNative OnDominantAreaChangedNative;
+
+    // Fine di RebuildFromTable: indici e nomi delle aree possono essere cambiati
+    FSimpleMulticastDelegate OnAreasRebuiltNative;
+
+public:
+    UPeopleCounterAreaAggregatorComponent();
+
+    // Ricompila il DataTable (da chiamare se AreaTable cambia a runtime)
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Areas")
+    void RebuildFromTable();
+
+    // Conteggio pesato dell'area; 0 se sconosciuta
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Areas")
+    float GetAreaCount(FName Area) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Areas")
+    int32 GetAreaCountRounded(FName Area) const { return FMath::RoundToInt(GetAreaCount(Area)); }
+
+    // Conteggio combinato prima del filtro; uguale a GetAreaCount senza filtro
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Filter")
+    float GetAreaRawCount(FName Area) const;
+
+    // Aggiunge una soglia ad AreaThresholds; lo stato sopra/sotto parte dal conteggio attuale
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Events")
+    void AddAreaThreshold(FName Area, float Threshold);
+
+    // Rimuove le soglie uguali; false se non ce n'erano
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Events")
+    bool RemoveAreaThreshold(FName Area, float Threshold);
+
+    // false se non ci sono aree o sono tutte vuote
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Areas")
+    bool GetMostPopulatedArea(FName& OutArea, float& OutCount) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Areas")
+    const TArray<FName>& GetAreaNames() const { return AreaNames; }
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Areas")
+    int32 GetAreaIndex(FName Area) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Areas")
+    float GetAreaCountByIndex(int32 AreaIndex) const { return AreaCounts.IsValidIndex(AreaIndex) ? AreaCounts[AreaIndex] : 0.f; }
+
+    TConstArrayView<float> GetAreaCounts() const { return AreaCounts; }
+
+    // Conteggio al tempo del frame corrente secondo TimeSmoothing. I tempi di cattura sono quelli
+    // dell'hub riportati sull'orologio del motore (serve il ping del sender); senza stima si usa
+    // l'arrivo del pacchetto.
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Smoothing")
+    float GetAreaCountSmoothed(FName Area) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Smoothing")
+    float GetAreaCountSmoothedByIndex(int32 AreaIndex) const;
+
+    // Stesso calcolo a un istante qualsiasi (base FPlatformTime::Seconds())
+    float GetAreaCountAtTime(int32 AreaIndex, double EngineSeconds) const;
+
+    // Area con conteggio scritto da fuori (es. UPeopleCounterAreaClassifierComponent) invece che
+    // dai sensori del DataTable; sopravvive a RebuildFromTable (anche senza Receiver) col suo
+    // ultimo conteggio, ma l'indice puo' cambiare: va riletto per nome. Se l'area e' anche nel DataTable
+    // i due contributi si sommano. Restituisce l'indice dell'area.
+    int32 AddExternalArea(FName Area);
+
+    // Nuovi conteggi di aree esterne, trattati come un pacchetto catturato a EngineSeconds:
+    // smoothing, area piu' popolata e OnAreasUpdated (solo se qualcosa cambia)
+    void SetExternalAreaCounts(TConstArrayView<int32> AreaIndices, TConstArrayView<float> Counts, double EngineSeconds);
+
+    // Ingresso dei pacchetti del Receiver (slot gia' risolti sul suo registro); pubblico per chi
+    // li consegna a mano, come i benchmark
+    void HandlePacket(const FPeopleCountPacket& Packet);
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+    // Restituisce la cattura del pacchetto precedente
+    double AdvanceTimeline(double& InOutPacketSeconds);
+    void MarkAreaDirty(int32 AreaIndex);
+    void CommitDirtyAreas(double PreviousPacketSeconds, double PacketSeconds);
+    void CommitAreaValue(int32 AreaIndex, float Value, double PreviousPacketSeconds, double PacketSeconds);
+    void ConfigureAreaFilter(int32 AreaIndex);
+    void RecomputeArea(int32 AreaIndex);
+    void RecomputeMostPopulated();
+    void CompileThresholds();
+    void BroadcastAreaEvents(int32 PreviousMostPopulated, uint32 Serial);
+    void HandleReceiverStarted();
+
+    FDelegateHandle PacketHandle;
+    FDelegateHandle ReceiverStartedHandle;
+    // RebuildFromTable prima di StartReceiver: i sensori si registrano all'avvio del Receiver
+    bool bWaitingForRegistry = false;
+
+    // Aree
+    TArray<FName> AreaNames;
+    TMap<FName, int32> AreaIndexByName;
+    TArray<float> AreaCounts;
+    TArray<EPeopleCounterAreaCombine> AreaCombine;
+    // Somma/massimo dei membri prima del filtro; con filtro spento uguale ad AreaCounts
+    TArray<float> RawAreaCounts;
+
+    // Un profilo per AreaFilter e uno per override, stato per indice d'area
+    FPeopleCounterCountFilter AreaCountFilter;
+    TArray<int32> FilterChanged;
+
+    // CSR sensore (slot registro) -> aree: archi [SensorEdgeStart[s], SensorEdgeStart[s+1])
+    TArray<int32> SensorEdgeStart;
+    TArray<int32> SensorEdgeArea;
+
+    // CSR area -> membri, per il ricalcolo
+    TArray<int32> AreaMemberStart;
+    TArray<int32> AreaMemberSlot;
+    TArray<float> AreaMemberWeight;
+
+    // Ultimo conteggio visto per slot (rilevamento modifiche)
+    TArray<int32> SensorCounts;
+
+    // Aree esterne e loro contributo per area (0 per quelle solo da DataTable)
+    TArray<FName> ExternalAreaNames;
+    TArray<float> ExternalCounts;
+
+    // Ultimo cambio di ogni area: da AreaFromCounts (vero fino a AreaFromSeconds, l'ultimo
+    // pacchetto precedente) a AreaCounts (catturato a AreaToSeconds)
+    TArray<float> AreaFromCounts;
+    TArray<double> AreaFromSeconds;
+    TArray<double> AreaToSeconds;
+    // Cattura dell'ultimo pacchetto e intervallo medio tra pacchetti (EMA)
+    double LastPacketSeconds = 0.0;
+    double MeanPacketIntervalSeconds = 0.0;
+
+    // Aree sporche del pacchetto corrente (riusati, niente allocazioni a regime)
+    TArray<int32> DirtyAreas;
+    TBitArray<> DirtyFlags;
+
+    int32 MostPopulatedIndex = INDEX_NONE;
+
+    // AreaThresholds in CSR per area, ordinate per valore: [ThresholdStart[a], ThresholdStart[a+1])
+    TArray<int32> ThresholdStart;
+    TArray<float> ThresholdValue;
+    // Aree cambiate nel commit corrente e loro valore prima del cambio
+    TArray<int32> ChangedAreas;
+    TArray<float> ChangedFromCounts;
+    // Cambia a ogni commit, RebuildFromTable e Add/RemoveAreaThreshold: se un handler ne provoca
+    // uno, gli eventi rimasti del commit precedente non partono
+    uint32 CommitSerial = 0;
+};
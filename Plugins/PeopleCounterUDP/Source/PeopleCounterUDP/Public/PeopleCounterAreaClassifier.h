@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Omografia immagine normalizzata del sensore -> pianta (X/Y del mondo, cm)
+struct PEOPLECOUNTERUDP_API FPeopleCounterHomography
+{
+    // Riga per riga, M[8] = 1
+    double M[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+
+    // Minimi quadrati (DLT con coordinate normalizzate) su almeno 4 corrispondenze;
+    // false se i punti sono degeneri (tre allineati, doppioni)
+    bool Fit(TConstArrayView<FVector2D> From, TConstArrayView<FVector2D> To);
+
+    FVector2f Project(FVector2f Point) const;
+};
+
+// Punto -> aree su poligoni statici. I poligoni vengono compilati una volta in una griglia
+// uniforme: ogni cella sa quali poligoni la coprono del tutto e, per quelli di cui attraversa il
+// bordo, se il suo centro e' dentro e quali lati la toccano. Un punto si classifica contando i lati
+// tagliati dal segmento centro della cella -> punto: solo i lati della cella, 4 alla volta in SIMD.
+//
+// Non thread-safe in Build; le query sono const e si possono fare da piu' thread.
+class PEOPLECOUNTERUDP_API FPeopleCounterAreaClassifier
+{
+public:
+    // Polygons: vertici in ordine (chiusura implicita), PolygonAreas: area di ogni poligono.
+    // Piu' poligoni possono dare la stessa area; le aree possono sovrapporsi.
+    void Build(TConstArrayView<TArray<FVector2f>> Polygons, TConstArrayView<int32> PolygonAreas, int32 InNumAreas, int32 GridResolution = 64);
+    void Reset();
+
+    bool IsEmpty() const { return Entries.Num() == 0; }
+    int32 GetNumAreas() const { return NumAreas; }
+
+    // Somma a OutAreaCounts (GetNumAreas() elementi) una persona per ogni area che contiene il punto
+    void CountPoints(TConstArrayView<FVector2f> Points, TArrayView<float> OutAreaCounts) const;
+
+    // Prima area (in ordine di poligono) che contiene il punto; INDEX_NONE fuori da tutte
+    int32 ClassifyPoint(FVector2f Point) const;
+
+private:
+    struct FCellEntry
+    {
+        int32 Polygon = INDEX_NONE;
+        // Lati in EdgeAX..EdgeD1, a gruppi di 4; 0 = cella tutta dentro il poligono
+        int32 EdgeStart = 0;
+        int32 NumEdges = 0;
+        bool bCenterInside = false;
+    };
+
+    FVector2f GridMin = FVector2f::ZeroVector;
+    float CellSize = 1.f;
+    float InvCellSize = 1.f;
+    int32 NumCellsX = 0;
+    int32 NumCellsY = 0;
+
+    // CSR cella -> voci [CellEntryStart[c], CellEntryStart[c+1])
+    TArray<int32> CellEntryStart;
+    TArray<FCellEntry> Entries;
+
+    // Lati in SoA: origine A, direzione E = B - A, orient(A, B, centro cella) precalcolato.
+    // Le code dei gruppi sono lati nulli, che non tagliano mai.
+    TArray<float> EdgeAX, EdgeAY, EdgeEX, EdgeEY, EdgeD1;
+
+    TArray<int32> PolygonArea;
+    int32 NumAreas = 0;
+
+    FVector2f GetCellCenter(int32 CellX, int32 CellY) const;
+    bool IsInside(const FCellEntry& Entry, FVector2f Center, FVector2f Point) const;
+
+    template <typename VisitorType>
+    void ForEachContainingPolygon(FVector2f Point, VisitorType&& Visit) const;
+};
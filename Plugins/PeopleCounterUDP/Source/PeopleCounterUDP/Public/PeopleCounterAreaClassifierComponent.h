@@ -0,0 +1,150 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/DataTable.h"
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterAreaClassifier.h"
+#include "PeopleCounterAreaClassifierComponent.generated.h"
+
+class UUDPJsonReceiverComponent;
+class UPeopleCounterAreaAggregatorComponent;
+class FPeopleCounterSensorRegistry;
+
+// Riga del DataTable dei poligoni: vertici in ordine sulla pianta (X/Y del mondo, cm).
+// Piu' righe con la stessa Area ne uniscono i poligoni.
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterAreaPolygonRow : public FTableRowBase
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    FName Area;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    TArray<FVector2D> Vertices;
+};
+
+// Calibrazione di un sensore: punti dell'immagine normalizzata [0,1] e gli stessi sulla pianta.
+// Almeno 4 coppie; ImagePoints vuoto = angoli dell'immagine (0,0), (1,0), (1,1), (0,1).
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterSensorCalibrationRow : public FTableRowBase
+{
+    GENERATED_BODY()
+
+    // Seriale RealSense del sensore (noto al receiver dopo list_sensors). Finche' l'hub non l'ha
+    // comunicato vale l'id del registro unito ("SENSORE001", "Sala1.SENSORE001" con piu' hub),
+    // che pero' cambia se si aggiungono o tolgono camere.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    FName SensorId;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    TArray<FVector2D> ImagePoints;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    TArray<FVector2D> FloorPoints;
+};
+
+// Centroidi dei pacchetti detections -> aree per posizione invece che per sensore.
+// Ogni sensore calibrato porta i suoi centroidi sulla pianta comune con la sua omografia; le
+// persone viste da due camere sovrapposte si fondono entro DuplicateMergeDistance; i punti
+// vengono classificati nei poligoni (DataTable e/o spline nel livello) dalla griglia SIMD di
+// FPeopleCounterAreaClassifier e i conteggi per area finiscono nell'aggregatore come aree esterne.
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PEOPLECOUNTERUDP_API UPeopleCounterAreaClassifierComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Se vuoti si usano i primi componenti dello stesso Actor
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier")
+    TObjectPtr<UUDPJsonReceiverComponent> Receiver;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier")
+    TObjectPtr<UPeopleCounterAreaAggregatorComponent> Aggregator;
+
+    // Righe FPeopleCounterAreaPolygonRow
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier", meta=(RequiredAssetDataTags="RowStructure=/Script/PeopleCounterUDP.PeopleCounterAreaPolygonRow"))
+    TObjectPtr<UDataTable> AreaPolygonTable;
+
+    // Actor con uno SplineComponent chiuso sul pavimento; area = primo tag dell'Actor, altrimenti il suo nome
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier")
+    TArray<TObjectPtr<AActor>> AreaSplineActors;
+
+    // Campioni per segmento delle spline curve
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier", meta=(ClampMin="1", ClampMax="64"))
+    int32 SplineSamplesPerSegment = 8;
+
+    // Righe FPeopleCounterSensorCalibrationRow; i sensori senza calibrazione vengono ignorati
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier", meta=(RequiredAssetDataTags="RowStructure=/Script/PeopleCounterUDP.PeopleCounterSensorCalibrationRow"))
+    TObjectPtr<UDataTable> CalibrationTable;
+
+    // Celle della griglia sul lato lungo dell'insieme dei poligoni
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier", meta=(ClampMin="1", ClampMax="1024"))
+    int32 GridResolution = 64;
+
+    // Punti di sensori diversi piu' vicini di cosi' (cm) sono la stessa persona; 0 = nessuna fusione
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier", meta=(ClampMin="0"))
+    float DuplicateMergeDistance = 40.f;
+
+    // Punti di un sensore senza pacchetti per questo tempo non contano piu'
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Classifier", meta=(ClampMin="0"))
+    float PointTimeoutSeconds = 2.f;
+
+public:
+    UPeopleCounterAreaClassifierComponent();
+
+    // Ricompila poligoni e calibrazioni (dopo modifiche a tabelle o spline a runtime)
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Classifier")
+    void Rebuild();
+
+    // Persone sulla pianta dopo la fusione dei doppioni, all'ultimo pacchetto
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Classifier")
+    TArray<FVector2D> GetFloorPositions() const;
+
+    // Area di un punto della pianta (prima in ordine di definizione); None fuori da tutte
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Classifier")
+    FName ClassifyFloorPoint(FVector2D FloorPoint) const;
+
+    TConstArrayView<FVector2f> GetFloorPoints() const { return MergedPoints; }
+    const FPeopleCounterAreaClassifier& GetClassifier() const { return Classifier; }
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+    void HandlePacket(const FPeopleCountPacket& Packet);
+    bool ResolveCalibration(int32 Slot, const FPeopleCounterSensorRegistry& Registry);
+    void MergeDuplicates();
+    void AddPolygon(FName Area, TArray<FVector2f>&& Vertices);
+
+    FDelegateHandle PacketHandle;
+
+    FPeopleCounterAreaClassifier Classifier;
+    TArray<FName> AreaNames;
+    TMap<FName, FPeopleCounterHomography> HomographyBySensor;
+
+    // Ultimi punti sulla pianta per slot del registro unito
+    struct FSlotPoints
+    {
+        TArray<FVector2f> Points;
+        double LastUpdateSeconds = 0.0;
+        // -1 da risolvere, 0 senza calibrazione, 1 calibrato
+        int8 State = -1;
+        // Seriale con cui e' stato risolto (vuoto = per id): se il registro ne riporta un altro si rifa'
+        FString Serial;
+        FPeopleCounterHomography Homography;
+    };
+    TArray<FSlotPoints> Slots;
+
+    // Riusati a ogni pacchetto
+    TArray<TArray<FVector2f>> PendingPolygons;
+    TArray<int32> PendingPolygonAreas;
+    TArray<FVector2f> MergedPoints;
+    TArray<int32> MergedSlots;
+    TArray<int32> SortOrder;
+    TBitArray<> Duplicate;
+    TArray<float> AreaCounts;
+    TArray<int32> AggregatorAreas;
+};
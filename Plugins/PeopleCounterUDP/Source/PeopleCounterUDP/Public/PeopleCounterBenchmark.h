@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonValue.h"
+#include "PeopleCounterTypes.h"
+
+class FPeopleCounterChannel;
+class FPeopleCounterLoadGenerator;
+
+struct PEOPLECOUNTERUDP_API FPeopleCounterBenchmarkSettings
+{
+    TArray<int32> SensorCounts = { 3, 20, 200, 2000 };
+    // Tempo misurato per ogni caso (dopo il riscaldamento)
+    float MinSecondsPerCase = 0.25f;
+    // Loopback: canale dedicato su 127.0.0.1 e generatore di carico verso di esso (0 secondi = saltato)
+    int32 LoopbackPort = 7791;
+    int32 LoopbackSensors = 20;
+    float LoopbackRate = 500.f;
+    float LoopbackSeconds = 3.f;
+    // Registrazione .pcrl o events.ndjson: anche il parsing di una sessione vera
+    FString SessionPath;
+    // Vuoto = Saved/PeopleCounter/Benchmarks/bench-<data>.json
+    FString OutputPath;
+    // Chiude il processo dopo aver scritto il file (esecuzioni da riga di comando, -ExecCmds)
+    bool bExitWhenDone = false;
+};
+
+// Benchmark della pipeline in JSON (ns/op e allocazioni/op per caso), da confrontare tra una
+// versione del plugin e l'altra: parser DOM, veloce e binario per numero di sensori, invio con
+// SendJsonString, aggregazione nelle aree, latenza socket -> broadcast su loopback.
+//
+// I casi sincroni girano nel GameThread dentro Start; il loopback ha bisogno dei frame (il
+// dispatch avviene nel tick) e il file JSON viene scritto quando finisce.
+class PEOPLECOUNTERUDP_API FPeopleCounterBenchmark
+{
+public:
+    explicit FPeopleCounterBenchmark(const FPeopleCounterBenchmarkSettings& InSettings);
+    ~FPeopleCounterBenchmark();
+
+    void Start();
+    bool IsFinished() const { return bFinished; }
+    const FString& GetOutputPath() const { return OutputPath; }
+
+private:
+    // Chiama Op finche' non passano MinSecondsPerCase e aggiunge il risultato; ogni chiamata vale OpsPerCall operazioni
+    void Measure(const FString& Name, int32 NumSensors, int32 OpsPerCall, TFunctionRef<void()> Op);
+    void RunParsers(int32 NumSensors);
+    void RunAggregation(int32 NumSensors);
+    void RunSend(int32 NumSensors);
+    void RunSession();
+
+    bool StartLoopback();
+    bool TickLoopback(float DeltaTime);
+    void HandleLoopbackPacket(const FPeopleCountPacket& Packet);
+    void FinishLoopback();
+    void WriteResults();
+
+    FPeopleCounterBenchmarkSettings Settings;
+    FString OutputPath;
+    TArray<TSharedPtr<FJsonValue>> Results;
+    bool bFinished = false;
+
+    TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> LoopbackChannel;
+    TUniquePtr<FPeopleCounterLoadGenerator> LoopbackGenerator;
+    FDelegateHandle LoopbackPacketHandle;
+    FTSTicker::FDelegateHandle TickerHandle;
+    // Microsecondi dall'uscita dal socket e dal timestamp del generatore fino al broadcast
+    TArray<float> SocketToBroadcastMicros;
+    TArray<float> SendToBroadcastMicros;
+    double LoopbackFinishedSeconds = 0.0;
+    double FrameSecondsSum = 0.0;
+    int32 NumFrames = 0;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PeopleCounterTypes.h"
+
+// Formato binario people_count_v2 (little-endian, senza padding):
+//
+//   offset  size  campo
+//   0       4     magic "PCNT"
+//   4       1     version (2)
+//   5       1     flags (bit 0: delta, solo sensori cambiati; bit 1: request id; bit 2: hub id; altri riservati)
+//   6       2     uint16 numero di entry
+//   8       4     uint32 sequence
+//   12      8     double timestamp (secondi epoch hub)
+//   20      4     uint32 request id, solo con il flag request id (risposta a un comando)
+//   ..      1+L   uint8 L + hub id ASCII, solo con il flag hub id (piu' hub verso lo stesso receiver)
+//   ..      4*N   entry: uint16 indice sensore (SENSORE%03d), uint16 count
+//
+// Lato Python: struct.pack("<4sBBHId", b"PCNT", 2, 0, n, seq, ts) + n * struct.pack("<HH", idx, count)
+namespace PeopleCounter::Binary
+{
+    constexpr uint8 Magic[4] = { 'P', 'C', 'N', 'T' };
+    constexpr uint8 Version = 2;
+    constexpr int32 HeaderSize = 20;
+    constexpr int32 EntrySize = 4;
+    constexpr uint8 FlagDelta = 1 << 0;
+    constexpr uint8 FlagRequestId = 1 << 1;
+    constexpr int32 RequestIdSize = 4;
+    constexpr uint8 FlagHubId = 1 << 2;
+
+    PEOPLECOUNTERUDP_API extern const FName SchemaV2;
+
+    // Basta il magic: un pacchetto JSON inizia sempre con '{' o spazi
+    inline bool IsBinaryPacket(const uint8* Data, int32 Num)
+    {
+        return Num >= HeaderSize && FMemory::Memcmp(Data, Magic, sizeof(Magic)) == 0;
+    }
+
+    // Decodifica senza conversioni di stringa; false se header o lunghezza non tornano
+    PEOPLECOUNTERUDP_API bool DecodePacket(const uint8* Data, int32 Num, FPeopleCountPacket& OutPacket);
+
+    // Codifica un pacchetto (id nella forma SENSORE%03d); sensori con id diverso vengono saltati.
+    // Type == delta_counts imposta FlagDelta, RequestId >= 0 imposta FlagRequestId, Source imposta FlagHubId.
+    PEOPLECOUNTERUDP_API void EncodePacket(const FPeopleCountPacket& Packet, TArray<uint8>& OutBytes);
+
+    // "SENSORE%03d" come FName, costruito una volta per indice
+    PEOPLECOUNTERUDP_API FName SensorNameForIndex(int32 Index);
+
+    // Inverso di SensorNameForIndex; INDEX_NONE se l'id non ha quella forma
+    PEOPLECOUNTERUDP_API int32 SensorIndexFromName(FName Id);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "PeopleCounterTypes.h"
+
+class FSocket;
+class FInternetAddr;
+class FRunnableThread;
+class FEvent;
+
+struct PEOPLECOUNTERUDP_API FPeopleCounterCaptureScheduleSettings
+{
+    float IntervalSeconds = 0.5f;
+    // Slot agli istanti Unix multipli di IntervalSeconds (+ PhaseSeconds): piu' sender e piu'
+    // macchine sincronizzate con NTP catturano insieme. false = periodo dal primo invio.
+    bool bAlignToWallClock = true;
+    float PhaseSeconds = 0.f;
+    // Datagram gia' codificato, inviato cosi' com'e' a ogni slot
+    TArray<uint8> Payload;
+};
+
+// Thread che invia un comando (di solito {"cmd":"capture"}) a periodo fisso, indipendente dal
+// frame rate e dagli stalli del GameThread. Attende con un evento fino a poco prima dello
+// slot e poi cede la CPU in un giro stretto fino all'istante esatto.
+//
+// Socket e indirizzo sono suoi (li distrugge StopAndWait); Start/StopAndWait dal GameThread,
+// SetInterval e GetStats da qualunque thread.
+class PEOPLECOUNTERUDP_API FPeopleCounterCaptureScheduler : public FRunnable
+{
+public:
+    FPeopleCounterCaptureScheduler(FSocket* InSocket, const TSharedRef<FInternetAddr>& InTargetAddr, const FPeopleCounterCaptureScheduleSettings& InSettings);
+    virtual ~FPeopleCounterCaptureScheduler() override;
+
+    bool Start();
+    void StopAndWait();
+    bool IsRunning() const { return Thread && !bFinished; }
+
+    // Vale dallo slot successivo
+    void SetInterval(float IntervalSeconds);
+    FPeopleCounterScheduleStats GetStats() const;
+
+    // FRunnable
+    virtual uint32 Run() override;
+    virtual void Stop() override;
+
+private:
+    // Primo slot dopo NowSeconds (FPlatformTime) con il periodo e l'offset dell'orologio correnti
+    double NextSlotAfter(double NowSeconds, double IntervalSeconds) const;
+    void SampleWallClockOffset();
+
+    FPeopleCounterCaptureScheduleSettings Settings;
+    FSocket* Socket = nullptr;
+    TSharedRef<FInternetAddr> TargetAddr;
+    FRunnableThread* Thread = nullptr;
+    FEvent* WakeEvent = nullptr;
+    TAtomic<bool> bStopping { false };
+    TAtomic<bool> bFinished { false };
+
+    // Secondi Unix - FPlatformTime::Seconds(), ricampionato per seguire le correzioni NTP
+    double WallClockOffsetSeconds = 0.0;
+
+    mutable FCriticalSection Mutex;
+    float PendingIntervalSeconds = 0.f;
+    bool bIntervalChanged = false;
+    FPeopleCounterScheduleStats Stats;
+    double LatenessTotalUs = 0.0;
+};
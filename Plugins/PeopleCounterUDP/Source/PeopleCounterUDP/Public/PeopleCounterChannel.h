@@ -0,0 +1,419 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Common/UdpSocketReceiver.h" // FArrayReaderPtr, FUdpSocketReceiver
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterFastParser.h"
+#include "PeopleCounterSensorRegistry.h"
+#include "PeopleCounterClockSync.h"
+#include "PeopleCounterCountFilter.h"
+
+class FSocket;
+class FPeopleCounterReceiveWorker;
+class IPeopleCounterClusterBridge;
+class FPeopleCounterSessionRecorder;
+class FPeopleCounterSessionReplay;
+template <typename T> class TPeopleCounterObjectPool;
+namespace UE::Tasks { class FPipe; }
+
+// Configurazione di un canale, presa dal primo receiver che lo apre
+struct PEOPLECOUNTERUDP_API FPeopleCounterChannelSettings
+{
+    FString ListenAddress = TEXT("0.0.0.0");
+    int32 ListenPort = 7777;
+    // Porte in piu' sullo stesso canale (un hub per porta); stesso registro e stesse statistiche
+    TArray<int32> AdditionalPorts;
+    // Gruppo multicast a cui iscrivere i socket (vuoto = unicast/broadcast) e scheda di rete
+    // su cui farlo (vuoto = tutte le interfacce scelte dal sistema)
+    FString MulticastGroup;
+    FString MulticastInterface;
+    // Riceve anche i pacchetti inviati al gruppo da questa stessa macchina
+    bool bMulticastLoopback = true;
+    EPeopleCounterReceiveMode ReceiveMode = EPeopleCounterReceiveMode::BlockingThread;
+    int32 ReceiveWaitMilliseconds = 100;
+    EPeopleCounterDispatchMode DispatchMode = EPeopleCounterDispatchMode::PerPacket;
+    bool bParse = true;
+    bool bRawJson = true;
+    bool bLogPackets = false;
+    // Parsing e stato di ogni sorgente su worker del task graph (una FPipe per hub)
+    bool bParallelSources = false;
+    // In una sessione nDisplay con PeopleCounterUDPCluster: riceve solo il primario, tutti i nodi
+    // applicano lo stato replicato nello stesso frame
+    bool bClusterSync = true;
+    int32 MaxQueuedPackets = 1024;
+    int32 MaxPacketsPerFrame = 64;
+    int32 MaxDispatchMicrosecondsPerFrame = 0;
+    int32 PacketPoolSize = 2048;
+    float ResyncCooldownSeconds = 0.5f;
+    // Messaggi a chunk (PCF1): tempo massimo tra il primo e l'ultimo chunk e dimensione massima
+    float ReassemblyTimeoutSeconds = 1.f;
+    int32 MaxMessageBytes = 4 * 1024 * 1024;
+    // Filtro temporale dei conteggi per sensore; SensorFilters per id (unito o dell'hub) lo sostituisce
+    FPeopleCounterFilterSettings CountFilter;
+    TMap<FName, FPeopleCounterFilterSettings> SensorFilters;
+
+    // Chiave di condivisione: un canale per indirizzo, insieme di porte e gruppo multicast
+    FString GetKey() const;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPeopleCounterChannelJson, const FString&);
+// Ritorna true se ha inviato {"cmd":"resync"} all'hub
+DECLARE_DELEGATE_RetVal_TwoParams(bool, FPeopleCounterResyncResponder, FName /*Source*/, const FIPv4Endpoint& /*Sender*/);
+
+// Pipeline di ricezione di una o piu' porte: socket, thread RX, parsing, sequenze/delta, pool,
+// code di dispatch, registri sensori e statistiche. Ogni pacchetto viene parsato una volta
+// e consegnato sul GameThread a tutti i receiver iscritti.
+//
+// Piu' hub possono scrivere sullo stesso canale: ogni sorgente (hub_id, altrimenti ip:porta)
+// ha sequenze, stato dei delta, coda e registro propri; il registro del canale e' la vista unita.
+//
+// Non e' un UObject: vive in UPeopleCounterSubsystem (condiviso, sopravvive alle sessioni PIE)
+// o dentro un singolo receiver (standalone).
+class PEOPLECOUNTERUDP_API FPeopleCounterChannel : public TSharedFromThis<FPeopleCounterChannel, ESPMode::ThreadSafe>
+{
+public:
+    explicit FPeopleCounterChannel(const FPeopleCounterChannelSettings& InSettings);
+    ~FPeopleCounterChannel();
+
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return bRunning; }
+
+    const FPeopleCounterChannelSettings& GetSettings() const { return Settings; }
+    void RegisterSensors(TConstArrayView<FName> SensorIds);
+
+    // --- GameThread: eventi ---
+
+    // Registri gia' aggiornati quando scattano
+    FOnPeopleCountReceivedNative OnPacket;
+    FOnPeopleCounterChannelJson OnJson;
+    // Fine di uno svuotamento delle code (Batched/Coalesced)
+    FSimpleMulticastDelegate OnDrained;
+    // Buco di sequenza: i responder sono interrogati in ordine di iscrizione e si ferma al primo
+    // che invia il resync. Su un canale condiviso un solo resync (e un solo keyframe) per buco.
+    FDelegateHandle AddResyncResponder(FPeopleCounterResyncResponder Responder);
+    void RemoveResyncResponder(FDelegateHandle Handle);
+
+    // Vista unita di tutte le sorgenti. Gli id di un hub con hub_id diventano "HubId.SensorId";
+    // senza hub_id restano quelli dell'hub. Sopravvive a Stop/Start: gli indici restano validi.
+    const TSharedRef<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>& GetSensorRegistry() const { return SensorRegistry; }
+
+    // Registro di una sola sorgente, con gli id originali; nullptr se mai vista
+    TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> GetSourceRegistry(FName Source) const;
+    void GetSources(TArray<FPeopleCounterSourceInfo>& OutSources) const;
+    // Registro di una sorgente, creato se serve; vive quanto il canale
+    FPeopleCounterSensorRegistry* FindOrAddSourceRegistry(FName Name);
+
+    // --- Orologi degli hub (GameThread) ---
+
+    // Stima alimentata dalle risposte pong ai ping del sender; non sincronizzata se mai vista
+    FPeopleCounterClockInfo GetClockInfo(FName Source) const;
+    // Timestamp di quell'hub sull'orologio del motore; false senza stima
+    bool HubToEngineSeconds(FName Source, double HubSeconds, double& OutEngineSeconds) const;
+
+    // --- Filtro dei conteggi (GameThread) ---
+
+    // Registri, pacchetti e replica portano i conteggi filtrati; questo e' l'ultimo grezzo dell'hub
+    int32 GetRawCount(int32 Slot) const;
+    bool IsCountFilterActive() const { return CountFilter.IsActive(); }
+
+    // --- Cluster (GameThread) ---
+
+    // Vero se questo nodo riceve lo stato dal primario invece che dai socket
+    bool IsClusterSecondary() const { return bRunning && ClusterBridge && bClusterSecondary; }
+    bool IsClusterReplicated() const { return bRunning && ClusterBridge; }
+
+    // Pacchetto arrivato dal bridge: Slot (registro unito) e SourceSlot gia' risolti su questo nodo.
+    // Aggiorna i registri e scatta OnPacket come un dispatch locale.
+    void ApplyReplicatedPacket(const FPeopleCountPacket& Packet, bool bQualifiedIds);
+    // Fine dei pacchetti replicati di un frame: OnDrained
+    void EndReplicatedBatch();
+
+    // --- Registrazione e replay (GameThread) ---
+
+    // Ogni datagram ricevuto (anche dal replay) finisce nel file col suo istante di arrivo
+    bool StartRecording(const FString& Path);
+    void StopRecording();
+    bool IsRecording() const;
+    FPeopleCounterSessionRecorder& GetRecorder() const { return *Recorder; }
+
+    // Rimanda una registrazione (o un events.ndjson dell'hub) nella pipeline come se arrivasse dai
+    // socket, con i mittenti originali. Speed 1 = tempo reale, <= 0 = il piu' in fretta possibile
+    // senza perdere pacchetti. Il canale deve essere avviato (non su un secondario del cluster).
+    bool StartReplay(const FString& Path, float Speed = 1.f, bool bLoop = false);
+    void StopReplay();
+    bool IsReplaying() const;
+
+    // --- Statistiche ---
+
+    FPeopleCounterReceiverStats GetStats() const;
+    void ResetStats();
+    int64 GetQueueOverflowCount() const { return QueueOverflowCount.Load(); }
+    int64 GetSupersededPacketCount() const { return SupersededPacketCount.Load(); }
+    int64 GetPacketPoolExhaustedCount() const { return PacketPoolExhaustedCount.Load(); }
+    int64 GetSequenceGapCount() const { return SequenceGapCount.Load(); }
+    int64 GetDiscardedDeltaCount() const { return DiscardedDeltaCount.Load(); }
+    void RecordRequestRoundTrip(double RoundTripMs);
+    void RecordRequestTimeout() { ++RequestTimeouts; }
+
+private:
+    FPeopleCounterChannelSettings Settings;
+
+    // Un socket per porta, ognuno con il suo thread (uno dei due, secondo ReceiveMode)
+    TArray<FSocket*> ListenSockets;
+    TArray<TUniquePtr<FPeopleCounterReceiveWorker>> ReceiveWorkers;
+    TArray<TUniquePtr<FUdpSocketReceiver>> SocketReceivers;
+    bool bRunning = false;
+    // Cambia a ogni Start: il drain si accorge di uno Stop/Start fatto da un listener
+    uint32 RunGeneration = 0;
+    // Piu' porte = piu' thread RX: lo stato di ogni sorgente passa comunque dalla sua pipe
+    bool bUsePipes = false;
+    // Bridge del cluster per questa esecuzione; nullptr senza replica
+    IPeopleCounterClusterBridge* ClusterBridge = nullptr;
+    bool bClusterSecondary = false;
+    FTSTicker::FDelegateHandle DrainTickerHandle;
+
+    // Vive quanto il canale: i thread RX lo usano senza sincronizzarsi con Start/StopRecording
+    TUniquePtr<FPeopleCounterSessionRecorder> Recorder;
+    // Un thread in piu' che chiama HandleDatagram; fermato in Stop prima delle sorgenti
+    TUniquePtr<FPeopleCounterSessionReplay> Replay;
+
+    // Un datagram pronto per il GameThread; vive nel pool e viene riempito sul posto
+    struct FReceivedPacket
+    {
+        FString            Json;
+        FPeopleCountPacket Packet;
+        FIPv4Endpoint      Endpoint;
+        // Copia del datagram: JSON convertito al dispatch (Coalesced) o parsing su un worker
+        TArray<uint8>      RawBytes;
+        // Registro della sorgente (vive quanto il canale)
+        FPeopleCounterSensorRegistry* SourceRegistry = nullptr;
+        bool               bParsed = false;
+        bool               bDeferredJson = false;
+        // delta_counts in Coalesced: Json = stato completo come snapshot_counts, costruito al dispatch
+        bool               bSnapshotJson = false;
+        // Id qualificati con l'hub nel registro unito
+        bool               bQualifiedIds = false;
+        // FPlatformTime::Seconds() all'uscita dal socket
+        double             ArrivalSeconds = 0.0;
+
+        // Un messaggio a chunk fino a MaxMessageBytes non resta residente in ogni pacchetto del pool
+        static constexpr int32 MaxRetainedBytes = 256 * 1024;
+        void TrimForPool()
+        {
+            if (RawBytes.Max() > MaxRetainedBytes)
+            {
+                RawBytes.Empty();
+            }
+            if (Json.GetCharArray().Max() > MaxRetainedBytes)
+            {
+                Json.Empty();
+            }
+        }
+    };
+    using FPacketPool = TPeopleCounterObjectPool<FReceivedPacket>;
+
+    // Il thread RX acquisisce, il GameThread rilascia dopo il dispatch
+    TSharedPtr<FPacketPool, ESPMode::ThreadSafe> PacketPool;
+    TAtomic<int64> PacketPoolExhaustedCount { 0 };
+    TAtomic<int64> QueueOverflowCount { 0 };
+    TAtomic<int64> SupersededPacketCount { 0 };
+
+    // Ricostruzione dei delta; solo chi elabora la sorgente (thread RX o la sua pipe)
+    struct FSourceStreamState
+    {
+        int64  HighestSequence = -1;
+        double LastArrivalSeconds = -1.0;
+        double LastHubTimestamp = 0.0;
+        int64  LastSequence = -1;
+        bool   bSynced = false;
+        double LastResyncRequestSeconds = -1.0;
+        // Stato completo ricostruito e indice slot -> posizione in StateSensors
+        TArray<FPeopleCountSensor> StateSensors;
+        TArray<int32> StateIndexBySlot;
+    };
+
+    // Un mittente. Creato dal thread RX al primo datagram, distrutto in Stop.
+    struct FSource
+    {
+        FIPv4Endpoint Endpoint;
+        FName EndpointName;
+        // hub_id appena l'hub lo invia, prima EndpointName
+        FName Name;
+        bool bQualified = false;
+        FPeopleCounterSensorRegistry* Registry = nullptr;
+        // Slot del registro della sorgente -> slot del registro unito
+        TArray<int32> MergedSlotBySourceSlot;
+        FSourceStreamState Stream;
+        TArray<TPeopleCountSensorView<UTF8CHAR>> FastParseScratch;
+        TArray<FVector2f> FastParsePointScratch;
+
+        // Messaggi a chunk in ricostruzione, direttamente nel RawBytes di un pacchetto del pool.
+        // Sotto ReassemblyLock: lo stesso mittente puo' arrivare da piu' thread RX (AdditionalListenPorts).
+        struct FReassembly
+        {
+            uint32 MessageId = 0;
+            FReceivedPacket* Packet = nullptr;
+            TBitArray<> ChunksReceived;
+            int32 ChunkCount = 0;
+            int32 ChunksPending = 0;
+            // Dimensione dei chunk tranne l'ultimo, nota dal primo chunk che la determina (0 = non ancora)
+            int32 ChunkSize = 0;
+            double FirstArrivalSeconds = 0.0;
+        };
+        // Oltre, il messaggio piu' vecchio viene abbandonato
+        static constexpr int32 MaxReassemblies = 4;
+        FCriticalSection ReassemblyLock;
+        TArray<FReassembly, TInlineAllocator<MaxReassemblies>> Reassemblies;
+        // Letto senza lock per saltare la scadenza quando non c'e' niente in ricostruzione
+        TAtomic<int32> NumReassembling { 0 };
+        // Serializza il lavoro della sorgente sui worker; nullptr senza bUsePipes
+        TUniquePtr<UE::Tasks::FPipe> Pipe;
+
+        // Sorgente (producer) -> GameThread (consumer)
+        TUniquePtr<TCircularQueue<FReceivedPacket*>> PendingPackets;
+        // Coalesced: ultimo snapshot non ancora consegnato
+        TAtomic<FReceivedPacket*> Latest { nullptr };
+
+        // Letti da GetSources sul GameThread
+        TAtomic<int64> PacketsReceived { 0 };
+        TAtomic<int64> CountsReceived { 0 };
+        TAtomic<int64> SequenceGaps { 0 };
+        TAtomic<int64> LastSequence { -1 };
+        TAtomic<bool>  bSynced { false };
+        TAtomic<int64> JitterMicros { 0 };
+
+        ~FSource();
+    };
+    // Mittente e provenienza: i datagram del replay hanno sorgenti loro, mai condivise con un
+    // thread RX reale che riceve dallo stesso indirizzo (coda a produttore singolo, sequenza, chunk)
+    struct FSourceKey
+    {
+        FIPv4Endpoint Endpoint;
+        bool bReplayed = false;
+
+        bool operator==(const FSourceKey& Other) const { return bReplayed == Other.bReplayed && Endpoint == Other.Endpoint; }
+        friend uint32 GetTypeHash(const FSourceKey& Key) { return HashCombine(GetTypeHash(Key.Endpoint), Key.bReplayed ? 1u : 0u); }
+    };
+    // Inserimenti dai thread RX (write lock), letture da tutti
+    TMap<FSourceKey, TUniquePtr<FSource>> Sources;
+    mutable FRWLock SourcesLock;
+
+    // Registri per sorgente, per nome: un hub che riparte su un'altra porta ritrova il suo
+    TMap<FName, TSharedRef<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>> SourceRegistries;
+    mutable FRWLock SourceRegistriesLock;
+
+    TAtomic<int64> SequenceGapCount { 0 };
+    TAtomic<int64> DiscardedDeltaCount { 0 };
+    TAtomic<int64> ReassembledMessageCount { 0 };
+    TAtomic<int64> ReassemblyFailureCount { 0 };
+
+    // Contatori scritti dai thread RX/worker, letti da GetStats
+    TAtomic<int64> PacketsReceivedCount { 0 };
+    TAtomic<int64> BytesReceivedCount { 0 };
+    TAtomic<int64> ParseFailureCount { 0 };
+    TAtomic<int64> OutOfOrderCount { 0 };
+    TAtomic<int64> DuplicateCount { 0 };
+    TAtomic<int64> InterArrivalMicrosSum { 0 };
+    TAtomic<int64> InterArrivalSamples { 0 };
+    // Finestra del contatore Packets/s, condivisa dai thread RX
+    TAtomic<int64> RateWindowStartMicros { 0 };
+    TAtomic<int32> RateWindowPackets { 0 };
+    double StatsStartSeconds = 0.0;
+
+    // Latenza misurata al dispatch; solo GameThread
+    static constexpr int32 NumLatencyBuckets = 12;
+    int64  LatencyBuckets[NumLatencyBuckets + 1] = {};
+    int64  LatencySamples = 0;
+    double LatencySumMs = 0.0;
+    double LatencyMinMs = 0.0;
+    double LatencyMaxMs = 0.0;
+
+    // Solo GameThread
+    TArray<TPair<FDelegateHandle, FPeopleCounterResyncResponder>> ResyncResponders;
+
+    // Round trip comando -> risposta; solo GameThread
+    int64  RequestsAnswered = 0;
+    int64  RequestTimeouts = 0;
+    double RoundTripSumMs = 0.0;
+    double RoundTripMinMs = 0.0;
+    double RoundTripMaxMs = 0.0;
+
+    // Tempo del GameThread nei dispatch (listener compresi); solo GameThread
+    int64  DispatchFrames = 0;
+    double DispatchTotalMs = 0.0;
+    double DispatchMaxMs = 0.0;
+    uint64 DispatchFrameNumber = 0;
+    double FrameDispatchMs = 0.0;
+
+    // Un orologio per hub, per nome come i registri; solo GameThread
+    TMap<FName, FPeopleCounterClockEstimator> ClockBySource;
+
+    // Filtro per slot del registro unito, prima dell'inoltro al cluster; solo GameThread.
+    // Per slot anche la sorgente che lo scrive: un delta riporta gli slot ancora in movimento
+    // solo se sono della sua sorgente.
+    FPeopleCounterCountFilter CountFilter;
+    TBitArray<> FilterResolved;
+    TBitArray<> FilterInPacket;
+    TArray<FPeopleCounterSensorRegistry*> FilterSourceRegistry;
+    TArray<int32> FilterSourceSlot;
+    // Slot del filtro per sorgente: un pacchetto fa avanzare solo i sensori del suo hub
+    TMap<FPeopleCounterSensorRegistry*, TArray<int32>> FilterSlotsBySource;
+    TArray<int32> FilterChanged;
+
+    TSharedRef<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> SensorRegistry = MakeShared<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>();
+
+    // Storage del parser veloce per sorgente; pacchetti piu' grandi passano dal DOM
+    static constexpr int32 FastParseMaxSensors = 2048;
+    static constexpr int32 FastParseMaxPoints = 8192;
+
+    // Riutilizzati tra i frame; solo GameThread
+    TArray<FSource*> DrainSources;
+    TArray<FReceivedPacket*> DrainedCoalesced;
+
+    bool CreateSockets();
+    void DestroySockets();
+
+    // Callback esatta per FUdpSocketReceiver
+    void HandlePacket(const FArrayReaderPtr& Data, const FIPv4Endpoint& Endpoint);
+    // Callback dei thread RX e del replay: Data vale solo durante la chiamata
+    void HandleDatagram(const uint8* Data, int32 Num, const FIPv4Endpoint& Endpoint, bool bReplayed);
+
+    // Thread RX
+    FSource& FindOrAddSource(const FIPv4Endpoint& Endpoint, bool bReplayed);
+    void UpdateRateWindow();
+    void HandleFragment(FSource& Source, const FIPv4Endpoint& Endpoint, double ArrivalSeconds, const uint8* Data, int32 Num);
+    void ExpireReassemblies(FSource& Source, double NowSeconds);
+    void AbandonReassembly(FSource& Source, FSource::FReassembly& Reassembly);
+    // Datagram o messaggio ricostruito gia' in RawBytes: elaborato nel contesto della sorgente
+    void ProcessOwnedPacket(FSource& Source, FReceivedPacket* Received);
+    void DropInSourceContext(FSource& Source);
+
+    // Contesto della sorgente (thread RX, o la sua pipe con bUsePipes)
+    void ProcessReceived(FSource& Source, FReceivedPacket* Received, const uint8* Data, int32 Num);
+    void BuildReceivedPacket(FSource& Source, const uint8* Data, int32 Num, FReceivedPacket& Out);
+    void ResolveSource(FSource& Source, FReceivedPacket& Received);
+    void RenameSource(FSource& Source, FName NewName);
+    void StoreCoalesced(FSource& Source, FReceivedPacket* Received);
+    void DropForSource(FSource& Source);
+    // Applica seq/delta; false se il pacchetto va scartato. In Coalesced i delta escono espansi a snapshot.
+    bool ApplySequencing(FSource& Source, FReceivedPacket& Received);
+    void RequestResyncFromSource(FSource& Source);
+    void UpdateStreamStats(FSource& Source, const FReceivedPacket& Received);
+
+    // GameThread
+    bool TickDrain(float DeltaTime);
+    void DispatchReceivedPacket(FReceivedPacket& Received);
+    void RecordDispatchLatency(const FPeopleCountPacket& Packet);
+    void RecordDispatchCost(double Seconds);
+    void HandlePong(const FPeopleCountPacket& Packet);
+    void StampEngineTime(FPeopleCountPacket& Packet) const;
+    void FilterCounts(FReceivedPacket& Received);
+    void ResolveFilterSlot(const FPeopleCountSensor& Sensor, FPeopleCounterSensorRegistry* SourceRegistry);
+    void ApplyToRegistry(const FPeopleCountPacket& Packet, FPeopleCounterSensorRegistry* SourceRegistry, bool bQualifiedIds);
+    void DrainPendingPackets();
+    void DrainCoalescedPackets(const TSharedRef<FPacketPool, ESPMode::ThreadSafe>& Pool, uint32 Generation);
+};
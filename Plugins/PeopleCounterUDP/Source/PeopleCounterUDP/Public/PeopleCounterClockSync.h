@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PeopleCounterTypes.h"
+
+// Stima dell'orologio di un hub rispetto a FPlatformTime::Seconds(), da scambi ping/pong NTP:
+// t0 invio del ping e t3 arrivo del pong (motore), t1 arrivo del ping e t2 partenza del pong (hub).
+//   offset = ((t1 - t0) + (t2 - t3)) / 2    round trip = (t3 - t0) - (t2 - t1)
+// L'errore sull'offset di un campione e' al piu' meta' del suo round trip: si tengono gli ultimi
+// campioni e la retta offset(t) si stima con i minimi quadrati solo su quelli con round trip
+// piu' basso, cosi' la deriva tra i due oscillatori viene seguita senza il rumore della coda di rete.
+//
+// Non thread-safe: il canale la usa solo dal GameThread.
+class PEOPLECOUNTERUDP_API FPeopleCounterClockEstimator
+{
+public:
+    static constexpr int32 MaxSamples = 32;
+
+    // false se il campione e' incoerente (round trip negativo o troppo lungo)
+    bool AddSample(double T0, double T1, double T2, double T3);
+    void Reset();
+
+    bool IsSynced() const { return bSynced; }
+
+    // Orologio dell'hub -> motore; HubSeconds invariato se non sincronizzato
+    double HubToEngineSeconds(double HubSeconds) const;
+    double EngineToHubSeconds(double EngineSeconds) const;
+
+    FPeopleCounterClockInfo GetInfo() const;
+
+private:
+    struct FSample
+    {
+        // Meta' del round trip sull'orologio del motore
+        double EngineSeconds = 0.0;
+        double Offset = 0.0;
+        double RoundTrip = 0.0;
+    };
+    TArray<FSample, TInlineAllocator<MaxSamples>> Samples;
+    int32 NextSample = 0;
+
+    // offset(t) = Offset + Drift * (t - ReferenceSeconds), hub = motore + offset
+    double ReferenceSeconds = 0.0;
+    double Offset = 0.0;
+    double Drift = 0.0;
+    double MinRoundTrip = 0.0;
+    bool bSynced = false;
+
+    void Refit();
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Features/IModularFeature.h"
+#include "PeopleCounterTypes.h"
+
+class FPeopleCounterChannel;
+
+// Replica in cluster (nDisplay): implementata dal plugin PeopleCounterUDPCluster e registrata
+// come modular feature. Senza il plugin, o fuori da una sessione cluster, non esiste e ogni nodo
+// riceve da solo come sempre.
+//
+// Con la replica attiva solo il nodo primario apre i socket; i pacchetti gia' parsati passano al
+// bridge invece di essere applicati, e tornano a tutti i nodi (primario compreso) nello stesso
+// frame tramite FPeopleCounterChannel::ApplyReplicatedPacket.
+class PEOPLECOUNTERUDP_API IPeopleCounterClusterBridge : public IModularFeature
+{
+public:
+    static FName GetModularFeatureName()
+    {
+        static const FName FeatureName(TEXT("PeopleCounterClusterBridge"));
+        return FeatureName;
+    }
+
+    // nullptr se nessun bridge e' registrato
+    static IPeopleCounterClusterBridge* Get();
+
+    virtual ~IPeopleCounterClusterBridge() = default;
+
+    // Vero dentro una sessione cluster, valutato all'avvio di ogni canale
+    virtual bool IsClusterActive() const = 0;
+    virtual bool IsPrimaryNode() const = 0;
+
+    // Primario, GameThread: pacchetto con Slot del registro unito gia' risolti.
+    // bQualifiedIds: gli id nel registro unito portano il prefisso della sorgente.
+    virtual void ForwardPacket(FPeopleCounterChannel& Channel, const FPeopleCountPacket& Packet, bool bQualifiedIds) = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PeopleCounterTypes.h"
+
+// Filtri temporali per molti conteggi indicizzati per slot (registro sensori o aree).
+// Stato in array paralleli per slot e finestre delle mediane in un unico buffer a passo fisso:
+// Step passa gli slot in un solo ciclo, senza un timer o un oggetto per sensore.
+//
+// I campioni sono a tenuta: Step ricampiona anche gli slot non aggiornati dall'ultimo SetInput,
+// cosi' i delta (che riportano solo i sensori cambiati) fanno avanzare mediana e permanenza.
+//
+// Non thread-safe: chi lo possiede lo usa da un solo thread (il GameThread).
+class PEOPLECOUNTERUDP_API FPeopleCounterCountFilter
+{
+public:
+    static constexpr int32 MaxMedianWindow = 15;
+
+    // Profili di filtro; il profilo 0 vale per gli slot senza SetSlotProfile. Azzera lo stato.
+    void SetProfiles(TConstArrayView<FPeopleCounterFilterSettings> InProfiles);
+    void SetSlotProfile(int32 Slot, int32 Profile);
+    // Vero se almeno un profilo e' attivo
+    bool IsActive() const { return bActive; }
+
+    int32 Num() const { return Input.Num(); }
+    void SetNum(int32 NumSlots);
+    void Reset();
+
+    void SetInput(int32 Slot, float Value);
+    float GetInput(int32 Slot) const { return Input.IsValidIndex(Slot) ? Input[Slot] : 0.f; }
+    float GetOutput(int32 Slot) const { return Output.IsValidIndex(Slot) ? Output[Slot] : 0.f; }
+
+    // Un passo di tutti gli slot all'istante Seconds; aggiunge a OutChanged gli slot con uscita cambiata
+    void Step(double Seconds, TArray<int32>& OutChanged);
+    // Solo gli slot indicati (quelli di una sorgente): le finestre degli altri non avanzano al suo ritmo
+    void Step(double Seconds, TConstArrayView<int32> Slots, TArray<int32>& OutChanged);
+
+private:
+    void StepSlot(int32 Slot, double Seconds, TArray<int32>& OutChanged);
+
+    TArray<FPeopleCounterFilterSettings> Profiles;
+    bool bActive = false;
+
+    TArray<uint8> SlotProfile;
+    // Slot mai arrivati restano fermi; Seeded si azzera a ogni cambio di profilo
+    TBitArray<> HasInput;
+    TBitArray<> Seeded;
+    TArray<float> Input;
+    TArray<float> Output;
+    TArray<float> Ema;
+    TArray<double> LastSeconds;
+    // Isteresi: lato dell'ingresso rispetto all'uscita (-1, 0, 1) e da quando
+    TArray<int8> PendingSide;
+    TArray<double> PendingSinceSeconds;
+    // MaxMedianWindow campioni per slot
+    TArray<float> MedianRing;
+    TArray<uint8> MedianHead;
+    TArray<uint8> MedianCount;
+};
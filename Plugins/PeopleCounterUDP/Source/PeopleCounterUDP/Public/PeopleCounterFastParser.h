@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StringView.h"
+
+// Parser a streaming per la forma nota di people_count_v1:
+// {"schema":"people_count_v1","type":...,"timestamp":...,"seq":...,"request_id":...,"hub_id":...,"sensors":[{"id":...,"count":...}]}
+// piu' "t0"/"t1" delle risposte pong e "points":[x,y,...] per sensore (type=detections).
+// Lavora direttamente sul buffer (UTF-8 dal socket o TCHAR) senza allocare:
+// le stringhe sono viste sul buffer sorgente, i sensori vanno nello storage del chiamante.
+
+enum class EPeopleCounterFastParseResult : uint8
+{
+    Ok,
+    // Campi/schema sconosciuti, escape nelle stringhe, storage pieno: usare il parser DOM
+    Unsupported,
+    // JSON non valido
+    Malformed
+};
+
+template <typename CharType>
+struct TPeopleCountSensorView
+{
+    TStringView<CharType> Id;
+    int32 Count = 0;
+    // Punti del sensore in PointStorage
+    int32 FirstPoint = 0;
+    int32 NumPoints = 0;
+};
+
+template <typename CharType>
+struct TPeopleCountPacketView
+{
+    TStringView<CharType> Schema;
+    TStringView<CharType> Type;
+    double Timestamp = 0.0;
+    int64 Sequence = -1;
+    int64 RequestId = -1;
+    double ClockT0 = 0.0;
+    double ClockT1 = 0.0;
+    TStringView<CharType> HubId;
+
+    // Fornito dal chiamante; il parser non lo ridimensiona mai
+    TArrayView<TPeopleCountSensorView<CharType>> SensorStorage;
+    int32 NumSensors = 0;
+    // Come SensorStorage, per i "points"; vuoto = pacchetti con punti al DOM
+    TArrayView<FVector2f> PointStorage;
+    int32 NumPoints = 0;
+
+    TArrayView<const TPeopleCountSensorView<CharType>> GetSensors() const
+    {
+        return TArrayView<const TPeopleCountSensorView<CharType>>(SensorStorage.GetData(), NumSensors);
+    }
+};
+
+namespace PeopleCounter
+{
+    PEOPLECOUNTERUDP_API EPeopleCounterFastParseResult FastParsePacket(FUtf8StringView Json, TPeopleCountPacketView<UTF8CHAR>& Out);
+    PEOPLECOUNTERUDP_API EPeopleCounterFastParseResult FastParsePacket(FStringView Json, TPeopleCountPacketView<TCHAR>& Out);
+}
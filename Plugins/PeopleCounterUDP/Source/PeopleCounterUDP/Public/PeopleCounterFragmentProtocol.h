@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Messaggi piu' grandi di un datagram (JSON o people_count_v2) spezzati in chunk
+// (little-endian, senza padding):
+//
+//   offset  size  campo
+//   0       4     magic "PCF1"
+//   4       4     uint32 message id (per mittente, cresce a ogni messaggio)
+//   8       2     uint16 indice del chunk
+//   10      2     uint16 numero di chunk del messaggio
+//   12      4     uint32 dimensione totale del messaggio
+//   16      4     uint32 offset del chunk nel messaggio
+//   20      ..    byte del chunk
+//
+// Lato Python: struct.pack("<4sIHHII", b"PCF1", msg_id, index, count, total, offset) + chunk
+// I chunk possono arrivare in qualunque ordine; il receiver li copia direttamente nel buffer
+// del messaggio finale e lo elabora come un datagram unico quando sono arrivati tutti.
+namespace PeopleCounter::Fragment
+{
+    constexpr uint8 Magic[4] = { 'P', 'C', 'F', '1' };
+    constexpr int32 HeaderSize = 20;
+
+    struct FHeader
+    {
+        uint32 MessageId = 0;
+        int32 ChunkIndex = 0;
+        int32 ChunkCount = 0;
+        int32 TotalSize = 0;
+        int32 Offset = 0;
+        const uint8* Payload = nullptr;
+        int32 PayloadSize = 0;
+    };
+
+    inline bool IsFragment(const uint8* Data, int32 Num)
+    {
+        return Num >= HeaderSize && FMemory::Memcmp(Data, Magic, sizeof(Magic)) == 0;
+    }
+
+    // Legge l'header e controlla che il chunk stia dentro il messaggio
+    inline bool ParseHeader(const uint8* Data, int32 Num, FHeader& Out)
+    {
+        if (!IsFragment(Data, Num)) return false;
+        auto ReadU16 = [Data](int32 At) { return static_cast<uint32>(Data[At]) | (static_cast<uint32>(Data[At + 1]) << 8); };
+        auto ReadU32 = [Data](int32 At) { return static_cast<uint32>(Data[At]) | (static_cast<uint32>(Data[At + 1]) << 8)
+            | (static_cast<uint32>(Data[At + 2]) << 16) | (static_cast<uint32>(Data[At + 3]) << 24); };
+
+        const uint32 Total = ReadU32(12);
+        const uint32 Offset = ReadU32(16);
+        Out.MessageId = ReadU32(4);
+        Out.ChunkIndex = static_cast<int32>(ReadU16(8));
+        Out.ChunkCount = static_cast<int32>(ReadU16(10));
+        Out.Payload = Data + HeaderSize;
+        Out.PayloadSize = Num - HeaderSize;
+        if (Total == 0 || Total > static_cast<uint32>(MAX_int32) || Out.ChunkCount == 0 || Out.ChunkIndex >= Out.ChunkCount
+            || Out.PayloadSize <= 0 || static_cast<uint64>(Offset) + Out.PayloadSize > Total)
+        {
+            return false;
+        }
+        Out.TotalSize = static_cast<int32>(Total);
+        Out.Offset = static_cast<int32>(Offset);
+        return true;
+    }
+}
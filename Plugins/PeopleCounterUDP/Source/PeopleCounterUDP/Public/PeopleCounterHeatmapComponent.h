@@ -0,0 +1,145 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterHeatmapComponent.generated.h"
+
+class UUDPJsonReceiverComponent;
+class UTexture2D;
+class UMaterialInstanceDynamic;
+
+// Dove finisce l'immagine di un sensore nella heatmap, in UV della texture: rettangolo
+// Origin..Origin+Size ruotato attorno al suo centro
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterHeatmapPlacement
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    FVector2D Origin = FVector2D::ZeroVector;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    FVector2D Size = FVector2D::UnitVector;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    float RotationDegrees = 0.f;
+
+    // Sensori montati a specchio rispetto alla pianta
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    bool bFlipX = false;
+};
+
+// Heatmap di occupazione dai centroidi dei pacchetti detections (hub con --detections).
+// Ogni persona e' una gaussiana sulla griglia CPU; a fine frame, solo se qualcosa e' cambiato,
+// la griglia va in una texture R16F transiente con un unico UpdateTextureRegions. Sostituisce
+// un Actor per persona in Blueprint: il costo dipende dalla risoluzione, non dalla folla.
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PEOPLECOUNTERUDP_API UPeopleCounterHeatmapComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Se vuoto si usa il primo UDPJsonReceiverComponent dello stesso Actor
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Heatmap")
+    TObjectPtr<UUDPJsonReceiverComponent> Receiver;
+
+    // Texel della texture; basse risoluzioni bastano, il filtro bilineare fa il resto
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="PeopleCounter|Heatmap", meta=(ClampMin="4", ClampMax="1024"))
+    int32 ResolutionX = 64;
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="PeopleCounter|Heatmap", meta=(ClampMin="4", ClampMax="1024"))
+    int32 ResolutionY = 64;
+
+    // Id del registro unito (con hub qualificati "Hub.Seriale") -> posizione nella pianta.
+    // Dopo modifiche a runtime chiamare RefreshPlacements.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Heatmap")
+    TMap<FName, FPeopleCounterHeatmapPlacement> SensorPlacements;
+
+    // Sensori senza posizione sull'intera texture; false = ignorati
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Heatmap")
+    bool bIncludeUnplacedSensors = true;
+
+    // Sigma della gaussiana in texel
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Heatmap", meta=(ClampMin="0.25"))
+    float SplatRadius = 1.5f;
+
+    // Valore al centro di una persona isolata
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Heatmap", meta=(ClampMin="0"))
+    float Intensity = 1.f;
+
+    // 0 = solo occupazione attuale; altrimenti scia: ogni texel scende a meta' in questo tempo,
+    // ma mai sotto l'occupazione attuale
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Heatmap", meta=(ClampMin="0"))
+    float DecayHalfLifeSeconds = 0.f;
+
+    // Punti di un sensore senza pacchetti per questo tempo vengono tolti (sensore scollegato)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Heatmap", meta=(ClampMin="0"))
+    float PointTimeoutSeconds = 2.f;
+
+public:
+    UPeopleCounterHeatmapComponent();
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Heatmap")
+    UTexture2D* GetHeatmapTexture() const { return Texture; }
+
+    // Imposta la texture come parametro del materiale
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Heatmap")
+    void BindToMaterial(UMaterialInstanceDynamic* Material, FName ParameterName = TEXT("Heatmap"));
+
+    // Ririsolve SensorPlacements contro il registro sensori
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Heatmap")
+    void RefreshPlacements();
+
+    // Toglie tutti i punti; la texture si svuota al prossimo frame
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Heatmap")
+    void ClearHeatmap();
+
+    // Valore massimo della griglia all'ultimo aggiornamento (per normalizzare nel materiale)
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Heatmap")
+    float GetPeakValue() const { return PeakValue; }
+
+    // Griglia CPU caricata per ultima, riga per riga
+    TConstArrayView<float> GetHeatmapValues() const { return Density; }
+
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+    void HandlePacket(const FPeopleCountPacket& Packet);
+    bool ResolvePlacement(int32 Slot);
+    void RebuildOccupancy();
+    void Splat(float X, float Y);
+    void Upload();
+    void RequestTick();
+
+    FDelegateHandle PacketHandle;
+
+    UPROPERTY(Transient)
+    TObjectPtr<UTexture2D> Texture;
+
+    // Ultimi punti per slot del registro unito, normalizzati come arrivano
+    struct FSlotPoints
+    {
+        TArray<FVector2f> Points;
+        double LastUpdateSeconds = 0.0;
+        // -1 da risolvere, 0 ignorato, 1 risolto
+        int8 State = -1;
+        FPeopleCounterHeatmapPlacement Placement;
+    };
+    TArray<FSlotPoints> Slots;
+
+    // Occupazione attuale e valore mostrato (uguali senza scia)
+    TArray<float> Occupancy;
+    TArray<float> Density;
+    float PeakValue = 0.f;
+    bool bOccupancyDirty = false;
+    bool bNeedsUpload = false;
+
+    // Upload: due buffer di staging, il render thread legge quello in volo mentre si scrive l'altro
+    struct FStagingBuffer;
+    TSharedPtr<FStagingBuffer, ESPMode::ThreadSafe> Staging[2];
+};
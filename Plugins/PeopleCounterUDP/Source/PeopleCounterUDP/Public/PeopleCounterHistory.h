@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Storia a memoria fissa di molte serie campionate insieme (aree, sensori): un campione per
+// serie a ogni Push, gli ultimi Capacity conservati in ring buffer per serie.
+//
+// Per finestre di lunghezza qualsiasi fino a Capacity campioni:
+// - media: somme cumulative nel ring, differenza di due elementi (O(1));
+// - minimo/massimo: code monotone per serie su tutta la capacita' (ammortizzato O(1) per Push),
+//   la finestra e' il loro suffisso con indici recenti, trovato per bisezione (O(log Capacity)).
+//
+// Tutto allocato in Init; Push e query non allocano. Non thread-safe.
+class PEOPLECOUNTERUDP_API FPeopleCounterHistory
+{
+public:
+    void Init(int32 InNumSeries, int32 InCapacity);
+    void Reset();
+
+    int32 NumSeries() const { return Series; }
+    int32 GetCapacity() const { return Capacity; }
+    // Campioni disponibili per una query (al massimo Capacity)
+    int32 NumAvailable() const { return static_cast<int32>(FMath::Min<int64>(NumPushed, Capacity)); }
+
+    // Un campione per tutte le serie; Values ha NumSeries elementi
+    void Push(TConstArrayView<float> Values);
+
+    // Finestre in campioni, ridotte a [1, NumAvailable()]; 0 senza campioni
+    float GetLatest(int32 SeriesIndex) const;
+    float GetAverage(int32 SeriesIndex, int32 WindowSamples) const;
+    float GetMin(int32 SeriesIndex, int32 WindowSamples) const;
+    float GetMax(int32 SeriesIndex, int32 WindowSamples) const;
+    // Campioni fa in cui la finestra ha toccato il massimo (0 = ultimo campione); il piu' recente a pari valore
+    int32 GetMaxAge(int32 SeriesIndex, int32 WindowSamples) const;
+
+private:
+    // Coda monotona di una serie: indici assoluti dei campioni in [Head, Tail) (posizioni % Capacity)
+    struct FMonotonicQueue
+    {
+        TArray<int64> Indices;
+        TArray<int64> Head;
+        TArray<int64> Tail;
+    };
+
+    int32 ClampWindow(int32 WindowSamples) const;
+    float ValueAt(int32 SeriesIndex, int64 SampleIndex) const { return Values[SeriesIndex * Capacity + static_cast<int32>(SampleIndex % Capacity)]; }
+    void PushQueue(FMonotonicQueue& Queue, int32 SeriesIndex, float Value, bool bMax);
+    // Prima posizione della coda con indice >= FirstSample
+    int64 FindInQueue(const FMonotonicQueue& Queue, int32 SeriesIndex, int64 FirstSample) const;
+
+    int32 Series = 0;
+    int32 Capacity = 0;
+    // Campioni inseriti da Init/Reset; l'ultimo ha indice NumPushed - 1
+    int64 NumPushed = 0;
+
+    // [Serie * Capacity + indice % Capacity]
+    TArray<float> Values;
+    // Somma di tutti i campioni fino a quell'indice compreso; Capacity + 1 per serie, cosi'
+    // la somma di una finestra piena ha ancora il suo elemento di partenza
+    TArray<double> Prefix;
+    FMonotonicQueue MaxQueue;
+    FMonotonicQueue MinQueue;
+};
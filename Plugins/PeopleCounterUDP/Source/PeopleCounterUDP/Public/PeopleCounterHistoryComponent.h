@@ -0,0 +1,113 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PeopleCounterHistory.h"
+#include "PeopleCounterHistoryComponent.generated.h"
+
+class UUDPJsonReceiverComponent;
+class UPeopleCounterAreaAggregatorComponent;
+
+// Storia dell'occupazione di aree e sensori per domande su finestre recenti ("area con la
+// media piu' alta negli ultimi 30 s"). Campiona a intervallo fisso i conteggi dell'aggregatore
+// (filtrati, come GetAreaCount) e del registro sensori in FPeopleCounterHistory: memoria fissa
+// decisa in BeginPlay, nessuna allocazione a regime, media in O(1) e min/max in O(log).
+//
+// Le finestre sono in secondi, arrotondate a campioni interi e limitate a HistorySeconds.
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PEOPLECOUNTERUDP_API UPeopleCounterHistoryComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Se vuoti si usano i primi componenti dello stesso Actor; senza aggregatore solo sensori
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|History")
+    TObjectPtr<UUDPJsonReceiverComponent> Receiver;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|History")
+    TObjectPtr<UPeopleCounterAreaAggregatorComponent> Aggregator;
+
+    // Finestra piu' lunga interrogabile
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="PeopleCounter|History", meta=(ClampMin="1"))
+    float HistorySeconds = 300.f;
+
+    // Intervallo tra due campioni di tutte le serie; e' anche la risoluzione delle finestre
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="PeopleCounter|History", meta=(ClampMin="0.01"))
+    float SampleIntervalSeconds = 0.1f;
+
+    // Serie riservate in BeginPlay: aree (per nome, assegnate alla prima comparsa) e sensori (per slot);
+    // le altre non hanno storia. Un'area tolta da RebuildFromTable tiene la sua serie, a 0
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="PeopleCounter|History", meta=(ClampMin="0"))
+    int32 MaxAreas = 64;
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="PeopleCounter|History", meta=(ClampMin="0"))
+    int32 MaxSensors = 256;
+
+public:
+    UPeopleCounterHistoryComponent();
+
+    // Svuota la storia (es. all'inizio di una scena); le finestre ripartono da zero campioni
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|History")
+    void ClearHistory();
+
+    // Secondi di storia disponibili (al massimo HistorySeconds)
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|History")
+    float GetRecordedSeconds() const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|History")
+    float GetAreaAverage(FName Area, float Seconds) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|History")
+    float GetAreaMin(FName Area, float Seconds) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|History")
+    float GetAreaMax(FName Area, float Seconds) const;
+
+    // Massimo della finestra e quanti secondi fa e' stato raggiunto (l'ultima volta)
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|History")
+    bool GetAreaPeak(FName Area, float Seconds, float& OutPeak, float& OutSecondsAgo) const;
+
+    // Area con la media piu' alta nella finestra; false senza aree o se sono rimaste tutte vuote
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|History")
+    bool GetHighestAverageArea(float Seconds, FName& OutArea, float& OutAverage) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|History")
+    float GetSensorAverage(FName SensorId, float Seconds) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|History")
+    float GetSensorMin(FName SensorId, float Seconds) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|History")
+    float GetSensorMax(FName SensorId, float Seconds) const;
+
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|History")
+    bool GetSensorPeak(FName SensorId, float Seconds, float& OutPeak, float& OutSecondsAgo) const;
+
+    const FPeopleCounterHistory& GetHistory() const { return History; }
+    // Serie di un'area o di un sensore in GetHistory(); INDEX_NONE senza storia
+    int32 GetAreaSeries(FName Area) const;
+    int32 GetSensorSeries(FName SensorId) const;
+    int32 SecondsToSamples(float Seconds) const;
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+    void Sample(int32 NumSamples);
+    // Serie per indice d'area dell'aggregatore, rifatte per nome dopo un RebuildFromTable
+    void BindAreaSeries();
+    bool GetPeak(int32 Series, float Seconds, float& OutPeak, float& OutSecondsAgo) const;
+
+    FPeopleCounterHistory History;
+    // Valori del campione corrente, una voce per serie
+    TArray<float> SampleScratch;
+    // Istante (FApp::GetCurrentTime) a cui e' dovuto il prossimo campione; 0 = al prossimo tick
+    double NextSampleSeconds = 0.0;
+
+    TMap<FName, int32> AreaSeriesByName;
+    TArray<int32> SeriesByAreaIndex;
+    bool bAreaSeriesDirty = true;
+    FDelegateHandle AreasRebuiltHandle;
+};
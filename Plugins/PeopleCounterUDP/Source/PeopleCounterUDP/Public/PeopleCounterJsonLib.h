@@ -1,5 +1,7 @@
 #pragma once
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterFastParser.h"
 #include "PeopleCounterJsonLib.generated.h"
 
 UCLASS()
@@ -12,4 +14,17 @@ public:
     static bool ParsePeopleCountPacket(const FString& JsonString,
         TMap<FString, int32>& OutSensors,
         double& OutTimestamp);
+
+    // Come ParsePeopleCountPacket ma nello struct tipizzato; thread-safe (usata anche dal thread RX)
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|JSON")
+    static bool ParsePeopleCountPacketStruct(const FString& JsonString,
+        FPeopleCountPacket& OutPacket);
+
+    // Direttamente sui byte UTF-8 del socket: parser veloce nello Scratch del chiamante,
+    // fallback al DOM per tutto cio' che non e' la forma nota di people_count_v1.
+    // PointScratch vuoto = i pacchetti detections passano dal DOM
+    static bool ParsePeopleCountPacketUtf8(const uint8* Data, int32 Num,
+        TArrayView<TPeopleCountSensorView<UTF8CHAR>> Scratch,
+        FPeopleCountPacket& OutPacket,
+        TArrayView<FVector2f> PointScratch = TArrayView<FVector2f>());
 };
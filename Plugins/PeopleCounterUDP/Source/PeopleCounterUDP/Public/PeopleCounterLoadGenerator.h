@@ -0,0 +1,117 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Math/RandomStream.h"
+#include "PeopleCounterTypes.h"
+
+class FSocket;
+class FInternetAddr;
+class FRunnableThread;
+
+// Profilo di carico di FPeopleCounterLoadGenerator
+struct PEOPLECOUNTERUDP_API FPeopleCounterLoadSettings
+{
+    FString TargetHost = TEXT("127.0.0.1");
+    int32 TargetPort = 7777;
+    // hub_id dei pacchetti (vuoto = nessuno, la sorgente e' ip:porta del generatore)
+    FString HubId;
+    // SENSORE001..SENSORE%03d
+    int32 NumSensors = 3;
+    // people_count_v2 invece di people_count_v1 JSON
+    bool bBinary = false;
+    float PacketsPerSecond = 30.f;
+    // 0 = fino a Stop
+    float DurationSeconds = 10.f;
+    // Frazione di pacchetti delta_counts (solo i sensori cambiati); il primo e' sempre uno snapshot
+    float DeltaFraction = 0.f;
+    // Sensori che cambiano conteggio a ogni pacchetto (passo +-1, tra 0 e MaxCount)
+    int32 ChangesPerPacket = 1;
+    int32 MaxCount = 20;
+    // Raffiche: ogni BurstPeriodSeconds, per BurstSeconds, il ritmo e' moltiplicato per BurstRateMultiplier
+    float BurstPeriodSeconds = 0.f;
+    float BurstSeconds = 0.f;
+    float BurstRateMultiplier = 1.f;
+    // Guasti iniettati: pacchetto numerato ma non inviato, scambiato col successivo, inviato due volte
+    float LossProbability = 0.f;
+    float ReorderProbability = 0.f;
+    float DuplicateProbability = 0.f;
+    // Messaggi piu' grandi partono a chunk PCF1, come --max-datagram dell'hub
+    int32 MaxDatagramBytes = 65000;
+    int32 Seed = 0;
+};
+
+// Generatore di carico sintetico: un thread che scrive pacchetti people_count_v1 (o v2) validi
+// verso una porta, al ritmo del profilo, con raffiche e perdite/riordini/duplicati iniettati.
+// Serve a misurare il limite della pipeline di ricezione senza hub Python e senza sensori.
+//
+// Start/StopAndWait dal GameThread; i contatori si leggono da qualunque thread.
+class PEOPLECOUNTERUDP_API FPeopleCounterLoadGenerator : public FRunnable
+{
+public:
+    explicit FPeopleCounterLoadGenerator(const FPeopleCounterLoadSettings& InSettings);
+    virtual ~FPeopleCounterLoadGenerator() override;
+
+    bool Start();
+    // Attende l'uscita del thread e chiude il socket
+    void StopAndWait();
+    bool IsRunning() const { return Thread && !bFinished; }
+    const FPeopleCounterLoadSettings& GetSettings() const { return Settings; }
+
+    // Prossimo messaggio (prima dei chunk) senza inviarlo: stessi byte del thread, per i benchmark
+    void BuildMessage(TArray<uint8>& OutBytes);
+
+    // Messaggi numerati, datagram passati al socket (chunk e duplicati compresi), guasti iniettati
+    int64 GetGeneratedMessages() const { return GeneratedMessages.Load(); }
+    int64 GetSentDatagrams() const { return SentDatagrams.Load(); }
+    int64 GetSentBytes() const { return SentBytes.Load(); }
+    int64 GetSendFailures() const { return SendFailures.Load(); }
+    int64 GetDroppedMessages() const { return DroppedMessages.Load(); }
+    int64 GetReorderedMessages() const { return ReorderedMessages.Load(); }
+    int64 GetDuplicatedMessages() const { return DuplicatedMessages.Load(); }
+    double GetElapsedSeconds() const;
+
+    // Riga di riepilogo: ritmo ottenuto contro quello richiesto e contatori
+    FString ToString() const;
+
+    // FRunnable
+    virtual uint32 Run() override;
+    virtual void Stop() override { bStopping = true; }
+
+private:
+    // Ritmo del profilo a T secondi dall'avvio (raffiche comprese)
+    float RateAt(double Seconds) const;
+    void StepCounts();
+    void EncodeJson(bool bDelta, TArray<uint8>& OutBytes);
+    void EncodeBinary(bool bDelta, TArray<uint8>& OutBytes);
+    // Un messaggio, a chunk se serve
+    void SendMessage(const TArray<uint8>& Message);
+    void SendDatagram(const uint8* Data, int32 Num);
+
+    FPeopleCounterLoadSettings Settings;
+    FRandomStream Random;
+    TArray<uint16> Counts;
+    // Sensori cambiati dall'ultimo pacchetto (indici in Counts), e flag per non ripeterli
+    TArray<int32> Changed;
+    TBitArray<> ChangedMask;
+    int64 Sequence = 0;
+    uint32 MessageId = 0;
+    FPeopleCountPacket BinaryPacket;
+    TArray<uint8> Chunk;
+
+    FSocket* Socket = nullptr;
+    TSharedPtr<FInternetAddr> TargetAddr;
+    FRunnableThread* Thread = nullptr;
+    double StartSeconds = 0.0;
+    double EndSeconds = 0.0;
+    TAtomic<bool> bStopping { false };
+    TAtomic<bool> bFinished { false };
+
+    TAtomic<int64> GeneratedMessages { 0 };
+    TAtomic<int64> SentDatagrams { 0 };
+    TAtomic<int64> SentBytes { 0 };
+    TAtomic<int64> SendFailures { 0 };
+    TAtomic<int64> DroppedMessages { 0 };
+    TAtomic<int64> ReorderedMessages { 0 };
+    TAtomic<int64> DuplicatedMessages { 0 };
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterRateControllerComponent.generated.h"
+
+class UUDPJsonReceiverComponent;
+class UUDPJsonSenderComponent;
+
+// Perche' il controller ha scelto l'intervallo corrente
+UENUM(BlueprintType)
+enum class EPeopleCounterRateReason : uint8
+{
+    // Nessuna valutazione ancora, o controller spento
+    Idle,
+    // Nessun pacchetto nella finestra: intervallo invariato
+    NoData,
+    // Dentro la banda: intervallo invariato
+    Hold,
+    // Margine su latenza e budget: piu' veloce
+    Headroom,
+    // Overflow delle code o pacchetti persi nella finestra
+    Drops,
+    // Troppi pacchetti in attesa del GameThread
+    QueueDepth,
+    // Dispatch oltre il budget per frame del GameThread
+    DispatchBudget,
+    // L'hub pubblica piu' lentamente dell'intervallo chiesto (GPU o cattura saturi)
+    HubSaturated,
+    // Latenza (o round trip dei comandi) oltre l'obiettivo
+    Latency,
+    // Impostato a mano con SetCaptureInterval
+    Manual
+};
+
+// Ultima decisione e le misure della finestra che l'hanno prodotta (debug, HUD)
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterRateDecision
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    float IntervalSeconds = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    EPeopleCounterRateReason Reason = EPeopleCounterRateReason::Idle;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    float WindowSeconds = 0.f;
+
+    // Snapshot/delta completi al secondo per hub attivo, e quanti hub li hanno inviati nella finestra
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    float ArrivalsPerSecond = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    int32 ActiveSources = 0;
+
+    // p95 della latenza hub -> dispatch nella finestra (limite del bucket), o round trip medio dei comandi se maggiore
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    float LatencyMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    float RoundTripMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    int32 QueueDepth = 0;
+
+    // Overflow delle code e pacchetti persi nella finestra
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    int64 Drops = 0;
+
+    // Tempo medio di dispatch per frame del GameThread nella finestra
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Rate")
+    float DispatchMsPerFrame = 0.f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnCaptureIntervalChanged, float, IntervalSeconds, EPeopleCounterRateReason, Reason);
+
+// Controller dell'intervallo di cattura dell'hub: resta fermo finche' il Sender non ha una cattura
+// programmata o l'hub non riporta un timer acceso (hub solo su comando = niente da governare).
+// Poi ogni ControlPeriodSeconds legge le
+// statistiche del Receiver nella finestra appena passata (arrivi, code, perdite, latenza,
+// costo del dispatch sul GameThread, round trip dei comandi) e manda {"cmd":"set_interval"}
+// con il Sender (o cambia il periodo della sua cattura programmata). Sovraccarico = intervallo moltiplicato per BackoffFactor; margine su tutti i
+// limiti = moltiplicato per SpeedupFactor; in mezzo resta fermo. Sempre tra Min e Max.
+// In EndPlay rimette l'intervallo trovato all'attivazione.
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PEOPLECOUNTERUDP_API UPeopleCounterRateControllerComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Se vuoti si usano i primi componenti dello stesso Actor
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate")
+    TObjectPtr<UUDPJsonReceiverComponent> Receiver;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate")
+    TObjectPtr<UUDPJsonSenderComponent> Sender;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate")
+    bool bEnabled = true;
+
+    // Limiti dell'intervallo scelto; InitialIntervalSeconds e' il primo inviato, alla prima finestra
+    // in cui c'e' un ritmo da governare (cattura programmata del Sender o timer dell'hub acceso)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0.01"))
+    float MinIntervalSeconds = 0.1f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0.01"))
+    float MaxIntervalSeconds = 2.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0.01"))
+    float InitialIntervalSeconds = 0.5f;
+
+    // Obiettivo sulla latenza hub -> dispatch (p95) e sul round trip dei comandi
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="1"))
+    float TargetLatencyMs = 150.f;
+
+    // Budget medio del GameThread per i dispatch del canale (listener compresi), per frame
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0.01"))
+    float DispatchBudgetMs = 2.f;
+
+    // Pacchetti in attesa del GameThread oltre cui si rallenta
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="1"))
+    int32 MaxQueueDepth = 16;
+
+    // Un hub che arriva sotto questa frazione del ritmo chiesto e' saturo
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0.1", ClampMax="1"))
+    float HubSaturationRatio = 0.8f;
+
+    // Banda morta attorno agli obiettivi (frazione): si accelera solo sotto (1 - banda)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0", ClampMax="0.9"))
+    float Hysteresis = 0.25f;
+
+    // Durata di una finestra di misura e di una decisione
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0.25"))
+    float ControlPeriodSeconds = 2.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="1.01"))
+    float BackoffFactor = 1.5f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0.1", ClampMax="0.99"))
+    float SpeedupFactor = 0.85f;
+
+    // Reinvio dell'intervallo corrente anche senza cambi (hub riavviato); 0 = mai
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter|Rate", meta=(ClampMin="0"))
+    float ResendSeconds = 30.f;
+
+    UPROPERTY(BlueprintAssignable, Category="PeopleCounter|Rate")
+    FOnCaptureIntervalChanged OnCaptureIntervalChanged;
+
+public:
+    UPeopleCounterRateControllerComponent();
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Rate")
+    const FPeopleCounterRateDecision& GetDecision() const { return Decision; }
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="PeopleCounter|Rate")
+    float GetCaptureInterval() const { return Decision.IntervalSeconds; }
+
+    // Invia subito l'intervallo (limitato a Min/Max); con bEnabled il controller riparte da li'
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter|Rate")
+    void SetCaptureInterval(float IntervalSeconds);
+
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+    // Misure cumulative del Receiver all'inizio della finestra
+    struct FBaseline
+    {
+        double Seconds = 0.0;
+        uint64 Frame = 0;
+        int64 PacketsReceived = 0;
+        int64 Drops = 0;
+        int64 LatencySamples = 0;
+        TArray<int64> LatencyBuckets;
+        int64 RequestsAnswered = 0;
+        double RoundTripTotalMs = 0.0;
+        double DispatchTotalMs = 0.0;
+        TMap<FName, int64> SourceCounts;
+    };
+
+    // Vero se c'e' un ritmo da governare; all'attivazione salva l'intervallo originale
+    bool TryActivate();
+    // Rimette l'intervallo originale a chi lo governava (schedule o timer dell'hub)
+    void ReleaseControl();
+    void Evaluate();
+    void TakeBaseline(const FPeopleCounterReceiverStats& Stats, FBaseline& Out) const;
+    void ApplyInterval(float IntervalSeconds, EPeopleCounterRateReason Reason);
+    bool SendInterval();
+
+    FPeopleCounterRateDecision Decision;
+    FBaseline Baseline;
+    bool bHasBaseline = false;
+    double LastSentSeconds = 0.0;
+
+    bool bActive = false;
+    // Attivato sulla cattura programmata (true) o sul timer dell'hub
+    bool bControlsSchedule = false;
+    float OriginalIntervalSeconds = 0.f;
+    double LastIntervalQuerySeconds = -1.0;
+};
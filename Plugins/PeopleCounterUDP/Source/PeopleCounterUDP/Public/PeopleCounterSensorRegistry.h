@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PeopleCounterTypes.h"
+
+// Registro persistente dei sensori: ogni id viene internato una volta e riceve
+// uno slot denso e stabile. I conteggi stanno in un array piatto indicizzato per slot,
+// quindi a regime un aggiornamento non fa lavoro sulle stringhe.
+//
+// Slot e id sono thread-safe (il thread RX risolve gli slot durante il parsing);
+// i conteggi sono stato del GameThread.
+class PEOPLECOUNTERUDP_API FPeopleCounterSensorRegistry
+{
+public:
+    int32 FindOrAddSlot(FName Id);
+    int32 FindSlot(FName Id) const;
+
+    // Assegna Sensor.Slot a tutti i sensori del pacchetto (un solo lock in lettura a regime)
+    void ResolveSlots(TArrayView<FPeopleCountSensor> Sensors);
+
+    FName GetSensorId(int32 Slot) const;
+    FString GetSerial(int32 Slot) const;
+    int32 Num() const;
+    void GetSensorIds(TArray<FName>& OutIds) const;
+
+    // Dalla risposta list_sensors: l'hub numera SENSORE001.. sui seriali ordinati.
+    // IdPrefix qualifica gli id nel registro unito di piu' hub ("Sala1.SENSORE001").
+    void SeedFromSerials(TConstArrayView<FString> Serials, FStringView IdPrefix = FStringView());
+
+    // --- GameThread ---
+    void SetCount(int32 Slot, int32 Count);
+    int32 GetCount(int32 Slot) const { return Counts.IsValidIndex(Slot) ? Counts[Slot] : 0; }
+    TConstArrayView<int32> GetCounts() const { return Counts; }
+
+private:
+    int32 AddSlotLocked(FName Id);
+
+    mutable FRWLock Lock;
+    TMap<FName, int32> SlotById;
+    TArray<FName> Ids;
+    TArray<FString> Serials;
+
+    // Solo GameThread; cresce alla prima scrittura di uno slot nuovo
+    TArray<int32> Counts;
+};
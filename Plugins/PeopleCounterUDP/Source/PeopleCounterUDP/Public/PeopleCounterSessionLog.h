@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+
+// Registrazione dei datagram ricevuti (little-endian, senza padding):
+//
+//   file    offset  size  campo
+//           0       4     magic "PCRL"
+//           4       2     uint16 versione (1)
+//           6       2     uint16 riservato
+//           8       8     double inizio della registrazione, secondi Unix (UTC)
+//   record  0       4     uint32 dimensione del datagram
+//           4       8     double arrivo, secondi dall'inizio della registrazione
+//           12      4     uint32 indirizzo IPv4 del mittente
+//           16      2     uint16 porta del mittente
+//           18      2     uint16 riservato
+//           20      ..    byte del datagram, cosi' come sono arrivati (anche i chunk PCF1)
+//
+// Lato Python: struct.unpack_from("<IdIHH", buf, off) per l'header di un record.
+// Un file troncato (crash durante la registrazione) vale fino all'ultimo record completo.
+// I campi si copiano come valori nativi: le piattaforme di destinazione sono tutte little-endian.
+namespace PeopleCounter::SessionLog
+{
+    constexpr uint8 Magic[4] = { 'P', 'C', 'R', 'L' };
+    constexpr uint16 Version = 1;
+    constexpr int32 FileHeaderSize = 16;
+    constexpr int32 RecordHeaderSize = 20;
+
+    struct FRecord
+    {
+        double ArrivalSeconds = 0.0;
+        FIPv4Endpoint Sender;
+        const uint8* Data = nullptr;
+        int32 Num = 0;
+    };
+
+    // Percorsi relativi sotto Saved/PeopleCounter
+    PEOPLECOUNTERUDP_API FString ResolvePath(const FString& Path);
+
+    inline bool IsSessionLog(const uint8* Data, int64 Num)
+    {
+        return Num >= FileHeaderSize && FMemory::Memcmp(Data, Magic, sizeof(Magic)) == 0;
+    }
+
+    inline void WriteFileHeader(TArray<uint8>& Out, double StartUnixSeconds)
+    {
+        const int32 At = Out.AddUninitialized(FileHeaderSize);
+        const uint16 Reserved = 0;
+        FMemory::Memcpy(&Out[At], Magic, 4);
+        FMemory::Memcpy(&Out[At + 4], &Version, 2);
+        FMemory::Memcpy(&Out[At + 6], &Reserved, 2);
+        FMemory::Memcpy(&Out[At + 8], &StartUnixSeconds, 8);
+    }
+
+    inline void AppendRecord(TArray<uint8>& Out, double ArrivalSeconds, const FIPv4Endpoint& Sender, const uint8* Data, int32 Num)
+    {
+        const int32 At = Out.AddUninitialized(RecordHeaderSize + Num);
+        const uint32 Size = static_cast<uint32>(Num);
+        const uint32 Address = Sender.Address.Value;
+        const uint16 Port = Sender.Port;
+        const uint16 Reserved = 0;
+        FMemory::Memcpy(&Out[At], &Size, 4);
+        FMemory::Memcpy(&Out[At + 4], &ArrivalSeconds, 8);
+        FMemory::Memcpy(&Out[At + 12], &Address, 4);
+        FMemory::Memcpy(&Out[At + 16], &Port, 2);
+        FMemory::Memcpy(&Out[At + 18], &Reserved, 2);
+        FMemory::Memcpy(&Out[At + RecordHeaderSize], Data, Num);
+    }
+
+    inline bool ParseFileHeader(const uint8* Data, int64 Num, double& OutStartUnixSeconds)
+    {
+        if (!IsSessionLog(Data, Num)) return false;
+        uint16 FileVersion = 0;
+        FMemory::Memcpy(&FileVersion, Data + 4, 2);
+        FMemory::Memcpy(&OutStartUnixSeconds, Data + 8, 8);
+        return FileVersion == Version;
+    }
+
+    // Record che inizia a InOutOffset; avanza al successivo. false alla fine o su un record troncato.
+    inline bool ReadRecord(const uint8* Data, int64 Num, int64& InOutOffset, FRecord& Out)
+    {
+        if (InOutOffset < 0 || Num - InOutOffset < RecordHeaderSize) return false;
+        const uint8* Header = Data + InOutOffset;
+        uint32 Size = 0;
+        uint32 Address = 0;
+        uint16 Port = 0;
+        FMemory::Memcpy(&Size, Header, 4);
+        FMemory::Memcpy(&Out.ArrivalSeconds, Header + 4, 8);
+        FMemory::Memcpy(&Address, Header + 12, 4);
+        FMemory::Memcpy(&Port, Header + 16, 2);
+        if (Size > static_cast<uint32>(MAX_int32) || Num - InOutOffset - RecordHeaderSize < static_cast<int64>(Size)) return false;
+        Out.Sender = FIPv4Endpoint(FIPv4Address(Address), Port);
+        Out.Data = Header + RecordHeaderSize;
+        Out.Num = static_cast<int32>(Size);
+        InOutOffset += RecordHeaderSize + Size;
+        return true;
+    }
+}
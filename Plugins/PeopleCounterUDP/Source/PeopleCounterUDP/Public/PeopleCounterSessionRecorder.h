@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Tasks/Pipe.h"
+
+class IFileHandle;
+
+// Scrive su file (formato PeopleCounterSessionLog.h) ogni datagram ricevuto da un canale, col suo
+// istante di arrivo. I thread RX copiano il datagram in un buffer sotto lock (nessun I/O sul loro
+// percorso); un ticker del GameThread scambia il buffer e lo scrive su disco da un task in pipe.
+//
+// Start/Stop dal GameThread, Append da qualunque thread.
+class PEOPLECOUNTERUDP_API FPeopleCounterSessionRecorder
+{
+public:
+    ~FPeopleCounterSessionRecorder();
+
+    bool Start(const FString& Path);
+    // Scrive quanto resta e chiude il file
+    void Stop();
+    bool IsRecording() const { return bRecording.Load(EMemoryOrder::Relaxed); }
+    const FString& GetPath() const { return Path; }
+
+    // ArrivalSeconds su FPlatformTime::Seconds(), come FPeopleCountPacket::ReceivedSeconds
+    void Append(const uint8* Data, int32 Num, const FIPv4Endpoint& Sender, double ArrivalSeconds);
+
+    int64 GetRecordedPackets() const { return RecordedPackets.Load(); }
+    int64 GetDroppedPackets() const { return DroppedPackets.Load(); }
+
+private:
+    bool Tick(float DeltaTime);
+    void Flush();
+
+    FString Path;
+    TAtomic<bool> bRecording { false };
+    double StartSeconds = 0.0;
+
+    // Datagram non ancora scritti; i thread RX aggiungono qui
+    FCriticalSection PendingLock;
+    TArray<uint8> Pending;
+    // Buffer gia' scritti, pronti per essere riusati (stesso lock)
+    TArray<TArray<uint8>> SpareBuffers;
+
+    // Solo i task di WritePipe scrivono su File; Stop aspetta che la pipe sia vuota
+    TUniquePtr<IFileHandle> File;
+    UE::Tasks::FPipe WritePipe { TEXT("PeopleCounterSessionRecorder") };
+    TAtomic<int64> QueuedBytes { 0 };
+    FTSTicker::FDelegateHandle TickerHandle;
+
+    TAtomic<int64> RecordedPackets { 0 };
+    TAtomic<int64> DroppedPackets { 0 };
+};
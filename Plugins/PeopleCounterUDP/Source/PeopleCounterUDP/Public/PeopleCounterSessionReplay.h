@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "PeopleCounterSessionLog.h"
+
+class FRunnableThread;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// Datagram valido solo durante la callback (punta nel file mappato)
+DECLARE_DELEGATE_ThreeParams(FOnPeopleCounterReplayDatagram, const uint8* /*Data*/, int32 /*Num*/, const FIPv4Endpoint& /*Sender*/);
+// false = la pipeline e' piena: il thread aspetta e riprova (solo a velocita' massima)
+DECLARE_DELEGATE_RetVal(bool, FOnPeopleCounterReplayCanSend);
+
+// Sorgente di replay: rimanda i datagram di una registrazione (PeopleCounterSessionLog.h) con i
+// tempi originali moltiplicati per la velocita', o di fila il piu' in fretta possibile.
+// Le registrazioni vengono mappate in memoria: nessuna copia e nessuna lettura durante il replay.
+// Accetta anche l'events.ndjson dell'hub (--save-frames): ogni riga diventa uno snapshot_counts
+// da 127.0.0.1:0 al suo istante "t", convertito una volta in memoria all'apertura.
+class PEOPLECOUNTERUDP_API FPeopleCounterSessionReplay : public FRunnable
+{
+public:
+    FPeopleCounterSessionReplay();
+    virtual ~FPeopleCounterSessionReplay() override;
+
+    // GameThread, prima di Start
+    bool Open(const FString& Path);
+    int32 NumRecords() const { return RecordCount; }
+    double GetDurationSeconds() const { return DurationSeconds; }
+    const FString& GetPath() const { return Path; }
+
+    // Tutti i record in ordine, senza thread (benchmark del parsing su una sessione reale)
+    void ForEachRecord(TFunctionRef<void(const PeopleCounter::SessionLog::FRecord&)> Visitor) const;
+
+    FOnPeopleCounterReplayDatagram& OnDatagram() { return DatagramDelegate; }
+    FOnPeopleCounterReplayCanSend& OnCanSend() { return CanSendDelegate; }
+
+    // Speed 1 = tempo reale, 10 = dieci volte piu' veloce, <= 0 = senza attese
+    void Start(float InSpeed, bool bInLoop);
+    // Attende l'uscita del thread: dopo il ritorno la callback non viene piu' chiamata
+    void StopAndWait();
+    bool IsRunning() const { return Thread && !bFinished; }
+    int64 GetSentPackets() const { return SentPackets.Load(); }
+
+    // FRunnable
+    virtual uint32 Run() override;
+    virtual void Stop() override { bStopping = true; }
+
+private:
+    bool ImportHubEvents(const uint8* Data, int64 Num);
+    // Attende fino a TargetSeconds (FPlatformTime) a piccoli passi; false se fermato nel frattempo
+    bool WaitUntil(double TargetSeconds) const;
+
+    FString Path;
+    TUniquePtr<IMappedFileHandle> MappedFile;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+    // Registrazione convertita (ndjson) o letta senza mapping; altrimenti vuoto
+    TArray<uint8> OwnedBytes;
+    const uint8* Bytes = nullptr;
+    int64 NumBytes = 0;
+    int32 RecordCount = 0;
+    double DurationSeconds = 0.0;
+
+    float Speed = 1.f;
+    bool bLoop = false;
+    FRunnableThread* Thread = nullptr;
+    TAtomic<bool> bStopping { false };
+    TAtomic<bool> bFinished { false };
+    TAtomic<int64> SentPackets { 0 };
+    FOnPeopleCounterReplayDatagram DatagramDelegate;
+    FOnPeopleCounterReplayCanSend CanSendDelegate;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "PeopleCounterChannel.h"
+#include "PeopleCounterLoadGenerator.h"
+#include "PeopleCounterBenchmark.h"
+
+#include "PeopleCounterSubsystem.generated.h"
+
+// Proprietario dei socket: un FPeopleCounterChannel per indirizzo:porta, condiviso da tutti i receiver.
+// Ogni pacchetto viene ricevuto e parsato una volta sola, qualunque sia il numero di iscritti.
+// E' un engine subsystem: socket e registro sensori sopravvivono tra una sessione PIE e l'altra
+// (PeopleCounter.KeepIdleChannels).
+UCLASS()
+class PEOPLECOUNTERUDP_API UPeopleCounterSubsystem : public UEngineSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // nullptr prima dell'inizializzazione del motore
+    static UPeopleCounterSubsystem* Get();
+
+    virtual void Deinitialize() override;
+
+    // Canale della porta, creato se serve ma non avviato (registro disponibile subito)
+    TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe> FindOrCreateChannel(const FPeopleCounterChannelSettings& Settings);
+
+    // Si iscrive al canale avviandolo se necessario; nullptr se il socket non si apre.
+    // Le impostazioni contano solo per il primo iscritto.
+    TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> AcquireChannel(const FPeopleCounterChannelSettings& Settings);
+
+    // Senza iscritti il canale resta aperto se PeopleCounter.KeepIdleChannels e' attivo
+    void ReleaseChannel(const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe>& Channel);
+
+    // nullptr se nessun receiver ha ancora aperto quella chiave
+    TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> FindChannel(const FString& Key) const;
+
+    void GetChannels(TArray<TSharedRef<FPeopleCounterChannel, ESPMode::ThreadSafe>>& OutChannels) const;
+
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter")
+    int32 GetNumOpenChannels() const;
+
+    // Chiude i canali senza iscritti (libera le porte)
+    UFUNCTION(BlueprintCallable, Category="PeopleCounter")
+    void CloseIdleChannels();
+
+    // Generatore di carico sintetico (PeopleCounter.LoadTest): azzera le statistiche del canale che
+    // ascolta sulla porta di destinazione e, a generatore finito, ne scrive il riepilogo nel log
+    bool StartLoadTest(const FPeopleCounterLoadSettings& Settings);
+    void StopLoadTest();
+    bool IsLoadTestRunning() const { return LoadGenerator && LoadGenerator->IsRunning(); }
+
+    // Benchmark della pipeline (PeopleCounter.Bench); false se ce n'e' gia' uno in corso
+    bool StartBenchmark(const FPeopleCounterBenchmarkSettings& Settings);
+
+private:
+    bool TickLoadTest(float DeltaTime);
+    void ReportLoadTest();
+
+
+    struct FChannelEntry
+    {
+        TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel;
+        int32 NumSubscribers = 0;
+    };
+    // Chiave: FPeopleCounterChannelSettings::GetKey(); solo GameThread
+    TMap<FString, FChannelEntry> Channels;
+
+    TUniquePtr<FPeopleCounterLoadGenerator> LoadGenerator;
+    // Canale misurato dal test di carico (nessuno se la porta e' su un'altra macchina)
+    TWeakPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> LoadChannel;
+    FTSTicker::FDelegateHandle LoadTickerHandle;
+    double LoadFinishedSeconds = 0.0;
+
+    TUniquePtr<FPeopleCounterBenchmark> Benchmark;
+};
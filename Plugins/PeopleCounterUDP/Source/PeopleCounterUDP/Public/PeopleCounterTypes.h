@@ -0,0 +1,425 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PeopleCounterTypes.generated.h"
+
+// Conteggio di un singolo sensore in un pacchetto people_count_v1
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCountSensor
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    FName Id;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int32 Count = 0;
+
+    // Slot denso nel registro sensori del receiver (INDEX_NONE se non risolto)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int32 Slot = INDEX_NONE;
+
+    // Slot nel registro della sorgente (hub) che ha inviato il pacchetto
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int32 SourceSlot = INDEX_NONE;
+
+    // Solo type=detections: centroidi del sensore in FPeopleCountPacket::Points
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Detections")
+    int32 FirstPoint = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Detections")
+    int32 NumPoints = 0;
+};
+
+// Pacchetto Hub -> UE gia' parsato (schema, type, timestamp, sensors)
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCountPacket
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    FName Schema;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    FName Type;
+
+    // Secondi epoch lato hub (now_ts())
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    double Timestamp = 0.0;
+
+    // Numero di sequenza dell'hub (campo "seq"); -1 se il pacchetto non lo porta
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int64 Sequence = -1;
+
+    // request_id del comando a cui il pacchetto risponde; -1 se non e' una risposta
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int64 RequestId = -1;
+
+    // Hub di provenienza: campo "hub_id", altrimenti ip:porta del mittente (assegnato dal receiver)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    FName Source;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    TArray<FPeopleCountSensor> Sensors;
+
+    // Solo type=sensor_list: seriali RealSense collegati all'hub
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    TArray<FString> Serials;
+
+    // Solo type=detections: centroidi delle persone in coordinate immagine normalizzate [0,1],
+    // di tutti i sensori in fila (FirstPoint/NumPoints di ogni sensore)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Detections")
+    TArray<FVector2D> Points;
+
+    // Solo type=pong: "t0" del ping (FPlatformTime::Seconds() del motore) e "t1", arrivo all'hub
+    // (orologio dell'hub); la partenza della risposta e' Timestamp
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    double ClockT0 = 0.0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    double ClockT1 = 0.0;
+
+    // Solo type=interval (risposta a set_interval/get_interval): timer di cattura dell'hub dopo e
+    // prima del comando, in secondi (0 = solo su comando); -1 se il pacchetto non li porta
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Interval")
+    double IntervalSeconds = -1.0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Interval")
+    double PreviousIntervalSeconds = -1.0;
+
+    // Arrivo del datagram sul thread RX, FPlatformTime::Seconds() (assegnato dal receiver)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    double ReceivedSeconds = 0.0;
+
+    // Timestamp riportato sull'orologio del motore (base di FPlatformTime::Seconds() e
+    // FApp::GetCurrentTime()); 0 finche' l'orologio di quell'hub non e' stimato
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    double EngineTimestamp = 0.0;
+
+    // Cattura sull'hub -> dispatch, corretta per offset e deriva degli orologi; -1 senza stima
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    float EndToEndLatencyMs = -1.f;
+
+    // Svuota mantenendo la capacita' dell'array sensori
+    void Reset()
+    {
+        Schema = NAME_None;
+        Type = NAME_None;
+        Timestamp = 0.0;
+        Sequence = -1;
+        RequestId = -1;
+        Source = NAME_None;
+        Sensors.Reset();
+        Serials.Reset();
+        Points.Reset();
+        ClockT0 = 0.0;
+        ClockT1 = 0.0;
+        IntervalSeconds = -1.0;
+        PreviousIntervalSeconds = -1.0;
+        ReceivedSeconds = 0.0;
+        EngineTimestamp = 0.0;
+        EndToEndLatencyMs = -1.f;
+    }
+};
+
+// Statistiche del receiver dall'avvio (o dall'ultimo reset)
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterReceiverStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    double ElapsedSeconds = 0.0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 PacketsReceived = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 BytesReceived = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float PacketsPerSecond = 0.f;
+
+    // Datagram non decodificabili (JSON o binario)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 ParseFailures = 0;
+
+    // Numeri di sequenza saltati; quelli arrivati dopo sono contati anche in OutOfOrderPackets
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 SequenceGaps = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 OutOfOrderPackets = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 DuplicatePackets = 0;
+
+    // Stima: SequenceGaps - OutOfOrderPackets
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 PacketsLost = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 QueueOverflows = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 SupersededPackets = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 DiscardedDeltas = 0;
+
+    // Messaggi a chunk (PCF1) ricostruiti, e abbandonati per chunk persi, scaduti o non validi
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 ReassembledMessages = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 ReassemblyFailures = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float MeanInterArrivalMs = 0.f;
+
+    // Jitter di arrivo rispetto al timestamp dell'hub (stima RFC 3550)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float JitterMs = 0.f;
+
+    // Latenza timestamp hub -> dispatch sul GameThread; corretta con la stima dell'orologio
+    // dell'hub quando c'e' (ping del sender), altrimenti include la differenza tra gli orologi
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 LatencySamples = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float LatencyMinMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float LatencyMeanMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float LatencyMaxMs = 0.f;
+
+    // Percentili approssimati al limite superiore del bucket
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float LatencyP50Ms = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float LatencyP95Ms = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float LatencyP99Ms = 0.f;
+
+    // Comandi con request_id: risposte ricevute e scadute, round trip misurato dal sender
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 RequestsAnswered = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 RequestTimeouts = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float RoundTripMinMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float RoundTripMeanMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float RoundTripMaxMs = 0.f;
+
+    // Pacchetti ricevuti e non ancora consegnati al GameThread
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int32 QueueDepth = 0;
+
+    // Tempo del GameThread nei dispatch (listener compresi): frame con almeno un dispatch,
+    // totale, media e massimo per frame
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    int64 DispatchFrames = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    double DispatchTotalMs = 0.0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float DispatchMeanMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    float DispatchMaxMs = 0.f;
+
+    // Limiti superiori dei bucket; LatencyBucketCounts ha un elemento in piu' (oltre l'ultimo limite)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    TArray<float> LatencyBucketUpperMs;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Stats")
+    TArray<int64> LatencyBucketCounts;
+
+    FString ToString() const;
+};
+
+// Stima dell'orologio di un hub rispetto a questa macchina (ping/pong NTP)
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterClockInfo
+{
+    GENERATED_BODY()
+
+    // Almeno un campione valido: i timestamp dell'hub si possono riportare sul motore
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    bool bSynced = false;
+
+    // Orologio dell'hub meno l'orologio UTC di questa macchina
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    float OffsetMs = 0.f;
+
+    // Velocita' relativa dell'orologio dell'hub (microsecondi al secondo)
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    float DriftPpm = 0.f;
+
+    // Round trip minimo tra i campioni tenuti; l'incertezza sull'offset e' al piu' la meta'
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    float RoundTripMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter|Clock")
+    int32 NumSamples = 0;
+};
+
+// Stato di una sorgente (hub) vista da un receiver
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterSourceInfo
+{
+    GENERATED_BODY()
+
+    // hub_id, oppure ip:porta se l'hub non lo invia
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    FName Source;
+
+    // Ultimo mittente visto
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    FString Endpoint;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int64 PacketsReceived = 0;
+
+    // Snapshot e delta completi passati alla consegna (senza chunk, pong, risposte e duplicati):
+    // il ritmo a cui l'hub pubblica davvero
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int64 CountsReceived = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int64 SequenceGaps = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int64 LastSequence = -1;
+
+    // Lo stato ricostruito dai delta e' allineato all'hub
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    bool bSynced = false;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    int32 NumSensors = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    float JitterMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="PeopleCounter")
+    FPeopleCounterClockInfo Clock;
+};
+
+// Come i pacchetti ricevuti arrivano al GameThread
+UENUM(BlueprintType)
+enum class EPeopleCounterDispatchMode : uint8
+{
+    // Un AsyncTask per datagram (comportamento storico)
+    PerPacket,
+    // Coda bounded svuotata una volta per tick, con budget per frame
+    Batched,
+    // Solo l'ultimo pacchetto per endpoint sorgente, al massimo uno per frame
+    Coalesced
+};
+
+// Thread che legge dal socket
+UENUM(BlueprintType)
+enum class EPeopleCounterReceiveMode : uint8
+{
+    // FUdpSocketReceiver del motore: polling con attesa fissa di 2 ms
+    SocketReceiver,
+    // Thread dedicato bloccato sul socket, svuota tutti i datagram a ogni risveglio (recvmmsg dove c'e')
+    BlockingThread
+};
+
+// Filtro temporale di un conteggio (sensore o area). Gli stadi attivi si applicano in ordine:
+// mediana (toglie i picchi di un frame), EMA (liscia), isteresi/permanenza (decide quando cambiare).
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterFilterSettings
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter")
+    bool bEnabled = false;
+
+    // Mediana mobile sugli ultimi N campioni; 1 = spenta
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter", meta=(ClampMin="1", ClampMax="15"))
+    int32 MedianWindow = 1;
+
+    // Costante di tempo dell'EMA (peso dal tempo tra i campioni, non dal numero); 0 = spenta
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter", meta=(ClampMin="0"))
+    float EmaTimeConstantSeconds = 0.f;
+
+    // L'uscita cambia solo se l'ingresso se ne allontana almeno di tanto...
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter", meta=(ClampMin="0"))
+    float HysteresisBand = 0.f;
+
+    // ...e resta dalla stessa parte per almeno questo tempo; entrambi 0 = uscita = ingresso filtrato
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="PeopleCounter", meta=(ClampMin="0"))
+    float MinDwellSeconds = 0.f;
+};
+
+// Cattura programmata del sender (UUDPJsonSenderComponent::StartScheduledCapture)
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterScheduleStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    bool bRunning = false;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    float IntervalSeconds = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    bool bAlignedToWallClock = false;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    int64 CapturesSent = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    int64 SendFailures = 0;
+
+    // Slot saltati perche' il thread e' arrivato oltre lo slot successivo (sistema sospeso, CPU satura)
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    int64 MissedSlots = 0;
+
+    // Ritardo dell'invio rispetto all'istante dello slot
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    float LatenessMeanUs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    float LatenessMaxUs = 0.f;
+
+    // Istante dell'ultimo slot inviato, secondi Unix (stesso orologio di "timestamp" dell'hub)
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Schedule")
+    double LastSlotUnixSeconds = 0.0;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPeopleCountReceivedNative, const FPeopleCountPacket&);
+
+namespace PeopleCounter
+{
+    // Nomi noti del protocollo, costruiti una volta sola
+    PEOPLECOUNTERUDP_API extern const FName SchemaV1;
+    PEOPLECOUNTERUDP_API extern const FName TypeSnapshotCounts;
+    PEOPLECOUNTERUDP_API extern const FName TypeSensorList;
+    // Solo i sensori cambiati rispetto al pacchetto precedente (stesso hub, seq consecutivo)
+    PEOPLECOUNTERUDP_API extern const FName TypeDeltaCounts;
+    // Risposta dell'hub a {"cmd":"ping"}: consumata dal canale per la stima dell'orologio
+    PEOPLECOUNTERUDP_API extern const FName TypePong;
+    // Centroidi per sensore (--detections sull'hub); non aggiorna i conteggi del registro
+    PEOPLECOUNTERUDP_API extern const FName TypeDetections;
+    // Risposta a set_interval (con request_id) e get_interval: IntervalSeconds/PreviousIntervalSeconds
+    PEOPLECOUNTERUDP_API extern const FName TypeInterval;
+
+    // Pacchetti che portano conteggi (e un numero di sequenza)
+    inline bool IsCountsType(FName Type) { return Type == TypeSnapshotCounts || Type == TypeDeltaCounts; }
+}
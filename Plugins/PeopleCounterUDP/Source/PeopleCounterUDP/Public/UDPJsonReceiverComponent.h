@@ -3,14 +3,20 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 
-// 🔧 TIPI DEL RECEIVER/ENDPOINT
-#include "Common/UdpSocketReceiver.h" // FArrayReaderPtr, FUdpSocketReceiver
-#include "Interfaces/IPv4/IPv4Endpoint.h"             // FIPv4Endpoint
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterSensorRegistry.h"
+#include "PeopleCounterChannel.h"
 
 #include "UDPJsonReceiverComponent.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnJsonReceived, const FString&, JsonString);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnJsonBatchReceived, const TArray<FString>&, JsonStrings);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPeopleCountReceived, const FPeopleCountPacket&, Packet);
 
+class UUDPJsonSenderComponent;
+
+// Vista su un canale UDP: socket, parsing e registro sensori vivono in FPeopleCounterChannel,
+// di norma condiviso tramite UPeopleCounterSubsystem con gli altri receiver sulla stessa porta
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class PEOPLECOUNTERUDP_API UUDPJsonReceiverComponent : public UActorComponent
 {
@@ -29,11 +35,125 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP")
     bool bLogPackets = false;
 
+    // Usa il canale condiviso della porta (UPeopleCounterSubsystem). Se false il receiver apre
+    // un socket suo, come prima: solo un receiver alla volta per porta.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP")
+    bool bUseSharedChannel = true;
+
+    // Porte in piu' sullo stesso canale, per hub che non possono condividere ListenPort.
+    // Fanno parte della chiave: receiver con porte diverse non condividono il canale.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP")
+    TArray<int32> AdditionalListenPorts;
+
+    // Gruppo multicast da cui ricevere (es. 239.10.10.10): tutti i nodi del cluster iscritti
+    // ricevono lo stesso datagram dell'hub. Vuoto = solo unicast/broadcast su ListenAddress.
+    // Con un gruppo ListenAddress resta di norma 0.0.0.0.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Multicast")
+    FString MulticastGroup;
+
+    // IP della scheda su cui iscriversi al gruppo; vuoto = scelta del sistema
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Multicast")
+    FString MulticastInterface;
+
+    // Riceve anche quello che questa macchina invia al gruppo (hub sullo stesso PC)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Multicast")
+    bool bMulticastLoopback = true;
+
+    // Con il plugin PeopleCounterUDPCluster in una sessione nDisplay: socket e parsing solo sul
+    // nodo primario, stato replicato e applicato da tutti i nodi nello stesso frame.
+    // Richiede bUseSharedChannel. OnJsonReceived scatta solo sul primario.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Cluster")
+    bool bSyncInCluster = true;
+
+    // Impostazioni di thread, parsing e dispatch: lette in StartReceiver; su un canale condiviso
+    // vale la configurazione del primo receiver che lo ha aperto
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Thread")
+    EPeopleCounterReceiveMode ReceiveMode = EPeopleCounterReceiveMode::BlockingThread;
+
+    // BlockingThread: attesa massima sul socket; limita solo il tempo di StopReceiver, non la latenza
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Thread", meta=(ClampMin="1", EditCondition="ReceiveMode==EPeopleCounterReceiveMode::BlockingThread"))
+    int32 ReceiveWaitMilliseconds = 100;
+
+    // Parsing JSON sul thread RX: il GameThread riceve solo FPeopleCountPacket
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Parsing")
+    bool bParseOnReceiveThread = true;
+
+    // Consegna anche la stringa JSON grezza (OnJsonReceived / OnJsonBatchReceived).
+    // Attivo di default per i Blueprint esistenti; disattivarlo evita la copia FString al GameThread.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Parsing")
+    bool bBroadcastRawJson = true;
+
+    // Parsing, sequenze e delta di ogni hub su worker del task graph, in parallelo tra hub
+    // e in ordine per hub. Utile con molti hub; con uno solo aggiunge solo un salto di thread.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Parsing")
+    bool bProcessSourcesInParallel = false;
+
+    // Letto in StartReceiver: cambiarlo a receiver avviato non ha effetto
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Dispatch")
+    EPeopleCounterDispatchMode DispatchMode = EPeopleCounterDispatchMode::PerPacket;
+
+    // Capacita' della coda Batched: oltre questa soglia i pacchetti vengono scartati
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Dispatch", meta=(ClampMin="1", EditCondition="DispatchMode==EPeopleCounterDispatchMode::Batched"))
+    int32 MaxQueuedPackets = 1024;
+
+    // Pacchetti massimi consegnati per frame (0 = nessun limite)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Dispatch", meta=(ClampMin="0", EditCondition="DispatchMode==EPeopleCounterDispatchMode::Batched"))
+    int32 MaxPacketsPerFrame = 64;
+
+    // Tempo massimo di dispatch per frame in microsecondi (0 = nessun limite)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Dispatch", meta=(ClampMin="0", EditCondition="DispatchMode==EPeopleCounterDispatchMode::Batched"))
+    int32 MaxDispatchMicrosecondsPerFrame = 0;
+
+    // Pacchetti preallocati all'avvio (parsing, JSON e sensori riusano i loro buffer).
+    // Deve coprire la coda Batched/gli slot Coalesced piu' i dispatch in volo; oltre si scarta.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Dispatch", meta=(ClampMin="1"))
+    int32 PacketPoolSize = 2048;
+
+    // Messaggi spezzati dall'hub in piu' datagram (--max-datagram): scartati se l'ultimo chunk
+    // non arriva entro questo tempo dal primo
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Fragments", meta=(ClampMin="0.01"))
+    float ReassemblyTimeoutSeconds = 1.f;
+
+    // Dimensione massima di un messaggio ricostruito; ogni pacchetto del pool puo' arrivare a tanto
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Fragments", meta=(ClampMin="1024"))
+    int32 MaxMessageBytes = 4 * 1024 * 1024;
+
+    // Sensori registrati subito, con indici stabili prima ancora del primo pacchetto
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Sensors")
+    TArray<FName> PreregisteredSensorIds;
+
+    // Filtro temporale dei conteggi di ogni sensore, applicato prima di registri, eventi e replica
+    // nel cluster; il JSON grezzo (OnJsonReceived) resta quello dell'hub
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Filter")
+    FPeopleCounterFilterSettings CountFilter;
+
+    // Filtri per singolo sensore (id del registro unito o id dell'hub) al posto di CountFilter
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Filter")
+    TMap<FName, FPeopleCounterFilterSettings> SensorFilters;
+
+    // Canale comandi verso l'hub (resync dopo un buco di sequenza); se vuoto si usa
+    // il primo UDPJsonSenderComponent dello stesso Actor
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Delta")
+    TObjectPtr<UUDPJsonSenderComponent> CommandSender;
+
+    // Intervallo minimo tra due richieste di resync alla stessa sorgente
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Delta", meta=(ClampMin="0"))
+    float ResyncCooldownSeconds = 0.5f;
+
     UPROPERTY(BlueprintAssignable, Category="UDP")
     FOnJsonReceived OnJsonReceived;
 
+    // Pacchetto gia' parsato sul thread RX (richiede bParseOnReceiveThread)
+    UPROPERTY(BlueprintAssignable, Category="UDP")
+    FOnPeopleCountReceived OnPeopleCountReceived;
+
+    // Batched/Coalesced: una volta per frame con tutti i pacchetti consegnati
+    UPROPERTY(BlueprintAssignable, Category="UDP")
+    FOnJsonBatchReceived OnJsonBatchReceived;
+
 public:
     UUDPJsonReceiverComponent();
+    virtual ~UUDPJsonReceiverComponent() override;
 
     UFUNCTION(BlueprintCallable, Category="UDP")
     bool StartReceiver();
@@ -44,19 +164,147 @@ public:
     UFUNCTION(BlueprintCallable, Category="UDP")
     bool IsRunning() const { return bRunning; }
 
+    // Pacchetti scartati perche' la coda Batched era piena
+    UFUNCTION(BlueprintCallable, Category="UDP|Dispatch")
+    int64 GetQueueOverflowCount() const;
+
+    // Pacchetti scartati perche' tutti i buffer del pool erano in uso
+    UFUNCTION(BlueprintCallable, Category="UDP|Dispatch")
+    int64 GetPacketPoolExhaustedCount() const;
+
+    // Pacchetti sostituiti da uno piu' recente prima del dispatch (modalita' Coalesced)
+    UFUNCTION(BlueprintCallable, Category="UDP|Dispatch")
+    int64 GetSupersededPacketCount() const;
+
+    // Chiede all'hub un keyframe completo ({"cmd":"resync"})
+    UFUNCTION(BlueprintCallable, Category="UDP|Delta")
+    bool RequestResync();
+
+    // Buchi nella sequenza dei pacchetti conteggi (pacchetti persi)
+    UFUNCTION(BlueprintCallable, Category="UDP|Delta")
+    int64 GetSequenceGapCount() const;
+
+    // Delta scartati perche' non applicabili (fuori ordine o in attesa di keyframe)
+    UFUNCTION(BlueprintCallable, Category="UDP|Delta")
+    int64 GetDiscardedDeltaCount() const;
+
+    // Snapshot di traffico, perdite, riordino, jitter e latenza del canale (anche da console: PeopleCounter.Stats)
+    UFUNCTION(BlueprintCallable, Category="UDP|Stats")
+    FPeopleCounterReceiverStats GetReceiverStats() const;
+
+    UFUNCTION(BlueprintCallable, Category="UDP|Stats")
+    void ResetReceiverStats();
+
+    // --- Registrazione e replay ---
+
+    // Registra ogni datagram ricevuto in un file .pcrl; percorsi relativi sotto Saved/PeopleCounter
+    UFUNCTION(BlueprintCallable, Category="UDP|Replay")
+    bool StartRecording(const FString& FilePath);
+
+    UFUNCTION(BlueprintCallable, Category="UDP|Replay")
+    void StopRecording();
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Replay")
+    bool IsRecording() const;
+
+    // Rimanda un .pcrl (o l'events.ndjson di una sessione dell'hub) nella pipeline del receiver
+    // avviato; Speed 1 = tempo reale, 0 = il piu' in fretta possibile
+    UFUNCTION(BlueprintCallable, Category="UDP|Replay")
+    bool StartReplay(const FString& FilePath, float Speed = 1.f, bool bLoop = false);
+
+    UFUNCTION(BlueprintCallable, Category="UDP|Replay")
+    void StopReplay();
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Replay")
+    bool IsReplaying() const;
+
+    // Chiamati dal sender sul GameThread per le richieste con request_id
+    void RecordRequestRoundTrip(double RoundTripMs);
+    void RecordRequestTimeout();
+
+    // --- Stato sensori (registro persistente, aggiornato dal dispatch) ---
+
+    // Ultimo conteggio noto; 0 per sensori mai visti
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sensors")
+    int32 GetSensorCount(FName SensorId) const;
+
+    // Ultimo conteggio dell'hub prima del filtro; uguale a GetSensorCount senza filtri
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Filter")
+    int32 GetSensorRawCount(FName SensorId) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sensors")
+    int32 GetSensorCountByIndex(int32 SensorIndex) const { return Channel ? Channel->GetSensorRegistry()->GetCount(SensorIndex) : 0; }
+
+    // Indice denso e stabile del sensore (INDEX_NONE se sconosciuto)
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sensors")
+    int32 GetSensorIndex(FName SensorId) const { return Channel ? Channel->GetSensorRegistry()->FindSlot(SensorId) : INDEX_NONE; }
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sensors")
+    TArray<FName> GetSensorIds() const;
+
+    // Seriale RealSense del sensore, noto dopo una risposta a list_sensors
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sensors")
+    FString GetSensorSerial(FName SensorId) const;
+
+    // --- Sorgenti (hub) ---
+
+    // Hub visti dall'avvio; Source e' l'hub_id inviato dall'hub, altrimenti "ip:porta"
+    UFUNCTION(BlueprintCallable, Category="UDP|Sources")
+    TArray<FPeopleCounterSourceInfo> GetSources() const;
+
+    // Conteggio con l'id originale del sensore nel registro di una sola sorgente
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sources")
+    int32 GetSourceSensorCount(FName Source, FName SensorId) const;
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sources")
+    TArray<FName> GetSourceSensorIds(FName Source) const;
+
+    // Stima dell'orologio dell'hub (serve un sender con ClockSyncIntervalSeconds > 0 verso quell'hub)
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Sources")
+    FPeopleCounterClockInfo GetSourceClock(FName Source) const;
+
+    // Consumer C++ (aggregatori ecc.): scatta sul GameThread prima di OnPeopleCountReceived,
+    // cosi' i Blueprint vedono gia' lo stato aggiornato
+    FOnPeopleCountReceivedNative OnPeopleCountReceivedNative;
+
+    // Fine di ogni StartReceiver riuscito: da qui GetSensorRegistry non e' piu' nullptr
+    FSimpleMulticastDelegate OnReceiverStartedNative;
+
+    // Registro del canale, condiviso da tutti i suoi receiver; sopravvive a Stop/StartReceiver
+    // (e, su un canale condiviso, alle sessioni PIE): gli indici restano validi.
+    // nullptr prima del primo StartReceiver: leggerlo non apre il canale
+    TSharedPtr<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe> GetSensorRegistry() const;
+
+    // Vero su un nodo nDisplay secondario: nessun socket, conteggi dal primario
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Cluster")
+    bool IsClusterSecondary() const { return bRunning && Channel && Channel->IsClusterSecondary(); }
+
+    // Canale in uso; nullptr se il receiver non e' avviato
+    TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> GetChannel() const { return bRunning ? Channel : nullptr; }
+
 protected:
     virtual void BeginPlay() override;
     virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 private:
-    // Socket + thread del receiver
-    FUdpSocketReceiver* SocketReceiver = nullptr;
-    FSocket*            ListenSocket   = nullptr;
-    bool                bRunning       = false;
+    // Creato da StartReceiver; resta dopo StopReceiver per il registro
+    TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel;
+    bool bRunning = false;
+    bool bSharedChannel = false;
+
+    FDelegateHandle PacketHandle;
+    FDelegateHandle JsonHandle;
+    FDelegateHandle DrainedHandle;
+    FDelegateHandle ResyncHandle;
+
+    // Riutilizzato tra i frame per non riallocare il batch
+    TArray<FString> DrainedBatch;
 
-    // Callback esatta per FUdpSocketReceiver
-    void HandlePacket(const FArrayReaderPtr& Data, const FIPv4Endpoint& Endpoint);
+    FPeopleCounterChannelSettings MakeChannelSettings() const;
 
-    bool CreateSocket();
-    void DestroySocket();
+    // Inoltro degli eventi del canale (GameThread)
+    void HandleChannelPacket(const FPeopleCountPacket& Packet);
+    void HandleChannelJson(const FString& Json);
+    void HandleChannelDrained();
+    bool HandleChannelResync(FName Source, const FIPv4Endpoint& Sender);
 };
@@ -2,8 +2,55 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Async/Future.h"
+#include "Containers/Ticker.h"
+#include "Engine/LatentActionManager.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "PeopleCounterTypes.h"
+#include "PeopleCounterCaptureScheduler.h"
 #include "UDPJsonSenderComponent.generated.h"
 
+class UUDPJsonReceiverComponent;
+
+// Comando gia' codificato in UTF-8 da PrepareCommand, valido per il sender che l'ha creato
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterPreparedCommand
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    int32 Index = INDEX_NONE;
+
+    bool IsValid() const { return Index != INDEX_NONE; }
+};
+
+UENUM(BlueprintType)
+enum class EPeopleCounterReplyResult : uint8
+{
+    Received,
+    TimedOut
+};
+
+// Esito di un comando con request_id
+USTRUCT(BlueprintType)
+struct PEOPLECOUNTERUDP_API FPeopleCounterCommandReply
+{
+    GENERATED_BODY()
+
+    // false se scaduto il timeout (o sender fermato) prima della risposta
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Requests")
+    bool bReceived = false;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Requests")
+    int64 RequestId = -1;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Requests")
+    float RoundTripMs = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category="UDP|Requests")
+    FPeopleCountPacket Packet;
+};
+
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class PEOPLECOUNTERUDP_API UUDPJsonSenderComponent : public UActorComponent
 {
@@ -19,6 +66,59 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP")
     bool bAutoConnect = true;
 
+    // Con TargetHost multicast (224.0.0.0/4) i comandi arrivano a tutti gli hub iscritti al gruppo.
+    // 1 = solo rete locale; ogni router attraversato toglie 1.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Multicast", meta=(ClampMin="0", ClampMax="255"))
+    int32 MulticastTtl = 1;
+
+    // IP della scheda da cui esce il multicast; vuoto = scelta del sistema
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Multicast")
+    FString MulticastInterface;
+
+    // Consegna il multicast anche agli hub sulla stessa macchina
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Multicast")
+    bool bMulticastLoopback = true;
+
+    // Receiver su cui arrivano le risposte; se vuoto si usa quello dello stesso Actor
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Requests")
+    TObjectPtr<UUDPJsonReceiverComponent> ReplyReceiver;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Requests", meta=(ClampMin="0.01"))
+    float DefaultRequestTimeoutSeconds = 2.f;
+
+    // Ping {"cmd":"ping"} ogni N secondi (0 = mai): le risposte dell'hub arrivano al suo receiver
+    // e tengono aggiornata la stima di offset e deriva dell'orologio (EndToEndLatencyMs, EngineTimestamp).
+    // I primi ping partono piu' fitti per avere subito una stima. Spento di default: hub vecchi e
+    // destinazioni che non sono hub riceverebbero comandi sconosciuti (2 = valore consigliato).
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Clock", meta=(ClampMin="0"))
+    float ClockSyncIntervalSeconds = 0.f;
+
+    // Cattura programmata: un thread del sender invia ScheduledCaptureCommand (gia' codificato) ogni
+    // ScheduledCaptureIntervalSeconds, senza il jitter e gli stalli del GameThread di un Timer Blueprint.
+    // Con true parte in BeginPlay.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Schedule")
+    bool bScheduledCapture = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Schedule", meta=(ClampMin="0.01"))
+    float ScheduledCaptureIntervalSeconds = 0.5f;
+
+    // Slot sugli istanti Unix multipli dell'intervallo (+ fase): piu' istanze con orologi NTP
+    // catturano nello stesso istante su tutti gli hub
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Schedule")
+    bool bAlignScheduleToWallClock = true;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Schedule", meta=(ClampMin="0"))
+    float ScheduledCapturePhaseSeconds = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Schedule")
+    FString ScheduledCaptureCommand = TEXT("{\"cmd\":\"capture\"}");
+
+    // All'avvio manda {"cmd":"set_interval","seconds":0} perche' l'hub non catturi anche da solo.
+    // Con un ReplyReceiver la risposta riporta il timer che l'hub aveva: allo stop (anche in EndPlay)
+    // si rimette quello; senza risposta l'hub resta a 0, cioe' cattura solo su comando
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="UDP|Schedule")
+    bool bStopHubTimerOnSchedule = true;
+
 public:
     UUDPJsonSenderComponent();
 
@@ -31,9 +131,69 @@ public:
     UFUNCTION(BlueprintCallable, Category="UDP")
     bool IsConnected() const { return bConnected; }
 
+    // Vero se i comandi partono verso questo indirizzo (instradamento del resync per hub);
+    // un gruppo multicast raggiunge tutti gli hub
+    bool TargetsAddress(const FIPv4Address& Address) const;
+
     UFUNCTION(BlueprintCallable, Category="UDP")
     bool SendJsonString(const FString& JsonString);
 
+    // Codifica il payload una volta sola; stringhe uguali danno lo stesso handle
+    UFUNCTION(BlueprintCallable, Category="UDP|Prepared")
+    FPeopleCounterPreparedCommand PrepareCommand(const FString& JsonString);
+
+    UFUNCTION(BlueprintCallable, Category="UDP|Prepared")
+    bool SendPrepared(FPeopleCounterPreparedCommand Handle);
+
+    // Invia piu' comandi preparati in una chiamata; ritorna quanti sono partiti
+    UFUNCTION(BlueprintCallable, Category="UDP|Prepared")
+    int32 SendMany(const TArray<FPeopleCounterPreparedCommand>& Handles);
+
+    // Datagram gia' codificato (C++)
+    bool SendBytes(TArrayView<const uint8> Payload);
+
+    // Un ping di sincronizzazione subito, con t0 = FPlatformTime::Seconds()
+    UFUNCTION(BlueprintCallable, Category="UDP|Clock")
+    bool SendClockPing();
+
+    // Invia un oggetto JSON aggiungendo "request_id"; il future si risolve con il pacchetto
+    // che riporta lo stesso id (capture, list_sensors, resync) o allo scadere del timeout.
+    // TimeoutSeconds <= 0 usa DefaultRequestTimeoutSeconds. Solo GameThread.
+    TFuture<FPeopleCounterCommandReply> SendRequestAsync(const FString& JsonObject, float TimeoutSeconds = 0.f);
+    TFuture<FPeopleCounterCommandReply> RequestCaptureAsync(float TimeoutSeconds = 0.f);
+
+    // Versione Blueprint di SendRequestAsync
+    UFUNCTION(BlueprintCallable, Category="UDP|Requests", meta=(Latent, LatentInfo="LatentInfo", ExpandEnumAsExecs="Result"))
+    void SendCommandAndWait(const FString& JsonObject, float TimeoutSeconds, EPeopleCounterReplyResult& Result, FPeopleCounterCommandReply& Reply, FLatentActionInfo LatentInfo);
+
+    UFUNCTION(BlueprintCallable, Category="UDP|Requests")
+    int32 GetPendingRequestCount() const { return PendingRequests.Num(); }
+
+    // Comando, intervallo, fase e destinazione vengono letti all'avvio; per cambiarli Stop e Start
+    UFUNCTION(BlueprintCallable, Category="UDP|Schedule")
+    bool StartScheduledCapture();
+
+    UFUNCTION(BlueprintCallable, Category="UDP|Schedule")
+    void StopScheduledCapture();
+
+    UFUNCTION(BlueprintCallable, Category="UDP|Schedule")
+    bool IsScheduledCaptureRunning() const;
+
+    // Unica impostazione che cambia senza riavvio: vale dallo slot successivo
+    UFUNCTION(BlueprintCallable, Category="UDP|Schedule")
+    void SetScheduledCaptureInterval(float IntervalSeconds);
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Schedule")
+    FPeopleCounterScheduleStats GetScheduledCaptureStats() const;
+
+    // Ultimo intervallo del timer dell'hub riportato dalle risposte a set_interval/get_interval; -1 = mai
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category="UDP|Schedule")
+    float GetHubIntervalSeconds() const { return HubIntervalSeconds; }
+
+    // Chiede {"cmd":"get_interval"}; falso senza ReplyReceiver (la risposta non arriverebbe)
+    UFUNCTION(BlueprintCallable, Category="UDP|Schedule")
+    bool RequestHubInterval();
+
 protected:
     virtual void BeginPlay() override;
     virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
@@ -41,7 +201,50 @@ protected:
 private:
     class FSocket* SendSocket = nullptr;
     bool bConnected = false;
+    // Opzioni multicast applicate a SendSocket
+    bool bSendSocketMulticast = false;
 
+    // Indirizzo risolto in Connect; si risolve di nuovo solo se cambiano TargetHost/TargetPort
+    TSharedPtr<class FInternetAddr> TargetAddr;
+    FString ResolvedHost;
+    int32 ResolvedPort = 0;
+
+    // Payload UTF-8 per handle, deduplicati per stringa
+    TArray<TArray<uint8>> PreparedPayloads;
+    TMap<FString, int32> PreparedIndexByJson;
+
+    // Richieste in attesa di risposta, per request_id
+    struct FPendingRequest
+    {
+        TUniquePtr<TPromise<FPeopleCounterCommandReply>> Promise;
+        double SentSeconds = 0.0;
+        double DeadlineSeconds = 0.0;
+    };
+    TMap<int64, FPendingRequest> PendingRequests;
+    FTSTicker::FDelegateHandle TimeoutTickerHandle;
+
+    FTSTicker::FDelegateHandle ClockSyncTickerHandle;
+    double NextClockPingSeconds = 0.0;
+    int32 ClockPingsSent = 0;
+
+    TUniquePtr<FPeopleCounterCaptureScheduler> CaptureScheduler;
+    // Timer dell'hub spento da StartScheduledCapture, da riaccendere allo stop
+    bool bHubTimerStopped = false;
+    // Intervallo dell'hub prima dello spegnimento, dalla risposta a set_interval; -1 = non riportato
+    float HubIntervalBeforeSchedule = -1.f;
+    // Scarta le risposte arrivate per un avvio precedente
+    int32 ScheduleGeneration = 0;
+    float HubIntervalSeconds = -1.f;
+    void RestoreHubTimer();
+
+    // Socket UDP verso TargetAddr con le opzioni multicast del componente
+    class FSocket* BuildSocket(const TCHAR* Description) const;
     bool CreateSocket();
     void DestroySocket();
+    bool ResolveTarget();
+
+    void HandleReply(const FPeopleCountPacket& Packet);
+    bool TickRequestTimeouts(float DeltaTime);
+    void FailPendingRequests();
+    bool TickClockSync(float DeltaTime);
 };
@@ -13,9 +13,13 @@ Hub multi-sensore RealSense con:
 Esempi:
 python sensor_hub_udp.py --model=yolov8_topview.pt --use-depth-input \
   --udp-host=192.168.1.50 --data-port=7777 --cmd-port=7780 --interval=1.0
+
+Multicast (tutti i nodi del cluster ricevono lo stesso datagram, senza relay):
+python sensor_hub_udp.py --model=yolov8_topview.pt --udp-host=239.10.10.10 \
+  --multicast-ttl=1 --multicast-if=192.168.1.20
 """
 
-import argparse, json, socket, struct, sys, threading, time, queue, signal
+import argparse, ipaddress, json, socket, struct, sys, threading, time, queue, signal
 from typing import Dict, List, Tuple
 import numpy as np
 import cv2
@@ -219,21 +223,108 @@ class PeopleDetector:
             plotted.append(r.plot())  # immagine BGR con bbox/label/conf
         return counts, plotted, boxes_all
 
+def normalized_centroids(boxes: np.ndarray, width: int, height: int) -> List[float]:
+    """bbox xyxy in pixel -> [x0, y0, x1, y1, ...] dei centri in [0,1] rispetto all'immagine."""
+    if boxes is None or len(boxes) == 0 or width <= 0 or height <= 0:
+        return []
+    cx = np.clip((boxes[:, 0] + boxes[:, 2]) * 0.5 / width, 0.0, 1.0)
+    cy = np.clip((boxes[:, 1] + boxes[:, 3]) * 0.5 / height, 0.0, 1.0)
+    return [round(float(v), 4) for v in np.stack([cx, cy], axis=1).ravel()]
+
 ###############################################################################
 # UDP Server (commands) + Sender (data)
 ###############################################################################
 
+# Formato binario people_count_v2 (vedi PeopleCounterBinaryProtocol.h):
+# header "<4sBBHId" = magic, version, flags, n entry, sequence, timestamp; poi n * "<HH" = (indice sensore, count)
+BINARY_MAGIC = b"PCNT"
+BINARY_VERSION = 2
+BINARY_HEADER = struct.Struct("<4sBBHId")
+BINARY_ENTRY = struct.Struct("<HH")
+BINARY_FLAG_DELTA = 1 << 0
+BINARY_FLAG_REQUEST_ID = 1 << 1
+BINARY_REQUEST_ID = struct.Struct("<I")
+BINARY_FLAG_HUB_ID = 1 << 2
+
+def encode_counts_binary(payload: dict, seq: int) -> bytes:
+    """snapshot_counts/delta_counts -> people_count_v2. Gli id devono essere nella forma SENSORE%03d."""
+    entries = []
+    for s in payload.get("sensors", []):
+        sid = str(s.get("id", ""))
+        if not sid.startswith("SENSORE") or not sid[7:].isdigit():
+            continue
+        entries.append(BINARY_ENTRY.pack(int(sid[7:]) & 0xFFFF, max(0, min(int(s.get("count", 0)), 0xFFFF))))
+    flags = BINARY_FLAG_DELTA if payload.get("type") == "delta_counts" else 0
+    request_id = b""
+    if "request_id" in payload:
+        # risposta a un comando: uint32 subito dopo l'header
+        flags |= BINARY_FLAG_REQUEST_ID
+        request_id = BINARY_REQUEST_ID.pack(int(payload["request_id"]) & 0xFFFFFFFF)
+    hub_id = b""
+    if payload.get("hub_id"):
+        # piu' hub verso lo stesso receiver: uint8 lunghezza + id ASCII
+        raw = str(payload["hub_id"]).encode("ascii", errors="replace")[:255]
+        flags |= BINARY_FLAG_HUB_ID
+        hub_id = bytes([len(raw)]) + raw
+    header = BINARY_HEADER.pack(BINARY_MAGIC, BINARY_VERSION, flags, len(entries),
+                                seq & 0xFFFFFFFF, float(payload.get("timestamp", now_ts())))
+    return header + request_id + hub_id + b"".join(entries)
+
+# Messaggi piu' grandi di --max-datagram (vedi PeopleCounterFragmentProtocol.h):
+# header "<4sIHHII" = magic, message id, indice chunk, numero chunk, dimensione totale, offset; poi i byte del chunk
+FRAGMENT_MAGIC = b"PCF1"
+FRAGMENT_HEADER = struct.Struct("<4sIHHII")
+FRAGMENT_MAX_CHUNKS = 0xFFFF
+
+def split_fragments(data: bytes, msg_id: int, max_datagram: int) -> List[bytes]:
+    """Un messaggio -> chunk PCF1 di al massimo max_datagram byte ciascuno."""
+    chunk = max(1, max_datagram - FRAGMENT_HEADER.size)
+    count = (len(data) + chunk - 1) // chunk
+    if count > FRAGMENT_MAX_CHUNKS:
+        raise ValueError(f"message of {len(data)} bytes needs {count} chunks (max {FRAGMENT_MAX_CHUNKS})")
+    view = memoryview(data)
+    return [FRAGMENT_HEADER.pack(FRAGMENT_MAGIC, msg_id & 0xFFFFFFFF, i, count, len(data), i * chunk)
+            + view[i * chunk:(i + 1) * chunk].tobytes()
+            for i in range(count)]
+
+def is_multicast(host: str) -> bool:
+    try:
+        return ipaddress.ip_address(host).is_multicast
+    except ValueError:
+        return False
+
 class UdpEndpoints:
-    def __init__(self, host: str, data_port: int, cmd_port: int):
+    def __init__(self, host: str, data_port: int, cmd_port: int, wire_format: str = "json", hub_id: str = "",
+                 multicast_ttl: int = 1, multicast_if: str = "", multicast_loop: bool = True,
+                 cmd_group: str = "", max_datagram: int = 65000):
         # Sender (data -> UE)
         self.target_addr = (host, data_port)
+        self.wire_format = wire_format
+        # Aggiunto a ogni pacchetto: distingue gli hub che scrivono sullo stesso receiver
+        self.hub_id = hub_id
+        self.seq = 0
+        # Oltre questa dimensione i messaggi partono a chunk PCF1
+        self.max_datagram = max(FRAGMENT_HEADER.size + 1, min(max_datagram, 65507))
+        self.msg_id = 0
         self.sock_send = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         self.sock_send.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        if is_multicast(host):
+            # Un gruppo 224.0.0.0/4: un solo invio, lo ricevono tutti i nodi iscritti
+            self.sock_send.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, max(0, min(255, multicast_ttl)))
+            self.sock_send.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1 if multicast_loop else 0)
+            if multicast_if:
+                self.sock_send.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(multicast_if))
+            print(f"[UDP] Multicast group {host}:{data_port} ttl={multicast_ttl}"
+                  + (f" if={multicast_if}" if multicast_if else ""))
 
         # Receiver (UE -> commands)
         self.sock_cmd = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         self.sock_cmd.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
         self.sock_cmd.bind(("0.0.0.0", cmd_port))
+        if cmd_group:
+            # Comandi inviati da UE a un gruppo: una capture raggiunge tutti gli hub insieme
+            mreq = socket.inet_aton(cmd_group) + socket.inet_aton(multicast_if or "0.0.0.0")
+            self.sock_cmd.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
         self.cmd_q = queue.Queue()
         self.running = True
         self.rx_thread = threading.Thread(target=self._rx_loop, daemon=True)
@@ -243,6 +334,9 @@ class UdpEndpoints:
         while self.running:
             try:
                 data, addr = self.sock_cmd.recvfrom(65535)
+                t1 = now_ts()
+                if b'"ping"' in data and self._answer_ping(data, t1):
+                    continue
                 try:
                     s = data.decode("utf-8", errors="ignore")
                     self.cmd_q.put((s, addr))
@@ -251,15 +345,52 @@ class UdpEndpoints:
             except Exception:
                 time.sleep(0.01)
 
+    def _answer_ping(self, data: bytes, t1: float) -> bool:
+        """Ping di sincronizzazione orologi: risposto qui, senza passare dalla coda comandi,
+        perche' il tempo di attesa nel loop principale falserebbe t1/t2."""
+        try:
+            cmd = json.loads(data)
+        except Exception:
+            return False
+        if not isinstance(cmd, dict) or cmd.get("cmd") != "ping":
+            return False
+        # t0 = invio (orologio UE), t1 = arrivo, timestamp = partenza della risposta (t2)
+        pong = {"schema": "people_count_v1", "type": "pong", "t0": cmd.get("t0", 0.0), "t1": t1}
+        if cmd.get("request_id") is not None:
+            pong["request_id"] = cmd["request_id"]
+        pong["timestamp"] = now_ts()
+        self.send_json(pong)
+        return True
+
     def get_command(self, timeout: float = 0.01):
         try:
             return self.cmd_q.get(timeout=timeout)
         except queue.Empty:
             return None
 
+    def _tag(self, payload: dict) -> dict:
+        return dict(payload, hub_id=self.hub_id) if self.hub_id else payload
+
+    def _send(self, data: bytes):
+        if len(data) <= self.max_datagram:
+            self.sock_send.sendto(data, self.target_addr)
+            return
+        # Un id per messaggio: il receiver ricostruisce piu' messaggi insieme
+        self.msg_id += 1
+        for fragment in split_fragments(data, self.msg_id, self.max_datagram):
+            self.sock_send.sendto(fragment, self.target_addr)
+
     def send_json(self, payload: dict):
-        data = json.dumps(payload).encode("utf-8")
-        self.sock_send.sendto(data, self.target_addr)
+        self._send(json.dumps(self._tag(payload)).encode("utf-8"))
+
+    def send_counts(self, payload: dict):
+        """snapshot_counts/delta_counts: numerati con "seq" (un contatore solo per i conteggi)."""
+        self.seq += 1
+        if self.wire_format == "binary":
+            data = encode_counts_binary(self._tag(payload), self.seq)
+        else:
+            data = json.dumps(dict(self._tag(payload), seq=self.seq)).encode("utf-8")
+        self._send(data)
 
     def shutdown(self):
         self.running = False
@@ -283,12 +414,24 @@ class SensorHub:
         self.rs = RealSenseManager(use_depth_input=args.use_depth_input,
                                    width=args.width, height=args.height, fps=args.fps)
         self.detector = PeopleDetector(args.model, conf=args.conf, device=args.device)
-        self.udp = UdpEndpoints(args.udp_host, args.data_port, args.cmd_port)
+        self.udp = UdpEndpoints(args.udp_host, args.data_port, args.cmd_port, wire_format=args.wire_format,
+                                hub_id=args.hub_id, multicast_ttl=args.multicast_ttl,
+                                multicast_if=args.multicast_if, multicast_loop=not args.no_multicast_loop,
+                                cmd_group=args.cmd_group, max_datagram=args.max_datagram)
         self.interval = args.interval
+        self.next_shot = 1e18
+        # Centroidi normalizzati delle persone per sensore (type=detections)
+        self.send_detections = args.detections
         self.use_depth_input = args.use_depth_input
         self.schema = "people_count_v1"
         self.running = True
 
+        # Delta: si inviano solo i sensori cambiati, con un keyframe completo ogni N pacchetti
+        self.delta = args.delta
+        self.keyframe_every = max(1, args.keyframe_every)
+        self._last_counts = None
+        self._since_keyframe = 0
+
         self.depth_min = args.depth_min_mm
         self.depth_max = args.depth_max_mm
         self.save_frames = args.save_frames
@@ -359,7 +502,7 @@ class SensorHub:
 
         return serials, imgs
 
-    def _tick_capture_and_send(self):
+    def _tick_capture_and_send(self, request_id=None):
         frames = self.rs.capture_all()
 
         # --- AUTO DEPTH ---
@@ -396,19 +539,21 @@ class SensorHub:
         serials, imgs = self._prepare_inputs(frames)
 
         if not imgs:
-            payload = {"schema": self.schema, "type": "snapshot_counts",
-                       "timestamp": now_ts(), "sensors": []}
-            self.udp.send_json(payload)
+            self._publish_counts([], request_id=request_id)
             return
 
         counts, plotted, boxes_all = self.detector.infer_batch_full(imgs)
 
         # ordina per serial per stabilità
-        serials_sorted = sorted(zip(serials, counts, plotted), key=lambda x: x[0])
+        serials_sorted = sorted(zip(serials, counts, plotted, boxes_all, imgs), key=lambda x: x[0])
 
         sensors_json = []
-        for idx, (serial, c, img_anno) in enumerate(serials_sorted, start=1):
+        detections_json = []
+        for idx, (serial, c, img_anno, boxes, img) in enumerate(serials_sorted, start=1):
             sensors_json.append({"id": f"SENSORE{idx:03d}", "count": int(c)})
+            if self.send_detections:
+                detections_json.append({"id": f"SENSORE{idx:03d}", "count": int(c),
+                                        "points": normalized_centroids(boxes, img.shape[1], img.shape[0])})
 
             # salvataggio frame annotato (uno per device a tick)
             if self.save_frames:
@@ -418,9 +563,11 @@ class SensorHub:
         # aggiorna totale sessione
         self.session_total += sum(counts)
 
-        payload = {"schema": self.schema, "type": "snapshot_counts",
-                   "timestamp": now_ts(), "sensors": sensors_json}
-        self.udp.send_json(payload)
+        self._publish_counts(sensors_json, request_id=request_id)
+        if self.send_detections:
+            # Dopo i conteggi, senza seq: un pacchetto perso non rompe i delta
+            self.udp.send_json({"schema": self.schema, "type": "detections",
+                                "timestamp": now_ts(), "sensors": detections_json})
 
         # log evento (append)
         if self.save_frames:
@@ -430,17 +577,59 @@ class SensorHub:
             with (self.session_dir / "events.ndjson").open("a", encoding="utf-8") as f:
                 f.write(json.dumps(event, ensure_ascii=False) + "\n")
 
+    def _publish_counts(self, sensors_json: List[dict], force_keyframe: bool = False, request_id=None):
+        counts = {s["id"]: s["count"] for s in sensors_json}
+        # Le risposte sono sempre keyframe: arrivano anche a un receiver fuori sync
+        keyframe = (not self.delta or force_keyframe or request_id is not None or self._last_counts is None
+                    or self._since_keyframe + 1 >= self.keyframe_every
+                    or counts.keys() != self._last_counts.keys())
+        if keyframe:
+            payload = {"schema": self.schema, "type": "snapshot_counts",
+                       "timestamp": now_ts(), "sensors": sensors_json}
+            self._since_keyframe = 0
+        else:
+            changed = [s for s in sensors_json if self._last_counts.get(s["id"]) != s["count"]]
+            payload = {"schema": self.schema, "type": "delta_counts",
+                       "timestamp": now_ts(), "sensors": changed}
+            self._since_keyframe += 1
+        if request_id is not None:
+            payload["request_id"] = request_id
+        self._last_counts = counts
+        self.udp.send_counts(payload)
+
+    def _send_interval(self, previous: float, request_id=None):
+        payload = {"schema": self.schema, "type": "interval", "timestamp": now_ts(),
+                   "seconds": self.interval, "previous_seconds": previous}
+        if request_id is not None:
+            payload["request_id"] = request_id
+        self.udp.send_json(payload)
+
     def _handle_command(self, s: str, addr):
         try:
             cmd = json.loads(s)
         except Exception:
             return
         t = cmd.get("cmd", "").lower()
+        # Eco di "request_id" nella risposta (capture, resync, list_sensors)
+        request_id = cmd.get("request_id")
         if t == "capture":
-            self._tick_capture_and_send()
+            self._tick_capture_and_send(request_id=request_id)
+        elif t == "resync":
+            # Il receiver ha perso un delta: rimanda subito l'ultimo stato completo
+            if self._last_counts is not None or request_id is not None:
+                sensors_json = [{"id": k, "count": v} for k, v in sorted((self._last_counts or {}).items())]
+                self._publish_counts(sensors_json, force_keyframe=True, request_id=request_id)
         elif t == "set_interval":
+            previous = self.interval
             sec = float(cmd.get("seconds", self.interval))
             self.interval = max(0.0, sec)
+            # Il nuovo intervallo vale da subito: niente attesa dello scatto programmato col vecchio
+            self.next_shot = min(self.next_shot, now_ts() + self.interval) if self.interval > 0 else 1e18
+            # Con request_id il sender sa quale intervallo rimettere quando restituisce il timer
+            if request_id is not None:
+                self._send_interval(previous, request_id)
+        elif t == "get_interval":
+            self._send_interval(self.interval, request_id)
         elif t == "list_sensors":
             lst = self.rs.list_serials()
             payload = {
@@ -449,6 +638,8 @@ class SensorHub:
                 "timestamp": now_ts(),
                 "serials": lst
             }
+            if request_id is not None:
+                payload["request_id"] = request_id
             self.udp.send_json(payload)
         elif t == "set_conf":
             conf = float(cmd.get("conf", self.detector.conf))
@@ -470,7 +661,7 @@ class SensorHub:
             self.running = False
 
     def run(self):
-        next_shot = now_ts() + (self.interval if self.interval > 0 else 1e9)
+        self.next_shot = now_ts() + (self.interval if self.interval > 0 else 1e18)
         while self.running:
             # comandi
             got = self.udp.get_command(timeout=0.01)
@@ -480,9 +671,9 @@ class SensorHub:
 
             # timer
             t = now_ts()
-            if self.interval > 0 and t >= next_shot:
+            if self.interval > 0 and t >= self.next_shot:
                 self._tick_capture_and_send()
-                next_shot = t + self.interval
+                self.next_shot = t + self.interval
             time.sleep(0.001)
 
         # graceful
@@ -506,6 +697,26 @@ def main():
     ap.add_argument("--data-port", type=int, default=7777)
     ap.add_argument("--cmd-port", type=int, default=7780)
     ap.add_argument("--interval", type=float, default=0.0, help="Intervallo auto-capture (0 = solo su comando)")
+    ap.add_argument("--multicast-ttl", type=int, default=1,
+                    help="TTL dei pacchetti se --udp-host e' un gruppo multicast (1 = solo rete locale)")
+    ap.add_argument("--multicast-if", default="",
+                    help="IP dell'interfaccia da cui inviare il multicast (default: scelta dal sistema)")
+    ap.add_argument("--no-multicast-loop", action="store_true",
+                    help="Non consegnare il multicast ai receiver sulla stessa macchina dell'hub")
+    ap.add_argument("--cmd-group", default="",
+                    help="Gruppo multicast su cui ascoltare anche i comandi (UDPJsonSenderComponent con TargetHost multicast)")
+    ap.add_argument("--detections", action="store_true",
+                    help="Dopo ogni capture invia anche i centroidi delle persone per sensore (type=detections)")
+    ap.add_argument("--max-datagram", type=int, default=65000,
+                    help="Messaggi piu' grandi partono a chunk PCF1 ricostruiti dal receiver (1400 evita la frammentazione IP)")
+    ap.add_argument("--hub-id", default="",
+                    help="Identificativo dell'hub (campo hub_id): necessario con piu' hub sullo stesso receiver")
+    ap.add_argument("--wire-format", choices=["json", "binary"], default="json",
+                    help="Formato dei snapshot_counts verso UE: json (people_count_v1) o binary (people_count_v2)")
+    ap.add_argument("--delta", action="store_true",
+                    help="Invia delta_counts (solo sensori cambiati) tra un keyframe e l'altro")
+    ap.add_argument("--keyframe-every", type=int, default=30,
+                    help="Con --delta: un snapshot_counts completo ogni N pacchetti")
     ap.add_argument("--save-frames", action="store_true",
                     help="Salva immagini annotate con bbox durante l'esecuzione")
     ap.add_argument("--save-dir", default="test_img",
@@ -0,0 +1,15 @@
+using UnrealBuildTool;
+
+public class PeopleCounterUDPCluster : ModuleRules
+{
+    public PeopleCounterUDPCluster(ReadOnlyTargetRules Target) : base(Target)
+    {
+        PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+        PublicDependencyModuleNames.AddRange(new string[] {
+            "Core", "CoreUObject", "Engine", "PeopleCounterUDP"
+        });
+
+        PrivateDependencyModuleNames.AddRange(new string[] { "DisplayCluster" });
+    }
+}
@@ -0,0 +1,452 @@
+#include "PeopleCounterClusterReplicator.h"
+
+#include "IDisplayCluster.h"
+#include "IDisplayClusterCallbacks.h"
+#include "DisplayClusterEnums.h"
+#include "Cluster/DisplayClusterClusterEvent.h"
+#include "Misc/CoreDelegates.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "PeopleCounterSubsystem.h"
+#include "PeopleCounterJsonLib.h"
+#include "PeopleCounterBinaryProtocol.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPeopleCounterUDP_Cluster, Log, All);
+
+namespace
+{
+    constexpr uint32 EventMagic = 0x53434350; // "PCCS"
+    // 2: eta' del pacchetto sull'orologio del primario
+    // 3: punti per sensore nei pacchetti detections
+    constexpr uint8 EventVersion = 3;
+    // Limite di sicurezza sugli slot letti da un evento
+    constexpr int32 MaxReplicatedSlots = 1 << 20;
+    // Limite di sicurezza sui punti di un sensore
+    constexpr int32 MaxReplicatedPoints = 1 << 16;
+
+    // Header dell'evento
+    constexpr uint8 EventFlagResetDefinitions = 1 << 0;
+
+    // Per pacchetto
+    constexpr uint8 PacketFlagQualifiedIds = 1 << 0;
+
+    // Schema e type noti come un byte; gli altri come stringa
+    enum class ENameCode : uint8
+    {
+        None,
+        SchemaV1,
+        SchemaV2,
+        SnapshotCounts,
+        DeltaCounts,
+        SensorList,
+        Detections,
+        Other = 255
+    };
+
+    void WriteName(FArchive& Ar, FName Name)
+    {
+        ENameCode Code = ENameCode::Other;
+        if (Name.IsNone()) Code = ENameCode::None;
+        else if (Name == PeopleCounter::SchemaV1) Code = ENameCode::SchemaV1;
+        else if (Name == PeopleCounter::Binary::SchemaV2) Code = ENameCode::SchemaV2;
+        else if (Name == PeopleCounter::TypeSnapshotCounts) Code = ENameCode::SnapshotCounts;
+        else if (Name == PeopleCounter::TypeDeltaCounts) Code = ENameCode::DeltaCounts;
+        else if (Name == PeopleCounter::TypeSensorList) Code = ENameCode::SensorList;
+        else if (Name == PeopleCounter::TypeDetections) Code = ENameCode::Detections;
+
+        uint8 Byte = static_cast<uint8>(Code);
+        Ar << Byte;
+        if (Code == ENameCode::Other)
+        {
+            FString String = Name.ToString();
+            Ar << String;
+        }
+    }
+
+    FName ReadName(FArchive& Ar)
+    {
+        uint8 Byte = 0;
+        Ar << Byte;
+        switch (static_cast<ENameCode>(Byte))
+        {
+        case ENameCode::None:           return NAME_None;
+        case ENameCode::SchemaV1:       return PeopleCounter::SchemaV1;
+        case ENameCode::SchemaV2:       return PeopleCounter::Binary::SchemaV2;
+        case ENameCode::SnapshotCounts: return PeopleCounter::TypeSnapshotCounts;
+        case ENameCode::DeltaCounts:    return PeopleCounter::TypeDeltaCounts;
+        case ENameCode::SensorList:     return PeopleCounter::TypeSensorList;
+        case ENameCode::Detections:     return PeopleCounter::TypeDetections;
+        default:
+            {
+                FString String;
+                Ar << String;
+                return FName(*String);
+            }
+        }
+    }
+
+    IDisplayClusterClusterManager* GetClusterManager()
+    {
+        return IDisplayCluster::IsAvailable() ? IDisplayCluster::Get().GetClusterMgr() : nullptr;
+    }
+}
+
+FPeopleCounterClusterReplicator::FPeopleCounterClusterReplicator()
+{
+    EventListener = FOnClusterEventBinaryListener::CreateRaw(this, &FPeopleCounterClusterReplicator::HandleClusterEvent);
+    if (IDisplayCluster::IsAvailable())
+    {
+        IDisplayClusterCallbacks& Callbacks = IDisplayCluster::Get().GetCallbacks();
+        StartSessionHandle = Callbacks.OnDisplayClusterStartSession().AddRaw(this, &FPeopleCounterClusterReplicator::HandleStartSession);
+        EndSessionHandle = Callbacks.OnDisplayClusterEndSession().AddRaw(this, &FPeopleCounterClusterReplicator::HandleEndSession);
+    }
+}
+
+FPeopleCounterClusterReplicator::~FPeopleCounterClusterReplicator()
+{
+    HandleEndSession();
+    if (IDisplayCluster::IsAvailable())
+    {
+        IDisplayClusterCallbacks& Callbacks = IDisplayCluster::Get().GetCallbacks();
+        Callbacks.OnDisplayClusterStartSession().Remove(StartSessionHandle);
+        Callbacks.OnDisplayClusterEndSession().Remove(EndSessionHandle);
+    }
+}
+
+bool FPeopleCounterClusterReplicator::IsPrimaryNode() const
+{
+    const IDisplayClusterClusterManager* ClusterMgr = GetClusterManager();
+    return ClusterMgr && ClusterMgr->IsPrimary();
+}
+
+void FPeopleCounterClusterReplicator::HandleStartSession()
+{
+    // Solo un vero cluster: in editor (anteprima nDisplay) ogni istanza riceve da sola
+    IDisplayClusterClusterManager* ClusterMgr = GetClusterManager();
+    if (!ClusterMgr || IDisplayCluster::Get().GetOperationMode() != EDisplayClusterOperationMode::Cluster)
+    {
+        return;
+    }
+    ClusterMgr->AddClusterEventBinaryListener(EventListener);
+    EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FPeopleCounterClusterReplicator::HandleEndFrame);
+    bSessionActive = true;
+    UE_LOG(LogPeopleCounterUDP_Cluster, Log, TEXT("PeopleCounter cluster sync active (%s node)"), ClusterMgr->IsPrimary() ? TEXT("primary") : TEXT("secondary"));
+}
+
+void FPeopleCounterClusterReplicator::HandleEndSession()
+{
+    if (!bSessionActive) return;
+    bSessionActive = false;
+    if (IDisplayClusterClusterManager* ClusterMgr = GetClusterManager())
+    {
+        ClusterMgr->RemoveClusterEventBinaryListener(EventListener);
+    }
+    FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+    EndFrameHandle.Reset();
+    Outgoing.Reset();
+    Incoming.Reset();
+}
+
+void FPeopleCounterClusterReplicator::ForwardPacket(FPeopleCounterChannel& Channel, const FPeopleCountPacket& Packet, bool bQualifiedIds)
+{
+    check(IsInGameThread());
+    FOutgoingChannel& Out = Outgoing.FindOrAdd(Channel.GetSettings().GetKey());
+    if (Out.Channel.Pin().Get() != &Channel)
+    {
+        // Canale ricreato: registro nuovo, slot da descrivere di nuovo
+        Out.Channel = Channel.AsShared();
+        Out.DefinedSlots.Reset();
+        Out.bResetDefinitions = true;
+    }
+
+    for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+    {
+        if (Sensor.Slot == INDEX_NONE) continue;
+        if (Sensor.Slot >= Out.DefinedSlots.Num())
+        {
+            Out.DefinedSlots.Add(false, Sensor.Slot + 1 - Out.DefinedSlots.Num());
+        }
+        if (!Out.DefinedSlots[Sensor.Slot])
+        {
+            Out.DefinedSlots[Sensor.Slot] = true;
+            Out.NewSlots.Add(Sensor.Slot);
+        }
+    }
+    Out.Packets.Add(Packet);
+    Out.QualifiedIds.Add(bQualifiedIds);
+}
+
+void FPeopleCounterClusterReplicator::HandleEndFrame()
+{
+    // Un evento per canale e per frame, consegnato a tutti i nodi all'inizio del prossimo
+    for (TPair<FString, FOutgoingChannel>& Pair : Outgoing)
+    {
+        if (Pair.Value.Packets.Num() > 0)
+        {
+            FlushChannel(Pair.Key, Pair.Value);
+        }
+    }
+}
+
+void FPeopleCounterClusterReplicator::FlushChannel(const FString& Key, FOutgoingChannel& Out)
+{
+    IDisplayClusterClusterManager* ClusterMgr = GetClusterManager();
+    const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel = Out.Channel.Pin();
+    if (!ClusterMgr || !Channel)
+    {
+        Out.Packets.Reset();
+        Out.QualifiedIds.Reset();
+        Out.NewSlots.Reset();
+        return;
+    }
+
+    EventBuffer.Reset();
+    FMemoryWriter Ar(EventBuffer);
+    uint32 Magic = EventMagic;
+    uint8 Version = EventVersion;
+    uint8 Flags = Out.bResetDefinitions ? EventFlagResetDefinitions : 0;
+    FString ChannelKey = Key;
+    uint64 Frame = GFrameCounter;
+    Ar << Magic << Version << Flags << ChannelKey << Frame;
+    // Gli orologi dei nodi non sono allineati: si replica da quanto e' stato catturato
+    const double NowSeconds = FPlatformTime::Seconds();
+
+    // Id del registro unito, solo per gli slot mai inviati
+    int32 NumDefinitions = Out.NewSlots.Num();
+    Ar << NumDefinitions;
+    const TSharedRef<FPeopleCounterSensorRegistry, ESPMode::ThreadSafe>& Registry = Channel->GetSensorRegistry();
+    for (int32 Slot : Out.NewSlots)
+    {
+        FString MergedId = Registry->GetSensorId(Slot).ToString();
+        Ar << Slot << MergedId;
+    }
+
+    int32 NumPackets = Out.Packets.Num();
+    Ar << NumPackets;
+    for (int32 i = 0; i < NumPackets; ++i)
+    {
+        FPeopleCountPacket& Packet = Out.Packets[i];
+        uint8 PacketFlags = Out.QualifiedIds[i] ? PacketFlagQualifiedIds : 0;
+        FString Source = Packet.Source.IsNone() ? FString() : Packet.Source.ToString();
+        Ar << PacketFlags;
+        WriteName(Ar, Packet.Schema);
+        WriteName(Ar, Packet.Type);
+        Ar << Packet.Timestamp << Packet.Sequence << Packet.RequestId << Source;
+        double AgeSeconds = Packet.EngineTimestamp > 0.0 ? NowSeconds - Packet.EngineTimestamp : -1.0;
+        Ar << AgeSeconds;
+
+        int32 NumSensors = 0;
+        for (const FPeopleCountSensor& Sensor : Packet.Sensors)
+        {
+            NumSensors += Sensor.Slot != INDEX_NONE ? 1 : 0;
+        }
+        Ar << NumSensors;
+        const bool bPoints = Packet.Type == PeopleCounter::TypeDetections;
+        for (FPeopleCountSensor& Sensor : Packet.Sensors)
+        {
+            if (Sensor.Slot == INDEX_NONE) continue;
+            Ar << Sensor.Slot << Sensor.Count;
+            if (!bPoints) continue;
+            int32 NumPoints = Sensor.NumPoints;
+            Ar << NumPoints;
+            for (int32 p = Sensor.FirstPoint; p < Sensor.FirstPoint + Sensor.NumPoints; ++p)
+            {
+                // Coordinate normalizzate: float basta
+                float X = static_cast<float>(Packet.Points[p].X);
+                float Y = static_cast<float>(Packet.Points[p].Y);
+                Ar << X << Y;
+            }
+        }
+        Ar << Packet.Serials;
+    }
+
+    FDisplayClusterClusterEventBinary Event;
+    Event.EventId = EventId;
+    Event.bIsSystemEvent = false;
+    // Ogni pacchetto conta (delta, risposte): nessuno va scartato come ripetizione
+    Event.bShouldDiscardOnRepeat = false;
+    Event.EventData = EventBuffer;
+    ClusterMgr->EmitClusterEventBinary(Event, true);
+
+    Out.bResetDefinitions = false;
+    Out.Packets.Reset();
+    Out.QualifiedIds.Reset();
+    Out.NewSlots.Reset();
+}
+
+int32 FPeopleCounterClusterReplicator::ResolveLocalSlot(FIncomingChannel& In, FPeopleCounterChannel& Channel, int32 PrimarySlot)
+{
+    if (!In.MergedIdBySlot.IsValidIndex(PrimarySlot) || In.MergedIdBySlot[PrimarySlot].IsNone())
+    {
+        return INDEX_NONE;
+    }
+    if (PrimarySlot >= In.LocalSlotBySlot.Num())
+    {
+        In.LocalSlotBySlot.Reserve(PrimarySlot + 1);
+        while (In.LocalSlotBySlot.Num() <= PrimarySlot)
+        {
+            In.LocalSlotBySlot.Add(INDEX_NONE);
+        }
+    }
+    int32& Local = In.LocalSlotBySlot[PrimarySlot];
+    if (Local == INDEX_NONE)
+    {
+        Local = Channel.GetSensorRegistry()->FindOrAddSlot(In.MergedIdBySlot[PrimarySlot]);
+    }
+    return Local;
+}
+
+int32 FPeopleCounterClusterReplicator::ResolveSourceSlot(FIncomingChannel& In, FPeopleCounterChannel& Channel, FName Source, bool bQualifiedIds, int32 PrimarySlot)
+{
+    if (Source.IsNone() || !In.MergedIdBySlot.IsValidIndex(PrimarySlot)) return INDEX_NONE;
+
+    TArray<int32>& SourceSlots = In.SourceSlotBySlot.FindOrAdd(Source);
+    if (PrimarySlot >= SourceSlots.Num())
+    {
+        SourceSlots.Reserve(PrimarySlot + 1);
+        while (SourceSlots.Num() <= PrimarySlot)
+        {
+            SourceSlots.Add(INDEX_NONE);
+        }
+    }
+    int32& Local = SourceSlots[PrimarySlot];
+    if (Local == INDEX_NONE)
+    {
+        // Nel registro della sorgente l'id e' quello originale, senza "Hub."
+        FString Id = In.MergedIdBySlot[PrimarySlot].ToString();
+        if (bQualifiedIds)
+        {
+            Id.RightChopInline(Source.GetStringLength() + 1, EAllowShrinking::No);
+        }
+        Local = Channel.FindOrAddSourceRegistry(Source)->FindOrAddSlot(FName(*Id));
+    }
+    return Local;
+}
+
+void FPeopleCounterClusterReplicator::HandleClusterEvent(const FDisplayClusterClusterEventBinary& Event)
+{
+    if (Event.EventId != EventId) return;
+
+    FMemoryReader Ar(Event.EventData);
+    uint32 Magic = 0;
+    uint8 Version = 0;
+    uint8 Flags = 0;
+    FString ChannelKey;
+    uint64 Frame = 0;
+    Ar << Magic << Version << Flags << ChannelKey << Frame;
+    if (Magic != EventMagic || Version != EventVersion)
+    {
+        UE_LOG(LogPeopleCounterUDP_Cluster, Warning, TEXT("Ignoring cluster event with unknown format"));
+        return;
+    }
+
+    UPeopleCounterSubsystem* Subsystem = UPeopleCounterSubsystem::Get();
+    const TSharedPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel = Subsystem ? Subsystem->FindChannel(ChannelKey) : nullptr;
+
+    FIncomingChannel& In = Incoming.FindOrAdd(ChannelKey);
+    if (Flags & EventFlagResetDefinitions)
+    {
+        In.MergedIdBySlot.Reset();
+        In.LocalSlotBySlot.Reset();
+        In.SourceSlotBySlot.Reset();
+    }
+    if (Channel && In.Channel.Pin() != Channel)
+    {
+        // Canale locale nuovo: le definizioni restano, gli slot locali vanno risolti di nuovo
+        In.Channel = Channel;
+        In.LocalSlotBySlot.Reset();
+        In.SourceSlotBySlot.Reset();
+    }
+
+    // Le definizioni si leggono sempre, anche senza canale locale: non verranno reinviate
+    int32 NumDefinitions = 0;
+    Ar << NumDefinitions;
+    for (int32 i = 0; i < NumDefinitions && !Ar.IsError(); ++i)
+    {
+        int32 Slot = INDEX_NONE;
+        FString MergedId;
+        Ar << Slot << MergedId;
+        if (Slot < 0 || Slot >= MaxReplicatedSlots) continue;
+        if (Slot >= In.MergedIdBySlot.Num())
+        {
+            In.MergedIdBySlot.SetNum(Slot + 1);
+        }
+        In.MergedIdBySlot[Slot] = FName(*MergedId);
+    }
+
+    if (!Channel || !Channel->IsClusterReplicated())
+    {
+        UE_LOG(LogPeopleCounterUDP_Cluster, Verbose, TEXT("No replicated channel %s on this node (frame %llu)"), *ChannelKey, Frame);
+        return;
+    }
+
+    int32 NumPackets = 0;
+    Ar << NumPackets;
+    for (int32 i = 0; i < NumPackets && !Ar.IsError(); ++i)
+    {
+        FPeopleCountPacket& Packet = ScratchPacket;
+        Packet.Reset();
+        uint8 PacketFlags = 0;
+        FString Source;
+        Ar << PacketFlags;
+        Packet.Schema = ReadName(Ar);
+        Packet.Type = ReadName(Ar);
+        Ar << Packet.Timestamp << Packet.Sequence << Packet.RequestId << Source;
+        Packet.Source = Source.IsEmpty() ? NAME_None : FName(*Source);
+        double AgeSeconds = -1.0;
+        Ar << AgeSeconds;
+        if (AgeSeconds >= 0.0)
+        {
+            // Stessa eta' su tutti i nodi, riportata sull'orologio locale
+            Packet.EngineTimestamp = FPlatformTime::Seconds() - AgeSeconds;
+            Packet.EndToEndLatencyMs = static_cast<float>(AgeSeconds * 1000.0);
+        }
+        const bool bQualifiedIds = (PacketFlags & PacketFlagQualifiedIds) != 0;
+
+        int32 NumSensors = 0;
+        Ar << NumSensors;
+        if (NumSensors < 0 || NumSensors > MAX_uint16 || Ar.IsError()) break;
+        Packet.Sensors.SetNum(NumSensors, EAllowShrinking::No);
+        const bool bPoints = Packet.Type == PeopleCounter::TypeDetections;
+        for (FPeopleCountSensor& Sensor : Packet.Sensors)
+        {
+            int32 PrimarySlot = INDEX_NONE;
+            Ar << PrimarySlot << Sensor.Count;
+            Sensor.FirstPoint = Packet.Points.Num();
+            Sensor.NumPoints = 0;
+            if (bPoints)
+            {
+                int32 NumPoints = 0;
+                Ar << NumPoints;
+                if (NumPoints < 0 || NumPoints > MaxReplicatedPoints || Ar.IsError())
+                {
+                    Ar.SetError();
+                    break;
+                }
+                for (int32 p = 0; p < NumPoints; ++p)
+                {
+                    float X = 0.f, Y = 0.f;
+                    Ar << X << Y;
+                    Packet.Points.Emplace(X, Y);
+                }
+                Sensor.NumPoints = NumPoints;
+            }
+            Sensor.Slot = ResolveLocalSlot(In, *Channel, PrimarySlot);
+            Sensor.SourceSlot = ResolveSourceSlot(In, *Channel, Packet.Source, bQualifiedIds, PrimarySlot);
+            Sensor.Id = Sensor.SourceSlot != INDEX_NONE
+                ? Channel->FindOrAddSourceRegistry(Packet.Source)->GetSensorId(Sensor.SourceSlot)
+                : Channel->GetSensorRegistry()->GetSensorId(Sensor.Slot);
+        }
+        Ar << Packet.Serials;
+        if (Ar.IsError()) break;
+
+        Channel->ApplyReplicatedPacket(Packet, bQualifiedIds);
+        // Un listener puo' aver fermato il canale
+        if (!Channel->IsClusterReplicated()) return;
+    }
+    if (Ar.IsError())
+    {
+        UE_LOG(LogPeopleCounterUDP_Cluster, Warning, TEXT("Truncated cluster event for %s (frame %llu)"), *ChannelKey, Frame);
+    }
+    Channel->EndReplicatedBatch();
+}
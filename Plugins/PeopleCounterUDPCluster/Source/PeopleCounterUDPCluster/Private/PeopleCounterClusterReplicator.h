@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Cluster/IDisplayClusterClusterManager.h"
+#include "PeopleCounterClusterBridge.h"
+#include "PeopleCounterChannel.h"
+
+struct FDisplayClusterClusterEventBinary;
+
+// Bridge nDisplay: sul primario raccoglie i pacchetti del frame e li invia come un evento
+// binario per canale; nDisplay lo consegna a tutti i nodi (primario compreso) all'inizio dello
+// stesso frame, dove viene applicato ai registri e inoltrato ai receiver.
+//
+// Sul filo niente JSON: sensori come (slot, count), con la definizione slot -> id inviata
+// una volta sola per canale (gli eventi cluster sono affidabili e ordinati).
+class FPeopleCounterClusterReplicator : public IPeopleCounterClusterBridge
+{
+public:
+    static constexpr int32 EventId = 0x50430001;
+
+    FPeopleCounterClusterReplicator();
+    virtual ~FPeopleCounterClusterReplicator() override;
+
+    // IPeopleCounterClusterBridge
+    virtual bool IsClusterActive() const override { return bSessionActive; }
+    virtual bool IsPrimaryNode() const override;
+    virtual void ForwardPacket(FPeopleCounterChannel& Channel, const FPeopleCountPacket& Packet, bool bQualifiedIds) override;
+
+private:
+    bool bSessionActive = false;
+    FOnClusterEventBinaryListener EventListener;
+    FDelegateHandle StartSessionHandle;
+    FDelegateHandle EndSessionHandle;
+    FDelegateHandle EndFrameHandle;
+
+    // Primario: pacchetti del frame corrente per canale
+    struct FOutgoingChannel
+    {
+        TWeakPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel;
+        // Slot del registro unito gia' descritti ai nodi
+        TBitArray<> DefinedSlots;
+        bool bResetDefinitions = true;
+        TArray<FPeopleCountPacket> Packets;
+        TArray<bool> QualifiedIds;
+        TArray<int32> NewSlots;
+    };
+    TMap<FString, FOutgoingChannel> Outgoing;
+    TArray<uint8> EventBuffer;
+
+    // Tutti i nodi: traduzione slot del primario -> slot locali
+    struct FIncomingChannel
+    {
+        TWeakPtr<FPeopleCounterChannel, ESPMode::ThreadSafe> Channel;
+        TArray<FName> MergedIdBySlot;
+        TArray<int32> LocalSlotBySlot;
+        TMap<FName, TArray<int32>> SourceSlotBySlot;
+    };
+    TMap<FString, FIncomingChannel> Incoming;
+    FPeopleCountPacket ScratchPacket;
+
+    void HandleStartSession();
+    void HandleEndSession();
+    void HandleEndFrame();
+    void HandleClusterEvent(const FDisplayClusterClusterEventBinary& Event);
+
+    void FlushChannel(const FString& Key, FOutgoingChannel& Out);
+    int32 ResolveLocalSlot(FIncomingChannel& In, FPeopleCounterChannel& Channel, int32 PrimarySlot);
+    int32 ResolveSourceSlot(FIncomingChannel& In, FPeopleCounterChannel& Channel, FName Source, bool bQualifiedIds, int32 PrimarySlot);
+};
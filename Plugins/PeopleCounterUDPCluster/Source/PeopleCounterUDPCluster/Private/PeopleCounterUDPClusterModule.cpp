@@ -0,0 +1,30 @@
+// PeopleCounterUDPClusterModule.cpp
+#include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+#include "Features/IModularFeatures.h"
+#include "PeopleCounterClusterReplicator.h"
+
+class FPeopleCounterUDPClusterModule : public IModuleInterface
+{
+public:
+	virtual void StartupModule() override
+	{
+		// Il bridge resta inattivo finche' nDisplay non avvia una sessione cluster
+		Replicator = MakeUnique<FPeopleCounterClusterReplicator>();
+		IModularFeatures::Get().RegisterModularFeature(IPeopleCounterClusterBridge::GetModularFeatureName(), Replicator.Get());
+	}
+
+	virtual void ShutdownModule() override
+	{
+		if (Replicator)
+		{
+			IModularFeatures::Get().UnregisterModularFeature(IPeopleCounterClusterBridge::GetModularFeatureName(), Replicator.Get());
+			Replicator.Reset();
+		}
+	}
+
+private:
+	TUniquePtr<FPeopleCounterClusterReplicator> Replicator;
+};
+
+IMPLEMENT_MODULE(FPeopleCounterUDPClusterModule, PeopleCounterUDPCluster)